@@ -16,7 +16,7 @@ using namespace rime;
 static void rime_sample_initialize() {
   LOG(INFO) << "registering components from module 'sample'.";
   Registry& r = Registry::instance();
-  r.Register("trivial_translator", new Component<sample::TrivialTranslator>);
+  r.Register<Component<sample::TrivialTranslator>>("trivial_translator");
 }
 
 static void rime_sample_finalize() {
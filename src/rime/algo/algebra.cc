@@ -5,12 +5,13 @@
 // 2012-01-19 GONG Chen <chen.sst@gmail.com>
 //
 #include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <rime/task_scheduler.h>
 #include <rime/algo/algebra.h>
 #include <rime/algo/calculus.h>
 
 #include <nvtx3/nvtx3.hpp>
-#include <omp.h>
 
 namespace rime {
 
@@ -124,84 +125,76 @@ bool Projection::Apply(Script* value) {
   if (!value || value->empty())
     return false;
 
-  const int n_threads = omp_get_max_threads();
-  const int keys_per_thread = value->size() / n_threads;
-
-  map<string, vector<Spelling>>::const_iterator thread_start[n_threads + 1];
-
+  // calculations apply to each spelling independently, so the script is split
+  // into chunks, each of which goes through all the rounds in a parallel task.
+  // chunks are cut at a fixed size rather than per thread, so that the merged
+  // result is the same with any number of threads.
+  const size_t kSyllablesPerChunk = 64;
+  size_t num_chunks =
+      (value->size() + kSyllablesPerChunk - 1) / kSyllablesPerChunk;
+  vector<Script> chunks(num_chunks);
   auto it = value->begin();
-  for (int i = 0; i < n_threads; ++i) {
-    thread_start[i] = it;
-
-    if (i == n_threads - 1)
-      thread_start[i + 1] = value->end();
-    else
-      std::advance(it, keys_per_thread);
+  for (auto& chunk : chunks) {
+    for (size_t k = 0; k < kSyllablesPerChunk && it != value->end();
+         ++k, ++it) {
+      chunk.insert(chunk.end(), *it);
+    }
   }
 
-  Script *thread_script[n_threads];
-  bool modified = false;
-
-  bool error = false;
-
-  #pragma omp parallel
-  {
-    int thread_id = omp_get_thread_num();
-  
-    Script *local_script = reinterpret_cast<Script *>(
-      new map<string, vector<Spelling>>(thread_start[thread_id], thread_start[thread_id + 1])
-    );
-
-    thread_script[thread_id] = local_script;
-
-    int round = 0;
-
-    for (an<Calculation>& x : calculation_) {
-      if (error)
-        break;
-
-      ++round;
-      DLOG(INFO) << "round #" << round;
-
-      nvtx3::event_attributes attr{"Round", nvtx3::rgb{0, 0, 172}, nvtx3::payload{local_script->size()}};
-      nvtx3::scoped_range r{attr};
-
-      Script new_script;
-      for (const Script::value_type& v : *local_script) {
-        Spelling s(v.first);
-        bool applied = false;
-        try {
-          applied = x->Apply(&s);
-        } catch (std::runtime_error& e) {
-          LOG(ERROR) << "Error applying calculation: " << e.what();
-          error = true;
-        }
-        if (applied) {
-          modified = true;
-          if (!x->deletion()) {
-            new_script.Merge(v.first, SpellingProperties(), v.second);
-          }
-          if (x->addition() && !s.str.empty()) {
-            new_script.Merge(s.str, s.properties, v.second);
+  std::atomic<bool> modified{false};
+  std::atomic<bool> error{false};
+  ParallelFor(
+      num_chunks,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          Script& local_script(chunks[i]);
+          int round = 0;
+          for (an<Calculation>& x : calculation_) {
+            if (error)
+              return;
+            ++round;
+            DLOG(INFO) << "round #" << round;
+
+            nvtx3::event_attributes attr{"Round", nvtx3::rgb{0, 0, 172}, nvtx3::payload{local_script.size()}};
+            nvtx3::scoped_range r{attr};
+
+            Script new_script;
+            for (const Script::value_type& v : local_script) {
+              Spelling s(v.first);
+              bool applied = false;
+              try {
+                applied = x->Apply(&s);
+              } catch (std::runtime_error& e) {
+                LOG(ERROR) << "Error applying calculation: " << e.what();
+                error = true;
+                return;
+              }
+              if (applied) {
+                modified = true;
+                if (!x->deletion()) {
+                  new_script.Merge(v.first, SpellingProperties(), v.second);
+                }
+                if (x->addition() && !s.str.empty()) {
+                  new_script.Merge(s.str, s.properties, v.second);
+                }
+              } else {
+                new_script.Merge(v.first, SpellingProperties(), v.second);
+              }
+            }
+            local_script.swap(new_script);
           }
-        } else {
-          new_script.Merge(v.first, SpellingProperties(), v.second);
         }
-      }
-      local_script->swap(new_script);
-    }
-
-  } // end omp parallel
+      },
+      1);
 
   if (error)
     return false;
 
   if (modified) {
-    // Merge all thread scripts
-
+    // merge the chunks in their original order
     Script new_value;
-    for (int i = 0; i < n_threads; ++i) {
-      for (const Script::value_type& v : *thread_script[i]) {
+    for (const auto& chunk : chunks) {
+      for (const Script::value_type& v : chunk) {
         new_value.Merge(v.first, SpellingProperties(), v.second);
       }
     }
@@ -209,7 +202,7 @@ bool Projection::Apply(Script* value) {
   }
 
   LOG(INFO) << "Total Size: " << value->size();
-  
+
   return modified;
 }
 
@@ -10,9 +10,7 @@
 
 #include <boost/regex.hpp>
 #include <rime_api.h>
-#include <boost/lockfree/stack.hpp>
-
-#include <tuple>
+#include <rime/common.h>
 
 namespace rime {
 
@@ -46,8 +44,6 @@ class Encoder {
   virtual bool EncodePhrase(const string& phrase, const string& value) = 0;
 
   void set_collector(PhraseCollector* collector) { collector_ = collector; }
-  
-  std::vector<std::tuple<string, string, string>> pending_entries;
 
  protected:
   PhraseCollector* collector_;
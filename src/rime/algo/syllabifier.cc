@@ -29,6 +29,8 @@ int Syllabifier::BuildSyllableGraph(const string& input,
     return 0;
 
   size_t farthest = 0;
+  size_t num_edges = 0;
+  bool windowed = false;
   VertexQueue queue;
   queue.push(Vertex{0, kNormalSpelling});  // start
 
@@ -39,6 +41,13 @@ int Syllabifier::BuildSyllableGraph(const string& input,
 
     // record a visit to the vertex
     if (graph->vertices.find(current_pos) == graph->vertices.end()) {
+      // vertices are visited in the order of position
+      if ((max_vertices_ && graph->vertices.size() >= max_vertices_) ||
+          (max_edges_ && num_edges >= max_edges_)) {
+        DLOG(INFO) << "syllable graph limits reached at " << current_pos;
+        windowed = true;
+        break;
+      }
       graph->vertices.insert(vertex);  // preferred spelling type comes first
     } else {
       //      graph->vertices[current_pos] =
@@ -134,9 +143,17 @@ int Syllabifier::BuildSyllableGraph(const string& input,
         DLOG(INFO) << "added to syllable graph, edge: [" << current_pos << ", "
                    << end_pos << ")";
       }
+      for (const auto& spellings : end_vertices) {
+        num_edges += spellings.second.size();
+      }
     }
   }
 
+  if (windowed) {
+    // the window ends at the last visited vertex
+    graph->edges.erase(farthest);
+  }
+
   DLOG(INFO) << "remove stale vertices and edges";
   set<int> good;
   good.insert(farthest);
@@ -187,7 +204,7 @@ int Syllabifier::BuildSyllableGraph(const string& input,
     good.insert(i);
   }
 
-  if (enable_completion_ && farthest < input.length()) {
+  if (enable_completion_ && !windowed && farthest < input.length()) {
     DLOG(INFO) << "completion enabled";
     const size_t kExpandSearchLimit = 512;
     vector<Prism::Match> keys;
@@ -56,6 +56,13 @@ class Syllabifier {
                                   Prism& prism,
                                   SyllableGraph* graph);
   RIME_API void EnableCorrection(Corrector* corrector);
+  // caps the size of the graph against pathological input; 0 for no limit.
+  // syllabification stops at the first vertex beyond the limits, leaving
+  // the rest of the input uninterpreted, to be syllabified in later rounds.
+  void SetLimits(size_t max_vertices, size_t max_edges) {
+    max_vertices_ = max_vertices;
+    max_edges_ = max_edges;
+  }
 
  protected:
   void CheckOverlappedSpellings(SyllableGraph* graph, size_t start, size_t end);
@@ -65,6 +72,9 @@ class Syllabifier {
   bool enable_completion_ = false;
   bool strict_spelling_ = false;
   Corrector* corrector_ = nullptr;
+  size_t max_vertices_ = 0;
+  // counted by syllables spelled on each edge
+  size_t max_edges_ = 0;
 };
 
 }  // namespace rime
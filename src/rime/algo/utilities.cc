@@ -39,6 +39,10 @@ void ChecksumComputer::ProcessFile(const string& file_name) {
   crc_.process_bytes(file_content.data(), file_content.length());
 }
 
+void ChecksumComputer::ProcessString(const string& content) {
+  crc_.process_bytes(content.data(), content.length());
+}
+
 uint32_t ChecksumComputer::Checksum() {
   return crc_.checksum();
 }
@@ -19,6 +19,7 @@ class ChecksumComputer {
  public:
   explicit ChecksumComputer(uint32_t initial_remainder = 0);
   void ProcessFile(const string& file_name);
+  void ProcessString(const string& content);
   uint32_t Checksum();
 
  private:
@@ -171,16 +171,37 @@ ConfigComponentBase::ConfigComponentBase(ResourceResolver* resource_resolver)
 
 ConfigComponentBase::~ConfigComponentBase() {}
 
+ResourceResolver* ConfigComponentBase::CreateSharedResourceResolver(
+    function<ResourceResolver*()> create) {
+  ServiceScope scope(&Service::shared_instance());
+  return create();
+}
+
 Config* ConfigComponentBase::Create(const string& file_name) {
   return new Config(GetConfigData(file_name));
 }
 
 an<ConfigData> ConfigComponentBase::GetConfigData(const string& file_name) {
-  auto config_id = resource_resolver_->ToResourceId(file_name);
+  // tenants look for user files in their own user data dir
+  the<ResourceResolver> tenant_resolver;
+  if (Service::instance().is_tenant())
+    tenant_resolver.reset(CreateResourceResolver());
+  ResourceResolver* resolver =
+      tenant_resolver ? tenant_resolver.get() : resource_resolver_.get();
+  auto config_id = resolver->ToResourceId(file_name);
+  auto file_path = resolver->ResolvePath(config_id).string();
+  std::lock_guard<std::mutex> lock(mutex_);
+  int deployment_count =
+      Service::shared_instance().deployer().deployment_count();
+  if (deployment_count != deployment_count_) {
+    // configs still in use by existing sessions stay loaded for them
+    cache_.clear();
+    deployment_count_ = deployment_count;
+  }
   // keep a weak reference to the shared config data in the component
-  weak<ConfigData>& wp(cache_[config_id]);
+  weak<ConfigData>& wp(cache_[file_path]);
   if (wp.expired()) {  // create a new copy and load it
-    auto data = LoadConfig(config_id);
+    auto data = LoadConfig(resolver, config_id);
     wp = data;
     return data;
   }
@@ -188,6 +209,19 @@ an<ConfigData> ConfigComponentBase::GetConfigData(const string& file_name) {
   return wp.lock();
 }
 
+size_t ConfigComponentBase::GetCacheStats(size_t* memory_usage) const {
+  size_t num_configs = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : cache_) {
+    if (auto data = entry.second.lock()) {
+      ++num_configs;
+      if (memory_usage)
+        *memory_usage += data->EstimateMemoryUsage();
+    }
+  }
+  return num_configs;
+}
+
 an<ConfigData> ConfigLoader::LoadConfig(ResourceResolver* resource_resolver,
                                         const string& config_id) {
   auto data = New<ConfigData>();
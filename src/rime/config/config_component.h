@@ -8,6 +8,7 @@
 #define RIME_CONFIG_COMPONENT_H_
 
 #include <iostream>
+#include <mutex>
 #include <type_traits>
 #include <rime/common.h>
 #include <rime/component.h>
@@ -93,14 +94,28 @@ class ConfigComponentBase : public Config::Component {
   RIME_API ConfigComponentBase(ResourceResolver* resource_resolver);
   RIME_API virtual ~ConfigComponentBase();
   RIME_API Config* Create(const string& file_name);
+  // counts the config data in use and estimates their total heap usage
+  RIME_API size_t GetCacheStats(size_t* memory_usage) const;
 
  protected:
-  virtual an<ConfigData> LoadConfig(const string& config_id) = 0;
+  virtual an<ConfigData> LoadConfig(ResourceResolver* resource_resolver,
+                                    const string& config_id) = 0;
+  // creates a resolver for the service of the tenant in scope
+  virtual ResourceResolver* CreateResourceResolver() const = 0;
+  // the component is shared by all tenants, so the resolver it keeps is
+  // created for the process-wide service, whichever tenant is in scope.
+  RIME_API static ResourceResolver* CreateSharedResourceResolver(
+      function<ResourceResolver*()> create);
   the<ResourceResolver> resource_resolver_;
 
  private:
   an<ConfigData> GetConfigData(const string& file_name);
+  // configs are loaded by sessions and the deployer concurrently
+  mutable std::mutex mutex_;
+  // keyed by file path, so that tenants share the same deployed configs
   map<string, weak<ConfigData>> cache_;
+  // the configs in the cache were deployed before this deployment count
+  int deployment_count_ = 0;
 };
 
 template <class Loader, class ResourceProvider = ConfigResourceProvider>
@@ -108,18 +123,28 @@ class ConfigComponent : public ConfigComponentBase {
  public:
   ConfigComponent(const ResourceType& resource_type =
                       ResourceProvider::kDefaultResourceType)
-      : ConfigComponentBase(
-            ResourceProvider::CreateResourceResolver(resource_type)) {}
+      : ConfigComponentBase(CreateSharedResourceResolver([&] {
+          return ResourceProvider::CreateResourceResolver(resource_type);
+        })),
+        resource_type_(resource_type) {}
   ConfigComponent(function<void(Loader* loader)> setup)
-      : ConfigComponentBase(ResourceProvider::CreateResourceResolver(
-            ResourceProvider::kDefaultResourceType)) {
+      : ConfigComponentBase(CreateSharedResourceResolver([] {
+          return ResourceProvider::CreateResourceResolver(
+              ResourceProvider::kDefaultResourceType);
+        })),
+        resource_type_(ResourceProvider::kDefaultResourceType) {
     setup(&loader_);
   }
 
  private:
-  an<ConfigData> LoadConfig(const string& config_id) override {
-    return loader_.LoadConfig(resource_resolver_.get(), config_id);
+  an<ConfigData> LoadConfig(ResourceResolver* resource_resolver,
+                            const string& config_id) override {
+    return loader_.LoadConfig(resource_resolver, config_id);
   }
+  ResourceResolver* CreateResourceResolver() const override {
+    return ResourceProvider::CreateResourceResolver(resource_type_);
+  }
+  ResourceType resource_type_;
   Loader loader_;
 };
 
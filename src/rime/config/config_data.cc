@@ -245,6 +245,38 @@ an<ConfigItem> ConfigData::Traverse(const string& path) {
   return p;
 }
 
+static size_t estimate_memory_usage(const an<ConfigItem>& node) {
+  if (!node)
+    return 0;
+  switch (node->type()) {
+    case ConfigItem::kScalar:
+      return sizeof(ConfigValue) + As<ConfigValue>(node)->str().size();
+    case ConfigItem::kList: {
+      auto list = As<ConfigList>(node);
+      size_t size = sizeof(ConfigList) + list->size() * sizeof(an<ConfigItem>);
+      for (auto it = list->begin(); it != list->end(); ++it) {
+        size += estimate_memory_usage(*it);
+      }
+      return size;
+    }
+    case ConfigItem::kMap: {
+      auto map = As<ConfigMap>(node);
+      size_t size = sizeof(ConfigMap);
+      for (auto it = map->begin(); it != map->end(); ++it) {
+        size += sizeof(ConfigMap::Map::value_type) + it->first.size() +
+                estimate_memory_usage(it->second);
+      }
+      return size;
+    }
+    default:
+      return sizeof(ConfigItem);
+  }
+}
+
+size_t ConfigData::EstimateMemoryUsage() const {
+  return sizeof(ConfigData) + estimate_memory_usage(root);
+}
+
 an<ConfigItem> ConvertFromYaml(const YAML::Node& node,
                                ConfigCompiler* compiler) {
   if (YAML::NodeType::Null == node.Type()) {
@@ -25,6 +25,8 @@ class ConfigData {
   bool SaveToFile(const string& file_name);
   bool TraverseWrite(const string& path, an<ConfigItem> item);
   an<ConfigItem> Traverse(const string& path);
+  // approximates the heap usage of the config tree
+  size_t EstimateMemoryUsage() const;
 
   static vector<string> SplitPath(const string& path);
   static string JoinPath(const vector<string>& keys);
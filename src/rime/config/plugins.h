@@ -52,9 +52,6 @@ class BuildInfoPlugin : public ConfigCompilerPlugin {
   Review ReviewLinkOutput;
 };
 
-class ResourceResolver;
-struct ResourceType;
-
 class SaveOutputPlugin : public ConfigCompilerPlugin {
  public:
   SaveOutputPlugin();
@@ -62,9 +59,6 @@ class SaveOutputPlugin : public ConfigCompilerPlugin {
 
   Review ReviewCompileOutput;
   Review ReviewLinkOutput;
-
- private:
-  the<ResourceResolver> resource_resolver_;
 };
 
 }  // namespace rime
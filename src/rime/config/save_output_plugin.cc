@@ -13,9 +13,7 @@ namespace rime {
 
 static const ResourceType kCompiledConfig = {"compiled_config", "", ".yaml"};
 
-SaveOutputPlugin::SaveOutputPlugin()
-    : resource_resolver_(
-          Service::instance().CreateStagingResourceResolver(kCompiledConfig)) {}
+SaveOutputPlugin::SaveOutputPlugin() {}
 
 SaveOutputPlugin::~SaveOutputPlugin() {}
 
@@ -26,7 +24,11 @@ bool SaveOutputPlugin::ReviewCompileOutput(ConfigCompiler* compiler,
 
 bool SaveOutputPlugin::ReviewLinkOutput(ConfigCompiler* compiler,
                                         an<ConfigResource> resource) {
-  auto file_path = resource_resolver_->ResolvePath(resource->resource_id);
+  // resolved on each save, as the output directory changes with staged
+  // maintenance
+  the<ResourceResolver> resource_resolver(
+      Service::instance().CreateStagingResourceResolver(kCompiledConfig));
+  auto file_path = resource_resolver->ResolvePath(resource->resource_id);
   return resource->data->SaveToFile(file_path.string());
 }
 
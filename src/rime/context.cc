@@ -4,6 +4,7 @@
 //
 // 2011-05-08 GONG Chen <chen.sst@gmail.com>
 //
+#include <atomic>
 #include <utility>
 #include <rime/candidate.h>
 #include <rime/context.h>
@@ -12,6 +13,19 @@
 
 namespace rime {
 
+// stamps are unique across contexts, so that the stamps of the context of
+// another engine differ from those last seen of the current one
+static std::atomic<int> g_last_stamp{0};
+
+static int NextStamp() {
+  return ++g_last_stamp;
+}
+
+Context::Context()
+    : composition_stamp_(NextStamp()),
+      highlight_stamp_(NextStamp()),
+      option_stamp_(NextStamp()) {}
+
 bool Context::Commit() {
   if (!IsComposing())
     return false;
@@ -67,6 +81,7 @@ bool Context::PushInput(char ch) {
     input_.insert(caret_pos_, 1, ch);
     ++caret_pos_;
   }
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
   return true;
 }
@@ -79,6 +94,7 @@ bool Context::PushInput(const string& str) {
     input_.insert(caret_pos_, str);
     caret_pos_ += str.length();
   }
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
   return true;
 }
@@ -88,6 +104,7 @@ bool Context::PopInput(size_t len) {
     return false;
   caret_pos_ -= len;
   input_.erase(caret_pos_, len);
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
   return true;
 }
@@ -96,6 +113,7 @@ bool Context::DeleteInput(size_t len) {
   if (caret_pos_ + len > input_.length())
     return false;
   input_.erase(caret_pos_, len);
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
   return true;
 }
@@ -104,6 +122,7 @@ void Context::Clear() {
   input_.clear();
   caret_pos_ = 0;
   composition_.clear();
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
 }
 
@@ -115,12 +134,24 @@ bool Context::Select(size_t index) {
     seg.selected_index = index;
     seg.status = Segment::kSelected;
     DLOG(INFO) << "Selected: '" << cand->text() << "', index = " << index;
+    composition_stamp_ = NextStamp();
     select_notifier_(this);
     return true;
   }
   return false;
 }
 
+bool Context::Highlight(size_t index) {
+  if (composition_.empty())
+    return false;
+  Segment& seg(composition_.back());
+  if (seg.selected_index != index) {
+    seg.selected_index = index;
+    highlight_stamp_ = NextStamp();
+  }
+  return true;
+}
+
 bool Context::DeleteCandidate(
     function<an<Candidate>(Segment& seg)> get_candidate) {
   if (composition_.empty())
@@ -159,6 +190,7 @@ bool Context::ConfirmCurrentSelection() {
     }
     // confirm raw input
   }
+  composition_stamp_ = NextStamp();
   select_notifier_(this);
   return true;
 }
@@ -170,6 +202,7 @@ bool Context::ConfirmPreviousSelection() {
     }
     if (it->status == Segment::kSelected) {
       it->status = Segment::kConfirmed;
+      composition_stamp_ = NextStamp();
       return true;
     }
   }
@@ -182,6 +215,7 @@ bool Context::ReopenPreviousSegment() {
         composition_.back().status >= Segment::kSelected) {
       composition_.back().Reopen(caret_pos());
     }
+    composition_stamp_ = NextStamp();
     update_notifier_(this);
     return true;
   }
@@ -207,6 +241,7 @@ bool Context::ReopenPreviousSelection() {
         composition_.pop_back();
       }
       it->Reopen(caret_pos());
+      composition_stamp_ = NextStamp();
       update_notifier_(this);
       return true;
     }
@@ -223,6 +258,7 @@ bool Context::ClearNonConfirmedComposition() {
   }
   if (reverted) {
     composition_.Forward();
+    composition_stamp_ = NextStamp();
     DLOG(INFO) << "composition: " << composition_.GetDebugText();
   }
   return reverted;
@@ -230,6 +266,7 @@ bool Context::ClearNonConfirmedComposition() {
 
 bool Context::RefreshNonConfirmedComposition() {
   if (ClearNonConfirmedComposition()) {
+    composition_stamp_ = NextStamp();
     update_notifier_(this);
     return true;
   }
@@ -241,21 +278,25 @@ void Context::set_caret_pos(size_t caret_pos) {
     caret_pos_ = input_.length();
   else
     caret_pos_ = caret_pos;
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
 }
 
 void Context::set_composition(Composition&& comp) {
   composition_ = std::move(comp);
+  composition_stamp_ = NextStamp();
 }
 
 void Context::set_input(const string& value) {
   input_ = value;
   caret_pos_ = input_.length();
+  composition_stamp_ = NextStamp();
   update_notifier_(this);
 }
 
 void Context::set_option(const string& name, bool value) {
   options_[name] = value;
+  option_stamp_ = NextStamp();
   option_update_notifier_(this, name);
 }
 
@@ -292,4 +333,14 @@ void Context::ClearTransientOptions() {
   }
 }
 
+void Context::SwapNotifiers(Notifiers* notifiers) {
+  commit_notifier_.swap(notifiers->commit);
+  select_notifier_.swap(notifiers->select);
+  update_notifier_.swap(notifiers->update);
+  delete_notifier_.swap(notifiers->del);
+  option_update_notifier_.swap(notifiers->option_update);
+  property_update_notifier_.swap(notifiers->property_update);
+  unhandled_key_notifier_.swap(notifiers->unhandled_key);
+}
+
 }  // namespace rime
@@ -25,7 +25,7 @@ class RIME_API Context {
   using KeyEventNotifier =
       signal<void(Context* ctx, const KeyEvent& key_event)>;
 
-  Context() = default;
+  Context();
   ~Context() = default;
 
   bool Commit();
@@ -44,6 +44,9 @@ class RIME_API Context {
 
   // return false if there is no candidate at index
   bool Select(size_t index);
+  // moves the highlight in the menu of the last segment to the candidate at
+  // index, which should have been prepared by the menu
+  bool Highlight(size_t index);
   bool DeleteCandidate(size_t index);
   // return false if there's no candidate for current segment
   bool ConfirmCurrentSelection();
@@ -72,10 +75,19 @@ class RIME_API Context {
   bool get_option(const string& name) const;
   void set_property(const string& name, const string& value);
   string get_property(const string& name) const;
+  const map<string, bool>& options() const { return options_; }
+  const map<string, string>& properties() const { return properties_; }
   // options and properties starting with '_' are local to schema;
   // others are session scoped.
   void ClearTransientOptions();
 
+  // Stamps of the last changes to the input and composition, to the
+  // highlighted candidate and to the options. A stamp is never reused,
+  // even by another context.
+  int composition_stamp() const { return composition_stamp_; }
+  int highlight_stamp() const { return highlight_stamp_; }
+  int option_stamp() const { return option_stamp_; }
+
   Notifier& commit_notifier() { return commit_notifier_; }
   Notifier& select_notifier() { return select_notifier_; }
   Notifier& update_notifier() { return update_notifier_; }
@@ -88,6 +100,21 @@ class RIME_API Context {
   }
   KeyEventNotifier& unhandled_key_notifier() { return unhandled_key_notifier_; }
 
+  // the notifiers with the slots connected to them
+  struct Notifiers {
+    Notifier commit;
+    Notifier select;
+    Notifier update;
+    Notifier del;
+    OptionUpdateNotifier option_update;
+    PropertyUpdateNotifier property_update;
+    KeyEventNotifier unhandled_key;
+  };
+  // exchanges the notifiers of the context with the given ones, so as to
+  // detach the slots connected by a set of components and attach them back
+  // later.
+  void SwapNotifiers(Notifiers* notifiers);
+
  private:
   string GetSoftCursor() const;
   bool DeleteCandidate(function<an<Candidate>(Segment& seg)> get_candidate);
@@ -98,6 +125,9 @@ class RIME_API Context {
   CommitHistory commit_history_;
   map<string, bool> options_;
   map<string, string> properties_;
+  int composition_stamp_;
+  int highlight_stamp_;
+  int option_stamp_;
 
   Notifier commit_notifier_;
   Notifier select_notifier_;
@@ -20,26 +20,26 @@ static void rime_core_initialize() {
   LOG(INFO) << "registering core components.";
   Registry& r = Registry::instance();
 
-  auto config_builder =
-      new ConfigComponent<ConfigBuilder>([&](ConfigBuilder* builder) {
-        builder->InstallPlugin(new AutoPatchConfigPlugin);
-        builder->InstallPlugin(new DefaultConfigPlugin);
-        builder->InstallPlugin(new LegacyPresetConfigPlugin);
-        builder->InstallPlugin(new LegacyDictionaryConfigPlugin);
-        builder->InstallPlugin(new BuildInfoPlugin);
-        builder->InstallPlugin(new SaveOutputPlugin);
-      });
-  r.Register("config_builder", config_builder);
-
-  auto config_loader =
-      new ConfigComponent<ConfigLoader, DeployedConfigResourceProvider>;
-  r.Register("config", config_loader);
-  r.Register("schema", new SchemaComponent(config_loader));
-
-  auto user_config =
-      new ConfigComponent<ConfigLoader, UserConfigResourceProvider>(
-          [](ConfigLoader* loader) { loader->set_auto_save(true); });
-  r.Register("user_config", user_config);
+  r.Register("config_builder", [] {
+    return new ConfigComponent<ConfigBuilder>([](ConfigBuilder* builder) {
+      builder->InstallPlugin(new AutoPatchConfigPlugin);
+      builder->InstallPlugin(new DefaultConfigPlugin);
+      builder->InstallPlugin(new LegacyPresetConfigPlugin);
+      builder->InstallPlugin(new LegacyDictionaryConfigPlugin);
+      builder->InstallPlugin(new BuildInfoPlugin);
+      builder->InstallPlugin(new SaveOutputPlugin);
+    });
+  });
+
+  r.Register<ConfigComponent<ConfigLoader, DeployedConfigResourceProvider>>(
+      "config");
+  r.Register("schema",
+             [] { return new SchemaComponent(Config::Require("config")); });
+
+  r.Register("user_config", [] {
+    return new ConfigComponent<ConfigLoader, UserConfigResourceProvider>(
+        [](ConfigLoader* loader) { loader->set_auto_save(true); });
+  });
 }
 
 static void rime_core_finalize() {
@@ -4,14 +4,86 @@
 //
 // 2011-12-01 GONG Chen <chen.sst@gmail.com>
 //
+#include <algorithm>
 #include <chrono>
 #include <exception>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <typeinfo>
 #include <utility>
 #include <filesystem>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <rime/algo/utilities.h>
 #include <rime/deployer.h>
+#include <rime/task_scheduler.h>
+
+namespace fs = std::filesystem;
 
 namespace rime {
 
+static fs::path generation_path(const string& staging_dir,
+                                const char* suffix) {
+  fs::path path(staging_dir);
+  if (!path.has_filename())
+    path = path.parent_path();
+  path += suffix;
+  return path;
+}
+
+// published in staging_dir by the process that deployed it
+static const char* kManifestFile = "deployment.manifest";
+
+// file locks do not exclude the threads of the owner process
+static std::timed_mutex g_deployment_mutex;
+
+DeploymentLock::DeploymentLock(Deployer* deployer)
+    : lock_file_(generation_path(deployer->staging_dir, ".lock").string()),
+      timeout_seconds_(deployer->lock_timeout()),
+      thread_lock_(g_deployment_mutex, std::defer_lock) {}
+
+DeploymentLock::~DeploymentLock() {
+  if (locked_)
+    lock_->unlock();
+}
+
+bool DeploymentLock::Acquire(bool* waited) {
+  bool dummy;
+  if (!waited)
+    waited = &dummy;
+  *waited = false;
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::seconds(timeout_seconds_);
+  if (!thread_lock_.try_lock()) {
+    LOG(INFO) << "waiting for another thread to finish deploying.";
+    *waited = true;
+    if (!thread_lock_.try_lock_until(deadline))
+      return false;
+  }
+  try {
+    // the lock file must exist, and is never written to; closing another
+    // handle to the file would release the lock on some systems.
+    std::ofstream(lock_file_, std::ios::app).close();
+    lock_.reset(new boost::interprocess::file_lock(lock_file_.c_str()));
+    while (!lock_->try_lock()) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        thread_lock_.unlock();
+        return false;
+      }
+      if (!*waited) {
+        LOG(INFO) << "waiting for another process to finish deploying.";
+        *waited = true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    locked_ = true;
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "deploying without lock " << lock_file_ << ": "
+                 << ex.what();
+  }
+  return true;
+}
+
 Deployer::Deployer()
     : shared_data_dir("."),
       user_data_dir("."),
@@ -35,7 +107,11 @@ bool Deployer::RunTask(const string& task_name, TaskInitializer arg) {
     LOG(ERROR) << "error creating deployment task: " << task_name;
     return false;
   }
-  return t->Run(this);
+  resource_path_index_.Suspend();
+  bool success = t->Run(this);
+  resource_path_index_.Resume();
+  ++deployment_count_;
+  return success;
 }
 
 bool Deployer::ScheduleTask(const string& task_name, TaskInitializer arg) {
@@ -78,9 +154,36 @@ bool Deployer::HasPendingTasks() {
 bool Deployer::Run() {
   LOG(INFO) << "running deployment tasks:";
   message_sink_("deploy", "start");
+  // processes sharing the staging dir deploy one at a time
+  DeploymentLock lock(this);
+  if (!lock.Acquire()) {
+    LOG(ERROR) << "timed out waiting for another process deploying to "
+               << staging_dir;
+    while (NextTask())
+      ;
+    message_sink_("deploy", "failure");
+    return false;
+  }
+  const string fingerprint = Fingerprint();
+  // whether or not we waited for it, another process may have deployed the
+  // same sources since
+  if (AdoptPublishedResults(fingerprint)) {
+    message_sink_("deploy", "success");
+    ++deployment_count_;
+    return true;
+  }
+  // not valid until the tasks are done
+  std::error_code ec;
+  fs::remove(fs::path(staging_dir) / kManifestFile, ec);
+  resource_path_index_.Suspend();
   int success = 0;
   int failure = 0;
   do {
+    bool staged = staged_ && PrepareGeneration();
+    if (staged_ && !staged) {
+      // the service stops serving sessions until the tasks are done
+      staged_ = false;
+    }
     while (auto task = NextTask()) {
       try {
         if (task->Run(this))
@@ -93,21 +196,134 @@ bool Deployer::Run() {
       }
       // boost::this_thread::interruption_point();
     }
+    if (staged && !ActivateGeneration())
+      ++failure;
     LOG(INFO) << success + failure << " tasks ran: " << success << " success, "
               << failure << " failure.";
     message_sink_("deploy", !failure ? "success" : "failure");
     // new tasks could have been enqueued while we were sending the message.
     // before quitting, double check if there is nothing left to do.
   } while (HasPendingTasks());
+  resource_path_index_.Resume();
+  if (!failure)
+    PublishResults(fingerprint);
+  ++deployment_count_;
   return !failure;
 }
 
-bool Deployer::StartWork(bool maintenance_mode) {
+// identifies the pending tasks with their arguments, and the files in the
+// data directories they may read
+string Deployer::Fingerprint() {
+  vector<string> sources;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto tasks = pending_tasks_; !tasks.empty(); tasks.pop()) {
+      const auto& task = *tasks.front();
+      sources.push_back(string(typeid(task).name()) + ' ' + task.arguments());
+    }
+  }
+  auto normal = [](const string& dir) {
+    std::error_code ec;
+    return fs::absolute(dir, ec).lexically_normal();
+  };
+  // written by deployments, not read by them
+  const fs::path staging = normal(staging_dir);
+  const set<fs::path> outputs = {
+      staging,
+      normal(generation_path(staging_dir, ".next").string()),
+      normal(generation_path(staging_dir, ".old").string()),
+      normal(generation_path(staging_dir, ".lock").string()),
+      normal(sync_dir),
+  };
+  set<fs::path> data_dirs = {normal(user_data_dir), normal(shared_data_dir)};
+  // usually the staging dir of the distribution
+  const fs::path prebuilt = normal(prebuilt_data_dir);
+  if (!outputs.count(prebuilt))
+    data_dirs.insert(prebuilt);
+  for (const auto& dir : data_dirs) {
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      const fs::path& file = it->path();
+      std::error_code file_ec;
+      if (it->is_directory(file_ec)) {
+        // user dictionaries are updated by typing, not by deployments
+        if (outputs.count(file.lexically_normal()) ||
+            file.extension() == ".userdb" || file.filename() == "trash")
+          it.disable_recursion_pending();
+        continue;
+      }
+      if (!it->is_regular_file(file_ec) ||
+          outputs.count(file.lexically_normal()))
+        continue;
+      // updated by every deployment
+      if (it.depth() == 0 && (file.filename() == "installation.yaml" ||
+                              file.filename() == "user.yaml"))
+        continue;
+      std::ostringstream source;
+      source << file.string() << ' ' << it->file_size(file_ec) << ' '
+             << it->last_write_time(file_ec).time_since_epoch().count();
+      sources.push_back(source.str());
+    }
+  }
+  std::sort(sources.begin(), sources.end());
+  ChecksumComputer cc;
+  for (const auto& source : sources) {
+    cc.ProcessString(source + '\n');
+  }
+  return std::to_string(cc.Checksum());
+}
+
+// skips the pending tasks if another process has just deployed them with
+// the same source files
+bool Deployer::AdoptPublishedResults(const string& fingerprint) {
+  std::ifstream manifest((fs::path(staging_dir) / kManifestFile).string());
+  string line;
+  const string key = "fingerprint: ";
+  while (std::getline(manifest, line)) {
+    if (line.compare(0, key.length(), key) != 0)
+      continue;
+    if (line.substr(key.length()) != fingerprint)
+      return false;
+    int count = 0;
+    while (NextTask())
+      ++count;
+    LOG(INFO) << "adopted deployment by another process; skipped " << count
+              << " tasks.";
+    return true;
+  }
+  return false;
+}
+
+void Deployer::PublishResults(const string& fingerprint) {
+  const fs::path manifest = fs::path(staging_dir) / kManifestFile;
+  fs::path temp = manifest;
+  temp += ".tmp";
+  std::error_code ec;
+  fs::create_directories(staging_dir, ec);
+  {
+    std::ofstream out(temp.string());
+    out << "fingerprint: " << fingerprint << "\n"
+        << "deployed_at: " << time(NULL) << "\n";
+    if (!out) {
+      LOG(ERROR) << "error writing " << temp;
+      return;
+    }
+  }
+  // replaced as a whole, so readers never see a partial manifest
+  fs::rename(temp, manifest, ec);
+  if (ec) {
+    LOG(ERROR) << "error publishing " << manifest << ": " << ec.message();
+  }
+}
+
+bool Deployer::StartWork(bool maintenance_mode, bool staged) {
   if (IsWorking()) {
     LOG(WARNING) << "a work thread is already running.";
     return false;
   }
   maintenance_mode_ = maintenance_mode;
+  staged_ = maintenance_mode && staged && CanStage();
   if (pending_tasks_.empty()) {
     return false;
   }
@@ -117,7 +333,7 @@ bool Deployer::StartWork(bool maintenance_mode) {
 #else
   LOG(INFO) << "starting work thread for " << pending_tasks_.size()
             << " tasks.";
-  work_ = std::async(std::launch::async, [this] { Run(); });
+  work_ = TaskScheduler::instance().Async([this] { Run(); });
   return work_.valid();
 #endif
 }
@@ -126,6 +342,10 @@ bool Deployer::StartMaintenance() {
   return StartWork(true);
 }
 
+bool Deployer::StartStagedMaintenance() {
+  return StartWork(true, true);
+}
+
 bool Deployer::IsWorking() {
   if (!work_.valid())
     return false;
@@ -147,7 +367,137 @@ void Deployer::JoinMaintenanceThread() {
 }
 
 string Deployer::user_data_sync_dir() const {
-  return (std::filesystem::path(sync_dir) / user_id).string();
+  return (fs::path(sync_dir) / user_id).string();
+}
+
+string Deployer::output_dir() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return output_dir_.empty() ? staging_dir : output_dir_;
+}
+
+bool Deployer::CanStage() {
+  // the staging directory is replaced as a whole, so it must not be the
+  // same directory as the source data.
+  if (staging_dir.empty())
+    return false;
+  for (const auto& dir : {user_data_dir, shared_data_dir}) {
+    std::error_code ec;
+    if (fs::equivalent(staging_dir, dir, ec))
+      return false;
+  }
+  return true;
+}
+
+bool Deployer::PrepareGeneration() {
+  const fs::path active(staging_dir);
+  const fs::path next = generation_path(staging_dir, ".next");
+  std::error_code ec;
+  fs::remove_all(next, ec);
+  fs::create_directories(next, ec);
+  if (ec) {
+    LOG(ERROR) << "error creating directory " << next << ": " << ec.message();
+    return false;
+  }
+  // start from a copy of the active generation, so that up-to-date files are
+  // not rebuilt. binary files are replaced rather than rewritten by the
+  // deployer, so both generations can share them.
+  fs::directory_iterator it, end;
+  if (fs::exists(active, ec))
+    it = fs::directory_iterator(active, ec);
+  for (; !ec && it != end; it.increment(ec)) {
+    const fs::path& source = it->path();
+    const fs::path target = next / source.filename();
+    std::error_code copy_ec;
+    if (it->is_symlink()) {
+      fs::copy_symlink(source, target, copy_ec);
+    } else if (!it->is_regular_file()) {
+      continue;
+    } else if (source.extension() != ".bin" ||
+               (fs::create_hard_link(source, target, copy_ec), copy_ec)) {
+      copy_ec.clear();
+      fs::copy_file(source, target, copy_ec);
+    }
+    if (copy_ec) {
+      LOG(ERROR) << "error copying " << source << ": " << copy_ec.message();
+      fs::remove_all(next, ec);
+      return false;
+    }
+  }
+  if (ec) {
+    LOG(ERROR) << "error reading directory " << active << ": " << ec.message();
+    fs::remove_all(next, ec);
+    return false;
+  }
+  LOG(INFO) << "building new generation in " << next;
+  std::lock_guard<std::mutex> lock(mutex_);
+  output_dir_ = next.string();
+  return true;
+}
+
+bool Deployer::ActivateGeneration() {
+  const fs::path active(staging_dir);
+  const fs::path next(output_dir());
+  const fs::path retired = generation_path(staging_dir, ".old");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_dir_.clear();
+  }
+  std::error_code ec;
+  fs::remove_all(retired, ec);
+  bool swapped = false;
+  {
+    std::unique_lock<std::shared_mutex> lock(generation_mutex_);
+    bool had_active = fs::exists(active, ec);
+    if (had_active)
+      fs::rename(active, retired, ec);
+    if (!ec) {
+      fs::rename(next, active, ec);
+      swapped = !ec;
+      std::error_code ignored;
+      if (!swapped && had_active)
+        fs::rename(retired, active, ignored);
+    }
+    if (!swapped) {
+      // directories holding mapped files cannot be renamed on some systems;
+      // update the active generation file by file instead. files are never
+      // rewritten in place, where sessions may have them mapped: each is
+      // copied aside and renamed over the active one.
+      LOG(WARNING) << "error renaming " << next << ": " << ec.message();
+      ec.clear();
+      fs::create_directories(active, ec);
+      for (fs::directory_iterator it(next, ec), end; !ec && it != end;
+           it.increment(ec)) {
+        const fs::path target = active / it->path().filename();
+        fs::path temp = target;
+        temp += ".tmp";
+        fs::remove_all(temp, ec);
+        if (!ec)
+          fs::copy(it->path(), temp,
+                   fs::copy_options::recursive |
+                       fs::copy_options::copy_symlinks,
+                   ec);
+        if (!ec)
+          fs::rename(temp, target, ec);
+        if (ec) {
+          std::error_code ignored;
+          fs::remove_all(temp, ignored);
+          LOG(ERROR) << "error updating " << target << ": " << ec.message();
+        }
+      }
+      if (ec) {
+        LOG(ERROR) << "error updating " << active << ": " << ec.message();
+      }
+    }
+    // sessions created from now on load the new files
+    ++deployment_count_;
+  }
+  // mappings of the retired files held by sessions stay valid on removal.
+  std::error_code ignored;
+  fs::remove_all(swapped ? retired : next, ignored);
+  if (!swapped)
+    return !ec;
+  LOG(INFO) << "activated new generation of " << active;
+  return true;
 }
 
 }  // namespace rime
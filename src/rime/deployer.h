@@ -7,13 +7,22 @@
 #ifndef RIME_DEPLOYER_H_
 #define RIME_DEPLOYER_H_
 
+#include <atomic>
 #include <future>
 #include <mutex>
 #include <queue>
+#include <shared_mutex>
 #include <any>
 #include <rime/common.h>
 #include <rime/component.h>
 #include <rime/messenger.h>
+#include <rime/resource.h>
+
+namespace boost {
+namespace interprocess {
+class file_lock;
+}  // namespace interprocess
+}  // namespace boost
 
 namespace rime {
 
@@ -27,6 +36,9 @@ class DeploymentTask : public Class<DeploymentTask, TaskInitializer> {
   virtual ~DeploymentTask() = default;
 
   virtual bool Run(Deployer* deployer) = 0;
+  // the arguments the task was created with; tells apart the tasks of the
+  // same class when identifying a deployment
+  virtual string arguments() const { return string(); }
 };
 
 class Deployer : public Messenger {
@@ -55,21 +67,76 @@ class Deployer : public Messenger {
   bool HasPendingTasks();
 
   bool Run();
-  bool StartWork(bool maintenance_mode = false);
+  bool StartWork(bool maintenance_mode = false, bool staged = false);
   bool StartMaintenance();
+  // builds into a new generation of staging_dir, which replaces the active
+  // one when the tasks are done. sessions keep being served meanwhile.
+  bool StartStagedMaintenance();
   bool IsWorking();
   bool IsMaintenanceMode();
+  bool IsStaged() const { return staged_; }
   // the following two methods equally wait until all threads are joined
   void JoinWorkThread();
   void JoinMaintenanceThread();
 
   string user_data_sync_dir() const;
+  // where deployment tasks write compiled data: the generation being built
+  // during staged maintenance, otherwise staging_dir.
+  string output_dir();
+  // held shared while sessions load data files; the active generation is
+  // swapped under an exclusive lock.
+  std::shared_mutex& generation_mutex() { return generation_mutex_; }
+
+  // files in the data directories, known between deployments
+  ResourcePathIndex& resource_path_index() { return resource_path_index_; }
+  // number of times deployment tasks have run or a new generation of
+  // staging_dir was activated; components loaded before a deployment may be
+  // using outdated data.
+  int deployment_count() const { return deployment_count_; }
+  // seconds to wait for another process deploying to the same staging_dir
+  void set_lock_timeout(int seconds) { lock_timeout_ = seconds; }
+  int lock_timeout() const { return lock_timeout_; }
 
  private:
+  bool CanStage();
+  bool PrepareGeneration();
+  bool ActivateGeneration();
+  string Fingerprint();
+  bool AdoptPublishedResults(const string& fingerprint);
+  void PublishResults(const string& fingerprint);
+
   std::queue<of<DeploymentTask>> pending_tasks_;
   std::mutex mutex_;
   std::future<void> work_;
   bool maintenance_mode_ = false;
+  std::atomic<bool> staged_{false};
+  string output_dir_;
+  std::shared_mutex generation_mutex_;
+  ResourcePathIndex resource_path_index_;
+  std::atomic<int> deployment_count_{0};
+  int lock_timeout_ = 300;
+};
+
+// An advisory lock on a file shared by the processes deploying to the same
+// staging directory, held while deployment tasks run. The system releases
+// the lock when the owner process exits, so a crashed deployer never blocks
+// the others. Threads of the same process are serialized as well.
+class DeploymentLock {
+ public:
+  RIME_API explicit DeploymentLock(Deployer* deployer);
+  RIME_API ~DeploymentLock();
+
+  // returns false if another process holds the lock until the lock timeout
+  // of the deployer. deploys without the lock if the lock file is not
+  // usable.
+  RIME_API bool Acquire(bool* waited = nullptr);
+
+ private:
+  string lock_file_;
+  int timeout_seconds_;
+  the<boost::interprocess::file_lock> lock_;
+  bool locked_ = false;
+  std::unique_lock<std::timed_mutex> thread_lock_;
 };
 
 }  // namespace rime
@@ -0,0 +1,82 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <rime/algo/strings.h>
+#include <rime/dict/build_record.h>
+
+namespace rime {
+
+static const char kBuildRecordFormat[] = "Rime::BuildRecord/1.0";
+static const char kBuildRecordTrailer[] = ".";
+
+// The record is a text file. After the format line, a line holds the dict
+// file checksum and the entries checksum, separated by a tab. A trailer line
+// marks the end of a completely written file.
+
+bool BuildRecord::Load() {
+  dict_file_checksum_ = entries_checksum_ = 0;
+  std::ifstream fin(file_name_.c_str());
+  if (!fin)
+    return false;
+  string line;
+  if (!getline(fin, line) || line != kBuildRecordFormat) {
+    LOG(WARNING) << "invalid build record: " << file_name_;
+    return false;
+  }
+  uint32_t dict_file_checksum = 0;
+  uint32_t entries_checksum = 0;
+  bool valid = false;
+  if (getline(fin, line)) {
+    auto row = strings::split(line, "\t");
+    try {
+      if (row.size() == 2) {
+        dict_file_checksum = static_cast<uint32_t>(std::stoul(row[0]));
+        entries_checksum = static_cast<uint32_t>(std::stoul(row[1]));
+        valid = true;
+      }
+    } catch (...) {
+    }
+  }
+  // a file cut short misses the trailer
+  if (!valid || !getline(fin, line) || line != kBuildRecordTrailer) {
+    LOG(WARNING) << "corrupted build record: " << file_name_;
+    return false;
+  }
+  dict_file_checksum_ = dict_file_checksum;
+  entries_checksum_ = entries_checksum;
+  return true;
+}
+
+bool BuildRecord::Save() {
+  // written aside and renamed into place, so that a file is either complete
+  // or left as it was
+  const string temp_file = file_name_ + ".tmp";
+  std::ofstream fout(temp_file.c_str());
+  if (!fout) {
+    LOG(ERROR) << "failed to save build record: " << file_name_;
+    return false;
+  }
+  fout << kBuildRecordFormat << '\n';
+  fout << dict_file_checksum_ << '\t' << entries_checksum_ << '\n';
+  fout << kBuildRecordTrailer << '\n';
+  fout.close();
+  std::error_code ec;
+  if (!fout) {
+    LOG(ERROR) << "error writing build record: " << file_name_;
+    std::filesystem::remove(temp_file, ec);
+    return false;
+  }
+  std::filesystem::rename(temp_file, file_name_, ec);
+  if (ec) {
+    LOG(ERROR) << "error replacing build record " << file_name_ << ": "
+               << ec.message();
+    std::filesystem::remove(temp_file, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace rime
@@ -0,0 +1,41 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#ifndef RIME_BUILD_RECORD_H_
+#define RIME_BUILD_RECORD_H_
+
+#include <rime/common.h>
+
+namespace rime {
+
+// Remembers what a table was last built from, so that recompiling a
+// dictionary whose entries did not change, e.g. after an edit of comments,
+// can reuse the table instead of building it again.
+class BuildRecord {
+ public:
+  explicit BuildRecord(const string& file_name) : file_name_(file_name) {}
+
+  bool Load();
+  bool Save();
+
+  // the checksum of the dict files, and that of the entries collected from
+  // them
+  uint32_t dict_file_checksum() const { return dict_file_checksum_; }
+  uint32_t entries_checksum() const { return entries_checksum_; }
+  void set_checksums(uint32_t dict_file_checksum, uint32_t entries_checksum) {
+    dict_file_checksum_ = dict_file_checksum;
+    entries_checksum_ = entries_checksum;
+  }
+
+  const string& file_name() const { return file_name_; }
+
+ private:
+  string file_name_;
+  uint32_t dict_file_checksum_ = 0;
+  uint32_t entries_checksum_ = 0;
+};
+
+}  // namespace rime
+
+#endif  // RIME_BUILD_RECORD_H_
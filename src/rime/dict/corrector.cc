@@ -295,7 +295,7 @@ void CorrectorComponent::Unified::ToleranceSearch(const Prism& prism,
   }
 }
 CorrectorComponent::CorrectorComponent()
-    : resolver_(Service::instance().CreateDeployedResourceResolver(
+    : resolver_(Service::shared_instance().CreateDeployedResourceResolver(
           {"corrector", "", ".correction.bin"})) {}
 
 Corrector* CorrectorComponent::Create(const Ticket& ticket) noexcept {
@@ -6,6 +6,7 @@
 //
 #include <boost/algorithm/string.hpp>
 #include <filesystem>
+#include <mutex>
 #include <rime/common.h>
 #include <rime/resource.h>
 #include <rime/service.h>
@@ -23,21 +24,53 @@ bool DbAccessor::MatchesPrefix(const string& key) {
 
 static const ResourceType kDbResourceType = {"db", "", ""};
 
+// components are shared by all tenants; the resolver is for the process-wide
+// service even if a tenant instantiates the component.
 DbComponentBase::DbComponentBase()
-    : db_resource_resolver_(
-          Service::instance().CreateResourceResolver(kDbResourceType)) {}
+    : db_resource_resolver_(Service::shared_instance().CreateResourceResolver(
+          kDbResourceType)) {}
 
 DbComponentBase::~DbComponentBase() {}
 
 string DbComponentBase::DbFilePath(const string& name,
                                    const string& extension) const {
+  Service& service = Service::instance();
+  if (service.is_tenant()) {
+    // in the user data dir of the tenant
+    the<ResourceResolver> resolver(
+        service.CreateResourceResolver(kDbResourceType));
+    return resolver->ResolvePath(name + extension).string();
+  }
   return db_resource_resolver_->ResolvePath(name + extension).string();
 }
 
 // Db members
 
+// all db instances, for memory accounting
+static std::mutex g_dbs_mutex;
+static set<const Db*> g_dbs;
+
 Db::Db(const string& file_name, const string& name)
-    : name_(name), file_name_(file_name) {}
+    : name_(name), file_name_(file_name) {
+  std::lock_guard<std::mutex> lock(g_dbs_mutex);
+  g_dbs.insert(this);
+}
+
+Db::~Db() {
+  std::lock_guard<std::mutex> lock(g_dbs_mutex);
+  g_dbs.erase(this);
+}
+
+vector<DbStats> Db::GetStats() {
+  vector<DbStats> result;
+  std::lock_guard<std::mutex> lock(g_dbs_mutex);
+  for (const auto* db : g_dbs) {
+    if (!db->loaded())
+      continue;
+    result.push_back({db->name(), db->file_name(), db->memory_usage()});
+  }
+  return result;
+}
 
 bool Db::Exists() const {
   return std::filesystem::exists(file_name());
@@ -7,6 +7,7 @@
 #ifndef RIME_DB_H_
 #define RIME_DB_H_
 
+#include <atomic>
 #include <rime_api.h>
 #include <rime/common.h>
 #include <rime/component.h>
@@ -30,10 +31,17 @@ class DbAccessor {
   string prefix_;
 };
 
+struct DbStats {
+  string name;
+  string file_name;
+  // estimated size of data the db holds in memory
+  size_t memory_usage = 0;
+};
+
 class Db : public Class<Db, const string&> {
  public:
   Db(const string& file_name, const string& name);
-  virtual ~Db() = default;
+  RIME_API virtual ~Db();
 
   RIME_API bool Exists() const;
   RIME_API virtual bool Remove();
@@ -63,6 +71,10 @@ class Db : public Class<Db, const string&> {
   bool disabled() const { return disabled_; }
   void disable() { disabled_ = true; }
   void enable() { disabled_ = false; }
+  size_t memory_usage() const { return memory_usage_; }
+
+  // lists all dbs that are currently opened by the process
+  RIME_API static vector<DbStats> GetStats();
 
  protected:
   string name_;
@@ -70,6 +82,8 @@ class Db : public Class<Db, const string&> {
   bool loaded_ = false;
   bool readonly_ = false;
   bool disabled_ = false;
+  // maintained by implementations that cache data in memory
+  std::atomic<size_t> memory_usage_{0};
 };
 
 class Transactional {
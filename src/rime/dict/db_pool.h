@@ -16,8 +16,13 @@ class DbPool {
   an<T> GetDb(const string& db_name);
 
  protected:
+  // returns the db pooled under the key, or the one made by create()
+  an<T> GetDb(const string& key, function<an<T>()> create);
+
   the<ResourceResolver> resource_resolver_;
   map<string, weak<T>> db_pool_;
+  // the dbs in the pool were deployed before this deployment count
+  int deployment_count_ = 0;
 };
 
 }  // namespace rime
@@ -3,6 +3,7 @@
 
 #include "db_pool.h"
 #include <rime/resource.h>
+#include <rime/service.h>
 
 namespace rime {
 
@@ -12,11 +13,25 @@ DbPool<T>::DbPool(the<ResourceResolver> resource_resolver)
 
 template <class T>
 an<T> DbPool<T>::GetDb(const string& db_name) {
-  auto db = db_pool_[db_name].lock();
-  if (!db) {
+  return GetDb(db_name, [this, &db_name]() {
     auto file_path = resource_resolver_->ResolvePath(db_name).string();
-    db = New<T>(file_path);
-    db_pool_[db_name] = db;
+    return New<T>(file_path);
+  });
+}
+
+template <class T>
+an<T> DbPool<T>::GetDb(const string& key, function<an<T>()> create) {
+  int deployment_count =
+      Service::shared_instance().deployer().deployment_count();
+  if (deployment_count != deployment_count_) {
+    // outdated dbs stay open for the sessions using them
+    db_pool_.clear();
+    deployment_count_ = deployment_count;
+  }
+  auto db = db_pool_[key].lock();
+  if (!db) {
+    db = create();
+    db_pool_[key] = db;
   }
   return db;
 };
@@ -0,0 +1,250 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <boost/interprocess/mapped_region.hpp>
+#include <rime/service.h>
+#include <rime/dict/dict_bundle.h>
+
+namespace fs = std::filesystem;
+
+namespace rime {
+
+const char kBundleFormat[] = "Rime::Bundle/1.0";
+
+const char kBundleFormatPrefix[] = "Rime::Bundle/";
+const size_t kBundleFormatPrefixLen = sizeof(kBundleFormatPrefix) - 1;
+
+DictBundle::DictBundle(const string& file_name) : MappedFile(file_name) {}
+
+bool DictBundle::Load() {
+  LOG(INFO) << "loading dictionary bundle: " << file_name();
+
+  if (IsOpen())
+    Close();
+
+  if (!OpenReadOnly()) {
+    LOG(ERROR) << "Error opening dictionary bundle '" << file_name() << "'.";
+    return false;
+  }
+  return LoadMetadata();
+}
+
+bool DictBundle::LoadMetadata() {
+  metadata_ = Find<bundle::Metadata>(0);
+  if (!metadata_ || file_size() < sizeof(bundle::Metadata) ||
+      strncmp(metadata_->format, kBundleFormatPrefix,
+              kBundleFormatPrefixLen)) {
+    LOG(ERROR) << "invalid metadata.";
+    metadata_ = nullptr;
+    Close();
+    return false;
+  }
+  auto* sections = metadata_->sections.get();
+  if (!sections || reinterpret_cast<char*>(sections->end()) >
+                       address() + file_size()) {
+    LOG(ERROR) << "sections not found.";
+    metadata_ = nullptr;
+    Close();
+    return false;
+  }
+  for (const auto& section : *sections) {
+    if (size_t(section.offset) + section.size > file_size()) {
+      LOG(ERROR) << "section '" << section.name << "' is out of range.";
+      metadata_ = nullptr;
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DictBundle::Build(const vector<pair<string, string>>& section_files,
+                       uint32_t dict_file_checksum,
+                       uint32_t schema_file_checksum) {
+  LOG(INFO) << "building dictionary bundle: " << file_name();
+  // readers never see a partially written bundle
+  DictBundle temp(file_name() + ".tmp");
+  if (!temp.Write(section_files, dict_file_checksum, schema_file_checksum) ||
+      !temp.Flush()) {
+    LOG(ERROR) << "Error building dictionary bundle '" << file_name() << "'.";
+    temp.Remove();
+    return false;
+  }
+  temp.Close();
+  if (IsOpen())
+    Close();
+  std::error_code ec;
+  fs::rename(temp.file_name(), file_name(), ec);
+  if (ec) {
+    LOG(ERROR) << "Error replacing dictionary bundle '" << file_name()
+               << "': " << ec.message();
+    temp.Remove();
+    return false;
+  }
+  return true;
+}
+
+bool DictBundle::Write(const vector<pair<string, string>>& section_files,
+                       uint32_t dict_file_checksum,
+                       uint32_t schema_file_checksum) {
+  if (section_files.empty())
+    return false;
+  const size_t page_size =
+      boost::interprocess::mapped_region::get_page_size();
+  auto page_aligned = [page_size](size_t size) {
+    return (size + page_size - 1) / page_size * page_size;
+  };
+  vector<size_t> sizes;
+  size_t header_size = sizeof(bundle::Metadata) +
+                       sizeof(Array<bundle::Section>) +
+                       sizeof(bundle::Section) * (section_files.size() - 1);
+  size_t total_size = page_aligned(header_size);
+  for (const auto& file : section_files) {
+    if (file.first.length() >= bundle::Section::kNameMaxLength) {
+      LOG(ERROR) << "section name too long: " << file.first;
+      return false;
+    }
+    std::error_code ec;
+    size_t size = fs::file_size(file.second, ec);
+    if (ec) {
+      LOG(ERROR) << "Error reading file '" << file.second << "'.";
+      return false;
+    }
+    sizes.push_back(size);
+    total_size = page_aligned(total_size) + size;
+  }
+  if (total_size > UINT32_MAX) {
+    LOG(ERROR) << "dictionary bundle too large: " << total_size;
+    return false;
+  }
+  // the capacity is exact; nothing is moved by growing the file
+  if (!Create(total_size)) {
+    LOG(ERROR) << "Error creating file '" << file_name() << "'.";
+    return false;
+  }
+  metadata_ = Allocate<bundle::Metadata>();
+  if (!metadata_) {
+    LOG(ERROR) << "Error creating metadata in file '" << file_name() << "'.";
+    return false;
+  }
+  metadata_->dict_file_checksum = dict_file_checksum;
+  metadata_->schema_file_checksum = schema_file_checksum;
+  metadata_->page_size = static_cast<uint32_t>(page_size);
+  auto* sections = CreateArray<bundle::Section>(section_files.size());
+  if (!sections) {
+    LOG(ERROR) << "Error creating section directory.";
+    return false;
+  }
+  metadata_->sections = sections;
+  for (size_t i = 0; i < section_files.size(); ++i) {
+    auto& section = sections->at[i];
+    std::strncpy(section.name, section_files[i].first.c_str(),
+                 bundle::Section::kNameMaxLength);
+    size_t used_space = file_size();
+    section.offset = static_cast<uint32_t>(page_aligned(used_space));
+    section.size = static_cast<uint32_t>(sizes[i]);
+    char* padding = Allocate<char>(section.offset - used_space + sizes[i]);
+    if (!padding) {
+      LOG(ERROR) << "Error allocating section '" << section.name << "'.";
+      return false;
+    }
+    std::ifstream in(section_files[i].second, std::ios::binary);
+    if (!in.read(address() + section.offset, sizes[i])) {
+      LOG(ERROR) << "Error reading file '" << section_files[i].second << "'.";
+      return false;
+    }
+  }
+  std::strncpy(metadata_->format, kBundleFormat,
+               bundle::Metadata::kFormatMaxLength);
+  return true;
+}
+
+const bundle::Section* DictBundle::FindSection(const string& name) const {
+  if (!metadata_)
+    return nullptr;
+  for (const auto& section : *metadata_->sections) {
+    if (!strncmp(section.name, name.c_str(), bundle::Section::kNameMaxLength))
+      return &section;
+  }
+  return nullptr;
+}
+
+bool DictBundle::HasSection(const string& name) const {
+  return FindSection(name) != nullptr;
+}
+
+bool DictBundle::Attach(const string& name, MappedFile* file) const {
+  const auto* section = FindSection(name);
+  if (!section || !file)
+    return false;
+  if (file->IsOpen())
+    file->Close();
+  file->bundle_ = file_;
+  file->section_offset_ = section->offset;
+  file->section_size_ = section->size;
+  return true;
+}
+
+uint32_t DictBundle::dict_file_checksum() const {
+  return metadata_ ? metadata_->dict_file_checksum : 0;
+}
+
+uint32_t DictBundle::schema_file_checksum() const {
+  return metadata_ ? metadata_->schema_file_checksum : 0;
+}
+
+// the bundles currently loaded by the process
+static std::mutex g_bundles_mutex;
+static map<string, weak<DictBundle>> g_bundles;
+// the mappings of the bundles, kept alive by the files attached to them
+static map<string, weak<MappedFileImpl>> g_bundle_mappings;
+// the bundles were deployed before this deployment count
+static int g_bundles_deployment_count = 0;
+
+an<DictBundle> DictBundle::Open(const string& file_name) {
+  std::lock_guard<std::mutex> lock(g_bundles_mutex);
+  int deployment_count =
+      Service::shared_instance().deployer().deployment_count();
+  if (deployment_count != g_bundles_deployment_count) {
+    // a bundle replaced by the deployment is opened anew
+    g_bundles.clear();
+    g_bundle_mappings.clear();
+    g_bundles_deployment_count = deployment_count;
+  }
+  auto bundle = g_bundles[file_name].lock();
+  if (!bundle) {
+    bundle = New<DictBundle>(file_name);
+    // files attached to the bundle may outlive it; their mapping is reused
+    // rather than mapping the file once more.
+    bool loaded = false;
+    if (auto mapping = g_bundle_mappings[file_name].lock()) {
+      bundle->file_ = mapping;
+      bundle->size_ = bundle->capacity();
+      loaded = bundle->LoadMetadata();
+    } else {
+      loaded = bundle->Exists() && bundle->Load();
+    }
+    if (!loaded) {
+      g_bundles.erase(file_name);
+      g_bundle_mappings.erase(file_name);
+      return nullptr;
+    }
+    g_bundles[file_name] = bundle;
+    g_bundle_mappings[file_name] = bundle->file_;
+  }
+  return bundle;
+}
+
+string DictBundle::BundleFileName(const string& prism_file_name) {
+  fs::path path(prism_file_name);
+  path.replace_extension("");
+  path.replace_extension(".bundle.bin");
+  return path.string();
+}
+
+}  // namespace rime
@@ -0,0 +1,77 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#ifndef RIME_DICT_BUNDLE_H_
+#define RIME_DICT_BUNDLE_H_
+
+#include <rime_api.h>
+#include <rime/common.h>
+#include <rime/dict/mapped_file.h>
+
+namespace rime {
+
+namespace bundle {
+
+struct Section {
+  static const int kNameMaxLength = 64;
+  char name[kNameMaxLength];
+  // page aligned
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct Metadata {
+  static const int kFormatMaxLength = 32;
+  char format[kFormatMaxLength];
+  // of all the sections, which are built from the same sources
+  uint32_t dict_file_checksum;
+  uint32_t schema_file_checksum;
+  uint32_t page_size;
+  OffsetPtr<Array<Section>> sections;
+};
+
+}  // namespace bundle
+
+// A compiled dictionary in a single file: the table, prism, reverse db and
+// packs of a schema are sections of the bundle, which is mapped into memory
+// once and shared by the files reading from its sections.
+class DictBundle : public MappedFile {
+ public:
+  RIME_API explicit DictBundle(const string& file_name);
+
+  RIME_API bool Load();
+  // copies the files into the sections named after them, and replaces the
+  // bundle file with the result in one go.
+  RIME_API bool Build(const vector<pair<string, string>>& section_files,
+                      uint32_t dict_file_checksum,
+                      uint32_t schema_file_checksum);
+
+  RIME_API bool HasSection(const string& name) const;
+  // the file is then read from the section with the bundle mapped in memory
+  // as long as the file is, and opens without accessing the file system.
+  RIME_API bool Attach(const string& name, MappedFile* file) const;
+
+  uint32_t dict_file_checksum() const;
+  uint32_t schema_file_checksum() const;
+
+  // a loaded bundle shared by the dictionary components, or null if the file
+  // does not exist or is invalid.
+  RIME_API static an<DictBundle> Open(const string& file_name);
+
+  // foo.prism.bin => foo.bundle.bin
+  static string BundleFileName(const string& prism_file_name);
+
+ private:
+  bool Write(const vector<pair<string, string>>& section_files,
+             uint32_t dict_file_checksum,
+             uint32_t schema_file_checksum);
+  bool LoadMetadata();
+  const bundle::Section* FindSection(const string& name) const;
+
+  bundle::Metadata* metadata_ = nullptr;
+};
+
+}  // namespace rime
+
+#endif  // RIME_DICT_BUNDLE_H_
@@ -8,9 +8,12 @@
 #include <cfloat>
 #include <cmath>
 #include <fstream>
+#include <sstream>
 #include <rime/algo/algebra.h>
 #include <rime/algo/utilities.h>
+#include <rime/dict/build_record.h>
 #include <rime/dict/corrector.h>
+#include <rime/dict/dict_bundle.h>
 #include <rime/dict/dict_compiler.h>
 #include <rime/dict/dict_settings.h>
 #include <rime/dict/dictionary.h>
@@ -21,6 +24,7 @@
 #include <rime/dict/table.h>
 #include <rime/resource.h>
 #include <rime/service.h>
+#include <rime/task_scheduler.h>
 
 #include <nvtx3/nvtx3.hpp>
 
@@ -28,6 +32,85 @@ namespace fs = std::filesystem;
 
 namespace rime {
 
+static fs::path relocate_target(const fs::path& source_path,
+                                ResourceResolver* target_resolver) {
+  auto resource_id = source_path.filename().string();
+  return target_resolver->ResolvePath(resource_id);
+}
+
+template <class T>
+static an<T> reopen_in_target(const an<T>& file,
+                              ResourceResolver* target_resolver) {
+  if (!file)
+    return file;
+  auto target_path = relocate_target(file->file_name(), target_resolver);
+  return New<T>(fs::exists(target_path) ? target_path.string()
+                                        : file->file_name());
+}
+
+// binds a copy of a compiled file to the checksum of the dict files
+template <class T>
+static bool copy_with_checksum(const fs::path& source_path,
+                               const fs::path& target_path,
+                               uint32_t dict_file_checksum) {
+  // the file can be shared with the data in use; don't modify it in place
+  fs::path temp_path(target_path.string() + ".tmp");
+  std::error_code ec;
+  fs::copy_file(source_path, temp_path, fs::copy_options::overwrite_existing,
+                ec);
+  if (ec) {
+    LOG(ERROR) << "error copying " << source_path << " to " << temp_path
+               << ": " << ec.message();
+    return false;
+  }
+  if (!T(temp_path.string()).SetDictFileChecksum(dict_file_checksum)) {
+    fs::remove(temp_path, ec);
+    return false;
+  }
+  fs::rename(temp_path, target_path, ec);
+  if (ec) {
+    LOG(ERROR) << "error replacing " << target_path << ": " << ec.message();
+    fs::remove(temp_path, ec);
+    return false;
+  }
+  return true;
+}
+
+// covers everything the table and the reverse db are built from
+static uint32_t compute_entries_checksum(const EntryCollector& collector,
+                                         DictSettings* settings) {
+  ChecksumComputer cc;
+  for (const auto& syllable : collector.syllabary) {
+    cc.ProcessString(syllable + '\n');
+  }
+  for (const auto& e : collector.entries) {
+    string line = e->text + '\t' + e->raw_code.ToString() + '\t';
+    line.append(reinterpret_cast<const char*>(&e->weight), sizeof(e->weight));
+    cc.ProcessString(line + '\n');
+  }
+  cc.ProcessString(std::to_string(collector.num_entries) + '\n');
+  map<string, const set<string>*> stems;
+  for (const auto& v : collector.stems) {
+    stems[v.first] = &v.second;
+  }
+  for (const auto& v : stems) {
+    string line = v.first;
+    for (const auto& code : *v.second) {
+      line += '\t' + code;
+    }
+    cc.ProcessString(line + '\n');
+  }
+  cc.ProcessString(settings->sort_order() + '\n' +
+                   std::to_string(settings->table_partitions()) + '\n');
+  if (settings->use_rule_based_encoder()) {
+    // saved in the reverse db
+    std::ostringstream yaml;
+    settings->SaveToStream(yaml);
+    cc.ProcessString(yaml.str());
+  }
+  return cc.Checksum();
+}
+
 DictCompiler::DictCompiler(Dictionary* dictionary)
     : dict_name_(dictionary->name()),
       packs_(dictionary->packs()),
@@ -36,7 +119,15 @@ DictCompiler::DictCompiler(Dictionary* dictionary)
       source_resolver_(
           Service::instance().CreateResourceResolver({"source_file", "", ""})),
       target_resolver_(Service::instance().CreateStagingResourceResolver(
-          {"target_file", "", ""})) {}
+          {"target_file", "", ""})) {
+  // the dictionary's own prism and tables can be in use by sessions, which
+  // keep running during staged maintenance; inspect and rebuild files via
+  // objects of our own, preferring the copies in the output directory.
+  prism_ = reopen_in_target(prism_, target_resolver_.get());
+  for (auto& table : tables_) {
+    table = reopen_in_target(table, target_resolver_.get());
+  }
+}
 
 DictCompiler::~DictCompiler() {}
 
@@ -86,6 +177,7 @@ bool DictCompiler::Compile(const string& schema_file) {
   nvtx3::scoped_range r{attr};
 
   LOG(INFO) << "compiling dictionary for " << schema_file;
+  stats_ = Stats();
   bool build_table_from_source = true;
   DictSettings settings;
   auto dict_file = source_resolver_->ResolvePath(dict_name_ + ".dict.yaml");
@@ -107,10 +199,18 @@ bool DictCompiler::Compile(const string& schema_file) {
       schema_file.empty() ? 0 : Checksum(schema_file);
   bool rebuild_table = false;
   bool rebuild_prism = false;
+  // the prism only depends on the syllabary of the table and the schema
+  Syllabary previous_syllabary;
+  uint32_t previous_checksum = 0;
+  bool prism_matches_table = false;
   const auto& primary_table = tables_[0];
+  // loading also validates the partitions of a partitioned table
   if (primary_table->Exists() && primary_table->Load()) {
+    previous_checksum = primary_table->dict_file_checksum();
     if (build_table_from_source) {
       rebuild_table = primary_table->dict_file_checksum() != dict_file_checksum;
+      if (rebuild_table)
+        primary_table->GetSyllabary(&previous_syllabary);
     } else {
       dict_file_checksum = primary_table->dict_file_checksum();
       LOG(INFO) << "reuse existing table: " << primary_table->file_name();
@@ -126,6 +226,10 @@ bool DictCompiler::Compile(const string& schema_file) {
   if (prism_->Exists() && prism_->Load()) {
     rebuild_prism = prism_->dict_file_checksum() != dict_file_checksum ||
                     prism_->schema_file_checksum() != schema_file_checksum;
+    prism_matches_table =
+        !previous_syllabary.empty() &&
+        prism_->dict_file_checksum() == previous_checksum &&
+        prism_->schema_file_checksum() == schema_file_checksum;
     prism_->Close();
   } else {
     rebuild_prism = true;
@@ -133,11 +237,9 @@ bool DictCompiler::Compile(const string& schema_file) {
   LOG(INFO) << dict_file << "[" << dict_files.size() << " file(s)]"
             << " (" << dict_file_checksum << ")";
   LOG(INFO) << schema_file << " (" << schema_file_checksum << ")";
+  fs::path reverse_db_path = FindReverseDb();
   {
-    the<ResourceResolver> resolver(
-        Service::instance().CreateDeployedResourceResolver(
-            {"find_reverse_db", "", ".reverse.bin"}));
-    ReverseDb reverse_db(resolver->ResolvePath(dict_name_).string());
+    ReverseDb reverse_db(reverse_db_path.string());
     if (!reverse_db.Exists() || !reverse_db.Load() ||
         reverse_db.dict_file_checksum() != dict_file_checksum) {
       rebuild_table = true;
@@ -157,10 +259,17 @@ bool DictCompiler::Compile(const string& schema_file) {
     }
     syllabary = std::move(collector.syllabary);
   }
+  if (rebuild_prism && rebuild_table && prism_matches_table &&
+      !(options_ & kRebuildPrism) && syllabary == previous_syllabary &&
+      ReusePrism(dict_file_checksum)) {
+    rebuild_prism = false;
+  }
   if (rebuild_prism &&
       !BuildPrism(schema_file, dict_file_checksum, schema_file_checksum)) {
     return false;
   }
+  stats_.table_rebuilt = rebuild_table && !stats_.table_reused;
+  stats_.prism_rebuilt = rebuild_prism;
   if (rebuild_table) {
     for (int table_index = 1; table_index < tables_.size(); ++table_index) {
       const auto& pack_name = packs_[table_index - 1];
@@ -189,14 +298,68 @@ bool DictCompiler::Compile(const string& schema_file) {
       syllabary = std::move(collector.syllabary);
     }
   }
+  if (options_ & kBundle) {
+    if (rebuild_table) {
+      // built anew in the output directory
+      reverse_db_path =
+          target_resolver_->ResolvePath(dict_name_ + ".reverse.bin");
+    }
+    if (!BuildBundle(reverse_db_path.string(), dict_file_checksum,
+                     schema_file_checksum, rebuild_table || rebuild_prism)) {
+      return false;
+    }
+  }
   // done!
   return true;
 }
 
-static fs::path relocate_target(const fs::path& source_path,
-                                ResourceResolver* target_resolver) {
-  auto resource_id = source_path.filename().string();
-  return target_resolver->ResolvePath(resource_id);
+bool DictCompiler::BuildBundle(const string& reverse_db_file,
+                               uint32_t dict_file_checksum,
+                               uint32_t schema_file_checksum,
+                               bool rebuilt) {
+  auto target_path = relocate_target(
+      DictBundle::BundleFileName(prism_->file_name()), target_resolver_.get());
+  DictBundle bundle(target_path.string());
+  if (!rebuilt && bundle.Exists() && bundle.Load() &&
+      bundle.dict_file_checksum() == dict_file_checksum &&
+      bundle.schema_file_checksum() == schema_file_checksum) {
+    LOG(INFO) << "dictionary bundle is up to date: " << target_path;
+    return true;
+  }
+  bundle.Close();
+  // the partitions of a table are mapped on demand, on their own
+  auto partitioned = [](const an<Table>& table) {
+    bool result = table->Load() && table->num_partitions() > 0;
+    table->Close();
+    return result;
+  };
+  if (partitioned(tables_[0])) {
+    LOG(WARNING) << "not bundling partitioned table: "
+                 << tables_[0]->file_name();
+    // a stale bundle is never read
+    if (bundle.Exists())
+      bundle.Remove();
+    return true;
+  }
+  vector<pair<string, string>> section_files = {
+      {"table", tables_[0]->file_name()},
+      {"prism", prism_->file_name()},
+  };
+  if (fs::exists(reverse_db_file)) {
+    section_files.push_back({"reverse", reverse_db_file});
+  }
+  for (size_t i = 1; i < tables_.size(); ++i) {
+    const auto& table = tables_[i];
+    if (table->Exists() && !partitioned(table)) {
+      section_files.push_back({"pack/" + packs_[i - 1], table->file_name()});
+    }
+  }
+  if (!bundle.Build(section_files, dict_file_checksum, schema_file_checksum)) {
+    if (bundle.Exists())
+      bundle.Remove();
+    return false;
+  }
+  return true;
 }
 
 bool DictCompiler::BuildTable(int table_index,
@@ -209,6 +372,7 @@ bool DictCompiler::BuildTable(int table_index,
   nvtx3::scoped_range r{attr};
 
   auto& table = tables_[table_index];
+  const string previous_table = table->file_name();
   auto target_path =
       relocate_target(table->file_name(), target_resolver_.get());
   LOG(INFO) << "building table: " << target_path;
@@ -216,11 +380,25 @@ bool DictCompiler::BuildTable(int table_index,
 
   collector.Configure(settings);
   collector.Collect(dict_files);
+  // an edit of comments, or one undone, yields the same entries
+  fs::path record_path(table->file_name());
+  record_path.replace_extension(".record");
+  BuildRecord record(record_path.string());
+  uint32_t entries_checksum = compute_entries_checksum(collector, settings);
+  bool same_entries = record.Load() && !(options_ & kRebuildTable) &&
+                      record.entries_checksum() == entries_checksum;
+  uint32_t previous_checksum = record.dict_file_checksum();
+  record.set_checksums(dict_file_checksum, entries_checksum);
+  record.Save();
   if (options_ & kDump) {
     fs::path dump_path(table->file_name());
     dump_path.replace_extension(".txt");
     collector.Dump(dump_path.string());
   }
+  if (same_entries && ReuseTable(table_index, previous_table,
+                                 previous_checksum, dict_file_checksum)) {
+    return true;
+  }
   Vocabulary vocabulary;
   // build .table.bin
   {
@@ -233,28 +411,33 @@ bool DictCompiler::BuildTable(int table_index,
       syllable_to_id[s] = syllable_id++;
     }
 
-    #pragma omp parallel for
-    for (const auto& r : collector.entries) {
-      Code code;
-      for (const auto& s : r->raw_code) {
-        code.push_back(syllable_to_id[s]);
+    // convert entries in parallel, then add them to the vocabulary in the
+    // order they were collected, which decides the order of homophones.
+    const auto& entries(collector.entries);
+    vector<of<ShortDictEntry>> short_entries(entries.size());
+    ParallelFor(entries.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const auto& r = entries[i];
+        auto e = New<ShortDictEntry>();
+        for (const auto& s : r->raw_code) {
+          e->code.push_back(syllable_to_id.at(s));
+        }
+        // release memory in time to reduce memory usage
+        RawCode().swap(r->raw_code);
+        e->text.swap(r->text);
+        e->weight = log(r->weight > 0 ? r->weight : DBL_EPSILON);
+        short_entries[i] = std::move(e);
       }
-      // release memory in time to reduce memory usage
-      RawCode().swap(r->raw_code);
-      rime::ShortDictEntryList *ls;
-      #pragma omp critical
-      ls = vocabulary.LocateEntries(code);
+    });
+    for (auto& e : short_entries) {
+      ShortDictEntryList* ls = vocabulary.LocateEntries(e->code);
       if (!ls) {
         LOG(ERROR) << "Error locating entries in vocabulary.";
         continue;
       }
-      auto e = New<ShortDictEntry>();
-      e->code.swap(code);
-      e->text.swap(r->text);
-      e->weight = log(r->weight > 0 ? r->weight : DBL_EPSILON);
-      #pragma omp critical
-      ls->push_back(e);
+      ls->push_back(std::move(e));
     }
+    vector<of<ShortDictEntry>>().swap(short_entries);
     // release memory in time to reduce memory usage
     vector<of<RawDictEntry>>().swap(collector.entries);
     if (settings->sort_order() != "original") {
@@ -262,7 +445,7 @@ bool DictCompiler::BuildTable(int table_index,
     }
     table->Remove();
     if (!table->Build(collector.syllabary, vocabulary, collector.num_entries,
-                      dict_file_checksum) ||
+                      dict_file_checksum, settings->table_partitions()) ||
         !table->Save()) {
       return false;
     }
@@ -298,6 +481,67 @@ bool DictCompiler::BuildReverseDb(DictSettings* settings,
   return true;
 }
 
+bool DictCompiler::ReusePrism(uint32_t dict_file_checksum) {
+  auto target_path =
+      relocate_target(prism_->file_name(), target_resolver_.get());
+  LOG(INFO) << "reusing prism of the same syllabary: " << target_path;
+  if (!copy_with_checksum<Prism>(prism_->file_name(), target_path,
+                                 dict_file_checksum)) {
+    return false;
+  }
+  prism_ = New<Prism>(target_path.string());
+  stats_.prism_reused = true;
+  return true;
+}
+
+bool DictCompiler::ReuseTable(int table_index,
+                              const string& previous_table,
+                              uint32_t previous_checksum,
+                              uint32_t dict_file_checksum) {
+  // the files must have been built from the entries of the previous build
+  {
+    Table table(previous_table);
+    if (!table.Load() || table.dict_file_checksum() != previous_checksum ||
+        table.num_partitions() > 0)
+      return false;
+  }
+  fs::path previous_reverse_db;
+  if (table_index == 0) {
+    previous_reverse_db = FindReverseDb();
+    ReverseDb reverse_db(previous_reverse_db.string());
+    if (!reverse_db.Load() ||
+        reverse_db.dict_file_checksum() != previous_checksum)
+      return false;
+  }
+  auto& table = tables_[table_index];
+  LOG(INFO) << "reusing table of the same entries: " << table->file_name();
+  if (!copy_with_checksum<Table>(previous_table, table->file_name(),
+                                 dict_file_checksum)) {
+    return false;
+  }
+  if (table_index == 0 &&
+      !copy_with_checksum<ReverseDb>(
+          previous_reverse_db,
+          relocate_target(dict_name_ + ".reverse.bin", target_resolver_.get()),
+          dict_file_checksum)) {
+    return false;
+  }
+  stats_.table_reused = true;
+  return true;
+}
+
+string DictCompiler::FindReverseDb() {
+  auto reverse_db_path =
+      target_resolver_->ResolvePath(dict_name_ + ".reverse.bin");
+  if (!fs::exists(reverse_db_path)) {
+    the<ResourceResolver> resolver(
+        Service::instance().CreateDeployedResourceResolver(
+            {"find_reverse_db", "", ".reverse.bin"}));
+    reverse_db_path = resolver->ResolvePath(dict_name_);
+  }
+  return reverse_db_path.string();
+}
+
 bool DictCompiler::BuildPrism(const string& schema_file,
                               uint32_t dict_file_checksum,
                               uint32_t schema_file_checksum) {
@@ -29,13 +29,25 @@ class DictCompiler {
     kRebuildTable = 2,
     kRebuild = kRebuildPrism | kRebuildTable,
     kDump = 4,
+    // also packs the compiled files into a single bundle file
+    kBundle = 8,
   };
 
   RIME_API explicit DictCompiler(Dictionary* dictionary);
   RIME_API virtual ~DictCompiler();
 
+  // what the last Compile() has done
+  struct Stats {
+    bool table_rebuilt = false;
+    // edited dict files yielded the same entries as the previous build
+    bool table_reused = false;
+    bool prism_rebuilt = false;
+    bool prism_reused = false;
+  };
+
   RIME_API bool Compile(const string& schema_file);
   void set_options(int options) { options_ = options; }
+  const Stats& stats() const { return stats_; }
 
  private:
   bool BuildTable(int table_index,
@@ -46,10 +58,21 @@ class DictCompiler {
   bool BuildPrism(const string& schema_file,
                   uint32_t dict_file_checksum,
                   uint32_t schema_file_checksum);
+  bool ReusePrism(uint32_t dict_file_checksum);
+  bool ReuseTable(int table_index,
+                  const string& previous_table,
+                  uint32_t previous_checksum,
+                  uint32_t dict_file_checksum);
+  // the reverse db of the previous build
+  string FindReverseDb();
   bool BuildReverseDb(DictSettings* settings,
                       const EntryCollector& collector,
                       const Vocabulary& vocabulary,
                       uint32_t dict_file_checksum);
+  bool BuildBundle(const string& reverse_db_file,
+                   uint32_t dict_file_checksum,
+                   uint32_t schema_file_checksum,
+                   bool rebuilt);
 
   const string& dict_name_;
   const vector<string>& packs_;
@@ -57,6 +80,7 @@ class DictCompiler {
   an<EditDistanceCorrector> correction_;
   vector<of<Table>> tables_;
   int options_ = 0;
+  Stats stats_;
   the<ResourceResolver> source_resolver_;
   the<ResourceResolver> target_resolver_;
 };
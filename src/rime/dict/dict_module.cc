@@ -5,10 +5,13 @@
 // 2013-10-17 GONG Chen <chen.sst@gmail.com>
 //
 
+#include <boost/algorithm/string.hpp>
 #include <rime_api.h>
 #include <rime/common.h>
+#include <rime/memory_stats.h>
 #include <rime/registry.h>
 #include <rime/dict/db.h>
+#include <rime/dict/mapped_file.h>
 #include <rime/dict/level_db.h>
 #include <rime/dict/table_db.h>
 #include <rime/dict/text_db.h>
@@ -19,29 +22,65 @@
 #include <rime/dict/user_dictionary.h>
 #include <rime/dict/user_db_recovery_task.h>
 
+static void rime_dict_collect_memory_stats(rime::MemoryStats* stats) {
+  using namespace rime;
+
+  for (const auto& file : MappedFile::GetStats()) {
+    ++stats->num_mapped_files;
+    stats->mapped_bytes += file.mapped_bytes;
+    stats->resident_bytes += file.resident_bytes;
+    if (boost::ends_with(file.file_name, ".table.bin"))
+      ++stats->num_tables;
+    else if (boost::ends_with(file.file_name, ".prism.bin"))
+      ++stats->num_prisms;
+    else if (boost::ends_with(file.file_name, ".reverse.bin"))
+      ++stats->num_reverse_dbs;
+  }
+  for (const auto& db : Db::GetStats()) {
+    ++stats->num_dbs;
+    stats->db_bytes += db.memory_usage;
+  }
+  // components not yet in use hold nothing
+  Registry& r = Registry::instance();
+  if (auto* dictionary = dynamic_cast<DictionaryComponent*>(
+          r.FindInstantiated("dictionary"))) {
+    stats->num_cached_dict_files +=
+        dictionary->GetCacheStats(&stats->cached_dict_bytes);
+  }
+  if (auto* user_dictionary = dynamic_cast<UserDictionaryComponent*>(
+          r.FindInstantiated("user_dictionary"))) {
+    stats->num_cached_user_dbs +=
+        user_dictionary->GetCacheStats(&stats->cached_user_db_bytes);
+  }
+}
+
 static void rime_dict_initialize() {
   using namespace rime;
 
   LOG(INFO) << "registering components from module 'dict'.";
   Registry& r = Registry::instance();
 
-  r.Register("tabledb", new DbComponent<TableDb>);
-  r.Register("stabledb", new DbComponent<StableDb>);
-  r.Register("plain_userdb", new UserDbComponent<TextDb>);
-  r.Register("userdb", new UserDbComponent<LevelDb>);
+  r.Register<DbComponent<TableDb>>("tabledb");
+  r.Register<DbComponent<StableDb>>("stabledb");
+  r.Register<UserDbComponent<TextDb>>("plain_userdb");
+  r.Register<UserDbComponent<LevelDb>>("userdb");
   // NOTE: register a legacy_userdb component in your plugin if you wish to
   // upgrade userdbs from an old file format (eg. TreeDb) during maintenance.
   // r.Register("legacy_userdb", ...);
 
-  r.Register("corrector", new CorrectorComponent);
+  r.Register<CorrectorComponent>("corrector");
+
+  r.Register<DictionaryComponent>("dictionary");
+  r.Register<ReverseLookupDictionaryComponent>("reverse_lookup_dictionary");
+  r.Register<UserDictionaryComponent>("user_dictionary");
 
-  r.Register("dictionary", new DictionaryComponent);
-  r.Register("reverse_lookup_dictionary", new ReverseLookupDictionaryComponent);
-  r.Register("user_dictionary", new UserDictionaryComponent);
+  r.Register<UserDbRecoveryTaskComponent>("userdb_recovery_task");
 
-  r.Register("userdb_recovery_task", new UserDbRecoveryTaskComponent);
+  RegisterMemoryStatsProvider("dict", &rime_dict_collect_memory_stats);
 }
 
-static void rime_dict_finalize() {}
+static void rime_dict_finalize() {
+  rime::UnregisterMemoryStatsProvider("dict");
+}
 
 RIME_REGISTER_MODULE(dict)
@@ -72,6 +72,10 @@ int DictSettings::max_phrase_length() {
   return (*this)["max_phrase_length"].ToInt();
 }
 
+int DictSettings::table_partitions() {
+  return (*this)["table_partitions"].ToInt();
+}
+
 double DictSettings::min_phrase_weight() {
   return (*this)["min_phrase_weight"].ToDouble();
 }
@@ -25,6 +25,7 @@ class DictSettings : public Config {
   string vocabulary();
   bool use_rule_based_encoder();
   int max_phrase_length();
+  int table_partitions();
   double min_phrase_weight();
   an<ConfigList> GetTables();
   int GetColumnIndex(const string& column_label);
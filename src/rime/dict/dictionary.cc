@@ -4,9 +4,11 @@
 //
 // 2011-07-05 GONG Chen <chen.sst@gmail.com>
 //
+#include <algorithm>
 #include <filesystem>
 #include <rime/algo/syllabifier.h>
 #include <rime/common.h>
+#include <rime/dict/dict_bundle.h>
 #include <rime/dict/dictionary.h>
 #include <rime/resource.h>
 #include <rime/schema.h>
@@ -26,10 +28,22 @@ struct Chunk {
   size_t cursor = 0;
   string remaining_code;  // for predictive queries
   double credibility = 0.0;
+  // keeps the entries mapped
+  an<TablePartition> partition;
 
   Chunk() = default;
-  Chunk(Table* t, const Code& c, const table::Entry* e, double cr = 0.0)
-      : table(t), code(c), entries(e), size(1), cursor(0), credibility(cr) {}
+  Chunk(Table* t,
+        const Code& c,
+        const table::Entry* e,
+        double cr = 0.0,
+        an<TablePartition> p = nullptr)
+      : table(t),
+        code(c),
+        entries(e),
+        size(1),
+        cursor(0),
+        credibility(cr),
+        partition(std::move(p)) {}
   Chunk(Table* t, const TableAccessor& a, double cr = 0.0)
       : Chunk(t, a, string(), cr) {}
   Chunk(Table* t, const TableAccessor& a, const string& r, double cr = 0.0)
@@ -39,7 +53,8 @@ struct Chunk {
         size(a.remaining()),
         cursor(0),
         remaining_code(r),
-        credibility(cr) {}
+        credibility(cr),
+        partition(a.partition()) {}
 };
 
 struct QueryResult {
@@ -199,9 +214,10 @@ static void lookup_table(Table* table,
                          DictEntryCollector* collector,
                          const SyllableGraph& syllable_graph,
                          size_t start_pos,
-                         double initial_credibility) {
+                         double initial_credibility,
+                         size_t max_frontier) {
   TableQueryResult result;
-  if (!table->Query(syllable_graph, start_pos, &result)) {
+  if (!table->Query(syllable_graph, start_pos, &result, max_frontier)) {
     return;
   }
   // copy result
@@ -216,7 +232,7 @@ static void lookup_table(Table* table,
           if (actual_end_pos == 0)
             continue;
           (*collector)[actual_end_pos].AddChunk(
-              {table, a.code(), a.entry(), cr});
+              {table, a.code(), a.entry(), cr, a.partition()});
         } while (a.Next());
       } else {
         (*collector)[end_pos].AddChunk({table, a, cr});
@@ -235,7 +251,7 @@ an<DictEntryCollector> Dictionary::Lookup(const SyllableGraph& syllable_graph,
     if (!table->IsOpen())
       continue;
     lookup_table(table.get(), collector.get(), syllable_graph, start_pos,
-                 initial_credibility);
+                 initial_credibility, max_query_frontier_);
   }
   if (collector->empty())
     return nullptr;
@@ -306,8 +322,8 @@ bool Dictionary::Decode(const Code& code, vector<string>* result) {
 }
 
 bool Dictionary::Exists() const {
-  return std::filesystem::exists(prism_->file_name()) && !tables_.empty() &&
-         std::filesystem::exists(tables_[0]->file_name());
+  // bundled files exist in the bundle
+  return prism_->Exists() && !tables_.empty() && tables_[0]->Exists();
 }
 
 bool Dictionary::Remove() {
@@ -356,13 +372,18 @@ static const ResourceType kPrismResourceType = {"prism", "", ".prism.bin"};
 
 static const ResourceType kTableResourceType = {"table", "", ".table.bin"};
 
+static const ResourceType kBundleResourceType = {"bundle", "", ".bundle.bin"};
+
 DictionaryComponent::DictionaryComponent()
     : prism_resource_resolver_(
-          Service::instance().CreateDeployedResourceResolver(
+          Service::shared_instance().CreateDeployedResourceResolver(
               kPrismResourceType)),
       table_resource_resolver_(
-          Service::instance().CreateDeployedResourceResolver(
-              kTableResourceType)) {}
+          Service::shared_instance().CreateDeployedResourceResolver(
+              kTableResourceType)),
+      bundle_resource_resolver_(
+          Service::shared_instance().CreateDeployedResourceResolver(
+              kBundleResourceType)) {}
 
 DictionaryComponent::~DictionaryComponent() {}
 
@@ -391,12 +412,63 @@ Dictionary* DictionaryComponent::Create(const Ticket& ticket) {
       }
     }
   }
-  return Create(std::move(dict_name), std::move(prism_name), std::move(packs));
+  Dictionary* dictionary = nullptr;
+  bool use_bundle = false;
+  if (config->GetBool(ticket.name_space + "/bundle", &use_bundle) &&
+      use_bundle) {
+    dictionary = CreateFromBundle(dict_name, prism_name, packs);
+  }
+  if (!dictionary) {
+    dictionary =
+        Create(std::move(dict_name), std::move(prism_name), std::move(packs));
+  }
+  if (dictionary) {
+    int partition_budget = 0;  // MB; no limit if not set
+    config->GetInt(ticket.name_space + "/partition_budget", &partition_budget);
+    // tables shared with other dictionaries keep the largest budget
+    for (const auto& table : dictionary->tables()) {
+      table->RequestPartitionBudget(size_t((std::max)(partition_budget, 0))
+                                    << 20);
+    }
+  }
+  return dictionary;
+}
+
+void DictionaryComponent::ForgetOutdatedFiles() {
+  int deployment_count =
+      Service::shared_instance().deployer().deployment_count();
+  if (deployment_count != deployment_count_) {
+    // files still in use by existing sessions stay loaded for them
+    prism_map_.clear();
+    table_map_.clear();
+    deployment_count_ = deployment_count;
+  }
+}
+
+template <class T>
+static size_t CountCachedFiles(const map<string, weak<T>>& cache,
+                               size_t* mapped_bytes) {
+  size_t num_files = 0;
+  for (const auto& entry : cache) {
+    if (auto file = entry.second.lock()) {
+      ++num_files;
+      *mapped_bytes += file->file_size();
+    }
+  }
+  return num_files;
+}
+
+size_t DictionaryComponent::GetCacheStats(size_t* mapped_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return CountCachedFiles(prism_map_, mapped_bytes) +
+         CountCachedFiles(table_map_, mapped_bytes);
 }
 
 Dictionary* DictionaryComponent::Create(string dict_name,
                                         string prism_name,
                                         vector<string> packs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ForgetOutdatedFiles();
   // obtain prism and primary table objects
   auto primary_table = table_map_[dict_name].lock();
   if (!primary_table) {
@@ -421,4 +493,48 @@ Dictionary* DictionaryComponent::Create(string dict_name,
                         std::move(tables), std::move(prism));
 }
 
+Dictionary* DictionaryComponent::CreateFromBundle(const string& dict_name,
+                                                  const string& prism_name,
+                                                  const vector<string>& packs) {
+  auto bundle_path = bundle_resource_resolver_->ResolvePath(prism_name);
+  auto bundle = DictBundle::Open(bundle_path.string());
+  if (!bundle)
+    return nullptr;
+  if (!bundle->HasSection("table") || !bundle->HasSection("prism")) {
+    LOG(WARNING) << "incomplete dictionary bundle: " << bundle_path;
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ForgetOutdatedFiles();
+  // sections of the bundle are cached apart from the stand-alone files
+  auto bundled = [&bundle_path](const string& section) {
+    return bundle_path.string() + "#" + section;
+  };
+  auto primary_table = table_map_[bundled("table")].lock();
+  if (!primary_table) {
+    auto file_path = table_resource_resolver_->ResolvePath(dict_name).string();
+    table_map_[bundled("table")] = primary_table = New<Table>(file_path);
+    bundle->Attach("table", primary_table.get());
+  }
+  auto prism = prism_map_[bundled("prism")].lock();
+  if (!prism) {
+    auto file_path = prism_resource_resolver_->ResolvePath(prism_name).string();
+    prism_map_[bundled("prism")] = prism = New<Prism>(file_path);
+    bundle->Attach("prism", prism.get());
+  }
+  vector<of<Table>> tables = {std::move(primary_table)};
+  for (const auto& pack : packs) {
+    const string section = "pack/" + pack;
+    auto table = table_map_[bundled(section)].lock();
+    if (!table) {
+      auto file_path = table_resource_resolver_->ResolvePath(pack).string();
+      table_map_[bundled(section)] = table = New<Table>(file_path);
+      // a pack missing in the bundle is looked for on its own
+      bundle->Attach(section, table.get());
+    }
+    tables.push_back(std::move(table));
+  }
+  return new Dictionary(dict_name, packs, std::move(tables), std::move(prism));
+}
+
 }  // namespace rime
@@ -7,6 +7,7 @@
 #ifndef RIME_DICTIONARY_H_
 #define RIME_DICTIONARY_H_
 
+#include <mutex>
 #include <rime_api.h>
 #include <rime/common.h>
 #include <rime/component.h>
@@ -92,11 +93,17 @@ class Dictionary : public Class<Dictionary, const Ticket&> {
   const an<Table>& primary_table() const { return tables_[0]; }
   const an<Prism>& prism() const { return prism_; }
 
+  // caps the breadth of phrase lookup in the syllable graph; 0 for no limit.
+  void set_max_query_frontier(size_t max_frontier) {
+    max_query_frontier_ = max_frontier;
+  }
+
  private:
   string name_;
   vector<string> packs_;
   vector<of<Table>> tables_;
   an<Prism> prism_;
+  size_t max_query_frontier_ = 0;
 };
 
 class ResourceResolver;
@@ -107,12 +114,28 @@ class DictionaryComponent : public Dictionary::Component {
   ~DictionaryComponent() override;
   Dictionary* Create(const Ticket& ticket) override;
   Dictionary* Create(string dict_name, string prism_name, vector<string> packs);
+  // reads the tables and prism from the bundle built for the prism;
+  // returns null if there is no such bundle.
+  Dictionary* CreateFromBundle(const string& dict_name,
+                               const string& prism_name,
+                               const vector<string>& packs);
+  // returns the number of cached tables and prisms in use, and adds up the
+  // size of their files
+  size_t GetCacheStats(size_t* mapped_bytes);
 
  private:
+  // called with the mutex locked
+  void ForgetOutdatedFiles();
+
+  // dictionaries are created by sessions and the deployer concurrently
+  std::mutex mutex_;
+  // the files cached were deployed before this deployment count
+  int deployment_count_ = 0;
   map<string, weak<Prism>> prism_map_;
   map<string, weak<Table>> table_map_;
   the<ResourceResolver> prism_resource_resolver_;
   the<ResourceResolver> table_resource_resolver_;
+  the<ResourceResolver> bundle_resource_resolver_;
 };
 
 }  // namespace rime
@@ -5,19 +5,19 @@
 // 2011-11-27 GONG Chen <chen.sst@gmail.com>
 //
 #include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <mutex>
+#include <tuple>
 #include <utility>
 #include <boost/algorithm/string.hpp>
 #include <rime/algo/strings.h>
 #include <rime/dict/dict_settings.h>
 #include <rime/dict/entry_collector.h>
 #include <rime/dict/preset_vocabulary.h>
+#include <rime/task_scheduler.h>
 #include <nvtx3/nvtx3.hpp>
 
-#include <omp.h>
-#include <thread>
-#include <mutex>
-
 namespace rime {
 
 EntryCollector::EntryCollector() {}
@@ -136,27 +136,43 @@ void EntryCollector::Collect(const string& dict_file) {
   LOG(INFO) << "num of entries to encode: " << encode_queue.size();
 }
 
-void writer_thread(EntryCollector* collector, Encoder *encoder) {
-  while (true) {
-    if (encoder->pending_entries.empty()) {
-      if (collector->work_done)
-        break;
-      continue;
+// entries created by the encoder task running in the current thread.
+// they are held back till all tasks are done, as CreateEntry() modifies the
+// word map that the encoder is reading.
+using PendingEntries = vector<std::tuple<string, string, string>>;
+static thread_local PendingEntries* tls_pending_entries = nullptr;
+
+size_t EntryCollector::EncodePhrases(const EncodeQueue& queue,
+                                     bool skip_collected) {
+  std::atomic<size_t> num_failures{0};
+  // keyed by the start of the range of queue items that produced them
+  map<size_t, PendingEntries> results;
+  std::mutex results_mutex;
+  ParallelFor(queue.size(), [&](size_t begin, size_t end) {
+    PendingEntries pending_entries;
+    tls_pending_entries = &pending_entries;
+    for (size_t i = begin; i < end; ++i) {
+      const auto& phrase(queue[i].first);
+      const auto& weight_str(queue[i].second);
+      if (skip_collected && collection.find(phrase) != collection.end())
+        continue;
+      if (!encoder->EncodePhrase(phrase, weight_str)) {
+        DLOG(WARNING) << "Encode failure: '" << phrase << "'.";
+        ++num_failures;
+      }
     }
-
-    std::tuple<string, string, string> entry;
-
-    #pragma omp critical
-    {
-      entry = encoder->pending_entries.back();
-      encoder->pending_entries.pop_back();
+    tls_pending_entries = nullptr;
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results[begin].swap(pending_entries);
+  });
+  // commit in queue order so that the output doesn't depend on scheduling
+  for (auto& r : results) {
+    for (const auto& entry : r.second) {
+      CreateEntry(std::get<0>(entry), std::get<1>(entry), std::get<2>(entry));
     }
-    
-    const auto& phrase(std::get<0>(entry));
-    const auto& code_str(std::get<1>(entry));
-    const auto& weight_str(std::get<2>(entry));
-    collector->CreateEntry(phrase, code_str, weight_str);
+    PendingEntries().swap(r.second);
   }
+  return num_failures;
 }
 
 void EntryCollector::Finish() {
@@ -167,45 +183,27 @@ void EntryCollector::Finish() {
     nvtx3::event_attributes attr{"Script Encoder", nvtx3::rgb{255, 0, 0}};
     nvtx3::scoped_range r{attr};
 
-    std::thread writer(writer_thread, this, encoder.get());
-
-    const int num_threads = omp_get_max_threads();
-    #pragma omp parallel for num_threads(num_threads - 1)
-    for (auto &entry: encode_queue) {
-      const auto& phrase(entry.first);
-      const auto& weight_str(entry.second);
-      if (!encoder->EncodePhrase(phrase, weight_str)) {
-        LOG(ERROR) << "Encode failure: '" << phrase << "'.";
-      }
+    size_t num_failures = EncodePhrases(encode_queue, false);
+    if (num_failures > 0) {
+      LOG(ERROR) << "failed to encode " << num_failures << " phrases.";
     }
-
-    work_done = true;
-
-    writer.join();
+    decltype(encode_queue)().swap(encode_queue);
   }
-
-
   LOG(INFO) << "Pass 2: total " << num_entries << " entries collected.";
   if (preset_vocabulary) {
     nvtx3::event_attributes attr{"Table Encoder", nvtx3::rgb{0, 0, 255}};
     nvtx3::scoped_range r{attr};
 
     preset_vocabulary->Reset();
-
-    vector<pair<string, string>> preset_vocabs;
+    EncodeQueue preset_vocabs;
     string phrase, weight_str;
     while (preset_vocabulary->GetNextEntry(&phrase, &weight_str)) {
       preset_vocabs.emplace_back(phrase, weight_str);
     }
-
-    #pragma omp parallel for
-    for (auto &[phrase, weight_str]: preset_vocabs) {
-      if (collection.find(phrase) != collection.end())
-        continue;
-
-      if (!encoder->EncodePhrase(phrase, weight_str)) {
-        LOG(WARNING) << "Encode failure: '" << phrase << "'.";
-      }
+    size_t num_failures = EncodePhrases(preset_vocabs, true);
+    if (num_failures > 0) {
+      LOG(WARNING) << "failed to encode " << num_failures
+                   << " phrases from preset vocabulary.";
     }
   }
   decltype(collection)().swap(collection);
@@ -217,6 +215,10 @@ void EntryCollector::Finish() {
 void EntryCollector::CreateEntry(const string& word,
                                  const string& code_str,
                                  const string& weight_str) {
+  if (tls_pending_entries) {
+    tls_pending_entries->emplace_back(word, code_str, weight_str);
+    return;
+  }
   an<RawDictEntry> e = New<RawDictEntry>();
   e->raw_code.FromString(code_str);
   e->text = word;
@@ -282,29 +284,12 @@ bool EntryCollector::TranslateWord(const string& word, vector<string>* result) {
   }
   const auto& w = words.find(word);
   if (w != words.end()) {
-    // std::map<string, omp_lock_t>::iterator lock;
-    // bool needs_sort = false;
-
-    // #pragma omp critical
-    // {
-    //   lock = word_locks.find(word);
-    //   if (lock == word_locks.end()) {
-    //     lock = word_locks.emplace(word, omp_lock_t()).first;
-    //     omp_init_lock(&lock->second);
-    //     needs_sort = true;
-    //   }
-    // }
-
-    // omp_set_lock(&lock->second);
-    // if (needs_sort) {
-    //   std::sort(w->second.begin(), w->second.end(),
-    //       [](const auto& a, const auto& b) { return a.first < b.first; });
-    // }
-    // omp_unset_lock(&lock->second);
-    
+    // called concurrently by encoder tasks; don't insert into the maps
+    const auto& t = total_weight.find(word);
+    double word_total_weight = t != total_weight.end() ? t->second : 0.0;
     for (const auto& v : w->second) {
       const double kMinimalWeight = 0.05;  // 5%
-      double min_weight = total_weight[word] * kMinimalWeight;
+      double min_weight = word_total_weight * kMinimalWeight;
       if (v.second < min_weight)
         continue;
       result->push_back(v.first);
@@ -7,9 +7,6 @@
 #ifndef RIME_ENTRY_COLLECTOR_H_
 #define RIME_ENTRY_COLLECTOR_H_
 
-#include <queue>
-#include <vector>
-#include <omp.h>
 #include <rime/common.h>
 #include <rime/algo/encoder.h>
 #include <rime/dict/dictionary.h>
@@ -42,7 +39,6 @@ class EntryCollector : public PhraseCollector {
   vector<of<RawDictEntry>> entries;
   size_t num_entries = 0;
   ReverseLookupTable stems;
-  bool work_done;
 
  public:
   EntryCollector();
@@ -62,13 +58,14 @@ class EntryCollector : public PhraseCollector {
 
   the<Encoder> encoder;
 
-
  protected:
   void LoadPresetVocabulary(DictSettings* settings);
   // call Collect() multiple times for all required tables
   void Collect(const string& dict_file);
   // encode all collected entries
   void Finish();
+  // encode phrases in parallel tasks; returns the number of failures
+  size_t EncodePhrases(const EncodeQueue& queue, bool skip_collected);
 
  protected:
   the<PresetVocabulary> preset_vocabulary;
@@ -5,6 +5,7 @@
 // 2014-12-04 Chen Gong <chen.sst@gmail.com>
 //
 
+#include <cstdlib>
 #include <filesystem>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
@@ -94,6 +95,14 @@ struct LevelDbWrapper {
     auto status = ptr->Write(leveldb::WriteOptions(), &batch);
     return status.ok();
   }
+
+  // memtables and block cache
+  size_t ApproximateMemoryUsage() {
+    string value;
+    if (!ptr || !ptr->GetProperty("leveldb.approximate-memory-usage", &value))
+      return 0;
+    return std::strtoull(value.c_str(), nullptr, 10);
+  }
 };
 
 // LevelDbAccessor members
@@ -249,6 +258,7 @@ bool LevelDb::Open() {
   loaded_ = status.ok();
 
   if (loaded_) {
+    memory_usage_ = db_->ApproximateMemoryUsage();
     string db_name;
     if (!MetaFetch("/db_name", &db_name)) {
       if (!CreateMetadata()) {
@@ -270,7 +280,9 @@ bool LevelDb::OpenReadOnly() {
   auto status = db_->Open(file_name(), readonly_);
   loaded_ = status.ok();
 
-  if (!loaded_) {
+  if (loaded_) {
+    memory_usage_ = db_->ApproximateMemoryUsage();
+  } else {
     LOG(ERROR) << "Error opening db '" << name() << "' read-only.";
   }
   return loaded_;
@@ -281,6 +293,7 @@ bool LevelDb::Close() {
     return false;
 
   db_->Release();
+  memory_usage_ = 0;
 
   LOG(INFO) << "closed db '" << name() << "'.";
   loaded_ = false;
@@ -323,6 +336,7 @@ bool LevelDb::CommitTransaction() {
   bool ok = db_->CommitBatch();
   db_->ClearBatch();
   in_transaction_ = false;
+  memory_usage_ = db_->ApproximateMemoryUsage();
   return ok;
 }
 
@@ -8,12 +8,39 @@
 //
 #include <fstream>
 #include <filesystem>
+#include <mutex>
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <rime/dict/mapped_file.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // _WIN32
+
 namespace rime {
 
+class MappedFileImpl;
+
+// the files currently mapped into memory, for memory accounting
+static std::mutex g_mapped_files_mutex;
+static set<const MappedFileImpl*> g_mapped_files;
+
+class MappedFileHandle {
+ public:
+  MappedFileHandle(const string& file_name, boost::interprocess::mode_t mode)
+      : file_name_(file_name), mode_(mode), file_(file_name.c_str(), mode) {}
+
+  const string& file_name() const { return file_name_; }
+  boost::interprocess::mode_t mode() const { return mode_; }
+  const boost::interprocess::file_mapping& file() const { return file_; }
+
+ private:
+  string file_name_;
+  boost::interprocess::mode_t mode_;
+  boost::interprocess::file_mapping file_;
+};
+
 class MappedFileImpl {
  public:
   enum OpenMode {
@@ -21,25 +48,34 @@ class MappedFileImpl {
     kOpenReadWrite,
   };
 
-  MappedFileImpl(const string& file_name, OpenMode mode) {
-    boost::interprocess::mode_t file_mapping_mode =
-        (mode == kOpenReadOnly) ? boost::interprocess::read_only
-                                : boost::interprocess::read_write;
-    file_.reset(new boost::interprocess::file_mapping(file_name.c_str(),
-                                                      file_mapping_mode));
+  MappedFileImpl(const string& file_name, OpenMode mode)
+      : MappedFileImpl(New<MappedFileHandle>(
+            file_name, (mode == kOpenReadOnly)
+                           ? boost::interprocess::read_only
+                           : boost::interprocess::read_write)) {}
+  explicit MappedFileImpl(const an<MappedFileHandle>& handle)
+      : file_(handle) {
     region_.reset(
-        new boost::interprocess::mapped_region(*file_, file_mapping_mode));
+        new boost::interprocess::mapped_region(file_->file(), file_->mode()));
+    std::lock_guard<std::mutex> lock(g_mapped_files_mutex);
+    g_mapped_files.insert(this);
   }
   ~MappedFileImpl() {
+    {
+      std::lock_guard<std::mutex> lock(g_mapped_files_mutex);
+      g_mapped_files.erase(this);
+    }
     region_.reset();
     file_.reset();
   }
   bool Flush() { return region_->flush(); }
   void* get_address() const { return region_->get_address(); }
   size_t get_size() const { return region_->get_size(); }
+  const string& file_name() const { return file_->file_name(); }
+  const an<MappedFileHandle>& handle() const { return file_; }
 
  private:
-  the<boost::interprocess::file_mapping> file_;
+  an<MappedFileHandle> file_;
   the<boost::interprocess::mapped_region> region_;
 };
 
@@ -52,8 +88,22 @@ MappedFile::~MappedFile() {
 }
 
 bool MappedFile::Create(size_t capacity) {
+  if (bundle_) {
+    // writes a file of its own
+    Close();
+    bundle_.reset();
+    section_offset_ = section_size_ = 0;
+  }
   if (Exists()) {
     LOG(INFO) << "overwriting file '" << file_name_ << "'.";
+    // replace the file rather than resize it in place, where possible, so
+    // that existing mappings of it, or of hard links to it, stay intact.
+    if (IsOpen())
+      Close();
+    std::error_code ec;
+    std::filesystem::remove(file_name_, ec);
+  }
+  if (Exists()) {
     Resize(capacity);
   } else {
     LOG(INFO) << "creating file '" << file_name_ << "'.";
@@ -74,6 +124,12 @@ bool MappedFile::Create(size_t capacity) {
 }
 
 bool MappedFile::OpenReadOnly() {
+  if (bundle_) {
+    // the bundle is already mapped
+    file_ = bundle_;
+    size_ = section_size_;
+    return true;
+  }
   if (!Exists()) {
     LOG(ERROR) << "attempt to open non-existent file '" << file_name_ << "'.";
     return false;
@@ -83,7 +139,19 @@ bool MappedFile::OpenReadOnly() {
   return bool(file_);
 }
 
+bool MappedFile::OpenReadOnly(const an<MappedFileHandle>& handle) {
+  if (bundle_ || !handle || handle->mode() != boost::interprocess::read_only)
+    return OpenReadOnly();
+  file_.reset(new MappedFileImpl(handle));
+  size_ = file_->get_size();
+  return bool(file_);
+}
+
 bool MappedFile::OpenReadWrite() {
+  if (bundle_) {
+    LOG(ERROR) << "attempt to write to bundled file '" << file_name_ << "'.";
+    return false;
+  }
   if (!Exists()) {
     LOG(ERROR) << "attempt to open non-existent file '" << file_name_ << "'.";
     return false;
@@ -101,7 +169,11 @@ void MappedFile::Close() {
 }
 
 bool MappedFile::Exists() const {
-  return std::filesystem::exists(file_name_);
+  return bundle_ || std::filesystem::exists(file_name_);
+}
+
+an<MappedFileHandle> MappedFile::handle() const {
+  return file_ ? file_->handle() : nullptr;
 }
 
 bool MappedFile::IsOpen() const {
@@ -122,6 +194,10 @@ bool MappedFile::ShrinkToFit() {
 bool MappedFile::Remove() {
   if (IsOpen())
     Close();
+  if (bundle_) {
+    bundle_.reset();
+    section_offset_ = section_size_ = 0;
+  }
   return boost::interprocess::file_mapping::remove(file_name_.c_str());
 }
 
@@ -158,11 +234,49 @@ bool MappedFile::CopyString(const string& src, String* dest) {
 }
 
 size_t MappedFile::capacity() const {
-  return file_->get_size();
+  return bundle_ ? section_size_ : file_->get_size();
 }
 
 char* MappedFile::address() const {
-  return reinterpret_cast<char*>(file_->get_address());
+  return reinterpret_cast<char*>(file_->get_address()) + section_offset_;
+}
+
+#ifndef _WIN32
+static size_t resident_bytes(void* address, size_t size) {
+  if (size == 0)
+    return 0;
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t num_pages = (size + page_size - 1) / page_size;
+#ifdef __APPLE__
+  vector<char> in_core(num_pages);
+#else
+  vector<unsigned char> in_core(num_pages);
+#endif  // __APPLE__
+  if (mincore(address, size, in_core.data()) != 0)
+    return 0;
+  size_t num_resident_pages = 0;
+  for (auto page : in_core) {
+    if (page & 1)
+      ++num_resident_pages;
+  }
+  return (std::min)(num_resident_pages * page_size, size);
+}
+#endif  // _WIN32
+
+vector<MappedFileStats> MappedFile::GetStats() {
+  vector<MappedFileStats> result;
+  std::lock_guard<std::mutex> lock(g_mapped_files_mutex);
+  for (const auto* file : g_mapped_files) {
+    MappedFileStats stats;
+    stats.file_name = file->file_name();
+    stats.mapped_bytes = file->get_size();
+#ifndef _WIN32
+    stats.resident_bytes =
+        resident_bytes(file->get_address(), file->get_size());
+#endif  // _WIN32
+    result.push_back(stats);
+  }
+  return result;
 }
 
 }  // namespace rime
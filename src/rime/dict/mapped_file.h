@@ -79,6 +79,15 @@ struct List {
 // MappedFile class definition
 
 class MappedFileImpl;
+class MappedFileHandle;
+class DictBundle;
+
+struct MappedFileStats {
+  string file_name;
+  size_t mapped_bytes = 0;
+  // pages of the mapping in physical memory; always 0 on Windows
+  size_t resident_bytes = 0;
+};
 
 class RIME_API MappedFile {
  protected:
@@ -87,6 +96,9 @@ class RIME_API MappedFile {
 
   bool Create(size_t capacity);
   bool OpenReadOnly();
+  // maps the file kept open by the handle, which may no longer be the file
+  // found at the path
+  bool OpenReadOnly(const an<MappedFileHandle>& handle);
   bool OpenReadWrite();
   bool Flush();
   bool Resize(size_t capacity);
@@ -111,8 +123,12 @@ class RIME_API MappedFile {
 
   bool Exists() const;
   bool IsOpen() const;
+  // the file is read from a section of a bundle; see DictBundle
+  bool bundled() const { return bool(bundle_); }
   void Close();
   bool Remove();
+  // keeps the open file without its mapping; null if not open
+  an<MappedFileHandle> handle() const;
 
   template <class T>
   T* Find(size_t offset);
@@ -120,10 +136,19 @@ class RIME_API MappedFile {
   const string& file_name() const { return file_name_; }
   size_t file_size() const { return size_; }
 
+  // lists all files mapped into memory by the process
+  static vector<MappedFileStats> GetStats();
+
  private:
+  friend class DictBundle;
+
   string file_name_;
   size_t size_ = 0;
-  the<MappedFileImpl> file_;
+  // shared with the bundle and other sections of it
+  an<MappedFileImpl> file_;
+  an<MappedFileImpl> bundle_;
+  size_t section_offset_ = 0;
+  size_t section_size_ = 0;
 };
 
 // member function definitions
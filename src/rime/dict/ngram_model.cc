@@ -0,0 +1,497 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utf8.h>
+#include <rime/common.h>
+#include <rime/dict/ngram_model.h>
+
+namespace rime {
+
+const char kNgramModelFormat[] = "Rime::Ngram/1.0";
+
+const char kNgramModelFormatPrefix[] = "Rime::Ngram/";
+const size_t kNgramModelFormatPrefixLen = sizeof(kNgramModelFormatPrefix) - 1;
+
+const char NgramModel::kSentenceBegin[] = "<s>";
+const char NgramModel::kSentenceEnd[] = "</s>";
+
+// FNV-1a; zero marks an empty slot
+static uint64_t fingerprint(const char* text, size_t length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(text[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash ? hash : 1;
+}
+
+NgramModel::NgramModel(const string& file_name) : MappedFile(file_name) {}
+
+NgramModel::~NgramModel() {}
+
+bool NgramModel::Load() {
+  LOG(INFO) << "loading n-gram model: " << file_name();
+
+  if (IsOpen())
+    Close();
+
+  if (!OpenReadOnly()) {
+    LOG(ERROR) << "Error opening n-gram model '" << file_name() << "'.";
+    return false;
+  }
+
+  metadata_ = Find<ngram::Metadata>(0);
+  if (!metadata_) {
+    LOG(ERROR) << "metadata not found.";
+    Close();
+    return false;
+  }
+  if (strncmp(metadata_->format, kNgramModelFormatPrefix,
+              kNgramModelFormatPrefixLen)) {
+    LOG(ERROR) << "invalid metadata.";
+    metadata_ = nullptr;
+    Close();
+    return false;
+  }
+  // words are looked up by linear probing in a power of two slots, at least
+  // one of them free
+  const uint32_t num_slots = metadata_->num_slots;
+  if (metadata_->order < 1 || metadata_->order > ngram::kMaxOrder ||
+      !metadata_->slots || !metadata_->string_table ||
+      metadata_->levels[0].num_nodes != metadata_->num_words ||
+      num_slots == 0 || (num_slots & (num_slots - 1)) != 0 ||
+      num_slots <= metadata_->num_words) {
+    LOG(ERROR) << "invalid n-gram model.";
+    metadata_ = nullptr;
+    Close();
+    return false;
+  }
+  string_table_.reset(new StringTable(metadata_->string_table.get(),
+                                      metadata_->string_table_size));
+  return true;
+}
+
+bool NgramModel::Save() {
+  LOG(INFO) << "saving n-gram model: " << file_name();
+
+  if (!metadata_) {
+    LOG(ERROR) << "the n-gram model has not been constructed!";
+    return false;
+  }
+
+  return ShrinkToFit();
+}
+
+uint32_t NgramModel::num_ngrams(int order) const {
+  if (!metadata_ || order < 1 || order > (int)metadata_->order)
+    return 0;
+  return metadata_->levels[order - 1].num_nodes;
+}
+
+NgramModel::WordId NgramModel::FindWord(const char* text,
+                                        size_t length) const {
+  if (!metadata_)
+    return kInvalidStringId;
+  uint64_t fp = fingerprint(text, length);
+  const uint32_t mask = metadata_->num_slots - 1;
+  const ngram::Slot* slots = metadata_->slots.get();
+  for (uint32_t i = fp & mask;; i = (i + 1) & mask) {
+    if (slots[i].fingerprint == fp)
+      return slots[i].word_id;
+    if (!slots[i].fingerprint)
+      return kInvalidStringId;
+  }
+}
+
+string NgramModel::GetWord(WordId word_id) const {
+  return string_table_ ? string_table_->GetString(word_id) : string();
+}
+
+uint32_t NgramModel::FindChild(int order,
+                               uint32_t node,
+                               WordId word_id) const {
+  if (order >= (int)metadata_->order)
+    return kNoNode;
+  const ngram::Node* parents = metadata_->levels[order - 1].nodes.get();
+  const ngram::Node* children = metadata_->levels[order].nodes.get();
+  uint32_t begin = parents[node].next;
+  uint32_t end = parents[node + 1].next;
+  if (begin == end)
+    return kNoNode;
+  // word ids are spread evenly, so a single interpolation step usually
+  // lands close to the target before bisecting the rest.
+  WordId low = children[begin].word_id;
+  WordId high = children[end - 1].word_id;
+  if (word_id < low || word_id > high)
+    return kNoNode;
+  if (high > low) {
+    uint32_t guess =
+        begin + static_cast<uint32_t>(uint64_t(word_id - low) *
+                                      (end - 1 - begin) / (high - low));
+    if (children[guess].word_id == word_id)
+      return guess;
+    if (children[guess].word_id < word_id)
+      begin = guess + 1;
+    else
+      end = guess;
+  }
+  while (begin < end) {
+    uint32_t middle = begin + (end - begin) / 2;
+    if (children[middle].word_id < word_id)
+      begin = middle + 1;
+    else
+      end = middle;
+  }
+  if (begin < parents[node + 1].next && children[begin].word_id == word_id)
+    return begin;
+  return kNoNode;
+}
+
+void NgramModel::SetContext(const WordId* words,
+                            size_t num_words,
+                            State* state) const {
+  if (!metadata_) {
+    state->length = 0;
+    return;
+  }
+  state->length =
+      static_cast<int>(std::min<size_t>(num_words, metadata_->order - 1));
+  for (int j = 1; j <= state->length; ++j) {
+    const WordId* suffix = words + num_words - j;
+    uint32_t node = suffix[0] < metadata_->num_words ? suffix[0] : kNoNode;
+    for (int i = 1; i < j && node != kNoNode; ++i) {
+      node = FindChild(i, node, suffix[i]);
+    }
+    state->nodes[j] = node;
+  }
+}
+
+double NgramModel::Score(const State& state, WordId word_id) const {
+  if (!metadata_ || word_id >= metadata_->num_words)
+    return -std::numeric_limits<double>::infinity();
+  const ngram::Level* levels = metadata_->levels;
+  double backoff = 0.0;
+  for (int j = state.length; j >= 1; --j) {
+    uint32_t node = state.nodes[j];
+    if (node == kNoNode)
+      continue;
+    uint32_t child = FindChild(j, node, word_id);
+    if (child != kNoNode) {
+      return backoff + levels[j].prob_codebook[levels[j].nodes[child].prob];
+    }
+    const auto& level = levels[j - 1];
+    backoff += level.backoff_codebook[level.nodes[node].backoff];
+  }
+  return backoff + levels[0].prob_codebook[levels[0].nodes[word_id].prob];
+}
+
+// builder
+
+namespace {
+
+using WordIds = vector<ngram::WordId>;
+
+struct Estimate {
+  double count = 0.0;
+  double prob = 0.0;
+  double backoff = 0.0;
+  uint32_t index = 0;
+};
+
+using Estimates = map<WordIds, Estimate>;
+
+// log probability of the word following the context, with backoff to lower
+// orders which have been estimated.
+double BackoffProb(const vector<Estimates>& levels,
+                   const WordIds& context,
+                   ngram::WordId word_id) {
+  double backoff = 0.0;
+  for (size_t j = context.size(); j >= 1; --j) {
+    WordIds suffix(context.end() - j, context.end());
+    WordIds ngram(suffix);
+    ngram.push_back(word_id);
+    auto found = levels[j].find(ngram);
+    if (found != levels[j].end())
+      return backoff + found->second.prob;
+    auto parent = levels[j - 1].find(suffix);
+    if (parent != levels[j - 1].end())
+      backoff += parent->second.backoff;
+  }
+  return backoff + levels[0].at({word_id}).prob;
+}
+
+// absolute discount from the count-of-counts of one order
+double Discount(const Estimates& estimates) {
+  double n1 = 0, n2 = 0;
+  for (const auto& e : estimates) {
+    double count = e.second.count;
+    if (count >= 0.5 && count < 1.5)
+      ++n1;
+    else if (count >= 1.5 && count < 2.5)
+      ++n2;
+  }
+  double discount = (n1 > 0 && n2 > 0) ? n1 / (n1 + 2 * n2) : 0.5;
+  return (std::max)(0.1, (std::min)(0.9, discount));
+}
+
+// equal-count bins over the sorted values, represented by their means
+void Quantize(const vector<double>& values,
+              float* codebook,
+              vector<ngram::Quantized>* codes) {
+  vector<double> sorted(values);
+  std::sort(sorted.begin(), sorted.end());
+  vector<double> bin_max;
+  auto unique_end = std::unique(sorted.begin(), sorted.end());
+  if (unique_end - sorted.begin() <= ngram::kCodebookSize) {
+    for (auto it = sorted.begin(); it != unique_end; ++it) {
+      codebook[bin_max.size()] = static_cast<float>(*it);
+      bin_max.push_back(*it);
+    }
+  } else {
+    sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    for (size_t bin = 0; bin < ngram::kCodebookSize; ++bin) {
+      size_t begin = bin * n / ngram::kCodebookSize;
+      size_t end = (bin + 1) * n / ngram::kCodebookSize;
+      if (begin == end)
+        continue;
+      double sum = 0.0;
+      for (size_t i = begin; i < end; ++i)
+        sum += sorted[i];
+      codebook[bin_max.size()] = static_cast<float>(sum / (end - begin));
+      bin_max.push_back(sorted[end - 1]);
+    }
+  }
+  codes->resize(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    auto bin = std::lower_bound(bin_max.begin(), bin_max.end(), values[i]);
+    (*codes)[i] = static_cast<ngram::Quantized>(
+        (std::min)(bin - bin_max.begin(), (ptrdiff_t)bin_max.size() - 1));
+  }
+}
+
+}  // namespace
+
+bool NgramModel::Build(const NgramCounts& counts, int order) {
+  order = (std::max)(1, (std::min)(order, ngram::kMaxOrder));
+  set<string> vocabulary;
+  for (const auto& entry : counts) {
+    if (entry.first.empty() || (int)entry.first.size() > order)
+      continue;
+    vocabulary.insert(entry.first.begin(), entry.first.end());
+  }
+  if (vocabulary.empty()) {
+    LOG(ERROR) << "no n-grams to build the model from.";
+    return false;
+  }
+  size_t num_words = vocabulary.size();
+  LOG(INFO) << "building n-gram model.";
+  LOG(INFO) << "order: " << order;
+  LOG(INFO) << "num words: " << num_words;
+
+  // word ids are assigned by the string table
+  StringTableBuilder string_table;
+  vector<string> words(vocabulary.begin(), vocabulary.end());
+  WordIds word_ids(num_words);
+  size_t max_word_length = 0;
+  for (size_t i = 0; i < num_words; ++i) {
+    string_table.Add(words[i], 1.0, &word_ids[i]);
+    // sentence markers never appear in the text
+    if (words[i] == kSentenceBegin || words[i] == kSentenceEnd)
+      continue;
+    const char* text = words[i].c_str();
+    max_word_length = (std::max)(
+        max_word_length,
+        (size_t)utf8::unchecked::distance(text, text + words[i].length()));
+  }
+  string_table.Build();
+  map<string, ngram::WordId> id_of;
+  for (size_t i = 0; i < num_words; ++i) {
+    id_of[words[i]] = word_ids[i];
+  }
+
+  // levels[k - 1] holds the n-grams of order k
+  vector<Estimates> levels(order);
+  for (const auto& entry : counts) {
+    if (entry.first.empty() || (int)entry.first.size() > order)
+      continue;
+    WordIds ngram;
+    for (const auto& word : entry.first) {
+      ngram.push_back(id_of[word]);
+    }
+    levels[ngram.size() - 1][ngram].count += entry.second;
+  }
+  // the prefix of every n-gram is a node in the lower order
+  for (int k = order; k >= 2; --k) {
+    for (const auto& e : levels[k - 1]) {
+      levels[k - 2].emplace(WordIds(e.first.begin(), e.first.end() - 1),
+                            Estimate());
+    }
+  }
+  for (ngram::WordId id = 0; id < num_words; ++id) {
+    levels[0].emplace(WordIds{id}, Estimate());
+  }
+
+  // unigrams, with add-half smoothing
+  double total = 0.0;
+  for (const auto& e : levels[0]) {
+    total += e.second.count;
+  }
+  for (auto& e : levels[0]) {
+    e.second.prob =
+        std::log((e.second.count + 0.5) / (total + 0.5 * num_words));
+  }
+  // higher orders, with interpolated absolute discounting
+  for (int k = 2; k <= order; ++k) {
+    auto& lower = levels[k - 2];
+    auto& upper = levels[k - 1];
+    double discount = Discount(upper);
+    map<WordIds, pair<double, int>> contexts;
+    for (const auto& e : upper) {
+      auto& context = contexts[WordIds(e.first.begin(), e.first.end() - 1)];
+      context.first += e.second.count;
+      if (e.second.count > 0)
+        ++context.second;
+    }
+    for (const auto& c : contexts) {
+      double context_count = c.second.first;
+      double alpha = context_count > 0
+                         ? discount * c.second.second / context_count
+                         : 1.0;
+      lower[c.first].backoff = std::log(alpha);
+    }
+    for (auto& e : upper) {
+      WordIds context(e.first.begin(), e.first.end() - 1);
+      const auto& c = contexts[context];
+      double alpha = std::exp(lower[context].backoff);
+      double lower_prob = BackoffProb(
+          levels, WordIds(context.begin() + 1, context.end()), e.first.back());
+      double prob = alpha * std::exp(lower_prob);
+      if (e.second.count > 0) {
+        prob += (std::max)(e.second.count - discount, 0.0) / c.first;
+      }
+      e.second.prob = std::log(prob);
+    }
+  }
+
+  // layout
+  uint32_t num_slots = 1;
+  while (num_slots < 2 * num_words)
+    num_slots <<= 1;
+  size_t num_nodes = 0;
+  for (const auto& level : levels) {
+    num_nodes += level.size() + 1;
+  }
+  const size_t kReservedSize = 4096;
+  size_t image_size = string_table.BinarySize();
+  size_t estimated_file_size = kReservedSize + sizeof(ngram::Metadata) +
+                               image_size + sizeof(ngram::Slot) * num_slots +
+                               sizeof(ngram::Node) * num_nodes;
+  LOG(INFO) << "estimated file size: " << estimated_file_size;
+  if (!Create(estimated_file_size)) {
+    LOG(ERROR) << "Error creating n-gram model file '" << file_name() << "'.";
+    return false;
+  }
+  auto* metadata = Allocate<ngram::Metadata>();
+  if (!metadata) {
+    LOG(ERROR) << "Error creating metadata in file '" << file_name() << "'.";
+    return false;
+  }
+  metadata->order = order;
+  metadata->num_words = num_words;
+  metadata->max_word_length = max_word_length;
+  auto special_id = [&](const char* word) {
+    auto found = id_of.find(word);
+    return found != id_of.end() ? found->second : kInvalidStringId;
+  };
+  metadata->sentence_begin = special_id(kSentenceBegin);
+  metadata->sentence_end = special_id(kSentenceEnd);
+
+  char* image = Allocate<char>(image_size);
+  if (!image) {
+    LOG(ERROR) << "Error creating string table image.";
+    return false;
+  }
+  string_table.Dump(image, image_size);
+  metadata->string_table = image;
+  metadata->string_table_size = image_size;
+
+  auto* slots = Allocate<ngram::Slot>(num_slots);
+  if (!slots) {
+    LOG(ERROR) << "Error creating vocabulary index.";
+    return false;
+  }
+  for (size_t i = 0; i < num_words; ++i) {
+    uint64_t fp = fingerprint(words[i].c_str(), words[i].length());
+    uint32_t j = fp & (num_slots - 1);
+    while (slots[j].fingerprint) {
+      if (slots[j].fingerprint == fp) {
+        LOG(ERROR) << "fingerprint collision: " << words[i];
+        return false;
+      }
+      j = (j + 1) & (num_slots - 1);
+    }
+    slots[j].fingerprint = fp;
+    slots[j].word_id = word_ids[i];
+  }
+  metadata->num_slots = num_slots;
+  metadata->slots = slots;
+
+  for (int k = 1; k <= order; ++k) {
+    auto& estimates = levels[k - 1];
+    auto& level = metadata->levels[k - 1];
+    auto* nodes = Allocate<ngram::Node>(estimates.size() + 1);
+    if (!nodes) {
+      LOG(ERROR) << "Error creating n-grams of order " << k << ".";
+      return false;
+    }
+    level.num_nodes = estimates.size();
+    level.nodes = nodes;
+    // sorted by (parent, word id), as the parents are sorted the same way.
+    vector<double> probs, backoffs;
+    uint32_t index = 0;
+    for (auto& e : estimates) {
+      e.second.index = index;
+      nodes[index].word_id = e.first.back();
+      probs.push_back(e.second.prob);
+      backoffs.push_back(e.second.backoff);
+      ++index;
+    }
+    vector<ngram::Quantized> prob_codes, backoff_codes;
+    Quantize(probs, level.prob_codebook, &prob_codes);
+    Quantize(backoffs, level.backoff_codebook, &backoff_codes);
+    for (uint32_t i = 0; i < index; ++i) {
+      nodes[i].prob = prob_codes[i];
+      nodes[i].backoff = backoff_codes[i];
+    }
+    if (k == 1)
+      continue;
+    // link the parents to their children
+    auto& parents = levels[k - 2];
+    auto& parent_level = metadata->levels[k - 2];
+    vector<uint32_t> num_children(parents.size() + 1);
+    for (const auto& e : estimates) {
+      const auto& parent =
+          parents.at(WordIds(e.first.begin(), e.first.end() - 1));
+      ++num_children[parent.index + 1];
+    }
+    for (size_t i = 0; i < parents.size(); ++i) {
+      num_children[i + 1] += num_children[i];
+    }
+    for (size_t i = 0; i <= parents.size(); ++i) {
+      parent_level.nodes[i].next = num_children[i];
+    }
+  }
+  std::strncpy(metadata->format, kNgramModelFormat,
+               ngram::Metadata::kFormatMaxLength);
+  metadata_ = metadata;
+  return true;
+}
+
+}  // namespace rime
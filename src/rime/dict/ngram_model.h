@@ -0,0 +1,128 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// compiled n-gram language model, mapped into memory
+//
+#ifndef RIME_NGRAM_MODEL_H_
+#define RIME_NGRAM_MODEL_H_
+
+#include <rime_api.h>
+#include <rime/common.h>
+#include <rime/dict/mapped_file.h>
+#include <rime/dict/string_table.h>
+
+namespace rime {
+
+namespace ngram {
+
+using WordId = StringId;
+using Quantized = uint8_t;
+
+const int kMaxOrder = 5;
+const int kCodebookSize = 256;
+
+// n-grams of one order are sorted by (parent node, word id), so that the
+// children of a node are a contiguous range in the next order:
+// [nodes[i].next, nodes[i + 1].next)
+struct Node {
+  WordId word_id;
+  uint32_t next;
+  Quantized prob;
+  Quantized backoff;
+};
+
+struct Level {
+  uint32_t num_nodes;
+  // followed by a sentinel node
+  OffsetPtr<Node> nodes;
+  // natural log values of the quantized probabilities and backoff weights
+  float prob_codebook[kCodebookSize];
+  float backoff_codebook[kCodebookSize];
+};
+
+// open addressing hash table from word fingerprints to word ids
+struct Slot {
+  uint64_t fingerprint;
+  WordId word_id;
+};
+
+struct Metadata {
+  static const int kFormatMaxLength = 32;
+  char format[kFormatMaxLength];
+  uint32_t order;
+  uint32_t num_words;
+  // in characters
+  uint32_t max_word_length;
+  WordId sentence_begin;
+  WordId sentence_end;
+  OffsetPtr<char> string_table;
+  uint32_t string_table_size;
+  uint32_t num_slots;
+  OffsetPtr<Slot> slots;
+  Level levels[kMaxOrder];
+};
+
+}  // namespace ngram
+
+// counts of n-grams of all orders, keyed by the words
+using NgramCounts = map<vector<string>, double>;
+
+class NgramModel : public MappedFile {
+ public:
+  using WordId = ngram::WordId;
+
+  static const char kSentenceBegin[];
+  static const char kSentenceEnd[];
+  static const uint32_t kNoNode = (uint32_t)-1;
+
+  // the context nodes of a query, resolved once for any number of words
+  struct State {
+    // number of context words
+    int length = 0;
+    // nodes[j]: node at order j for the last j context words, or kNoNode
+    uint32_t nodes[ngram::kMaxOrder] = {};
+  };
+
+  RIME_API explicit NgramModel(const string& file_name);
+  RIME_API virtual ~NgramModel();
+
+  RIME_API bool Load();
+  RIME_API bool Save();
+  RIME_API bool Build(const NgramCounts& counts, int order);
+
+  // returns kInvalidStringId for words out of vocabulary
+  RIME_API WordId FindWord(const char* text, size_t length) const;
+  RIME_API string GetWord(WordId word_id) const;
+
+  // `words` are the context, oldest first
+  RIME_API void SetContext(const WordId* words,
+                           size_t num_words,
+                           State* state) const;
+  // natural log probability of the word following the context
+  RIME_API double Score(const State& state, WordId word_id) const;
+
+  int order() const { return metadata_ ? metadata_->order : 0; }
+  uint32_t num_words() const { return metadata_ ? metadata_->num_words : 0; }
+  uint32_t max_word_length() const {
+    return metadata_ ? metadata_->max_word_length : 0;
+  }
+  uint32_t num_ngrams(int order) const;
+  WordId sentence_begin() const {
+    return metadata_ ? metadata_->sentence_begin : kInvalidStringId;
+  }
+  WordId sentence_end() const {
+    return metadata_ ? metadata_->sentence_end : kInvalidStringId;
+  }
+
+ private:
+  // returns the index of the child node in the next order, or kNoNode
+  uint32_t FindChild(int order, uint32_t node, WordId word_id) const;
+
+  ngram::Metadata* metadata_ = nullptr;
+  the<StringTable> string_table_;
+};
+
+}  // namespace rime
+
+#endif  // RIME_NGRAM_MODEL_H_
@@ -121,6 +121,26 @@ bool Prism::Save() {
   }
   return ShrinkToFit();
 }
+bool Prism::SetDictFileChecksum(uint32_t dict_file_checksum) {
+  if (IsOpen())
+    Close();
+  if (!OpenReadWrite()) {
+    LOG(ERROR) << "error opening prism file '" << file_name() << "'.";
+    return false;
+  }
+  auto* metadata = Find<prism::Metadata>(0);
+  if (!metadata ||
+      strncmp(metadata->format, kPrismFormatPrefix, kPrismFormatPrefixLen)) {
+    LOG(ERROR) << "invalid metadata.";
+    Close();
+    return false;
+  }
+  metadata->dict_file_checksum = dict_file_checksum;
+  bool success = Flush();
+  Close();
+  return success;
+}
+
 bool Prism::Build(const Syllabary& syllabary,
                   const Script* script,
                   uint32_t dict_file_checksum,
@@ -75,6 +75,8 @@ class Prism : public MappedFile {
                       const Script* script = nullptr,
                       uint32_t dict_file_checksum = 0,
                       uint32_t schema_file_checksum = 0);
+  // binds the prism to a table rebuilt with the same syllabary
+  RIME_API bool SetDictFileChecksum(uint32_t dict_file_checksum);
 
   RIME_API bool HasKey(const string& key);
   RIME_API bool GetValue(const string& key, int* value) const;
@@ -89,6 +91,7 @@ class Prism : public MappedFile {
   uint32_t dict_file_checksum() const;
   uint32_t schema_file_checksum() const;
   Darts::DoubleArray& trie() const { return *trie_; }
+  prism::Metadata* metadata() const { return metadata_; }
 
  protected:
   the<Darts::DoubleArray> trie_;
@@ -5,23 +5,29 @@
 // 2012-01-05 GONG Chen <chen.sst@gmail.com>
 // 2014-07-06 GONG Chen <chen.sst@gmail.com> redesigned binary file format.
 //
+#include <algorithm>
 #include <cfloat>
+#include <chrono>
 #include <cstdlib>
+#include <numeric>
 #include <sstream>
 #include <boost/algorithm/string.hpp>
 #include <filesystem>
 #include <rime/resource.h>
 #include <rime/schema.h>
 #include <rime/service.h>
+#include <rime/task_scheduler.h>
 #include <rime/ticket.h>
 #include <rime/dict/db_pool_impl.h>
+#include <rime/dict/dict_bundle.h>
 #include <rime/dict/dict_settings.h>
 #include <rime/dict/reverse_lookup_dictionary.h>
 
 namespace rime {
 
-const char kReverseFormat[] = "Rime::Reverse/3.1";
-const double kReverseFormatCompatible = 3.0;
+// skipping 4.x, which readers of 3.x would take as compatible
+const char kReverseFormat[] = "Rime::Reverse/5.0";
+const double kReverseFormatCompatible = 5.0;
 
 const char kReverseFormatPrefix[] = "Rime::Reverse/";
 const size_t kReverseFormatPrefixLen = sizeof(kReverseFormatPrefix) - 1;
@@ -63,66 +69,206 @@ bool ReverseDb::Load() {
 
   key_trie_.reset(
       new StringTable(metadata_->key_trie.get(), metadata_->key_trie_size));
-  value_trie_.reset(
-      new StringTable(metadata_->value_trie.get(), metadata_->value_trie_size));
+  code_trie_.reset(
+      new StringTable(metadata_->code_trie.get(), metadata_->code_trie_size));
 
+  std::lock_guard<std::mutex> lock(codes_cache_mutex_);
+  codes_cache_.clear();
+  codes_cache_index_.clear();
   return true;
 }
 
-bool ReverseDb::Lookup(const string& text, string* result) {
-  if (!key_trie_ || !value_trie_ || !metadata_->index.size) {
+bool ReverseDb::DecodeCodes(const string& text, vector<string>* codes) {
+  codes->clear();
+  if (!key_trie_ || !code_trie_ || !metadata_->index.size) {
     return false;
   }
   StringId key_id = key_trie_->Lookup(text);
-  if (key_id == kInvalidStringId) {
+  if (key_id == kInvalidStringId || key_id >= metadata_->index.size) {
+    return false;
+  }
+  uint32_t entry = metadata_->index.at[key_id];
+  if (entry & reverse::kLastCode) {
+    codes->push_back(code_trie_->GetString(entry & ~reverse::kLastCode));
+    return true;
+  }
+  for (const StringId* p = &metadata_->code_lists.at[entry];; ++p) {
+    codes->push_back(code_trie_->GetString(*p & ~reverse::kLastCode));
+    if (*p & reverse::kLastCode)
+      break;
+  }
+  return !codes->empty();
+}
+
+bool ReverseDb::Lookup(const string& text, string* result) {
+  vector<string> codes;
+  if (!LookupCodes(text, &codes)) {
     return false;
   }
-  StringId value_id = metadata_->index.at[key_id];
-  *result = value_trie_->GetString(value_id);
-  return !result->empty();
+  *result = boost::algorithm::join(codes, " ");
+  return true;
 }
 
+bool ReverseDb::LookupCodes(const string& text, vector<string>* codes) {
+  std::lock_guard<std::mutex> lock(codes_cache_mutex_);
+  auto found = codes_cache_index_.find(text);
+  if (found != codes_cache_index_.end()) {
+    codes_cache_.splice(codes_cache_.begin(), codes_cache_, found->second);
+    *codes = found->second->second;
+    return !codes->empty();
+  }
+  DecodeCodes(text, codes);
+  if (codes_cache_.size() >= kCodesCacheCapacity) {
+    codes_cache_index_.erase(codes_cache_.back().first);
+    codes_cache_.pop_back();
+  }
+  codes_cache_.emplace_front(text, *codes);
+  codes_cache_index_[text] = codes_cache_.begin();
+  return !codes->empty();
+}
+
+// texts are spread over shards by hash, so that the shards can be merged
+// independently.
+static const size_t kNumShards = 64;
+
+// text -> indices of the pages it is found in
+using PageLists = hash_map<string, vector<uint32_t>>;
+
 bool ReverseDb::Build(DictSettings* settings,
                       const Syllabary& syllabary,
                       const Vocabulary& vocabulary,
                       const ReverseLookupTable& stems,
                       uint32_t dict_file_checksum) {
   LOG(INFO) << "building reversedb...";
-  ReverseLookupTable rev_table;
-  int syllable_id = 0;
+  auto start_time = std::chrono::steady_clock::now();
+  // pages follow the order of the syllabary, which is the order of the
+  // codes in each list.
+  vector<pair<const string*, const ShortDictEntryList*>> pages;
+  SyllableId syllable_id = 0;
   for (const string& syllable : syllabary) {
-    auto it = vocabulary.find(syllable_id++);
-    if (it == vocabulary.end())
-      continue;
-    const auto& entries(it->second.entries);
-    for (const auto& e : entries) {
-      rev_table[e->text].insert(syllable);
+    auto page = vocabulary.find(syllable_id++);
+    if (page != vocabulary.end() && !page->second.entries.empty())
+      pages.emplace_back(&syllable, &page->second.entries);
+  }
+  // aggregate the syllables of each text in per-range shards
+  map<size_t, vector<PageLists>> ranges;
+  std::mutex ranges_mutex;
+  ParallelFor(pages.size(), [&](size_t begin, size_t end) {
+    vector<PageLists> shards(kNumShards);
+    std::hash<string> hasher;
+    for (size_t i = begin; i < end; ++i) {
+      for (const auto& e : *pages[i].second) {
+        shards[hasher(e->text) % kNumShards][e->text].push_back(i);
+      }
     }
+    std::lock_guard<std::mutex> lock(ranges_mutex);
+    ranges[begin] = std::move(shards);
+  });
+  // merge the shards, in the order of the ranges
+  vector<PageLists> shards(kNumShards);
+  ParallelFor(
+      kNumShards,
+      [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+          auto& shard = shards[k];
+          for (auto& range : ranges) {
+            if (shard.empty()) {
+              shard.swap(range.second[k]);
+              continue;
+            }
+            for (auto& v : range.second[k]) {
+              auto& ids = shard[v.first];
+              ids.insert(ids.end(), v.second.begin(), v.second.end());
+            }
+            PageLists().swap(range.second[k]);
+          }
+          for (auto& v : shard) {
+            auto& ids = v.second;
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+          }
+        }
+      },
+      1);
+  ranges.clear();
+
+  // the code trie holds syllables and stems alike
+  StringTableBuilder code_trie_builder;
+  vector<StringId> page_code_ids(pages.size());
+  for (size_t i = 0; i < pages.size(); ++i) {
+    code_trie_builder.Add(*pages[i].first, 0.0, &page_code_ids[i]);
+  }
+  set<string> stem_codes;
+  for (const auto& v : stems) {
+    stem_codes.insert(v.second.begin(), v.second.end());
   }
+  map<string, StringId> stem_code_ids;
+  for (const string& code : stem_codes) {
+    code_trie_builder.Add(code, 0.0, &stem_code_ids[code]);
+  }
+  code_trie_builder.Build();
+
+  // identical code lists are stored once
+  vector<StringId> code_lists;
+  map<vector<StringId>, uint32_t> code_list_index;
+  auto add_code_list = [&](vector<StringId>&& list) {
+    if (list.size() == 1)
+      return list[0] | reverse::kLastCode;
+    auto found = code_list_index.find(list);
+    if (found != code_list_index.end())
+      return found->second;
+    uint32_t position = static_cast<uint32_t>(code_lists.size());
+    code_lists.insert(code_lists.end(), list.begin(), list.end());
+    code_lists.back() |= reverse::kLastCode;
+    code_list_index.emplace(std::move(list), position);
+    return position;
+  };
+
   StringTableBuilder key_trie_builder;
-  StringTableBuilder value_trie_builder;
-  size_t entry_count = rev_table.size() + stems.size();
+  size_t entry_count = stems.size();
+  for (const auto& shard : shards) {
+    entry_count += shard.size();
+  }
   vector<StringId> key_ids(entry_count);
-  vector<StringId> value_ids(entry_count);
-  int i = 0;
-  // save reverse lookup entries
-  for (const auto& v : rev_table) {
-    const string& key(v.first);
-    string value(boost::algorithm::join(v.second, " "));
-    key_trie_builder.Add(key, 0.0, &key_ids[i]);
-    value_trie_builder.Add(value, 0.0, &value_ids[i]);
-    ++i;
+  vector<vector<StringId>> lists(entry_count);
+  size_t i = 0;
+  // reverse lookup entries
+  for (const auto& shard : shards) {
+    for (const auto& v : shard) {
+      auto& list = lists[i];
+      list.reserve(v.second.size());
+      for (uint32_t page : v.second) {
+        list.push_back(page_code_ids[page]);
+      }
+      key_trie_builder.Add(v.first, 0.0, &key_ids[i]);
+      ++i;
+    }
   }
-  // save stems
+  // stems
   for (const auto& v : stems) {
-    string key(v.first + kStemKeySuffix);
-    string value(boost::algorithm::join(v.second, " "));
-    key_trie_builder.Add(key, 0.0, &key_ids[i]);
-    value_trie_builder.Add(value, 0.0, &value_ids[i]);
+    auto& list = lists[i];
+    list.reserve(v.second.size());
+    for (const string& code : v.second) {
+      list.push_back(stem_code_ids[code]);
+    }
+    key_trie_builder.Add(v.first + kStemKeySuffix, 0.0, &key_ids[i]);
     ++i;
   }
   key_trie_builder.Build();
-  value_trie_builder.Build();
+  // the shards are visited in hash order, which differs with the number of
+  // threads; code lists are pooled in the order of key ids instead, so that
+  // the file is the same however it is built.
+  vector<size_t> key_order(entry_count);
+  std::iota(key_order.begin(), key_order.end(), 0);
+  std::sort(key_order.begin(), key_order.end(),
+            [&](size_t a, size_t b) { return key_ids[a] < key_ids[b]; });
+  vector<uint32_t> positions(entry_count);
+  for (size_t i : key_order) {
+    positions[i] = add_code_list(std::move(lists[i]));
+  }
+  vector<vector<StringId>>().swap(lists);
+  size_t num_shared_lists = code_list_index.size();
+  map<vector<StringId>, uint32_t>().swap(code_list_index);
+  vector<PageLists>().swap(shards);
 
   // dict settings required by UniTE
   string dict_settings;
@@ -135,12 +281,13 @@ bool ReverseDb::Build(DictSettings* settings,
   // creating reversedb file
   const size_t kReservedSize = 1024;
   size_t key_trie_image_size = key_trie_builder.BinarySize();
-  size_t value_trie_image_size = value_trie_builder.BinarySize();
-  size_t estimated_data_size = kReservedSize + dict_settings.length() +
-                               entry_count * sizeof(StringId) +
-                               key_trie_image_size + value_trie_image_size;
+  size_t code_trie_image_size = code_trie_builder.BinarySize();
+  size_t estimated_data_size =
+      kReservedSize + dict_settings.length() + entry_count * sizeof(uint32_t) +
+      code_lists.size() * sizeof(StringId) + key_trie_image_size +
+      code_trie_image_size;
   if (!Create(estimated_data_size)) {
-    LOG(ERROR) << "Error creating prism file '" << file_name() << "'.";
+    LOG(ERROR) << "Error creating reversedb file '" << file_name() << "'.";
     return false;
   }
 
@@ -158,16 +305,25 @@ bool ReverseDb::Build(DictSettings* settings,
     }
   }
 
-  auto entries = Allocate<StringId>(entry_count);
+  auto entries = Allocate<uint32_t>(entry_count);
   if (!entries) {
     return false;
   }
   for (size_t i = 0; i < entry_count; ++i) {
-    entries[key_ids[i]] = value_ids[i];
+    entries[key_ids[i]] = positions[i];
   }
   metadata_->index.size = entry_count;
   metadata_->index.at = entries;
 
+  auto pool = Allocate<StringId>(code_lists.size());
+  if (!pool) {
+    LOG(ERROR) << "Error creating code lists.";
+    return false;
+  }
+  std::copy(code_lists.begin(), code_lists.end(), pool);
+  metadata_->code_lists.size = code_lists.size();
+  metadata_->code_lists.at = pool;
+
   // save key trie image
   char* key_trie_image = Allocate<char>(key_trie_image_size);
   if (!key_trie_image) {
@@ -178,19 +334,25 @@ bool ReverseDb::Build(DictSettings* settings,
   metadata_->key_trie = key_trie_image;
   metadata_->key_trie_size = key_trie_image_size;
 
-  // save value trie image
-  char* value_trie_image = Allocate<char>(value_trie_image_size);
-  if (!value_trie_image) {
-    LOG(ERROR) << "Error creating value trie image.";
+  // save code trie image
+  char* code_trie_image = Allocate<char>(code_trie_image_size);
+  if (!code_trie_image) {
+    LOG(ERROR) << "Error creating code trie image.";
     return false;
   }
-  value_trie_builder.Dump(value_trie_image, value_trie_image_size);
-  metadata_->value_trie = value_trie_image;
-  metadata_->value_trie_size = value_trie_image_size;
+  code_trie_builder.Dump(code_trie_image, code_trie_image_size);
+  metadata_->code_trie = code_trie_image;
+  metadata_->code_trie_size = code_trie_image_size;
 
   // at last, complete the metadata
   std::strncpy(metadata_->format, kReverseFormat,
                reverse::Metadata::kFormatMaxLength);
+  LOG(INFO) << "reversedb: " << entry_count << " entries, "
+            << num_shared_lists << " lists of multiple codes, built in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start_time)
+                   .count()
+            << " ms.";
   return true;
 }
 
@@ -199,6 +361,26 @@ bool ReverseDb::Save() {
   return ShrinkToFit();
 }
 
+bool ReverseDb::SetDictFileChecksum(uint32_t dict_file_checksum) {
+  if (IsOpen())
+    Close();
+  if (!OpenReadWrite()) {
+    LOG(ERROR) << "error opening reversedb file '" << file_name() << "'.";
+    return false;
+  }
+  auto* metadata = Find<reverse::Metadata>(0);
+  if (!metadata || strncmp(metadata->format, kReverseFormat,
+                           reverse::Metadata::kFormatMaxLength)) {
+    LOG(ERROR) << "not a reversedb of the latest format.";
+    Close();
+    return false;
+  }
+  metadata->dict_file_checksum = dict_file_checksum;
+  bool success = Flush();
+  Close();
+  return success;
+}
+
 uint32_t ReverseDb::dict_file_checksum() const {
   return metadata_ ? metadata_->dict_file_checksum : 0;
 }
@@ -218,6 +400,16 @@ bool ReverseLookupDictionary::LookupStems(const string& text, string* result) {
   return db_->Lookup(text + kStemKeySuffix, result);
 }
 
+bool ReverseLookupDictionary::ReverseLookup(const string& text,
+                                            vector<string>* codes) {
+  return db_->LookupCodes(text, codes);
+}
+
+bool ReverseLookupDictionary::LookupStems(const string& text,
+                                          vector<string>* codes) {
+  return db_->LookupCodes(text + kStemKeySuffix, codes);
+}
+
 an<DictSettings> ReverseLookupDictionary::GetDictSettings() {
   an<DictSettings> settings;
   reverse::Metadata* metadata = db_->metadata();
@@ -235,10 +427,15 @@ an<DictSettings> ReverseLookupDictionary::GetDictSettings() {
 static const ResourceType kReverseDbResourceType = {"reverse_db", "",
                                                     ".reverse.bin"};
 
+static const ResourceType kBundleResourceType = {"bundle", "", ".bundle.bin"};
+
 ReverseLookupDictionaryComponent::ReverseLookupDictionaryComponent()
     : DbPool(the<ResourceResolver>(
-          Service::instance().CreateDeployedResourceResolver(
-              kReverseDbResourceType))) {}
+          Service::shared_instance().CreateDeployedResourceResolver(
+              kReverseDbResourceType))),
+      bundle_resource_resolver_(
+          Service::shared_instance().CreateDeployedResourceResolver(
+              kBundleResourceType)) {}
 
 ReverseLookupDictionary* ReverseLookupDictionaryComponent::Create(
     const string& dict_name) {
@@ -256,6 +453,28 @@ ReverseLookupDictionary* ReverseLookupDictionaryComponent::Create(
     // missing!
     return NULL;
   }
+  bool use_bundle = false;
+  if (config->GetBool(ticket.name_space + "/bundle", &use_bundle) &&
+      use_bundle) {
+    // the bundle is named after the prism of the dictionary
+    string prism_name;
+    if (!config->GetString(ticket.name_space + "/prism", &prism_name)) {
+      prism_name = dict_name;
+    }
+    auto bundle_path =
+        bundle_resource_resolver_->ResolvePath(prism_name).string();
+    auto bundle = DictBundle::Open(bundle_path);
+    if (bundle && bundle->HasSection("reverse")) {
+      // the section is pooled apart from the stand-alone file
+      auto db = GetDb(bundle_path + "#reverse", [&]() {
+        auto file_path = resource_resolver_->ResolvePath(dict_name).string();
+        auto db = New<ReverseDb>(file_path);
+        bundle->Attach("reverse", db.get());
+        return db;
+      });
+      return new ReverseLookupDictionary(db);
+    }
+  }
   return Create(dict_name);
 }
 
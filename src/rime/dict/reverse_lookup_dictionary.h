@@ -9,6 +9,8 @@
 #define RIME_REVERSE_LOOKUP_DICTIONARY_H_
 
 #include <stdint.h>
+#include <list>
+#include <mutex>
 #include <rime/common.h>
 #include <rime/component.h>
 #include <rime/dict/db_pool.h>
@@ -20,16 +22,24 @@ namespace rime {
 
 namespace reverse {
 
+// marks the last code id of a list in the pool. an index entry with the
+// mark is the only code of the key, and is not stored in the pool.
+const uint32_t kLastCode = 0x80000000;
+
+// codes are stored once in the code trie; each distinct list of more than
+// one code is stored once in the pool as a sequence of code ids.
 struct Metadata {
   static const int kFormatMaxLength = 32;
   char format[kFormatMaxLength];
   uint32_t dict_file_checksum;
   String dict_settings;
-  List<StringId> index;
+  // key id -> position of the code list in the pool, or the marked code id
+  List<uint32_t> index;
   OffsetPtr<char> key_trie;
   uint32_t key_trie_size;
-  OffsetPtr<char> value_trie;
-  uint32_t value_trie_size;
+  OffsetPtr<char> code_trie;
+  uint32_t code_trie_size;
+  List<StringId> code_lists;
 };
 
 }  // namespace reverse
@@ -39,10 +49,13 @@ class DictSettings;
 
 class ReverseDb : public MappedFile {
  public:
-  explicit ReverseDb(const string& file_name);
+  RIME_API explicit ReverseDb(const string& file_name);
 
-  bool Load();
+  RIME_API bool Load();
+  // looks up the codes separated by spaces in the result.
   bool Lookup(const string& text, string* result);
+  // results of recent lookups, including misses, are cached.
+  bool LookupCodes(const string& text, vector<string>* codes);
 
   bool Build(DictSettings* settings,
              const Syllabary& syllabary,
@@ -50,14 +63,28 @@ class ReverseDb : public MappedFile {
              const ReverseLookupTable& stems,
              uint32_t dict_file_checksum);
   bool Save();
+  // binds a db of the latest format to edited dict files that the same
+  // entries are collected from
+  bool SetDictFileChecksum(uint32_t dict_file_checksum);
 
   uint32_t dict_file_checksum() const;
   reverse::Metadata* metadata() const { return metadata_; }
 
+  static const size_t kCodesCacheCapacity = 4096;
+
  private:
+  // decodes the code list of the text, without caching
+  bool DecodeCodes(const string& text, vector<string>* codes);
+
   reverse::Metadata* metadata_ = nullptr;
   the<StringTable> key_trie_;
-  the<StringTable> value_trie_;
+  the<StringTable> code_trie_;
+
+  // most recently used first
+  using CodesCache = std::list<pair<string, vector<string>>>;
+  std::mutex codes_cache_mutex_;
+  CodesCache codes_cache_;
+  hash_map<string, CodesCache::iterator> codes_cache_index_;
 };
 
 class ReverseLookupDictionary
@@ -67,6 +94,8 @@ class ReverseLookupDictionary
   bool Load();
   bool ReverseLookup(const string& text, string* result);
   bool LookupStems(const string& text, string* result);
+  bool ReverseLookup(const string& text, vector<string>* codes);
+  bool LookupStems(const string& text, vector<string>* codes);
   an<DictSettings> GetDictSettings();
 
  protected:
@@ -82,6 +111,9 @@ class ReverseLookupDictionaryComponent
   ReverseLookupDictionaryComponent();
   ReverseLookupDictionary* Create(const Ticket& ticket);
   ReverseLookupDictionary* Create(const string& dict_name);
+
+ private:
+  the<ResourceResolver> bundle_resource_resolver_;
 };
 
 }  // namespace rime
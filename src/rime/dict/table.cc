@@ -7,6 +7,7 @@
 #include <cfloat>
 #include <cstring>
 #include <algorithm>
+#include <filesystem>
 #include <queue>
 #include <utility>
 #include <rime/common.h>
@@ -17,8 +18,15 @@
 
 namespace rime {
 
-const char kTableFormatLatest[] = "Rime::Table/4.0";
+const char kTableFormatLatest[] = "Rime::Table/4.1";
 const int kTableFormatLowestCompatible = 4.0;
+// partitioned tables
+const double kTableFormatPartitioned = 4.1;
+
+const char kTablePartitionFormat[] = "Rime::TablePartition/1.0";
+const char kTablePartitionFormatPrefix[] = "Rime::TablePartition/";
+const size_t kTablePartitionFormatPrefixLen =
+    sizeof(kTablePartitionFormatPrefix) - 1;
 
 const char kTableFormatPrefix[] = "Rime::Table/";
 const size_t kTableFormatPrefixLen = sizeof(kTableFormatPrefix) - 1;
@@ -137,15 +145,25 @@ static table::TrunkIndexNode* find_node(table::TrunkIndexNode* first,
   return it == last || key < it->key ? last : it;
 }
 
+const table::HeadIndexNode* TableQuery::FindHeadNode(
+    SyllableId syllable_id,
+    an<TablePartition>* partition) const {
+  if (table_)
+    return table_->FindHeadNode(syllable_id, partition);
+  if (!lv1_index_ || syllable_id < 0 ||
+      syllable_id >= static_cast<SyllableId>(lv1_index_->size))
+    return nullptr;
+  return &lv1_index_->at[syllable_id];
+}
+
 bool TableQuery::Walk(SyllableId syllable_id) {
   if (level_ == 0) {
-    if (!lv1_index_ || syllable_id < 0 ||
-        syllable_id >= static_cast<SyllableId>(lv1_index_->size))
-      return false;
-    auto node = &lv1_index_->at[syllable_id];
-    if (!node->next_level)
+    an<TablePartition> partition;
+    auto node = FindHeadNode(syllable_id, &partition);
+    if (!node || !node->next_level)
       return false;
     lv2_index_ = &node->next_level->trunk();
+    partition_ = std::move(partition);
   } else if (level_ == 1) {
     if (!lv2_index_)
       return false;
@@ -179,12 +197,14 @@ TableAccessor TableQuery::Access(SyllableId syllable_id,
                                  double credibility) const {
   credibility += credibility_.back();
   if (level_ == 0) {
-    if (!lv1_index_ || syllable_id < 0 ||
-        syllable_id >= static_cast<SyllableId>(lv1_index_->size))
+    an<TablePartition> partition;
+    auto node = FindHeadNode(syllable_id, &partition);
+    if (!node)
       return TableAccessor();
-    auto node = &lv1_index_->at[syllable_id];
-    return TableAccessor(add_syllable(index_code_, syllable_id), &node->entries,
-                         credibility);
+    TableAccessor accessor(add_syllable(index_code_, syllable_id),
+                           &node->entries, credibility);
+    accessor.partition_ = std::move(partition);
+    return accessor;
   } else if (level_ == 1 || level_ == 2) {
     auto index = (level_ == 1) ? lv2_index_ : lv3_index_;
     if (!index)
@@ -192,12 +212,16 @@ TableAccessor TableQuery::Access(SyllableId syllable_id,
     auto node = find_node(index->begin(), index->end(), syllable_id);
     if (node == index->end())
       return TableAccessor();
-    return TableAccessor(add_syllable(index_code_, syllable_id), &node->entries,
-                         credibility);
+    TableAccessor accessor(add_syllable(index_code_, syllable_id),
+                           &node->entries, credibility);
+    accessor.partition_ = partition_;
+    return accessor;
   } else if (level_ == 3) {
     if (!lv4_index_)
       return TableAccessor();
-    return TableAccessor(index_code_, lv4_index_, credibility);
+    TableAccessor accessor(index_code_, lv4_index_, credibility);
+    accessor.partition_ = partition_;
+    return accessor;
   }
   return TableAccessor();
 }
@@ -248,7 +272,100 @@ bool Table::OnLoad() {
   return true;
 }
 
-Table::Table(const string& file_name) : MappedFile(file_name) {}
+TablePartition::TablePartition(const string& file_name, Table* table)
+    : TableFile(file_name), table_(table) {}
+
+bool TablePartition::Load(uint32_t dict_file_checksum,
+                          SyllableId begin,
+                          SyllableId end,
+                          const an<MappedFileHandle>& handle) {
+  LOG(INFO) << "loading table partition: " << file_name();
+
+  if (IsOpen())
+    Close();
+
+  if (!OpenReadOnly(handle)) {
+    LOG(ERROR) << "Error opening table partition '" << file_name() << "'.";
+    return false;
+  }
+  metadata_ = Find<table::PartitionMetadata>(0);
+  if (!metadata_ || strncmp(metadata_->format, kTablePartitionFormatPrefix,
+                            kTablePartitionFormatPrefixLen)) {
+    LOG(ERROR) << "invalid metadata.";
+    Close();
+    return false;
+  }
+  // must have been built along with the root table
+  index_ = metadata_->index.get();
+  if (metadata_->dict_file_checksum != dict_file_checksum ||
+      metadata_->begin != begin || metadata_->end != end || !index_ ||
+      index_->size != static_cast<uint32_t>(end - begin)) {
+    LOG(ERROR) << "table partition does not match the table.";
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool TablePartition::Save() {
+  LOG(INFO) << "saving table partition: " << file_name();
+
+  if (!index_) {
+    LOG(ERROR) << "the table partition has not been constructed!";
+    return false;
+  }
+
+  return ShrinkToFit();
+}
+
+bool TablePartition::Build(const Vocabulary& vocabulary,
+                           SyllableId begin,
+                           SyllableId end,
+                           size_t num_entries,
+                           uint32_t dict_file_checksum,
+                           uint32_t partition) {
+  const size_t kReservedSize = 4096;
+  size_t estimated_file_size =
+      kReservedSize + 32 * (end - begin) + 64 * num_entries;
+  if (!Create(estimated_file_size)) {
+    LOG(ERROR) << "Error creating table partition '" << file_name() << "'.";
+    return false;
+  }
+  metadata_ = Allocate<table::PartitionMetadata>();
+  if (!metadata_) {
+    LOG(ERROR) << "Error creating metadata in file '" << file_name() << "'.";
+    return false;
+  }
+  metadata_->dict_file_checksum = dict_file_checksum;
+  metadata_->partition = partition;
+  metadata_->begin = begin;
+  metadata_->end = end;
+  index_ = BuildHeadIndex(vocabulary, begin, end);
+  if (!index_) {
+    LOG(ERROR) << "Error creating table index.";
+    return false;
+  }
+  metadata_->index = index_;
+  std::strncpy(metadata_->format, kTablePartitionFormat,
+               table::PartitionMetadata::kFormatMaxLength);
+  return true;
+}
+
+const table::HeadIndexNode* TablePartition::FindHeadNode(
+    SyllableId syllable_id) const {
+  SyllableId i = syllable_id - metadata_->begin;
+  if (i < 0 || i >= static_cast<SyllableId>(index_->size))
+    return nullptr;
+  return &index_->at[i];
+}
+
+bool TablePartition::AddString(const string& src,
+                               table::StringType* dest,
+                               double weight) {
+  return table_ && table_->AddString(src, dest, weight);
+}
+
+Table::Table(const string& file_name) : TableFile(file_name) {}
 
 Table::~Table() {}
 
@@ -289,7 +406,39 @@ bool Table::Load() {
     return false;
   }
   index_ = metadata_->index.get();
-  if (!index_) {
+  {
+    std::lock_guard<std::mutex> lock(partitions_mutex_);
+    partitions_.clear();
+    partition_bounds_ = nullptr;
+    if (format_version >= kTableFormatPartitioned - DBL_EPSILON &&
+        metadata_->num_partitions > 0) {
+      partition_bounds_ = metadata_->partition_bounds.get();
+      if (!partition_bounds_ ||
+          partition_bounds_->size != metadata_->num_partitions + 1) {
+        LOG(ERROR) << "table partitions not found.";
+        partition_bounds_ = nullptr;
+        Close();
+        return false;
+      }
+      partitions_.resize(metadata_->num_partitions);
+      // validates every partition now, and keeps the files open to map
+      // them on demand later
+      for (size_t k = 0; k < partitions_.size(); ++k) {
+        TablePartition partition(partition_file_name(k));
+        if (!partition.Load(metadata_->dict_file_checksum,
+                            partition_bounds_->at[k],
+                            partition_bounds_->at[k + 1])) {
+          LOG(ERROR) << "table partition " << k << " is not available.";
+          partitions_.clear();
+          partition_bounds_ = nullptr;
+          Close();
+          return false;
+        }
+        partitions_[k].pinned = partition.handle();
+      }
+    }
+  }
+  if (!index_ && !partition_bounds_) {
     LOG(ERROR) << "table index not found.";
     Close();
     return false;
@@ -301,14 +450,193 @@ bool Table::Load() {
 bool Table::Save() {
   LOG(INFO) << "saving table file: " << file_name();
 
-  if (!index_) {
+  if (!index_ && partitions_.empty()) {
     LOG(ERROR) << "the table has not been constructed!";
     return false;
   }
 
+  for (auto& slot : partitions_) {
+    if (!slot.mapped || !slot.mapped->Save())
+      return false;
+  }
+  partitions_.clear();
+  // to be loaded again from the saved file
+  partition_bounds_ = nullptr;
   return ShrinkToFit();
 }
 
+bool Table::Remove() {
+  RemovePartitionFiles();
+  return MappedFile::Remove();
+}
+
+string Table::partition_file_name(size_t partition) const {
+  // foo.table.bin => foo.table.0.bin
+  const string kExtension = ".bin";
+  string base = file_name();
+  if (base.length() >= kExtension.length() &&
+      base.compare(base.length() - kExtension.length(), kExtension.length(),
+                   kExtension) == 0) {
+    base.erase(base.length() - kExtension.length());
+  }
+  return base + "." + std::to_string(partition) + kExtension;
+}
+
+void Table::RemovePartitionFiles() {
+  // those recorded in the table file are removed even if some are missing;
+  // files of more partitions, from an older build, as long as they are found
+  size_t num_partitions = recorded_num_partitions();
+  for (size_t k = 0;; ++k) {
+    std::filesystem::path path(partition_file_name(k));
+    std::error_code ec;
+    if (!std::filesystem::remove(path, ec) && k >= num_partitions)
+      break;
+  }
+}
+
+size_t Table::recorded_num_partitions() {
+  if (IsOpen())
+    return partition_bounds_ ? num_partitions() : 0;
+  if (bundled() || !Exists() || !OpenReadOnly())
+    return 0;
+  size_t count = 0;
+  auto metadata = Find<table::Metadata>(0);
+  if (metadata &&
+      !strncmp(metadata->format, kTableFormatPrefix, kTableFormatPrefixLen) &&
+      atof(&metadata->format[kTableFormatPrefixLen]) >=
+          kTableFormatPartitioned - DBL_EPSILON) {
+    count = metadata->num_partitions;
+  }
+  Close();
+  return count;
+}
+
+const table::HeadIndexNode* Table::FindHeadNode(
+    SyllableId syllable_id,
+    an<TablePartition>* partition) {
+  if (index_) {
+    if (syllable_id < 0 || syllable_id >= static_cast<SyllableId>(index_->size))
+      return nullptr;
+    return &index_->at[syllable_id];
+  }
+  if (!partition_bounds_ || syllable_id < 0 ||
+      syllable_id >= partition_bounds_->end()[-1])
+    return nullptr;
+  auto bound = std::upper_bound(partition_bounds_->begin(),
+                                partition_bounds_->end(), syllable_id);
+  auto found = GetPartition(bound - partition_bounds_->begin() - 1);
+  if (!found)
+    return nullptr;
+  auto node = found->FindHeadNode(syllable_id);
+  *partition = std::move(found);
+  return node;
+}
+
+an<TablePartition> Table::GetPartition(size_t partition) {
+  std::lock_guard<std::mutex> lock(partitions_mutex_);
+  if (partition >= partitions_.size())
+    return nullptr;
+  auto& slot = partitions_[partition];
+  slot.last_used = ++partition_clock_;
+  if (slot.mapped)
+    return slot.mapped;
+  auto found = slot.in_use.lock();
+  if (!found) {
+    found = New<TablePartition>(partition_file_name(partition));
+    // maps the file validated by Load, even if replaced since then
+    if (!found->Load(metadata_->dict_file_checksum,
+                     partition_bounds_->at[partition],
+                     partition_bounds_->at[partition + 1], slot.pinned)) {
+      return nullptr;
+    }
+    slot.in_use = found;
+  }
+  slot.mapped = found;
+  EvictPartitions(partition);
+  return found;
+}
+
+void Table::EvictPartitions(size_t keep) {
+  if (partition_budget_ == 0)
+    return;
+  size_t mapped_bytes = 0;
+  for (const auto& slot : partitions_) {
+    if (slot.mapped)
+      mapped_bytes += slot.mapped->file_size();
+  }
+  while (mapped_bytes > partition_budget_) {
+    PartitionSlot* victim = nullptr;
+    for (size_t k = 0; k < partitions_.size(); ++k) {
+      auto& slot = partitions_[k];
+      if (k != keep && slot.mapped &&
+          (!victim || slot.last_used < victim->last_used))
+        victim = &slot;
+    }
+    if (!victim)
+      break;
+    mapped_bytes -= victim->mapped->file_size();
+    victim->mapped.reset();
+  }
+}
+
+void Table::set_partition_budget(size_t budget) {
+  std::lock_guard<std::mutex> lock(partitions_mutex_);
+  partition_budget_ = budget;
+  EvictPartitions(partitions_.size());
+}
+
+void Table::RequestPartitionBudget(size_t budget) {
+  std::lock_guard<std::mutex> lock(partitions_mutex_);
+  // no limit is the largest budget of all
+  if (!partition_budget_requested_ ||
+      (partition_budget_ != 0 &&
+       (budget == 0 || budget > partition_budget_))) {
+    partition_budget_ = budget;
+  }
+  partition_budget_requested_ = true;
+  EvictPartitions(partitions_.size());
+}
+
+size_t Table::partition_budget() {
+  std::lock_guard<std::mutex> lock(partitions_mutex_);
+  return partition_budget_;
+}
+
+size_t Table::num_mapped_partitions() {
+  std::lock_guard<std::mutex> lock(partitions_mutex_);
+  size_t count = 0;
+  for (const auto& slot : partitions_) {
+    if (slot.in_use.lock())
+      ++count;
+  }
+  return count;
+}
+
+bool Table::SetDictFileChecksum(uint32_t dict_file_checksum) {
+  if (IsOpen())
+    Close();
+  if (!OpenReadWrite()) {
+    LOG(ERROR) << "error opening table file '" << file_name() << "'.";
+    return false;
+  }
+  auto* metadata = Find<table::Metadata>(0);
+  if (!metadata || strncmp(metadata->format, kTableFormatLatest,
+                           table::Metadata::kFormatMaxLength)) {
+    LOG(ERROR) << "not a table of the latest format.";
+    Close();
+    return false;
+  }
+  if (metadata->num_partitions > 0) {
+    LOG(ERROR) << "partitions are bound to the table checksum.";
+    Close();
+    return false;
+  }
+  metadata->dict_file_checksum = dict_file_checksum;
+  bool success = Flush();
+  Close();
+  return success;
+}
+
 uint32_t Table::dict_file_checksum() const {
   return metadata_ ? metadata_->dict_file_checksum : 0;
 }
@@ -316,7 +644,8 @@ uint32_t Table::dict_file_checksum() const {
 bool Table::Build(const Syllabary& syllabary,
                   const Vocabulary& vocabulary,
                   size_t num_entries,
-                  uint32_t dict_file_checksum) {
+                  uint32_t dict_file_checksum,
+                  size_t num_partitions) {
 
   nvtx3::event_attributes attr{"Table::Build", nvtx3::rgb{128, 0, 0}};
   nvtx3::scoped_range r{attr};
@@ -329,6 +658,10 @@ bool Table::Build(const Syllabary& syllabary,
   LOG(INFO) << "num syllables: " << num_syllables;
   LOG(INFO) << "num entries: " << num_entries;
   LOG(INFO) << "estimated file size: " << estimated_file_size;
+  // before the table file holding their number is overwritten
+  RemovePartitionFiles();
+  partitions_.clear();
+  partition_bounds_ = nullptr;
   if (!Create(estimated_file_size)) {
     LOG(ERROR) << "Error creating table file '" << file_name() << "'.";
     return false;
@@ -361,13 +694,22 @@ bool Table::Build(const Syllabary& syllabary,
   }
   metadata_->syllabary = syllabary_;
 
-  LOG(INFO) << "creating table index.";
-  index_ = BuildIndex(vocabulary, num_syllables);
-  if (!index_) {
-    LOG(ERROR) << "Error creating table index.";
-    return false;
+  num_partitions = (std::min)(num_partitions, num_syllables);
+  if (num_partitions > 1) {
+    LOG(INFO) << "creating " << num_partitions << " table partitions.";
+    if (!BuildPartitions(vocabulary, num_syllables, num_partitions)) {
+      LOG(ERROR) << "Error creating table partitions.";
+      return false;
+    }
+  } else {
+    LOG(INFO) << "creating table index.";
+    index_ = BuildIndex(vocabulary, num_syllables);
+    if (!index_) {
+      LOG(ERROR) << "Error creating table index.";
+      return false;
+    }
+    metadata_->index = index_;
   }
-  metadata_->index = index_;
 
   if (!OnBuildFinish()) {
     return false;
@@ -382,26 +724,93 @@ bool Table::Build(const Syllabary& syllabary,
 table::Index* Table::BuildIndex(const Vocabulary& vocabulary,
                                 size_t num_syllables) {
   return reinterpret_cast<table::Index*>(
-      BuildHeadIndex(vocabulary, num_syllables));
+      BuildHeadIndex(vocabulary, 0, num_syllables));
+}
+
+static size_t count_entries(const Vocabulary& vocabulary) {
+  size_t count = 0;
+  for (const auto& v : vocabulary) {
+    count += v.second.entries.size();
+    if (v.second.next_level)
+      count += count_entries(*v.second.next_level);
+  }
+  return count;
+}
+
+bool Table::BuildPartitions(const Vocabulary& vocabulary,
+                            size_t num_syllables,
+                            size_t num_partitions) {
+  // split syllable ids into ranges of about the same number of entries,
+  // each having at least one syllable.
+  vector<size_t> num_entries(num_syllables);
+  size_t total = 0;
+  for (const auto& v : vocabulary) {
+    if (v.first < 0 || v.first >= static_cast<int>(num_syllables))
+      continue;
+    num_entries[v.first] = v.second.entries.size();
+    if (v.second.next_level)
+      num_entries[v.first] += count_entries(*v.second.next_level);
+    total += num_entries[v.first];
+  }
+  vector<SyllableId> bounds{0};
+  size_t count = 0;
+  for (size_t i = 0; i + 1 < num_syllables && bounds.size() < num_partitions;
+       ++i) {
+    count += num_entries[i];
+    size_t k = bounds.size();
+    if (count * num_partitions >= total * k ||
+        num_syllables - (i + 1) <= num_partitions - k) {
+      bounds.push_back(static_cast<SyllableId>(i + 1));
+    }
+  }
+  bounds.push_back(static_cast<SyllableId>(num_syllables));
+
+  for (size_t k = 0; k < num_partitions; ++k) {
+    size_t partition_entries = 0;
+    for (SyllableId i = bounds[k]; i < bounds[k + 1]; ++i) {
+      partition_entries += num_entries[i];
+    }
+    auto partition = New<TablePartition>(partition_file_name(k), this);
+    if (!partition->Build(vocabulary, bounds[k], bounds[k + 1],
+                          partition_entries, metadata_->dict_file_checksum,
+                          k)) {
+      return false;
+    }
+    // kept open until the string table is built
+    PartitionSlot slot;
+    slot.mapped = std::move(partition);
+    partitions_.push_back(std::move(slot));
+  }
+
+  partition_bounds_ = CreateArray<SyllableId>(bounds.size());
+  if (!partition_bounds_) {
+    return false;
+  }
+  std::copy(bounds.begin(), bounds.end(), partition_bounds_->begin());
+  metadata_->num_partitions = num_partitions;
+  metadata_->partition_bounds = partition_bounds_;
+  return true;
 }
 
-table::HeadIndex* Table::BuildHeadIndex(const Vocabulary& vocabulary,
-                                        size_t num_syllables) {
-  auto index = CreateArray<table::HeadIndexNode>(num_syllables);
+table::HeadIndex* TableFile::BuildHeadIndex(const Vocabulary& vocabulary,
+                                            SyllableId begin,
+                                            SyllableId end) {
+  auto index = CreateArray<table::HeadIndexNode>(end - begin);
   if (!index) {
     return NULL;
   }
-  for (const auto& v : vocabulary) {
-    int syllable_id = v.first;
-    auto& node(index->at[syllable_id]);
-    const auto& entries(v.second.entries);
+  for (auto v = vocabulary.lower_bound(begin);
+       v != vocabulary.end() && v->first < end; ++v) {
+    int syllable_id = v->first;
+    auto& node(index->at[syllable_id - begin]);
+    const auto& entries(v->second.entries);
     if (!BuildEntryList(entries, &node.entries)) {
       return NULL;
     }
-    if (v.second.next_level) {
+    if (v->second.next_level) {
       Code code;
       code.push_back(syllable_id);
-      auto next_level_index = BuildTrunkIndex(code, *v.second.next_level);
+      auto next_level_index = BuildTrunkIndex(code, *v->second.next_level);
       if (!next_level_index) {
         return NULL;
       }
@@ -411,8 +820,8 @@ table::HeadIndex* Table::BuildHeadIndex(const Vocabulary& vocabulary,
   return index;
 }
 
-table::TrunkIndex* Table::BuildTrunkIndex(const Code& prefix,
-                                          const Vocabulary& vocabulary) {
+table::TrunkIndex* TableFile::BuildTrunkIndex(const Code& prefix,
+                                              const Vocabulary& vocabulary) {
   auto index = CreateArray<table::TrunkIndexNode>(vocabulary.size());
   if (!index) {
     return NULL;
@@ -448,8 +857,8 @@ table::TrunkIndex* Table::BuildTrunkIndex(const Code& prefix,
   return index;
 }
 
-table::TailIndex* Table::BuildTailIndex(const Code& prefix,
-                                        const Vocabulary& vocabulary) {
+table::TailIndex* TableFile::BuildTailIndex(const Code& prefix,
+                                            const Vocabulary& vocabulary) {
   if (vocabulary.find(-1) == vocabulary.end()) {
     return NULL;
   }
@@ -479,7 +888,8 @@ table::TailIndex* Table::BuildTailIndex(const Code& prefix,
   return index;
 }
 
-Array<table::Entry>* Table::BuildEntryArray(const ShortDictEntryList& entries) {
+Array<table::Entry>* TableFile::BuildEntryArray(
+    const ShortDictEntryList& entries) {
   auto array = CreateArray<table::Entry>(entries.size());
   if (!array) {
     return NULL;
@@ -492,8 +902,8 @@ Array<table::Entry>* Table::BuildEntryArray(const ShortDictEntryList& entries) {
   return array;
 }
 
-bool Table::BuildEntryList(const ShortDictEntryList& src,
-                           List<table::Entry>* dest) {
+bool TableFile::BuildEntryList(const ShortDictEntryList& src,
+                               List<table::Entry>* dest) {
   if (!dest)
     return false;
   dest->size = src.size();
@@ -510,7 +920,8 @@ bool Table::BuildEntryList(const ShortDictEntryList& src,
   return true;
 }
 
-bool Table::BuildEntry(const ShortDictEntry& dict_entry, table::Entry* entry) {
+bool TableFile::BuildEntry(const ShortDictEntry& dict_entry,
+                           table::Entry* entry) {
   if (!entry)
     return false;
   if (!AddString(dict_entry.text, &entry->text, dict_entry.weight)) {
@@ -538,14 +949,14 @@ string Table::GetSyllableById(SyllableId syllable_id) {
 }
 
 TableAccessor Table::QueryWords(SyllableId syllable_id) {
-  TableQuery query(index_);
+  TableQuery query(this);
   return query.Access(syllable_id);
 }
 
 TableAccessor Table::QueryPhrases(const Code& code) {
   if (code.empty())
     return TableAccessor();
-  TableQuery query(index_);
+  TableQuery query(this);
   for (size_t i = 0; i < Code::kIndexCodeMaxLength; ++i) {
     if (code.size() == i + 1)
       return query.Access(code[i]);
@@ -557,12 +968,14 @@ TableAccessor Table::QueryPhrases(const Code& code) {
 
 bool Table::Query(const SyllableGraph& syll_graph,
                   size_t start_pos,
-                  TableQueryResult* result) {
-  if (!result || !index_ || start_pos >= syll_graph.interpreted_length)
+                  TableQueryResult* result,
+                  size_t max_frontier) {
+  if (!result || (!index_ && !partition_bounds_) ||
+      start_pos >= syll_graph.interpreted_length)
     return false;
   result->clear();
   std::queue<pair<size_t, TableQuery>> q;
-  TableQuery initial_state(index_);
+  TableQuery initial_state(this);
   q.push({start_pos, initial_state});
   while (!q.empty()) {
     size_t current_pos = q.front().first;
@@ -587,6 +1000,9 @@ bool Table::Query(const SyllableGraph& syll_graph,
         if (!accessor.exhausted()) {
           (*result)[end_pos].push_back(accessor);
         }
+        if (max_frontier && q.size() >= max_frontier) {
+          continue;  // stop extending phrases
+        }
         if (end_pos < syll_graph.interpreted_length &&
             query.Advance(syll_id, props->credibility)) {
           q.push({end_pos, query});
@@ -9,6 +9,7 @@
 #define RIME_TABLE_H_
 
 #include <cstring>
+#include <mutex>
 #include <rime/common.h>
 #include <rime/dict/mapped_file.h>
 #include <rime/dict/vocabulary.h>
@@ -89,10 +90,27 @@ struct Metadata {
   int32_t reserved_2;
   OffsetPtr<char> string_table;
   uint32_t string_table_size;
+  // v4.1
+  // a partitioned table has no index in the root file; partition k holds the
+  // head index for syllable ids [partition_bounds[k], partition_bounds[k + 1])
+  uint32_t num_partitions;
+  OffsetPtr<Array<SyllableId>> partition_bounds;
+};
+
+struct PartitionMetadata {
+  static const int kFormatMaxLength = 32;
+  char format[kFormatMaxLength];
+  uint32_t dict_file_checksum;
+  uint32_t partition;
+  SyllableId begin;
+  SyllableId end;
+  OffsetPtr<HeadIndex> index;
 };
 
 }  // namespace table
 
+class TablePartition;
+
 class TableAccessor {
  public:
   TableAccessor() = default;
@@ -115,23 +133,31 @@ class TableAccessor {
   const Code& index_code() const { return index_code_; }
   Code code() const;
   double credibility() const { return credibility_; }
+  // keeps the partition holding the entries mapped; null if not partitioned
+  const an<TablePartition>& partition() const { return partition_; }
 
  private:
+  friend class TableQuery;
+
   Code index_code_;
   const table::Entry* entries_ = nullptr;
   const table::LongEntry* long_entries_ = nullptr;
   size_t size_ = 0;
   size_t cursor_ = 0;
   double credibility_ = 0.0;
+  an<TablePartition> partition_;
 };
 
 using TableQueryResult = map<int, vector<TableAccessor>>;
 
 struct SyllableGraph;
+class Table;
 
 class TableQuery {
  public:
   TableQuery(table::Index* index) : lv1_index_(index) { Reset(); }
+  // also works with partitioned tables
+  explicit TableQuery(Table* table) : table_(table) { Reset(); }
 
   TableAccessor Access(SyllableId syllable_id, double credibility = 0.0) const;
 
@@ -153,54 +179,145 @@ class TableQuery {
 
  private:
   bool Walk(SyllableId syllable_id);
+  const table::HeadIndexNode* FindHeadNode(
+      SyllableId syllable_id,
+      an<TablePartition>* partition) const;
 
+  Table* table_ = nullptr;
   table::HeadIndex* lv1_index_ = nullptr;
   table::TrunkIndex* lv2_index_ = nullptr;
   table::TrunkIndex* lv3_index_ = nullptr;
   table::TailIndex* lv4_index_ = nullptr;
+  // holding the lower level indices
+  an<TablePartition> partition_;
+};
+
+// a file holding table index, either the whole table or a partition of it
+class TableFile : public MappedFile {
+ protected:
+  explicit TableFile(const string& file_name) : MappedFile(file_name) {}
+
+  // builds the head index for syllable ids [begin, end)
+  table::HeadIndex* BuildHeadIndex(const Vocabulary& vocabulary,
+                                   SyllableId begin,
+                                   SyllableId end);
+  table::TrunkIndex* BuildTrunkIndex(const Code& prefix,
+                                     const Vocabulary& vocabulary);
+  table::TailIndex* BuildTailIndex(const Code& prefix,
+                                   const Vocabulary& vocabulary);
+  Array<table::Entry>* BuildEntryArray(const ShortDictEntryList& entries);
+  bool BuildEntryList(const ShortDictEntryList& src, List<table::Entry>* dest);
+  bool BuildEntry(const ShortDictEntry& dict_entry, table::Entry* entry);
+
+  virtual bool AddString(const string& src,
+                         table::StringType* dest,
+                         double weight) = 0;
+};
+
+class TablePartition : public TableFile {
+ public:
+  TablePartition(const string& file_name, Table* table = nullptr);
+
+  // maps the file kept open by the handle if given
+  bool Load(uint32_t dict_file_checksum,
+            SyllableId begin,
+            SyllableId end,
+            const an<MappedFileHandle>& handle = nullptr);
+  bool Save();
+  // strings are added to the string table of the root table
+  bool Build(const Vocabulary& vocabulary,
+             SyllableId begin,
+             SyllableId end,
+             size_t num_entries,
+             uint32_t dict_file_checksum,
+             uint32_t partition);
+
+  const table::HeadIndexNode* FindHeadNode(SyllableId syllable_id) const;
+
+ protected:
+  bool AddString(const string& src,
+                 table::StringType* dest,
+                 double weight) override;
+
+ private:
+  Table* table_;
+  table::PartitionMetadata* metadata_ = nullptr;
+  table::HeadIndex* index_ = nullptr;
 };
 
-class Table : public MappedFile {
+class Table : public TableFile {
  public:
   RIME_API Table(const string& file_name);
   virtual ~Table();
 
   RIME_API bool Load();
   RIME_API bool Save();
+  // also removes the partition files
+  RIME_API bool Remove();
+  // with more than 1 partition, the index is split into separate files
+  // that are mapped on demand.
   RIME_API bool Build(const Syllabary& syllabary,
                       const Vocabulary& vocabulary,
                       size_t num_entries,
-                      uint32_t dict_file_checksum = 0);
+                      uint32_t dict_file_checksum = 0,
+                      size_t num_partitions = 1);
+  // binds a table of the latest format, not partitioned, to edited dict
+  // files that the same entries are collected from
+  RIME_API bool SetDictFileChecksum(uint32_t dict_file_checksum);
+
+  // maps the partition holding the node if necessary, and keeps it mapped
+  // as long as the partition pointer is held.
+  RIME_API const table::HeadIndexNode* FindHeadNode(
+      SyllableId syllable_id,
+      an<TablePartition>* partition);
+  // partitions are unmapped, least recently used first, when the mapped
+  // partitions take more bytes than the budget; 0 for no limit.
+  // those still in use by queries stay mapped until they are released.
+  RIME_API void set_partition_budget(size_t budget);
+  // for a table shared by dictionaries with different budgets: the budget is
+  // raised to the largest asked for, so that none of them has fewer bytes of
+  // partitions mapped than configured. 0 asks for no limit.
+  RIME_API void RequestPartitionBudget(size_t budget);
+  RIME_API size_t partition_budget();
+  RIME_API size_t num_mapped_partitions();
+  size_t num_partitions() const {
+    return partition_bounds_ ? partition_bounds_->size - 1 : 0;
+  }
+  RIME_API string partition_file_name(size_t partition) const;
 
   bool GetSyllabary(Syllabary* syllabary);
   RIME_API string GetSyllableById(int syllable_id);
   RIME_API TableAccessor QueryWords(int syllable_id);
   RIME_API TableAccessor QueryPhrases(const Code& code);
+  // max_frontier caps the number of pending query states; 0 for no limit.
   RIME_API bool Query(const SyllableGraph& syll_graph,
                       size_t start_pos,
-                      TableQueryResult* result);
+                      TableQueryResult* result,
+                      size_t max_frontier = 0);
   RIME_API string GetEntryText(const table::Entry& entry);
 
   uint32_t dict_file_checksum() const;
   table::Metadata* metadata() const { return metadata_; }
 
  private:
+  friend class TablePartition;
+
   table::Index* BuildIndex(const Vocabulary& vocabulary, size_t num_syllables);
-  table::HeadIndex* BuildHeadIndex(const Vocabulary& vocabulary,
-                                   size_t num_syllables);
-  table::TrunkIndex* BuildTrunkIndex(const Code& prefix,
-                                     const Vocabulary& vocabulary);
-  table::TailIndex* BuildTailIndex(const Code& prefix,
-                                   const Vocabulary& vocabulary);
+  bool BuildPartitions(const Vocabulary& vocabulary,
+                       size_t num_syllables,
+                       size_t num_partitions);
   bool BuildPhraseIndex(Code code,
                         const Vocabulary& vocabulary,
                         map<string, int>* index_data);
-  Array<table::Entry>* BuildEntryArray(const ShortDictEntryList& entries);
-  bool BuildEntryList(const ShortDictEntryList& src, List<table::Entry>* dest);
-  bool BuildEntry(const ShortDictEntry& dict_entry, table::Entry* entry);
+  an<TablePartition> GetPartition(size_t partition);
+  void EvictPartitions(size_t keep);
+  void RemovePartitionFiles();
+  size_t recorded_num_partitions();
 
   string GetString(const table::StringType& x);
-  bool AddString(const string& src, table::StringType* dest, double weight);
+  bool AddString(const string& src,
+                 table::StringType* dest,
+                 double weight) override;
   bool OnBuildStart();
   bool OnBuildFinish();
   bool OnLoad();
@@ -212,6 +329,22 @@ class Table : public MappedFile {
 
   the<StringTable> string_table_;
   the<StringTableBuilder> string_table_builder_;
+
+  struct PartitionSlot {
+    an<TablePartition> mapped;
+    // still mapped while held by queries after being evicted
+    weak<TablePartition> in_use;
+    uint64_t last_used = 0;
+    // the file validated by Load, kept open so that the partition is mapped
+    // again as loaded after its path is taken by a later deployment
+    an<MappedFileHandle> pinned;
+  };
+  Array<SyllableId>* partition_bounds_ = nullptr;
+  vector<PartitionSlot> partitions_;
+  std::mutex partitions_mutex_;
+  size_t partition_budget_ = 0;
+  bool partition_budget_requested_ = false;
+  uint64_t partition_clock_ = 0;
 };
 
 }  // namespace rime
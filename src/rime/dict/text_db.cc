@@ -80,11 +80,25 @@ bool TextDb::Fetch(const string& key, string* value) {
   return true;
 }
 
+// approximates the heap usage of a node in the tree map
+static size_t entry_memory_usage(const string& key, const string& value) {
+  const size_t kNodeOverhead = 4 * sizeof(void*);
+  return sizeof(TextDbData::value_type) + kNodeOverhead + key.size() +
+         value.size();
+}
+
 bool TextDb::Update(const string& key, const string& value) {
   if (!loaded() || readonly())
     return false;
   DLOG(INFO) << "update db entry: " << key << " => " << value;
-  data_[key] = value;
+  auto it = data_.find(key);
+  if (it != data_.end()) {
+    memory_usage_ -= entry_memory_usage(it->first, it->second);
+    it->second = value;
+  } else {
+    data_.emplace(key, value);
+  }
+  memory_usage_ += entry_memory_usage(key, value);
   modified_ = true;
   return true;
 }
@@ -93,8 +107,11 @@ bool TextDb::Erase(const string& key) {
   if (!loaded() || readonly())
     return false;
   DLOG(INFO) << "erase db entry: " << key;
-  if (data_.erase(key) == 0)
+  auto it = data_.find(key);
+  if (it == data_.end())
     return false;
+  memory_usage_ -= entry_memory_usage(it->first, it->second);
+  data_.erase(it);
   modified_ = true;
   return true;
 }
@@ -151,6 +168,7 @@ bool TextDb::Close() {
 void TextDb::Clear() {
   metadata_.clear();
   data_.clear();
+  memory_usage_ = 0;
 }
 
 bool TextDb::Backup(const string& snapshot_file) {
@@ -487,7 +487,13 @@ UserDictionaryComponent::UserDictionaryComponent() {}
 
 UserDictionary* UserDictionaryComponent::Create(const string& dict_name,
                                                 const string& db_class) {
-  auto db = db_pool_[dict_name].lock();
+  // tenants have separate user dbs of the same name
+  Service& service = Service::instance();
+  string db_key = service.is_tenant()
+                      ? service.deployer().user_data_dir + '/' + dict_name
+                      : dict_name;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto db = db_pool_[db_key].lock();
   if (!db) {
     auto component = Db::Require(db_class);
     if (!component) {
@@ -495,11 +501,23 @@ UserDictionary* UserDictionaryComponent::Create(const string& dict_name,
       return NULL;
     }
     db.reset(component->Create(dict_name));
-    db_pool_[dict_name] = db;
+    db_pool_[db_key] = db;
   }
   return new UserDictionary(dict_name, db);
 }
 
+size_t UserDictionaryComponent::GetCacheStats(size_t* memory_usage) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t num_dbs = 0;
+  for (const auto& entry : db_pool_) {
+    if (auto db = entry.second.lock()) {
+      ++num_dbs;
+      *memory_usage += db->memory_usage();
+    }
+  }
+  return num_dbs;
+}
+
 UserDictionary* UserDictionaryComponent::Create(const Ticket& ticket) {
   if (!ticket.schema)
     return NULL;
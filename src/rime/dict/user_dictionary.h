@@ -8,6 +8,7 @@
 #define RIME_USER_DICTIONARY_H_
 
 #include <time.h>
+#include <mutex>
 #include <rime/common.h>
 #include <rime/component.h>
 #include <rime/dict/user_db.h>
@@ -107,9 +108,14 @@ class UserDictionaryComponent : public UserDictionary::Component {
   UserDictionaryComponent();
   UserDictionary* Create(const Ticket& ticket);
   UserDictionary* Create(const string& dict_name, const string& db_class);
+  // returns the number of cached user dbs in use, and adds up their memory
+  // usage
+  size_t GetCacheStats(size_t* memory_usage);
 
  private:
+  // keyed by dict name, prefixed with the user data dir of tenants
   map<string, weak<Db>> db_pool_;
+  std::mutex mutex_;
 };
 
 }  // namespace rime
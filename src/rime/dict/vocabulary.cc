@@ -98,7 +98,8 @@ inline void sort_range(C& container, size_t start, size_t count) {
 }
 
 void ShortDictEntryList::Sort() {
-  sort(*this);
+  // homophones of equal weight keep their original order
+  std::stable_sort(begin(), end(), dereference_less<value_type>);
 }
 
 void ShortDictEntryList::SortRange(size_t start, size_t count) {
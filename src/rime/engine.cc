@@ -17,6 +17,7 @@
 #include <rime/schema.h>
 #include <rime/segmentation.h>
 #include <rime/segmentor.h>
+#include <rime/service.h>
 #include <rime/switcher.h>
 #include <rime/switches.h>
 #include <rime/ticket.h>
@@ -33,11 +34,16 @@ class ConcreteEngine : public Engine {
   virtual void ApplySchema(Schema* schema);
   virtual void CommitText(string text);
   virtual void Compose(Context* ctx);
+  virtual an<Candidate> Probe(const string& input);
+  virtual void set_schema_pool_size(size_t size);
+  virtual void ReleaseSchemaPool();
+  virtual size_t EstimateMemoryUsage() const;
 
  protected:
+  void ConnectContext();
   void InitializeComponents();
   void InitializeOptions();
-  void CalculateSegmentation(Segmentation* segments);
+  void CalculateSegmentation(Segmentation* segments, size_t caret_pos);
   void TranslateSegments(Segmentation* segments);
   void FormatText(string* text);
   void OnCommit(Context* ctx);
@@ -55,6 +61,27 @@ class ConcreteEngine : public Engine {
   // To make sure dumping user.yaml when processors_.clear(),
   // switcher is owned by processors_[0]
   weak<Switcher> switcher_;
+
+  // components of a schema switched away from
+  struct SchemaComponents {
+    the<Schema> schema;
+    vector<of<Processor>> processors;
+    vector<of<Segmentor>> segmentors;
+    vector<of<Translator>> translators;
+    vector<of<Filter>> filters;
+    vector<of<Formatter>> formatters;
+    vector<of<Processor>> post_processors;
+    weak<Switcher> switcher;
+    int deployment_count;
+    // slots connected to the context by the components
+    the<Context::Notifiers> notifiers;
+  };
+  void SuspendComponents();
+  bool ResumeComponents(const string& schema_id);
+
+  // most recently used first
+  list<SchemaComponents> schema_pool_;
+  size_t schema_pool_size_ = 0;
 };
 
 // implementations
@@ -72,7 +99,17 @@ Engine::~Engine() {
 
 ConcreteEngine::ConcreteEngine() {
   LOG(INFO) << "starting engine.";
-  // receive context notifications
+  ConnectContext();
+  InitializeComponents();
+  InitializeOptions();
+}
+
+ConcreteEngine::~ConcreteEngine() {
+  LOG(INFO) << "engine disposed.";
+}
+
+// receive context notifications
+void ConcreteEngine::ConnectContext() {
   context_->commit_notifier().connect([this](Context* ctx) { OnCommit(ctx); });
   context_->select_notifier().connect([this](Context* ctx) { OnSelect(ctx); });
   context_->update_notifier().connect(
@@ -85,12 +122,6 @@ ConcreteEngine::ConcreteEngine() {
       [this](Context* ctx, const string& property) {
         OnPropertyUpdate(ctx, property);
       });
-  InitializeComponents();
-  InitializeOptions();
-}
-
-ConcreteEngine::~ConcreteEngine() {
-  LOG(INFO) << "engine disposed.";
 }
 
 bool ConcreteEngine::ProcessKey(const KeyEvent& key_event) {
@@ -160,12 +191,29 @@ void ConcreteEngine::Compose(Context* ctx) {
     // translate one segment past caret pos.
     comp.Reset(ctx->input());
   }
-  CalculateSegmentation(&comp);
+  CalculateSegmentation(&comp, ctx->caret_pos());
   TranslateSegments(&comp);
   DLOG(INFO) << "composition: [" << comp.GetDebugText() << "]";
 }
 
-void ConcreteEngine::CalculateSegmentation(Segmentation* segments) {
+an<Candidate> ConcreteEngine::Probe(const string& input) {
+  // segments shared with the current input keep their menus, so only the
+  // changed tail is segmented and translated again.
+  Composition comp(context_->composition());
+  comp.Reset(input);
+  CalculateSegmentation(&comp, input.length());
+  TranslateSegments(&comp);
+  DLOG(INFO) << "probed composition: [" << comp.GetDebugText() << "]";
+  if (comp.empty())
+    return nullptr;
+  const auto& menu(comp.back().menu);
+  if (!menu || menu->empty())
+    return nullptr;
+  return comp.back().GetSelectedCandidate();
+}
+
+void ConcreteEngine::CalculateSegmentation(Segmentation* segments,
+                                           size_t caret_pos) {
   DLOG(INFO) << "CalculateSegmentation, segments: " << segments->size()
              << ", finished? " << segments->HasFinishedSegmentation();
   while (!segments->HasFinishedSegmentation()) {
@@ -184,7 +232,7 @@ void ConcreteEngine::CalculateSegmentation(Segmentation* segments) {
       break;
     // only one segment is allowed past caret pos, which is the segment
     // immediately after the caret.
-    if (start_pos >= context_->caret_pos())
+    if (start_pos >= caret_pos)
       break;
     // move onto the next segment...
     if (!segments->HasFinishedSegmentation())
@@ -289,12 +337,134 @@ void ConcreteEngine::ApplySchema(Schema* schema) {
                           time(NULL));
     }
   }
+  // reapplying the current schema reloads it
+  if (schema_pool_size_ > 0 && schema_->schema_id() != schema->schema_id()) {
+    context_->Clear();
+    SuspendComponents();
+  }
   schema_.reset(schema);
   context_->Clear();
   context_->ClearTransientOptions();
-  InitializeComponents();
+  if (!ResumeComponents(schema->schema_id())) {
+    InitializeComponents();
+  }
+  // only now that the schema switched to is out of the pool
+  while (schema_pool_.size() > schema_pool_size_)
+    schema_pool_.pop_back();
   InitializeOptions();
-  message_sink_("schema", schema->schema_id() + "/" + schema->schema_name());
+  message_sink_("schema",
+                schema_->schema_id() + "/" + schema_->schema_name());
+}
+
+static int current_deployment() {
+  return Service::shared_instance().deployer().deployment_count();
+}
+
+void ConcreteEngine::SuspendComponents() {
+  for (auto& processor : processors_)
+    processor->Suspend();
+  for (auto& segmentor : segmentors_)
+    segmentor->Suspend();
+  for (auto& translator : translators_)
+    translator->Suspend();
+  for (auto& filter : filters_)
+    filter->Suspend();
+  for (auto& processor : post_processors_)
+    processor->Suspend();
+  // components keeping the default Suspend() are also detached from the
+  // context, whatever they connected to
+  the<Context::Notifiers> notifiers(new Context::Notifiers);
+  context_->SwapNotifiers(notifiers.get());
+  ConnectContext();
+  schema_pool_.push_front(SchemaComponents{
+      std::move(schema_), std::move(processors_), std::move(segmentors_),
+      std::move(translators_), std::move(filters_), std::move(formatters_),
+      std::move(post_processors_), std::move(switcher_), current_deployment(),
+      std::move(notifiers)});
+  processors_.clear();
+  segmentors_.clear();
+  translators_.clear();
+  filters_.clear();
+  formatters_.clear();
+  post_processors_.clear();
+  switcher_.reset();
+}
+
+bool ConcreteEngine::ResumeComponents(const string& schema_id) {
+  int deployment_count = current_deployment();
+  for (auto it = schema_pool_.begin(); it != schema_pool_.end();) {
+    if (it->deployment_count != deployment_count) {
+      it = schema_pool_.erase(it);  // outdated
+      continue;
+    }
+    if (it->schema->schema_id() != schema_id) {
+      ++it;
+      continue;
+    }
+    LOG(INFO) << "resuming components of schema: " << schema_id;
+    schema_ = std::move(it->schema);
+    processors_ = std::move(it->processors);
+    segmentors_ = std::move(it->segmentors);
+    translators_ = std::move(it->translators);
+    filters_ = std::move(it->filters);
+    formatters_ = std::move(it->formatters);
+    post_processors_ = std::move(it->post_processors);
+    switcher_ = std::move(it->switcher);
+    context_->SwapNotifiers(it->notifiers.get());
+    schema_pool_.erase(it);
+    for (auto& processor : processors_)
+      processor->Resume();
+    for (auto& segmentor : segmentors_)
+      segmentor->Resume();
+    for (auto& translator : translators_)
+      translator->Resume();
+    for (auto& filter : filters_)
+      filter->Resume();
+    for (auto& processor : post_processors_)
+      processor->Resume();
+    return true;
+  }
+  return false;
+}
+
+// the components themselves are not accounted for; they mostly refer to
+// data shared among engines
+template <class T>
+static size_t EstimateComponents(const vector<T>& components) {
+  return components.capacity() * sizeof(T);
+}
+
+size_t ConcreteEngine::EstimateMemoryUsage() const {
+  size_t size = sizeof(ConcreteEngine) + EstimateComponents(processors_) +
+                EstimateComponents(segmentors_) +
+                EstimateComponents(translators_) +
+                EstimateComponents(filters_) +
+                EstimateComponents(formatters_) +
+                EstimateComponents(post_processors_);
+  for (const auto& pooled : schema_pool_) {
+    size += sizeof(pooled) + sizeof(Schema) + sizeof(Context::Notifiers) +
+            EstimateComponents(pooled.processors) +
+            EstimateComponents(pooled.segmentors) +
+            EstimateComponents(pooled.translators) +
+            EstimateComponents(pooled.filters) +
+            EstimateComponents(pooled.formatters) +
+            EstimateComponents(pooled.post_processors);
+  }
+  return size;
+}
+
+void ConcreteEngine::set_schema_pool_size(size_t size) {
+  schema_pool_size_ = size;
+  if (schema_pool_.size() > size)
+    schema_pool_.resize(size);
+}
+
+void ConcreteEngine::ReleaseSchemaPool() {
+  if (!schema_pool_.empty()) {
+    LOG(INFO) << "releasing components of " << schema_pool_.size()
+              << " schemas.";
+    schema_pool_.clear();
+  }
 }
 
 void ConcreteEngine::InitializeComponents() {
@@ -302,6 +472,8 @@ void ConcreteEngine::InitializeComponents() {
   segmentors_.clear();
   translators_.clear();
   filters_.clear();
+  formatters_.clear();
+  post_processors_.clear();
 
   if (auto switcher = New<Switcher>(this)) {
     switcher_ = switcher;
@@ -13,6 +13,7 @@
 
 namespace rime {
 
+class Candidate;
 class KeyEvent;
 class Schema;
 class Context;
@@ -26,6 +27,18 @@ class Engine : public Messenger {
   virtual void ApplySchema(Schema* schema) {}
   virtual void CommitText(string text) { sink_(text); }
   virtual void Compose(Context* ctx) {}
+  // composes `input` on a scratch copy of the current composition and returns
+  // the candidate that would be selected in the last segment. neither the
+  // context nor its observers are touched.
+  virtual an<Candidate> Probe(const string& input) { return nullptr; }
+  // keeps the components of up to `size` schemas recently switched away
+  // from, so that switching back to them takes no reloading. 0 disables it.
+  virtual void set_schema_pool_size(size_t size) {}
+  // releases the components kept for switching schemas.
+  virtual void ReleaseSchemaPool() {}
+  // approximates the heap usage of the engine and the schemas it keeps for
+  // switching, excluding the context and the data shared among engines
+  virtual size_t EstimateMemoryUsage() const { return sizeof(Engine); }
 
   Schema* schema() const { return schema_.get(); }
   Context* context() const { return context_.get(); }
@@ -30,6 +30,10 @@ class Filter : public Class<Filter, const Ticket&> {
 
   virtual bool AppliesToSegment(Segment* segment) { return true; }
 
+  // called when the engine sets the component aside and puts it back to use.
+  virtual void Suspend() {}
+  virtual void Resume() {}
+
   string name_space() const { return name_space_; }
 
  protected:
@@ -0,0 +1,240 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+#include <rime/context.h>
+#include <rime/engine.h>
+#include <rime/flight_recorder.h>
+#include <rime/key_event.h>
+#include <rime/schema.h>
+
+namespace rime {
+
+FlightRecorder::FlightRecorder(size_t capacity,
+                               int threshold_ms,
+                               const string& dump_dir)
+    : ring_((std::max)(capacity, size_t(1))),
+      threshold_(std::chrono::milliseconds(threshold_ms)),
+      dump_dir_(dump_dir) {}
+
+void FlightRecorder::BeginKey(const KeyEvent& key_event, Engine* engine) {
+  KeystrokeRecord& record = ring_[next_];
+  Engine* active = engine->active_engine();
+  Schema* schema = active->schema();
+  Context* ctx = active->context();
+  // assigning to the reused strings seldom allocates
+  record.schema_id.assign(schema ? schema->schema_id() : string());
+  record.options.resize(ctx->options().size());
+  auto option = record.options.begin();
+  for (const auto& entry : ctx->options()) {
+    option->first.assign(entry.first);
+    option->second = entry.second;
+    ++option;
+  }
+  record.input.assign(ctx->input());
+  record.caret_pos = ctx->caret_pos();
+  record.key.assign(key_event.repr());
+  key_start_time_ = std::chrono::steady_clock::now();
+}
+
+bool FlightRecorder::EndKey(bool accepted) {
+  auto elapsed = std::chrono::steady_clock::now() - key_start_time_;
+  KeystrokeRecord& record = ring_[next_];
+  record.accepted = accepted;
+  record.elapsed_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  next_ = (next_ + 1) % ring_.size();
+  if (size_ < ring_.size())
+    ++size_;
+  if (elapsed < threshold_)
+    return false;
+  LOG(WARNING) << "slow key: " << record.key << ", " << record.elapsed_us
+               << " us.";
+  return Dump();
+}
+
+// dumps of the process are numbered, so that those written by recorders in
+// the same millisecond do not overwrite each other
+static std::atomic<unsigned> g_dump_count{0};
+
+bool FlightRecorder::Dump() {
+  if (size_ == 0)
+    return false;
+  auto now = std::chrono::system_clock::now();
+  time_t seconds = std::chrono::system_clock::to_time_t(now);
+  auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          now.time_since_epoch())
+                          .count() %
+                      1000;
+  struct tm local_time;
+#ifdef _WIN32
+  localtime_s(&local_time, &seconds);
+#else
+  localtime_r(&seconds, &local_time);
+#endif
+  char timestamp[20];
+  strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &local_time);
+  std::ostringstream file_name;
+  file_name << "rime.slow_keys." << timestamp << "." << std::setw(3)
+            << std::setfill('0') << milliseconds << "." << std::hex
+            << reinterpret_cast<uintptr_t>(this) << "." << std::dec
+            << ++g_dump_count << ".txt";
+  auto file_path = std::filesystem::path(dump_dir_) / file_name.str();
+  bool success = Save(file_path.string(), records());
+  if (success) {
+    LOG(INFO) << "dumped " << size_ << " keys to " << file_path;
+    last_dump_file_ = file_path.string();
+  }
+  // the next dump is about the keys since
+  size_ = 0;
+  return success;
+}
+
+vector<KeystrokeRecord> FlightRecorder::records() const {
+  vector<KeystrokeRecord> result;
+  size_t start = (next_ + ring_.size() - size_) % ring_.size();
+  for (size_t i = 0; i < size_; ++i) {
+    result.push_back(ring_[(start + i) % ring_.size()]);
+  }
+  return result;
+}
+
+// The dump is a text file of tab separated lines. State lines give the
+// schema and options in effect for the following keys, written only when
+// changed:
+//   schema <schema_id>
+//   option <name> <0|1>
+//   key <repr> <accepted> <elapsed_us> <caret_pos> <input>
+// Backslashes, tabs and line breaks in the fields are escaped with a
+// backslash.
+
+static string Escape(const string& field) {
+  string escaped;
+  escaped.reserve(field.length());
+  for (char ch : field) {
+    switch (ch) {
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\t':
+        escaped += "\\t";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      case '\r':
+        escaped += "\\r";
+        break;
+      default:
+        escaped += ch;
+    }
+  }
+  return escaped;
+}
+
+static string Unescape(const string& field) {
+  string unescaped;
+  unescaped.reserve(field.length());
+  for (size_t i = 0; i < field.length(); ++i) {
+    if (field[i] != '\\' || i + 1 == field.length()) {
+      unescaped += field[i];
+      continue;
+    }
+    switch (field[++i]) {
+      case 't':
+        unescaped += '\t';
+        break;
+      case 'n':
+        unescaped += '\n';
+        break;
+      case 'r':
+        unescaped += '\r';
+        break;
+      default:
+        unescaped += field[i];
+    }
+  }
+  return unescaped;
+}
+
+bool FlightRecorder::Save(const string& file_path,
+                          const vector<KeystrokeRecord>& records) {
+  std::ofstream out(file_path);
+  if (!out) {
+    LOG(ERROR) << "error opening file " << file_path;
+    return false;
+  }
+  out << "# Rime flight record\n";
+  const KeystrokeRecord* last = nullptr;
+  for (const auto& record : records) {
+    if (!last || last->schema_id != record.schema_id) {
+      out << "schema\t" << Escape(record.schema_id) << "\n";
+    }
+    for (const auto& option : record.options) {
+      if (!last || std::find(last->options.begin(), last->options.end(),
+                             option) == last->options.end()) {
+        out << "option\t" << Escape(option.first) << "\t" << option.second
+            << "\n";
+      }
+    }
+    out << "key\t" << Escape(record.key) << "\t" << record.accepted << "\t"
+        << record.elapsed_us << "\t" << record.caret_pos << "\t"
+        << Escape(record.input) << "\n";
+    last = &record;
+  }
+  return bool(out);
+}
+
+bool FlightRecorder::Load(const string& file_path,
+                          vector<KeystrokeRecord>* records) {
+  std::ifstream in(file_path);
+  if (!in) {
+    LOG(ERROR) << "error opening file " << file_path;
+    return false;
+  }
+  string schema_id;
+  map<string, bool> options;
+  string line;
+  int line_no = 0;
+  while (std::getline(in, line)) {
+    ++line_no;
+    if (line.empty() || line[0] == '#')
+      continue;
+    vector<string> fields;
+    boost::split(fields, line, boost::is_any_of("\t"));
+    if (fields[0] == "schema" && fields.size() == 2) {
+      schema_id = Unescape(fields[1]);
+    } else if (fields[0] == "option" && fields.size() == 3) {
+      options[Unescape(fields[1])] = fields[2] == "1";
+    } else if (fields[0] == "key" && fields.size() == 6) {
+      KeystrokeRecord record;
+      record.schema_id = schema_id;
+      record.options.assign(options.begin(), options.end());
+      record.key = Unescape(fields[1]);
+      try {
+        record.accepted = fields[2] == "1";
+        record.elapsed_us = std::stoll(fields[3]);
+        record.caret_pos = std::stoul(fields[4]);
+      } catch (...) {
+        LOG(ERROR) << "invalid key record at line " << line_no;
+        return false;
+      }
+      record.input = Unescape(fields[5]);
+      records->push_back(std::move(record));
+    } else {
+      LOG(ERROR) << "invalid line " << line_no << " in " << file_path;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace rime
@@ -0,0 +1,68 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#ifndef RIME_FLIGHT_RECORDER_H_
+#define RIME_FLIGHT_RECORDER_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <rime_api.h>
+#include <rime/common.h>
+
+namespace rime {
+
+class Engine;
+class KeyEvent;
+
+// a key processed by a session, with the state of the session before the key
+struct KeystrokeRecord {
+  string schema_id;
+  vector<pair<string, bool>> options;
+  string input;
+  size_t caret_pos = 0;
+  // KeyEvent::repr()
+  string key;
+  bool accepted = false;
+  int64_t elapsed_us = 0;
+};
+
+// Keeps the last keys processed by a session in a ring buffer, and dumps
+// them to a file when a key takes longer than the threshold. The dump can be
+// replayed with the same schema to profile the slow key offline.
+class FlightRecorder {
+ public:
+  RIME_API FlightRecorder(size_t capacity,
+                          int threshold_ms,
+                          const string& dump_dir);
+
+  // records the state of the active engine before the key
+  RIME_API void BeginKey(const KeyEvent& key_event, Engine* engine);
+  // returns true if the key is slow and the records have been dumped
+  RIME_API bool EndKey(bool accepted);
+  // writes the records to a new file in dump_dir, and starts over
+  RIME_API bool Dump();
+
+  // the recorded keys, oldest first
+  RIME_API vector<KeystrokeRecord> records() const;
+  const string& last_dump_file() const { return last_dump_file_; }
+
+  RIME_API static bool Save(const string& file_path,
+                            const vector<KeystrokeRecord>& records);
+  RIME_API static bool Load(const string& file_path,
+                            vector<KeystrokeRecord>* records);
+
+ private:
+  // records are reused to avoid allocations on every key
+  vector<KeystrokeRecord> ring_;
+  size_t next_ = 0;
+  size_t size_ = 0;
+  std::chrono::steady_clock::duration threshold_;
+  string dump_dir_;
+  string last_dump_file_;
+  std::chrono::steady_clock::time_point key_start_time_;
+};
+
+}  // namespace rime
+
+#endif  // RIME_FLIGHT_RECORDER_H_
@@ -55,6 +55,11 @@ AsciiComposer::~AsciiComposer() {
   connection_.disconnect();
 }
 
+void AsciiComposer::Suspend() {
+  connection_.disconnect();
+  shift_key_pressed_ = ctrl_key_pressed_ = false;
+}
+
 ProcessResult AsciiComposer::ProcessKeyEvent(const KeyEvent& key_event) {
   if ((key_event.shift() && key_event.ctrl()) || key_event.alt() ||
       key_event.super()) {
@@ -33,6 +33,7 @@ class AsciiComposer : public Processor {
   ~AsciiComposer();
 
   virtual ProcessResult ProcessKeyEvent(const KeyEvent& key_event);
+  void Suspend() override;
 
  protected:
   ProcessResult ProcessCapsLock(const KeyEvent& key_event);
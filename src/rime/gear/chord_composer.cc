@@ -43,6 +43,27 @@ ChordComposer::~ChordComposer() {
   unhandled_key_connection_.disconnect();
 }
 
+void ChordComposer::Suspend() {
+  update_connection_.disconnect();
+  unhandled_key_connection_.disconnect();
+  pressed_.clear();
+  chord_.clear();
+  editing_chord_ = false;
+  sending_chord_ = false;
+  composing_ = false;
+  raw_sequence_.clear();
+}
+
+void ChordComposer::Resume() {
+  // transient options are reset on switching schemas
+  Context* ctx = engine_->context();
+  ctx->set_option("_chord_typing", true);
+  update_connection_ = ctx->update_notifier().connect(
+      [this](Context* ctx) { OnContextUpdate(ctx); });
+  unhandled_key_connection_ = ctx->unhandled_key_notifier().connect(
+      [this](Context* ctx, const KeyEvent& key) { OnUnhandledKey(ctx, key); });
+}
+
 ProcessResult ChordComposer::ProcessFunctionKey(const KeyEvent& key_event) {
   if (key_event.release()) {
     return kNoop;
@@ -21,6 +21,8 @@ class ChordComposer : public Processor {
   ~ChordComposer();
 
   virtual ProcessResult ProcessKeyEvent(const KeyEvent& key_event);
+  void Suspend() override;
+  void Resume() override;
 
  protected:
   ProcessResult ProcessChordingKey(const KeyEvent& key_event);
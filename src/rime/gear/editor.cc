@@ -39,10 +39,17 @@ static struct EditorCharHandlerDef {
                                        {"noop", nullptr}};
 
 Editor::Editor(const Ticket& ticket, bool auto_commit)
-    : Processor(ticket), KeyBindingProcessor(editor_action_definitions) {
+    : Processor(ticket),
+      KeyBindingProcessor(editor_action_definitions),
+      auto_commit_(auto_commit) {
   engine_->context()->set_option("_auto_commit", auto_commit);
 }
 
+void Editor::Resume() {
+  // transient options are reset on switching schemas
+  engine_->context()->set_option("_auto_commit", auto_commit_);
+}
+
 ProcessResult Editor::ProcessKeyEvent(const KeyEvent& key_event) {
   if (key_event.release())
     return kRejected;
@@ -24,6 +24,7 @@ class Editor : public Processor, public KeyBindingProcessor<Editor> {
 
   Editor(const Ticket& ticket, bool auto_commit);
   ProcessResult ProcessKeyEvent(const KeyEvent& key_event);
+  void Resume() override;
 
   Handler Confirm;
   Handler ToggleSelection;
@@ -45,6 +46,7 @@ class Editor : public Processor, public KeyBindingProcessor<Editor> {
   void LoadConfig();
 
   CharHandlerPtr char_handler_ = nullptr;
+  bool auto_commit_;
 };
 
 class FluidEditor : public Editor {
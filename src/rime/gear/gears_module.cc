@@ -19,6 +19,7 @@
 #include <rime/gear/key_binder.h>
 #include <rime/gear/matcher.h>
 #include <rime/gear/navigator.h>
+#include <rime/gear/ngram_grammar.h>
 #include <rime/gear/punctuator.h>
 #include <rime/gear/recognizer.h>
 #include <rime/gear/reverse_lookup_filter.h>
@@ -43,51 +44,54 @@ static void rime_gears_initialize() {
   Registry& r = Registry::instance();
 
   // processors
-  r.Register("ascii_composer", new Component<AsciiComposer>);
-  r.Register("chord_composer", new Component<ChordComposer>);
-  r.Register("express_editor", new Component<ExpressEditor>);
-  r.Register("fluid_editor", new Component<FluidEditor>);
-  r.Register("fluency_editor", new Component<FluidEditor>);  // alias
-  r.Register("key_binder", new Component<KeyBinder>);
-  r.Register("navigator", new Component<Navigator>);
-  r.Register("punctuator", new Component<Punctuator>);
-  r.Register("recognizer", new Component<Recognizer>);
-  r.Register("selector", new Component<Selector>);
-  r.Register("speller", new Component<Speller>);
-  r.Register("shape_processor", new Component<ShapeProcessor>);
+  r.Register<Component<AsciiComposer>>("ascii_composer");
+  r.Register<Component<ChordComposer>>("chord_composer");
+  r.Register<Component<ExpressEditor>>("express_editor");
+  r.Register<Component<FluidEditor>>("fluid_editor");
+  r.Register<Component<FluidEditor>>("fluency_editor");  // alias
+  r.Register<Component<KeyBinder>>("key_binder");
+  r.Register<Component<Navigator>>("navigator");
+  r.Register<Component<Punctuator>>("punctuator");
+  r.Register<Component<Recognizer>>("recognizer");
+  r.Register<Component<Selector>>("selector");
+  r.Register<Component<Speller>>("speller");
+  r.Register<Component<ShapeProcessor>>("shape_processor");
 
   // segmentors
-  r.Register("abc_segmentor", new Component<AbcSegmentor>);
-  r.Register("affix_segmentor", new Component<AffixSegmentor>);
-  r.Register("ascii_segmentor", new Component<AsciiSegmentor>);
-  r.Register("matcher", new Component<Matcher>);
-  r.Register("punct_segmentor", new Component<PunctSegmentor>);
-  r.Register("fallback_segmentor", new Component<FallbackSegmentor>);
+  r.Register<Component<AbcSegmentor>>("abc_segmentor");
+  r.Register<Component<AffixSegmentor>>("affix_segmentor");
+  r.Register<Component<AsciiSegmentor>>("ascii_segmentor");
+  r.Register<Component<Matcher>>("matcher");
+  r.Register<Component<PunctSegmentor>>("punct_segmentor");
+  r.Register<Component<FallbackSegmentor>>("fallback_segmentor");
 
   // translators
-  r.Register("echo_translator", new Component<EchoTranslator>);
-  r.Register("punct_translator", new Component<PunctTranslator>);
-  r.Register("table_translator", new Component<TableTranslator>);
-  r.Register("script_translator", new Component<ScriptTranslator>);
-  r.Register("r10n_translator", new Component<ScriptTranslator>);  // alias
-  r.Register("reverse_lookup_translator",
-             new Component<ReverseLookupTranslator>);
-  r.Register("schema_list_translator", new Component<SchemaListTranslator>);
-  r.Register("switch_translator", new Component<SwitchTranslator>);
-  r.Register("history_translator", new Component<HistoryTranslator>);
+  r.Register<Component<EchoTranslator>>("echo_translator");
+  r.Register<Component<PunctTranslator>>("punct_translator");
+  r.Register<Component<TableTranslator>>("table_translator");
+  r.Register<Component<ScriptTranslator>>("script_translator");
+  r.Register<Component<ScriptTranslator>>("r10n_translator");  // alias
+  r.Register<Component<ReverseLookupTranslator>>(
+      "reverse_lookup_translator");
+  r.Register<Component<SchemaListTranslator>>("schema_list_translator");
+  r.Register<Component<SwitchTranslator>>("switch_translator");
+  r.Register<Component<HistoryTranslator>>("history_translator");
 
   // filters
-  r.Register("simplifier", new Component<Simplifier>);
-  r.Register("uniquifier", new Component<Uniquifier>);
-  if (!r.Find("charset_filter")) {  // allow improved implementation
-    r.Register("charset_filter", new Component<CharsetFilter>);
+  r.Register<Component<Simplifier>>("simplifier");
+  r.Register<Component<Uniquifier>>("uniquifier");
+  if (!r.IsRegistered("charset_filter")) {  // allow improved implementation
+    r.Register<Component<CharsetFilter>>("charset_filter");
   }
-  r.Register("cjk_minifier", new Component<CharsetFilter>);  // alias
-  r.Register("reverse_lookup_filter", new Component<ReverseLookupFilter>);
-  r.Register("single_char_filter", new Component<SingleCharFilter>);
+  r.Register<Component<CharsetFilter>>("cjk_minifier");  // alias
+  r.Register<Component<ReverseLookupFilter>>("reverse_lookup_filter");
+  r.Register<Component<SingleCharFilter>>("single_char_filter");
 
   // formatters
-  r.Register("shape_formatter", new Component<ShapeFormatter>);
+  r.Register<Component<ShapeFormatter>>("shape_formatter");
+
+  // grammar; plugins loaded later may replace it
+  r.Register<NgramGrammarComponent>("grammar");
 }
 
 static void rime_gears_finalize() {}
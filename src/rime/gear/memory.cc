@@ -71,7 +71,14 @@ Memory::Memory(const Ticket& ticket) {
       : dict_    ? new Language{Language::get_language_component(dict_->name())}
                  : nullptr);
 
-  Context* ctx = ticket.engine->context();
+  Connect(ticket.engine->context());
+}
+
+Memory::~Memory() {
+  Disconnect();
+}
+
+void Memory::Connect(Context* ctx) {
   commit_connection_ =
       ctx->commit_notifier().connect([this](Context* ctx) { OnCommit(ctx); });
   delete_connection_ = ctx->delete_notifier().connect(
@@ -80,7 +87,7 @@ Memory::Memory(const Ticket& ticket) {
       [this](Context* ctx, const KeyEvent& key) { OnUnhandledKey(ctx, key); });
 }
 
-Memory::~Memory() {
+void Memory::Disconnect() {
   commit_connection_.disconnect();
   delete_connection_.disconnect();
   unhandled_key_connection_.disconnect();
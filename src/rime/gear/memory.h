@@ -43,6 +43,10 @@ class Memory {
   bool FinishSession();
   bool DiscardSession();
 
+  // receives commits and edits made in the context
+  void Connect(Context* ctx);
+  void Disconnect();
+
   Dictionary* dict() const { return dict_.get(); }
   UserDictionary* user_dict() const { return user_dict_.get(); }
 
@@ -0,0 +1,109 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <algorithm>
+#include <utf8.h>
+#include <rime/config.h>
+#include <rime/resource.h>
+#include <rime/service.h>
+#include <rime/dict/db_pool_impl.h>
+#include <rime/gear/ngram_grammar.h>
+
+namespace rime {
+
+static const double kUnknownWordPenalty = -18.420680743952367;  // log(1e-8)
+
+NgramGrammar::NgramGrammar(Config* config, an<NgramModel> model)
+    : model_(model), unknown_word_penalty_(kUnknownWordPenalty) {
+  if (config) {
+    config->GetDouble("grammar/unknown_word_penalty", &unknown_word_penalty_);
+  }
+  SetContext(string());
+}
+
+void NgramGrammar::SetContext(const string& context) {
+  context_ = context;
+  context_words_.clear();
+  const size_t max_words = model_->order() - 1;
+  const char* begin = context.c_str();
+  const char* end = begin + context.length();
+  // backward longest match
+  while (end > begin && context_words_.size() < max_words) {
+    const char* start = end;
+    const char* matched = nullptr;
+    NgramModel::WordId word_id = kInvalidStringId;
+    for (uint32_t n = 0; n < model_->max_word_length() && start > begin;
+         ++n) {
+      utf8::unchecked::prior(start);
+      auto id = model_->FindWord(start, end - start);
+      if (id != kInvalidStringId) {
+        matched = start;
+        word_id = id;
+      }
+    }
+    if (!matched)
+      break;
+    context_words_.push_back(word_id);
+    end = matched;
+  }
+  // the context starts a sentence
+  if (end == begin && context_words_.size() < max_words &&
+      model_->sentence_begin() != kInvalidStringId) {
+    context_words_.push_back(model_->sentence_begin());
+  }
+  std::reverse(context_words_.begin(), context_words_.end());
+  model_->SetContext(context_words_.data(), context_words_.size(), &state_);
+}
+
+double NgramGrammar::Query(const string& context,
+                           const string& word,
+                           bool is_rear) {
+  if (context != context_) {
+    SetContext(context);
+  }
+  auto word_id = model_->FindWord(word.c_str(), word.length());
+  if (word_id == kInvalidStringId) {
+    return unknown_word_penalty_;
+  }
+  double score = model_->Score(state_, word_id);
+  if (is_rear && model_->sentence_end() != kInvalidStringId) {
+    vector<NgramModel::WordId> words(context_words_);
+    words.push_back(word_id);
+    NgramModel::State state;
+    model_->SetContext(words.data(), words.size(), &state);
+    score += model_->Score(state, model_->sentence_end());
+  }
+  return score;
+}
+
+static const ResourceType kNgramModelResourceType = {"ngram_model", "",
+                                                     ".ngram.bin"};
+
+NgramGrammarComponent::NgramGrammarComponent()
+    : DbPool(the<ResourceResolver>(
+          Service::shared_instance().CreateResourceResolver(
+              kNgramModelResourceType))) {}
+
+NgramGrammar* NgramGrammarComponent::Create(Config* config) {
+  string language;
+  if (!config || !config->GetString("grammar/language", &language) ||
+      language.empty()) {
+    return nullptr;
+  }
+  auto model = GetDb(language);
+  if (!model->IsOpen()) {
+    // the grammar is optional; the model may not be installed
+    if (!model->Exists()) {
+      LOG(INFO) << "n-gram model not found: " << language;
+      return nullptr;
+    }
+    if (!model->Load()) {
+      LOG(ERROR) << "failed to load n-gram model: " << language;
+      return nullptr;
+    }
+  }
+  return new NgramGrammar(config, model);
+}
+
+}  // namespace rime
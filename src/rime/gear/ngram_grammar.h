@@ -0,0 +1,43 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#ifndef RIME_NGRAM_GRAMMAR_H_
+#define RIME_NGRAM_GRAMMAR_H_
+
+#include <rime/dict/db_pool.h>
+#include <rime/dict/ngram_model.h>
+#include <rime/gear/grammar.h>
+
+namespace rime {
+
+// scores words with a compiled n-gram model: <language>.ngram.bin
+class NgramGrammar : public Grammar {
+ public:
+  RIME_API NgramGrammar(Config* config, an<NgramModel> model);
+
+  RIME_API double Query(const string& context,
+                        const string& word,
+                        bool is_rear) override;
+
+ private:
+  // splits the end of the context into words known to the model
+  void SetContext(const string& context);
+
+  an<NgramModel> model_;
+  double unknown_word_penalty_;
+  string context_;
+  vector<NgramModel::WordId> context_words_;
+  NgramModel::State state_;
+};
+
+class NgramGrammarComponent : public Grammar::Component,
+                              protected DbPool<NgramModel> {
+ public:
+  NgramGrammarComponent();
+  NgramGrammar* Create(Config* config) override;
+};
+
+}  // namespace rime
+
+#endif  // RIME_NGRAM_GRAMMAR_H_
@@ -199,31 +199,44 @@ an<Sentence> Poet::MakeSentenceWithStrategy(const WordGraph& graph,
       continue;
     DLOG(INFO) << "start pos: " << start_pos;
     const auto& source_state = states[start_pos];
-    const auto update = [this, &states, &sv, start_pos, total_length,
+    // dict entries on valid edges, by end pos.
+    vector<pair<size_t, const DictEntry*>> words;
+    for (const auto& ev : sv.second) {
+      size_t end_pos = ev.first;
+      if (start_pos == 0 && end_pos == total_length)
+        continue;  // exclude single word from the result
+      for (const auto& entry : ev.second) {
+        words.emplace_back(end_pos, entry.get());
+      }
+    }
+    if (max_lattice_width_ && words.size() > max_lattice_width_) {
+      // keep the heaviest words
+      std::stable_sort(words.begin(), words.end(),
+                       [](const auto& a, const auto& b) {
+                         return a.second->weight > b.second->weight;
+                       });
+      words.resize(max_lattice_width_);
+    }
+    const auto update = [this, &states, &words, total_length,
                          &preceding_text](const Line& candidate) {
-      for (const auto& ev : sv.second) {
-        size_t end_pos = ev.first;
-        if (start_pos == 0 && end_pos == total_length)
-          continue;  // exclude single word from the result
-        DLOG(INFO) << "end pos: " << end_pos;
+      // extend candidates with the words.
+      for (const auto& word : words) {
+        size_t end_pos = word.first;
+        const DictEntry* entry = word.second;
         bool is_rear = end_pos == total_length;
         auto& target_state = states[end_pos];
-        // extend candidates with dict entries on a valid edge.
-        const DictEntryList& entries = ev.second;
-        for (const auto& entry : entries) {
-          const string& context =
-              candidate.empty() ? preceding_text : candidate.context();
-          double weight = candidate.weight +
-                          Grammar::Evaluate(context, entry->text, entry->weight,
-                                            is_rear, grammar_.get());
-          Line new_line{&candidate, entry.get(), end_pos, weight};
-          Line& best = Strategy::BestLineToUpdate(target_state, new_line);
-          if (best.empty() || compare_(best, new_line)) {
-            DLOG(INFO) << "updated line ending at " << end_pos
-                       << " with text: ..." << new_line.last_word()
-                       << " weight: " << new_line.weight;
-            best = new_line;
-          }
+        const string& context =
+            candidate.empty() ? preceding_text : candidate.context();
+        double weight = candidate.weight +
+                        Grammar::Evaluate(context, entry->text, entry->weight,
+                                          is_rear, grammar_.get());
+        Line new_line{&candidate, entry, end_pos, weight};
+        Line& best = Strategy::BestLineToUpdate(target_state, new_line);
+        if (best.empty() || compare_(best, new_line)) {
+          DLOG(INFO) << "updated line ending at " << end_pos
+                     << " with text: ..." << new_line.last_word()
+                     << " weight: " << new_line.weight;
+          best = new_line;
         }
       }
     };
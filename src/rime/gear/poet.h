@@ -40,6 +40,9 @@ class Poet {
                             size_t total_length,
                             const string& preceding_text);
 
+  // number of words to extend lines with at each position; 0 for no limit.
+  void set_max_lattice_width(size_t width) { max_lattice_width_ = width; }
+
   template <class TranslatorT>
   an<Translation> ContextualWeighted(an<Translation> translation,
                                      const string& input,
@@ -65,6 +68,7 @@ class Poet {
   const Language* language_;
   the<Grammar> grammar_;
   Compare compare_;
+  size_t max_lattice_width_ = 0;
 };
 
 }  // namespace rime
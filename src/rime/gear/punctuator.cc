@@ -112,8 +112,9 @@ bool Punctuator::AlternatePunct(const string& key,
       return false;
     }
     DLOG(INFO) << "alternating punctuation '" << key << "'.";
-    (segment.selected_index += 1) %= segment.menu->candidate_count();
     segment.status = Segment::kGuess;
+    ctx->Highlight((segment.selected_index + 1) %
+                   segment.menu->candidate_count());
     return true;
   }
   return false;
@@ -150,7 +151,7 @@ bool Punctuator::PairPunct(const an<ConfigItem>& definition) {
     }
     DLOG(INFO) << "alternating paired punctuation.";
     auto& oddness(oddness_[definition]);
-    (segment.selected_index += oddness) %= 2;
+    ctx->Highlight((segment.selected_index + oddness) % 2);
     oddness = 1 - oddness;
     ctx->ConfirmCurrentSelection();
     return true;
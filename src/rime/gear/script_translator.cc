@@ -88,6 +88,9 @@ class ScriptSyllabifier : public PhraseSyllabifier {
     if (corrector) {
       syllabifier_.EnableCorrection(corrector);
     }
+    syllabifier_.SetLimits(
+        (std::max)(translator->max_syllable_graph_vertices(), 0),
+        (std::max)(translator->max_syllable_graph_edges(), 0));
   }
 
   virtual Spans Syllabify(const Phrase* phrase);
@@ -150,6 +153,7 @@ class ScriptTranslation : public Translation {
 
   size_t max_corrections_ = 4;
   size_t correction_count_ = 0;
+  int candidate_count_ = 0;
 
   bool enable_correction_;
 };
@@ -166,7 +170,18 @@ ScriptTranslator::ScriptTranslator(const Ticket& ticket)
                     &always_show_comments_);
     config->GetBool(name_space_ + "/enable_correction", &enable_correction_);
     config->GetInt(name_space_ + "/max_homophones", &max_homophones_);
+    config->GetInt(name_space_ + "/max_syllable_graph_vertices",
+                   &max_syllable_graph_vertices_);
+    config->GetInt(name_space_ + "/max_syllable_graph_edges",
+                   &max_syllable_graph_edges_);
+    config->GetInt(name_space_ + "/max_query_frontier", &max_query_frontier_);
+    config->GetInt(name_space_ + "/max_lattice_width", &max_lattice_width_);
+    config->GetInt(name_space_ + "/max_candidates", &max_candidates_);
     poet_.reset(new Poet(language(), config));
+    poet_->set_max_lattice_width((std::max)(max_lattice_width_, 0));
+  }
+  if (dict_) {
+    dict_->set_max_query_frontier((std::max)(max_query_frontier_, 0));
   }
   if (enable_correction_) {
     if (auto* corrector = Corrector::Require("corrector")) {
@@ -225,6 +240,15 @@ string ScriptTranslator::GetPrecedingText(size_t start) const {
                      : engine_->context()->commit_history().latest_text();
 }
 
+void ScriptTranslator::Suspend() {
+  FinishSession();
+  Disconnect();
+}
+
+void ScriptTranslator::Resume() {
+  Connect(engine_->context());
+}
+
 bool ScriptTranslator::Memorize(const CommitEntry& commit_entry) {
   bool update_elements = false;
   // avoid updating single character entries within a phrase which is
@@ -369,6 +393,13 @@ bool ScriptTranslation::Evaluate(Dictionary* dict, UserDictionary* user_dict) {
 }
 
 bool ScriptTranslation::Next() {
+  if (exhausted())
+    return false;
+  int max_candidates = translator_->max_candidates();
+  if (max_candidates > 0 && ++candidate_count_ >= max_candidates) {
+    set_exhausted(true);
+    return false;
+  }
   bool is_correction;
   do {
     is_correction = false;
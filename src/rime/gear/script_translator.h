@@ -32,6 +32,8 @@ class ScriptTranslator : public Translator,
 
   virtual an<Translation> Query(const string& input, const Segment& segment);
   virtual bool Memorize(const CommitEntry& commit_entry);
+  void Suspend() override;
+  void Resume() override;
 
   string FormatPreedit(const string& preedit);
   string Spell(const Code& code);
@@ -41,9 +43,21 @@ class ScriptTranslator : public Translator,
   int max_homophones() const { return max_homophones_; }
   int spelling_hints() const { return spelling_hints_; }
   bool always_show_comments() const { return always_show_comments_; }
+  int max_syllable_graph_vertices() const {
+    return max_syllable_graph_vertices_;
+  }
+  int max_syllable_graph_edges() const { return max_syllable_graph_edges_; }
+  int max_candidates() const { return max_candidates_; }
 
  protected:
   int max_homophones_ = 1;
+  // complexity limits against pathological input; 0 for no limit.
+  // input beyond the syllable graph limits is left for later rounds.
+  int max_syllable_graph_vertices_ = 1024;
+  int max_syllable_graph_edges_ = 16384;
+  int max_query_frontier_ = 0;
+  int max_lattice_width_ = 0;
+  int max_candidates_ = 0;
   int spelling_hints_ = 0;
   bool always_show_comments_ = false;
   bool enable_correction_ = false;
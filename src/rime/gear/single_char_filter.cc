@@ -16,42 +16,76 @@ static inline size_t unistrlen(const string& text) {
   return utf8::unchecked::distance(text.c_str(), text.c_str() + text.length());
 }
 
+static bool is_table_phrase(const an<Candidate>& cand) {
+  auto phrase = As<Phrase>(Candidate::GetGenuineCandidate(cand));
+  return phrase &&
+         (phrase->type() == "table" || phrase->type() == "user_table");
+}
+
+// Moves single characters ahead of longer phrases among the leading table
+// candidates. Single characters are passed on as soon as they are found;
+// only the phrases in between are held back, so the translation is not
+// drained to show the first page.
 class SingleCharFirstTranslation : public PrefetchTranslation {
  public:
+  // beyond this many phrases, the remaining candidates keep their order
+  static const size_t kMaxDeferredPhrases = 100;
+
   SingleCharFirstTranslation(an<Translation> translation);
 
+  bool Next() override;
+
+ protected:
+  bool Replenish() override;
+
  private:
-  bool Rearrange();
+  bool rearranging_ = true;
+  CandidateQueue deferred_;
 };
 
 SingleCharFirstTranslation::SingleCharFirstTranslation(
     an<Translation> translation)
-    : PrefetchTranslation(translation) {
-  Rearrange();
-}
+    : PrefetchTranslation(translation) {}
 
-bool SingleCharFirstTranslation::Rearrange() {
+bool SingleCharFirstTranslation::Next() {
   if (exhausted()) {
     return false;
   }
-  CandidateQueue top;
-  CandidateQueue bottom;
-  while (!translation_->exhausted()) {
+  if (!cache_.empty() || Replenish()) {
+    cache_.pop_front();
+  } else {
+    translation_->Next();
+  }
+  if (cache_.empty() && !Replenish() && translation_->exhausted()) {
+    set_exhausted(true);
+  }
+  return true;
+}
+
+bool SingleCharFirstTranslation::Replenish() {
+  while (rearranging_ && cache_.empty()) {
+    if (translation_->exhausted()) {
+      rearranging_ = false;
+      break;
+    }
     auto cand = translation_->Peek();
-    auto phrase = As<Phrase>(Candidate::GetGenuineCandidate(cand));
-    if (!phrase ||
-        (phrase->type() != "table" && phrase->type() != "user_table")) {
+    if (!is_table_phrase(cand)) {
+      rearranging_ = false;
       break;
     }
+    translation_->Next();
     if (unistrlen(cand->text()) == 1) {
-      top.push_back(cand);
+      cache_.push_back(cand);
     } else {
-      bottom.push_back(cand);
+      deferred_.push_back(cand);
+      if (deferred_.size() >= kMaxDeferredPhrases) {
+        rearranging_ = false;
+      }
     }
-    translation_->Next();
   }
-  cache_.splice(cache_.end(), top);
-  cache_.splice(cache_.end(), bottom);
+  if (cache_.empty() && !deferred_.empty()) {
+    cache_.splice(cache_.end(), deferred_);
+  }
   return !cache_.empty();
 }
 
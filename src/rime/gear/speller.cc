@@ -228,13 +228,13 @@ bool Speller::FindEarlierMatch(Context* ctx, size_t start, size_t end) {
   string converted = input;
   while (--end > start) {
     converted.resize(end);
-    ctx->set_input(converted);
-    if (!ctx->HasMenu())
+    // probe shorter input without recomposing; only a match is composed
+    auto cand = engine_->Probe(converted);
+    if (!cand)
       break;
-    const Segment& segment(ctx->composition().back());
-    if (is_auto_selectable(segment.GetSelectedCandidate(), converted,
-                           delimiters_)) {
+    if (is_auto_selectable(cand, converted, delimiters_)) {
       // select previous match
+      ctx->set_input(converted);
       if (ctx->get_option("_auto_commit")) {
         ctx->Commit();
         string rest = input.substr(end);
@@ -255,7 +255,6 @@ bool Speller::FindEarlierMatch(Context* ctx, size_t start, size_t end) {
       return true;
     }
   }
-  ctx->set_input(input);
   return false;
 }
 
@@ -306,6 +306,15 @@ an<Translation> TableTranslator::Query(const string& input,
   return translation;
 }
 
+void TableTranslator::Suspend() {
+  FinishSession();
+  Disconnect();
+}
+
+void TableTranslator::Resume() {
+  Connect(engine_->context());
+}
+
 bool TableTranslator::Memorize(const CommitEntry& commit_entry) {
   if (!user_dict_)
     return false;
@@ -30,6 +30,8 @@ class TableTranslator : public Translator,
 
   virtual an<Translation> Query(const string& input, const Segment& segment);
   virtual bool Memorize(const CommitEntry& commit_entry);
+  void Suspend() override;
+  void Resume() override;
 
   an<Translation> MakeSentence(const string& input,
                                size_t start,
@@ -59,13 +59,9 @@ bool UnityTableEncoder::TranslateWord(const string& word,
   if (!rev_dict_) {
     return false;
   }
-  string str_list;
-  if (rev_dict_->LookupStems(word, &str_list) ||
-      rev_dict_->ReverseLookup(word, &str_list)) {
-    boost::split(*code, str_list, boost::is_any_of(" "));
-    return !code->empty();
-  }
-  return false;
+  // parsed results are cached by the reverse db, shared among sessions
+  return rev_dict_->LookupStems(word, code) ||
+         rev_dict_->ReverseLookup(word, code);
 }
 
 size_t UnityTableEncoder::LookupPhrases(UserDictEntryIterator* result,
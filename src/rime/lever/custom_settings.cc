@@ -31,9 +31,15 @@ CustomSettings::CustomSettings(Deployer* deployer,
     : deployer_(deployer), config_id_(config_id), generator_id_(generator_id) {}
 
 bool CustomSettings::Load() {
-  fs::path config_path =
-      fs::path(deployer_->staging_dir) / (config_id_ + ".yaml");
-  if (!config_.LoadFromFile(config_path.string())) {
+  // the generation being built during staged maintenance, if any
+  const string output_dir = deployer_->output_dir();
+  fs::path config_path = fs::path(output_dir) / (config_id_ + ".yaml");
+  bool loaded = config_.LoadFromFile(config_path.string());
+  if (!loaded && output_dir != deployer_->staging_dir) {
+    config_path = fs::path(deployer_->staging_dir) / (config_id_ + ".yaml");
+    loaded = config_.LoadFromFile(config_path.string());
+  }
+  if (!loaded) {
     config_path =
         fs::path(deployer_->prebuilt_data_dir) / (config_id_ + ".yaml");
     if (!config_.LoadFromFile(config_path.string())) {
@@ -161,6 +161,28 @@ bool InstallationUpdate::Run(Deployer* deployer) {
   return config.SaveToFile(installation_info.string());
 }
 
+// compiled configs are looked up in the output directory first, which holds
+// the generation being built during staged maintenance.
+static fs::path ResolveCompiledConfig(const string& config_id) {
+  const ResourceType kCompiledConfig = {"compiled_config", "", ".yaml"};
+  the<ResourceResolver> resolver(
+      Service::instance().CreateStagingResourceResolver(kCompiledConfig));
+  auto file_path = resolver->ResolvePath(config_id);
+  if (!fs::exists(file_path)) {
+    resolver.reset(
+        Service::instance().CreateDeployedResourceResolver(kCompiledConfig));
+    file_path = resolver->ResolvePath(config_id);
+  }
+  return file_path;
+}
+
+// loads a fresh copy rather than the config data shared with sessions
+static Config* LoadCompiledConfig(const string& config_id) {
+  auto config = new Config;
+  config->LoadFromFile(ResolveCompiledConfig(config_id).string());
+  return config;
+}
+
 bool WorkspaceUpdate::Run(Deployer* deployer) {
   LOG(INFO) << "updating workspace.";
   {
@@ -174,7 +196,7 @@ bool WorkspaceUpdate::Run(Deployer* deployer) {
     t->Run(deployer);
   }
 
-  the<Config> config(Config::Require("config")->Create("default"));
+  the<Config> config(LoadCompiledConfig("default"));
   if (!config) {
     LOG(ERROR) << "Error loading default config.";
     return false;
@@ -218,7 +240,6 @@ bool WorkspaceUpdate::Run(Deployer* deployer) {
     else
       ++failure;
   };
-  auto schema_component = Config::Require("schema");
   for (auto it = schema_list->begin(); it != schema_list->end(); ++it) {
     auto item = As<ConfigMap>(*it);
     if (!item)
@@ -228,7 +249,7 @@ bool WorkspaceUpdate::Run(Deployer* deployer) {
       continue;
     const string& schema_id = schema_property->str();
     build_schema(schema_id);
-    the<Config> schema_config(schema_component->Create(schema_id));
+    the<Config> schema_config(LoadCompiledConfig(schema_id + ".schema"));
     if (!schema_config)
       continue;
     if (auto dependencies = schema_config->GetList("schema/dependencies")) {
@@ -344,7 +365,8 @@ bool SchemaUpdate::Run(Deployer* deployer) {
     return false;
   }
   // reload compiled config
-  config.reset(Config::Require("schema")->Create(schema_id));
+  auto compiled_schema = ResolveCompiledConfig(schema_id + ".schema").string();
+  config.reset(LoadCompiledConfig(schema_id + ".schema"));
   string dict_name;
   if (!config->GetString("translator/dictionary", &dict_name)) {
     // not requiring a dictionary
@@ -360,17 +382,20 @@ bool SchemaUpdate::Run(Deployer* deployer) {
 
   LOG(INFO) << "preparing dictionary '" << dict_name << "'.";
   const fs::path user_data_path(deployer->user_data_dir);
-  if (!MaybeCreateDirectory(deployer->staging_dir)) {
+  if (!MaybeCreateDirectory(deployer->output_dir())) {
     return false;
   }
   DictCompiler dict_compiler(dict.get());
+  int options = 0;
   if (verbose_) {
-    dict_compiler.set_options(DictCompiler::kRebuild | DictCompiler::kDump);
+    options |= DictCompiler::kRebuild | DictCompiler::kDump;
   }
-  the<ResourceResolver> resolver(
-      Service::instance().CreateDeployedResourceResolver(
-          {"compiled_schema", "", ".schema.yaml"}));
-  auto compiled_schema = resolver->ResolvePath(schema_id).string();
+  bool use_bundle = false;
+  if (schema.config()->GetBool("translator/bundle", &use_bundle) &&
+      use_bundle) {
+    options |= DictCompiler::kBundle;
+  }
+  dict_compiler.set_options(options);
   if (!dict_compiler.Compile(compiled_schema)) {
     LOG(ERROR) << "dictionary '" << dict_name << "' failed to compile.";
     return false;
@@ -442,7 +467,7 @@ bool ConfigFileUpdate::Run(Deployer* deployer) {
   // build the config file if needs update
   the<Config> config(Config::Require("config")->Create(file_name_));
   if (ConfigNeedsUpdate(config.get())) {
-    if (!MaybeCreateDirectory(deployer->staging_dir)) {
+    if (!MaybeCreateDirectory(deployer->output_dir())) {
       return false;
     }
     config.reset(Config::Require("config_builder")->Create(file_name_));
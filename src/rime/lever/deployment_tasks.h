@@ -50,6 +50,7 @@ class RIME_API SchemaUpdate : public DeploymentTask {
       : schema_file_(schema_file) {}
   SchemaUpdate(TaskInitializer arg);
   bool Run(Deployer* deployer);
+  string arguments() const { return schema_file_; }
   void set_verbose(bool verbose) { verbose_ = verbose; }
 
  protected:
@@ -64,6 +65,7 @@ class ConfigFileUpdate : public DeploymentTask {
       : file_name_(file_name), version_key_(version_key) {}
   ConfigFileUpdate(TaskInitializer arg);
   bool Run(Deployer* deployer);
+  string arguments() const { return file_name_ + ' ' + version_key_; }
 
  protected:
   string file_name_;
@@ -23,17 +23,17 @@ static void rime_levers_initialize() {
   Registry& r = Registry::instance();
 
   // deployment tools
-  r.Register("detect_modifications", new Component<DetectModifications>);
-  r.Register("installation_update", new Component<InstallationUpdate>);
-  r.Register("workspace_update", new Component<WorkspaceUpdate>);
-  r.Register("schema_update", new Component<SchemaUpdate>);
-  r.Register("config_file_update", new Component<ConfigFileUpdate>);
-  r.Register("prebuild_all_schemas", new Component<PrebuildAllSchemas>);
-  r.Register("user_dict_upgrade", new Component<UserDictUpgrade>);
-  r.Register("cleanup_trash", new Component<CleanupTrash>);
-  r.Register("user_dict_sync", new Component<UserDictSync>);
-  r.Register("backup_config_files", new Component<BackupConfigFiles>);
-  r.Register("clean_old_log_files", new Component<CleanOldLogFiles>);
+  r.Register<Component<DetectModifications>>("detect_modifications");
+  r.Register<Component<InstallationUpdate>>("installation_update");
+  r.Register<Component<WorkspaceUpdate>>("workspace_update");
+  r.Register<Component<SchemaUpdate>>("schema_update");
+  r.Register<Component<ConfigFileUpdate>>("config_file_update");
+  r.Register<Component<PrebuildAllSchemas>>("prebuild_all_schemas");
+  r.Register<Component<UserDictUpgrade>>("user_dict_upgrade");
+  r.Register<Component<CleanupTrash>>("cleanup_trash");
+  r.Register<Component<UserDictSync>>("user_dict_sync");
+  r.Register<Component<BackupConfigFiles>>("backup_config_files");
+  r.Register<Component<CleanOldLogFiles>>("clean_old_log_files");
 }
 
 static void rime_levers_finalize() {}
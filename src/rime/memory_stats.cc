@@ -0,0 +1,54 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+
+#include <mutex>
+#include <rime/config/config_component.h>
+#include <rime/memory_stats.h>
+#include <rime/registry.h>
+#include <rime/service.h>
+
+namespace rime {
+
+static std::mutex g_providers_mutex;
+static map<string, MemoryStatsProvider> g_providers;
+
+void RegisterMemoryStatsProvider(const string& name,
+                                 MemoryStatsProvider provider) {
+  std::lock_guard<std::mutex> lock(g_providers_mutex);
+  g_providers[name] = std::move(provider);
+}
+
+void UnregisterMemoryStatsProvider(const string& name) {
+  std::lock_guard<std::mutex> lock(g_providers_mutex);
+  g_providers.erase(name);
+}
+
+MemoryStats CollectMemoryStats() {
+  MemoryStats stats;
+  stats.num_sessions = Service::instance().GetSessionStats(&stats.sessions);
+  for (const auto& session : stats.sessions) {
+    const auto& usage = session.second;
+    stats.session_bytes += usage.total();
+    stats.engine_bytes += usage.engine_bytes;
+    stats.context_bytes += usage.context_bytes;
+    stats.menu_bytes += usage.menu_bytes;
+  }
+  // components not yet in use hold nothing
+  for (const char* component_name : {"config", "config_builder",
+                                     "user_config"}) {
+    auto* component = dynamic_cast<ConfigComponentBase*>(
+        Registry::instance().FindInstantiated(component_name));
+    if (component) {
+      stats.num_configs += component->GetCacheStats(&stats.config_bytes);
+    }
+  }
+  std::lock_guard<std::mutex> lock(g_providers_mutex);
+  for (const auto& provider : g_providers) {
+    provider.second(&stats);
+  }
+  return stats;
+}
+
+}  // namespace rime
@@ -0,0 +1,60 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+
+#ifndef RIME_MEMORY_STATS_H_
+#define RIME_MEMORY_STATS_H_
+
+#include <rime_api.h>
+#include <rime/common.h>
+#include <rime/service.h>
+
+namespace rime {
+
+// Memory held by the library. Sizes of in-memory data are estimates.
+struct MemoryStats {
+  // files mapped into memory
+  size_t num_mapped_files = 0;
+  size_t num_tables = 0;
+  size_t num_prisms = 0;
+  size_t num_reverse_dbs = 0;
+  size_t mapped_bytes = 0;
+  size_t resident_bytes = 0;
+  // opened dbs, including user dictionaries
+  size_t num_dbs = 0;
+  size_t db_bytes = 0;
+  // sessions, excluding the shared resources counted above
+  size_t num_sessions = 0;
+  size_t session_bytes = 0;
+  // parts of session_bytes
+  size_t engine_bytes = 0;
+  size_t context_bytes = 0;
+  size_t menu_bytes = 0;
+  map<SessionId, SessionMemoryUsage> sessions;
+  // config data in use
+  size_t num_configs = 0;
+  size_t config_bytes = 0;
+  // tables and prisms cached by the dictionary component, which are among
+  // the mapped files
+  size_t num_cached_dict_files = 0;
+  size_t cached_dict_bytes = 0;
+  // user dbs cached by the user dictionary component, which are among the
+  // dbs
+  size_t num_cached_user_dbs = 0;
+  size_t cached_user_db_bytes = 0;
+};
+
+// Modules holding resources outside of the core add their numbers to stats.
+using MemoryStatsProvider = function<void(MemoryStats* stats)>;
+
+RIME_API void RegisterMemoryStatsProvider(const string& name,
+                                          MemoryStatsProvider provider);
+RIME_API void UnregisterMemoryStatsProvider(const string& name);
+
+// Should be called in the thread that processes input for the sessions.
+RIME_API MemoryStats CollectMemoryStats();
+
+}  // namespace rime
+
+#endif  // RIME_MEMORY_STATS_H_
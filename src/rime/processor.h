@@ -31,6 +31,12 @@ class Processor : public Class<Processor, const Ticket&> {
     return kNoop;
   }
 
+  // the engine suspends components of a schema it switches away from, and
+  // keeps them for switching back; they are resumed when put back to use.
+  // components connected to the context should disconnect on suspension.
+  virtual void Suspend() {}
+  virtual void Resume() {}
+
   string name_space() const { return name_space_; }
 
  protected:
@@ -12,15 +12,30 @@ namespace rime {
 
 void Registry::Register(const string& name, ComponentBase* component) {
   LOG(INFO) << "registering component: " << name;
-  if (ComponentBase* existing = Find(name)) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (IsRegistered(name)) {
     LOG(WARNING) << "replacing previously registered component: " << name;
-    delete existing;
+    delete FindInstantiated(name);
+    factories_.erase(name);
   }
   map_[name] = component;
 }
 
+void Registry::Register(const string& name, ComponentFactory factory) {
+  DLOG(INFO) << "registering component factory: " << name;
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (IsRegistered(name)) {
+    LOG(WARNING) << "replacing previously registered component: " << name;
+    delete FindInstantiated(name);
+    map_.erase(name);
+  }
+  factories_[name] = std::move(factory);
+}
+
 void Registry::Unregister(const string& name) {
   LOG(INFO) << "unregistering component: " << name;
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  factories_.erase(name);
   ComponentMap::iterator it = map_.find(name);
   if (it == map_.end())
     return;
@@ -28,7 +43,14 @@ void Registry::Unregister(const string& name) {
   map_.erase(it);
 }
 
+bool Registry::IsRegistered(const string& name) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return map_.count(name) != 0 || factories_.count(name) != 0;
+}
+
 void Registry::Clear() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  factories_.clear();
   ComponentMap::iterator it = map_.begin();
   while (it != map_.end()) {
     delete it->second;
@@ -37,6 +59,40 @@ void Registry::Clear() {
 }
 
 ComponentBase* Registry::Find(const string& name) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (ComponentBase* component = FindInstantiated(name)) {
+    return component;
+  }
+  FactoryMap::iterator it = factories_.find(name);
+  if (it == factories_.end()) {
+    return NULL;
+  }
+  // a component looking up itself while being created does not find itself
+  if (instantiating_.count(name)) {
+    return NULL;
+  }
+  // copied, as the component may replace the factory while being created
+  ComponentFactory factory = it->second;
+  LOG(INFO) << "instantiating component: " << name;
+  instantiating_.insert(name);
+  ComponentBase* component = NULL;
+  try {
+    component = factory();
+  } catch (...) {
+    instantiating_.erase(name);
+    throw;
+  }
+  instantiating_.erase(name);
+  // the factory is kept for another try if it failed
+  if (component) {
+    map_[name] = component;
+    factories_.erase(name);
+  }
+  return component;
+}
+
+ComponentBase* Registry::FindInstantiated(const string& name) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ComponentMap::const_iterator it = map_.find(name);
   if (it != map_.end()) {
     return it->second;
@@ -7,6 +7,7 @@
 #ifndef RIME_REGISTRY_H_
 #define RIME_REGISTRY_H_
 
+#include <mutex>
 #include <rime_api.h>
 #include <rime/common.h>
 
@@ -17,10 +18,22 @@ class ComponentBase;
 class Registry {
  public:
   using ComponentMap = map<string, ComponentBase*>;
+  using ComponentFactory = function<ComponentBase*()>;
+  using FactoryMap = map<string, ComponentFactory>;
 
+  // instantiates the component on first call if registered with a factory
   RIME_API ComponentBase* Find(const string& name);
+  // returns nullptr if the component has not been instantiated yet
+  RIME_API ComponentBase* FindInstantiated(const string& name);
   RIME_API void Register(const string& name, ComponentBase* component);
+  // defers creating the component until it is looked up
+  RIME_API void Register(const string& name, ComponentFactory factory);
+  template <class T>
+  void Register(const string& name) {
+    Register(name, ComponentFactory([] { return new T; }));
+  }
   RIME_API void Unregister(const string& name);
+  RIME_API bool IsRegistered(const string& name);
   void Clear();
 
   RIME_API static Registry& instance();
@@ -28,7 +41,12 @@ class Registry {
  private:
   Registry() = default;
 
+  // component constructors may look up other components
+  std::recursive_mutex mutex_;
   ComponentMap map_;
+  FactoryMap factories_;
+  // components being created by their factories
+  set<string> instantiating_;
 };
 
 }  // namespace rime
@@ -33,14 +33,116 @@ std::filesystem::path ResourceResolver::ResolvePath(const string& resource_id) {
       std::filesystem::path(type_.prefix + resource_id + type_.suffix));
 }
 
+// file names are matched as the file system would
+static string file_name_key(const std::filesystem::path& file_path) {
+#if defined(_WIN32) || defined(__APPLE__)
+  return boost::algorithm::to_lower_copy(file_path.filename().string());
+#else
+  return file_path.filename().string();
+#endif
+}
+
+static string directory_key(const std::filesystem::path& dir) {
+  auto normal = dir.lexically_normal();
+  // "/a/b/" and "/a/b" name the same directory
+  if (!normal.has_filename() && normal != normal.root_path())
+    normal = normal.parent_path();
+  return normal.string();
+}
+
+bool ResourcePathIndex::Exists(const std::filesystem::path& file_path) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!suspended_) {
+      auto& directory = Find(file_path.parent_path());
+      return directory.files.count(file_name_key(file_path)) != 0;
+    }
+  }
+  return std::filesystem::exists(file_path);
+}
+
+void ResourcePathIndex::Scan(const std::filesystem::path& dir) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto key = directory_key(std::filesystem::absolute(dir));
+  Load(key, &directories_[key]);
+}
+
+void ResourcePathIndex::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  directories_.clear();
+}
+
+void ResourcePathIndex::Suspend() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++suspended_;
+}
+
+void ResourcePathIndex::Resume() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (suspended_ > 0 && --suspended_ == 0)
+    directories_.clear();
+}
+
+bool ResourcePathIndex::suspended() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return suspended_ > 0;
+}
+
+ResourcePathIndex::Directory& ResourcePathIndex::Find(
+    const std::filesystem::path& dir) {
+  auto key = directory_key(dir);
+  auto found = directories_.find(key);
+  if (found == directories_.end()) {
+    auto& directory = directories_[key];
+    Load(key, &directory);
+    return directory;
+  }
+  auto& directory = found->second;
+  auto now = std::chrono::steady_clock::now();
+  if (now - directory.last_check >= kRecheckInterval) {
+    std::error_code ec;
+    auto last_write_time = std::filesystem::last_write_time(key, ec);
+    if (bool(ec) == directory.exists ||
+        (!ec && last_write_time != directory.last_write_time)) {
+      Load(key, &directory);
+    } else {
+      directory.last_check = now;
+    }
+  }
+  return directory;
+}
+
+void ResourcePathIndex::Load(const std::filesystem::path& dir,
+                             Directory* directory) {
+  directory->files.clear();
+  directory->last_check = std::chrono::steady_clock::now();
+  std::error_code ec;
+  directory->last_write_time = std::filesystem::last_write_time(dir, ec);
+  directory->exists = !ec;
+  if (!directory->exists)
+    return;
+  for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    directory->files.insert(file_name_key(it->path()));
+  }
+  if (ec) {
+    LOG(WARNING) << "error scanning directory " << dir << ": " << ec.message();
+  }
+}
+
+bool FallbackResourceResolver::Exists(const std::filesystem::path& file_path) {
+  return path_index_ ? path_index_->Exists(file_path)
+                     : std::filesystem::exists(file_path);
+}
+
 std::filesystem::path FallbackResourceResolver::ResolvePath(
     const string& resource_id) {
   auto default_path = ResourceResolver::ResolvePath(resource_id);
-  if (!std::filesystem::exists(default_path)) {
+  if (!Exists(default_path)) {
     auto fallback_path = std::filesystem::absolute(
         fallback_root_path_ /
         std::filesystem::path(type_.prefix + resource_id + type_.suffix));
-    if (std::filesystem::exists(fallback_path)) {
+    if (Exists(fallback_path)) {
       return fallback_path;
     }
   }
@@ -6,7 +6,9 @@
 #ifndef RIME_RESOURCE_H_
 #define RIME_RESOURCE_H_
 
+#include <chrono>
 #include <filesystem>
+#include <mutex>
 #include <rime_api.h>
 #include <rime/common.h>
 
@@ -37,6 +39,39 @@ class RIME_API ResourceResolver {
   std::filesystem::path root_path_;
 };
 
+// Remembers the files in data directories, so that resolving a resource
+// does not probe the file system each time.
+// A directory is scanned on first use, and rescanned if its modification
+// time has changed when checked again after kRecheckInterval.
+class RIME_API ResourcePathIndex {
+ public:
+  static constexpr std::chrono::seconds kRecheckInterval{1};
+
+  bool Exists(const std::filesystem::path& file_path);
+  void Scan(const std::filesystem::path& dir);
+  void Invalidate();
+  // while data files are being updated, Exists() probes the file system
+  // directly; the index is rebuilt after the last Resume().
+  void Suspend();
+  void Resume();
+  bool suspended() const;
+
+ private:
+  struct Directory {
+    bool exists = false;
+    std::filesystem::file_time_type last_write_time;
+    std::chrono::steady_clock::time_point last_check;
+    set<string> files;
+  };
+  Directory& Find(const std::filesystem::path& dir);
+  static void Load(const std::filesystem::path& dir, Directory* directory);
+
+  // guards the directories and the suspension count
+  mutable std::mutex mutex_;
+  map<string, Directory> directories_;
+  int suspended_ = 0;
+};
+
 // try fallback path if target file doesn't exist in root path
 class RIME_API FallbackResourceResolver : public ResourceResolver {
  public:
@@ -46,9 +81,16 @@ class RIME_API FallbackResourceResolver : public ResourceResolver {
   void set_fallback_root_path(std::filesystem::path fallback_root_path) {
     fallback_root_path_ = fallback_root_path;
   }
+  // consults the index, if given, instead of the file system
+  void set_path_index(ResourcePathIndex* path_index) {
+    path_index_ = path_index;
+  }
 
  private:
+  bool Exists(const std::filesystem::path& file_path);
+
   std::filesystem::path fallback_root_path_;
+  ResourcePathIndex* path_index_ = nullptr;
 };
 
 }  // namespace rime
@@ -23,6 +23,10 @@ class Segmentor : public Class<Segmentor, const Ticket&> {
 
   virtual bool Proceed(Segmentation* segmentation) = 0;
 
+  // called when the engine sets the component aside and puts it back to use.
+  virtual void Suspend() {}
+  virtual void Resume() {}
+
   string name_space() const { return name_space_; }
 
  protected:
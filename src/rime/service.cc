@@ -4,8 +4,14 @@
 //
 // 2011-08-08 GONG Chen <chen.sst@gmail.com>
 //
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <rime/candidate.h>
 #include <rime/context.h>
 #include <rime/engine.h>
+#include <rime/flight_recorder.h>
+#include <rime/menu.h>
 #include <rime/resource.h>
 #include <rime/schema.h>
 #include <rime/service.h>
@@ -15,15 +21,45 @@ using namespace std::placeholders;
 namespace rime {
 
 Session::Session() {
-  engine_.reset(Engine::Create());
-  engine_->sink().connect(std::bind(&Session::OnCommit, this, _1));
+  Service& service = Service::instance();
+  if (service.flight_recorder_size() > 0 && service.slow_key_threshold() > 0) {
+    flight_recorder_.reset(new FlightRecorder(
+        service.flight_recorder_size(), service.slow_key_threshold(),
+        service.flight_recorder_dump_dir()));
+  }
+  CreateEngine();
   SessionId session_id = reinterpret_cast<SessionId>(this);
   engine_->message_sink().connect(
       std::bind(&Service::Notify, &Service::instance(), session_id, _1, _2));
 }
 
+Session::~Session() {}
+
+void Session::CreateEngine() {
+  engine_.reset(Engine::Create());
+  engine_->set_schema_pool_size(
+      (std::max)(Service::instance().schema_pool_size(), 0));
+  engine_->sink().connect(std::bind(&Session::OnCommit, this, _1));
+}
+
+// keeps the active generation of deployed data in place while sessions
+// load data files from it
+static std::shared_lock<std::shared_mutex> LockDeployedData() {
+  return std::shared_lock<std::shared_mutex>(
+      Service::shared_instance().deployer().generation_mutex());
+}
+
 bool Session::ProcessKey(const KeyEvent& key_event) {
-  return engine_->ProcessKey(key_event);
+  std::lock_guard<std::recursive_mutex> session_lock(mutex_);
+  if (!engine_)
+    return false;
+  auto lock = LockDeployedData();
+  if (!flight_recorder_)
+    return engine_->ProcessKey(key_event);
+  flight_recorder_->BeginKey(key_event, engine_.get());
+  bool accepted = engine_->ProcessKey(key_event);
+  flight_recorder_->EndKey(accepted);
+  return accepted;
 }
 
 void Session::Activate() {
@@ -35,6 +71,7 @@ void Session::ResetCommitText() {
 }
 
 bool Session::CommitComposition() {
+  std::lock_guard<std::recursive_mutex> session_lock(mutex_);
   if (!engine_)
     return false;
   engine_->context()->Commit();
@@ -42,17 +79,70 @@ bool Session::CommitComposition() {
 }
 
 void Session::ClearComposition() {
+  std::lock_guard<std::recursive_mutex> session_lock(mutex_);
   if (!engine_)
     return;
   engine_->context()->Clear();
 }
 
 void Session::ApplySchema(Schema* schema) {
+  std::lock_guard<std::recursive_mutex> session_lock(mutex_);
+  if (!engine_)
+    Revive();
+  auto lock = LockDeployedData();
   engine_->ApplySchema(schema);
 }
 
+void Session::ReleaseSchemaPool() {
+  std::lock_guard<std::recursive_mutex> session_lock(mutex_);
+  if (engine_)
+    engine_->ReleaseSchemaPool();
+}
+
 void Session::OnCommit(const string& commit_text) {
   commit_text_ += commit_text;
+  ++versions_.commit;
+}
+
+const SessionVersions& Session::UpdateVersions() {
+  Context* ctx = context();
+  Schema* schema = this->schema();
+  // the context stamps its changes; only the page is worked out here
+  int composition_stamp = ctx ? ctx->composition_stamp() : 0;
+  int highlight_stamp = ctx ? ctx->highlight_stamp() : 0;
+  int option_stamp = ctx ? ctx->option_stamp() : 0;
+  int page_no = -1;
+  if (ctx && ctx->HasMenu()) {
+    int page_size = schema ? schema->page_size() : 5;
+    page_no = static_cast<int>(ctx->composition().back().selected_index) /
+              (std::max)(page_size, 1);
+  }
+  bool composing = ctx && ctx->IsComposing();
+  bool disabled = Service::instance().disabled();
+  if (composition_stamp != seen_.composition_stamp) {
+    seen_.composition_stamp = composition_stamp;
+    ++versions_.composition;
+    // the menu is rebuilt with the composition
+    ++versions_.menu;
+  } else if (page_no != seen_.page_no) {
+    ++versions_.menu;
+  }
+  seen_.page_no = page_no;
+  if (highlight_stamp != seen_.highlight_stamp) {
+    seen_.highlight_stamp = highlight_stamp;
+    ++versions_.highlight;
+  }
+  if (option_stamp != seen_.option_stamp || composing != seen_.composing ||
+      disabled != seen_.disabled || schema != seen_.schema ||
+      (schema && schema->schema_id() != seen_.schema_id)) {
+    seen_.option_stamp = option_stamp;
+    seen_.composing = composing;
+    seen_.disabled = disabled;
+    seen_.schema = schema;
+    seen_.schema_id = schema ? schema->schema_id() : string();
+    ++versions_.status;
+  }
+  return versions_;
 }
 
 Context* Session::context() const {
@@ -63,6 +153,276 @@ Schema* Session::schema() const {
   return engine_ ? engine_->active_engine()->schema() : NULL;
 }
 
+SessionMemoryUsage Session::EstimateMemoryUsage() const {
+  SessionMemoryUsage usage;
+  usage.session_bytes =
+      sizeof(Session) + commit_text_.capacity() + snapshot_.capacity();
+  if (!engine_)
+    return usage;
+  usage.engine_bytes = engine_->EstimateMemoryUsage();
+  Context* ctx = context();
+  if (!ctx)
+    return usage;
+  usage.context_bytes = sizeof(Context) + ctx->input().capacity();
+  for (const auto& record : ctx->commit_history()) {
+    usage.context_bytes +=
+        sizeof(CommitRecord) + record.type.capacity() + record.text.capacity();
+  }
+  for (const auto& segment : ctx->composition()) {
+    usage.context_bytes += sizeof(Segment) + segment.prompt.capacity();
+    if (!segment.menu)
+      continue;
+    usage.menu_bytes += sizeof(Menu);
+    for (size_t i = 0; i < segment.menu->candidate_count(); ++i) {
+      if (auto cand = segment.menu->GetCandidateAt(i)) {
+        usage.menu_bytes +=
+            sizeof(Candidate) + cand->text().size() + cand->comment().size();
+      }
+    }
+  }
+  return usage;
+}
+
+namespace {
+
+// Session state is saved in a compact binary form: unsigned integers are
+// encoded as varints, and strings are prefixed with their lengths.
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(string* out) : out_(out) {}
+
+  void Write(size_t value) {
+    while (value >= 0x80) {
+      out_->push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    out_->push_back(static_cast<char>(value));
+  }
+  void Write(const string& str) {
+    Write(str.length());
+    out_->append(str);
+  }
+
+ private:
+  string* out_;
+};
+
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(const string& in) : in_(in) {}
+
+  bool Read(size_t* value) {
+    *value = 0;
+    for (int shift = 0; pos_ < in_.length() && shift < 64; shift += 7) {
+      auto byte = static_cast<unsigned char>(in_[pos_++]);
+      *value |= static_cast<size_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+  bool Read(string* str) {
+    size_t length = 0;
+    if (!Read(&length) || length > in_.length() - pos_)
+      return false;
+    str->assign(in_, pos_, length);
+    pos_ += length;
+    return true;
+  }
+
+ private:
+  const string& in_;
+  size_t pos_ = 0;
+};
+
+struct SegmentSnapshot {
+  size_t start = 0;
+  size_t end = 0;
+  size_t status = Segment::kVoid;
+  size_t selected_index = 0;
+};
+
+struct SessionSnapshot {
+  string schema_id;
+  map<string, bool> options;
+  map<string, string> properties;
+  string input;
+  size_t caret_pos = 0;
+  vector<SegmentSnapshot> segments;
+  vector<CommitRecord> commit_history;
+
+  void Save(string* out) const;
+  bool Load(const string& in);
+};
+
+void SessionSnapshot::Save(string* out) const {
+  SnapshotWriter writer(out);
+  writer.Write(schema_id);
+  writer.Write(options.size());
+  for (const auto& option : options) {
+    writer.Write(option.first);
+    writer.Write(size_t(option.second));
+  }
+  writer.Write(properties.size());
+  for (const auto& property : properties) {
+    writer.Write(property.first);
+    writer.Write(property.second);
+  }
+  writer.Write(input);
+  writer.Write(caret_pos);
+  writer.Write(segments.size());
+  for (const auto& segment : segments) {
+    writer.Write(segment.start);
+    writer.Write(segment.end);
+    writer.Write(segment.status);
+    writer.Write(segment.selected_index);
+  }
+  writer.Write(commit_history.size());
+  for (const auto& record : commit_history) {
+    writer.Write(record.type);
+    writer.Write(record.text);
+  }
+}
+
+bool SessionSnapshot::Load(const string& in) {
+  SnapshotReader reader(in);
+  size_t count = 0;
+  if (!reader.Read(&schema_id) || !reader.Read(&count))
+    return false;
+  for (size_t i = 0; i < count; ++i) {
+    string name;
+    size_t value = 0;
+    if (!reader.Read(&name) || !reader.Read(&value))
+      return false;
+    options[name] = value != 0;
+  }
+  if (!reader.Read(&count))
+    return false;
+  for (size_t i = 0; i < count; ++i) {
+    string name, value;
+    if (!reader.Read(&name) || !reader.Read(&value))
+      return false;
+    properties[name] = value;
+  }
+  if (!reader.Read(&input) || !reader.Read(&caret_pos) || !reader.Read(&count))
+    return false;
+  segments.resize(count);
+  for (auto& segment : segments) {
+    if (!reader.Read(&segment.start) || !reader.Read(&segment.end) ||
+        !reader.Read(&segment.status) || !reader.Read(&segment.selected_index))
+      return false;
+  }
+  if (!reader.Read(&count))
+    return false;
+  for (size_t i = 0; i < count; ++i) {
+    string type, text;
+    if (!reader.Read(&type) || !reader.Read(&text))
+      return false;
+    commit_history.emplace_back(type, text);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool Session::Hibernate() {
+  // not while the session is in use
+  std::unique_lock<std::recursive_mutex> session_lock(mutex_,
+                                                      std::try_to_lock);
+  if (!session_lock.owns_lock())
+    return false;
+  // not while another engine, eg. the schema menu, is active
+  if (!engine_ || engine_->active_engine() != engine_.get())
+    return false;
+  Context* ctx = engine_->context();
+  SessionSnapshot snapshot;
+  if (Schema* schema = engine_->schema())
+    snapshot.schema_id = schema->schema_id();
+  snapshot.options = ctx->options();
+  snapshot.properties = ctx->properties();
+  snapshot.input = ctx->input();
+  snapshot.caret_pos = ctx->caret_pos();
+  for (const auto& segment : ctx->composition()) {
+    snapshot.segments.push_back({segment.start, segment.end,
+                                 static_cast<size_t>(segment.status),
+                                 segment.selected_index});
+  }
+  snapshot.commit_history.assign(ctx->commit_history().begin(),
+                                 ctx->commit_history().end());
+  string blob;
+  snapshot.Save(&blob);
+  snapshot_.swap(blob);
+  engine_.reset();
+  hibernated_ = true;
+  DLOG(INFO) << "session hibernated, state: " << snapshot_.length()
+             << " bytes.";
+  return true;
+}
+
+bool Session::Revive() {
+  std::lock_guard<std::recursive_mutex> session_lock(mutex_);
+  if (engine_)
+    return true;
+  auto lock = LockDeployedData();
+  SessionSnapshot snapshot;
+  bool loaded = snapshot.Load(snapshot_);
+  string().swap(snapshot_);
+  CreateEngine();
+  hibernated_ = false;
+  if (!loaded) {
+    LOG(ERROR) << "error restoring hibernated session; starting over.";
+  } else {
+    Engine* engine = engine_.get();
+    // the switcher selects the schema used last time by default
+    if (!snapshot.schema_id.empty() &&
+        snapshot.schema_id != engine->schema()->schema_id()) {
+      engine->ApplySchema(new Schema(snapshot.schema_id));
+    }
+    Context* ctx = engine->context();
+    for (const auto& option : snapshot.options) {
+      ctx->set_option(option.first, option.second);
+    }
+    for (const auto& property : snapshot.properties) {
+      ctx->set_property(property.first, property.second);
+    }
+    ctx->commit_history().assign(snapshot.commit_history.begin(),
+                                 snapshot.commit_history.end());
+    if (!snapshot.input.empty()) {
+      ctx->set_input(snapshot.input);
+      // repeat the selections to rebuild confirmed segments
+      for (const auto& segment : snapshot.segments) {
+        if (segment.status < Segment::kSelected)
+          break;
+        const auto& comp = ctx->composition();
+        if (comp.empty() || comp.back().start != segment.start ||
+            !ctx->Select(segment.selected_index)) {
+          LOG(WARNING) << "failed to restore selection at " << segment.start;
+          break;
+        }
+      }
+      if (ctx->caret_pos() != snapshot.caret_pos) {
+        ctx->set_caret_pos(snapshot.caret_pos);
+      }
+      // the highlighted candidate in the segment being composed
+      auto& comp = ctx->composition();
+      if (!comp.empty() && comp.size() == snapshot.segments.size()) {
+        const auto& last = snapshot.segments.back();
+        auto& segment = comp.back();
+        if (last.status < Segment::kSelected && segment.start == last.start &&
+            segment.GetCandidateAt(last.selected_index)) {
+          segment.selected_index = last.selected_index;
+        }
+      }
+    }
+  }
+  // connected at last; the client is not notified of restored state
+  SessionId session_id = reinterpret_cast<SessionId>(this);
+  engine_->message_sink().connect(
+      std::bind(&Service::Notify, &Service::instance(), session_id, _1, _2));
+  DLOG(INFO) << "session revived.";
+  return true;
+}
+
 Service::Service() {
   deployer_.message_sink().connect(
       std::bind(&Service::Notify, this, 0, _1, _2));
@@ -72,13 +432,50 @@ Service::~Service() {
   StopService();
 }
 
+namespace {
+
+thread_local Service* g_current_service = nullptr;
+
+struct Tenant {
+  an<Service> service;
+  // ready once the last reference to the tenant is released
+  std::shared_future<void> destroyed;
+};
+
+std::mutex g_tenants_mutex;
+map<Service*, Tenant> g_tenants;
+// sessions created by tenants
+std::mutex g_session_owners_mutex;
+map<SessionId, weak<Service>> g_session_owners;
+
+// applies to the sessions of all tenants as well
+template <class Action>
+void ForEachTenant(Action action) {
+  std::lock_guard<std::mutex> lock(g_tenants_mutex);
+  for (const auto& entry : g_tenants) {
+    ServiceScope scope(entry.first);
+    action(entry.first);
+  }
+}
+
+}  // namespace
+
 void Service::StartService() {
+  auto& index = deployer_.resource_path_index();
+  index.Invalidate();
+  for (const auto& dir :
+       {deployer_.user_data_dir, deployer_.shared_data_dir,
+        deployer_.staging_dir, deployer_.prebuilt_data_dir}) {
+    index.Scan(dir);
+  }
   started_ = true;
 }
 
 void Service::StopService() {
   started_ = false;
   CleanupAllSessions();
+  if (!is_tenant())
+    DestroyAllTenants();
 }
 
 SessionId Service::CreateSession() {
@@ -86,9 +483,18 @@ SessionId Service::CreateSession() {
   if (disabled())
     return id;
   try {
-    auto session = New<Session>();
+    an<Session> session;
+    {
+      auto lock = LockDeployedData();
+      session = New<Session>();
+    }
     session->Activate();
     id = reinterpret_cast<uintptr_t>(session.get());
+    if (is_tenant()) {
+      std::lock_guard<std::mutex> lock(g_session_owners_mutex);
+      g_session_owners[id] = weak_from_this();
+    }
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     sessions_[id] = session;
   } catch (const std::exception& ex) {
     LOG(ERROR) << "Error creating session: " << ex.what();
@@ -107,9 +513,16 @@ SessionId Service::CreateSession() {
 an<Session> Service::GetSession(SessionId session_id) {
   if (disabled())
     return nullptr;
-  SessionMap::iterator it = sessions_.find(session_id);
-  if (it != sessions_.end()) {
-    auto& session = it->second;
+  an<Session> session;
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    SessionMap::iterator it = sessions_.find(session_id);
+    if (it != sessions_.end())
+      session = it->second;
+  }
+  if (session) {
+    if (session->hibernated() && !session->Revive())
+      return nullptr;
     session->Activate();
     return session;
   }
@@ -117,32 +530,113 @@ an<Session> Service::GetSession(SessionId session_id) {
 }
 
 bool Service::DestroySession(SessionId session_id) {
-  auto it = sessions_.find(session_id);
-  if (it == sessions_.end())
-    return false;
-  sessions_.erase(it);
+  an<Session> session;
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end())
+      return false;
+    session = std::move(it->second);
+    sessions_.erase(it);
+  }
+  if (is_tenant()) {
+    std::lock_guard<std::mutex> lock(g_session_owners_mutex);
+    g_session_owners.erase(session_id);
+  }
+  // the engine is torn down outside the lock
+  session.reset();
   return true;
 }
 
 void Service::CleanupStaleSessions() {
   time_t now = time(NULL);
+  vector<an<Session>> stale_sessions;
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      if (it->second &&
+          it->second->last_active_time() < now - Session::kLifeSpan) {
+        if (is_tenant()) {
+          std::lock_guard<std::mutex> lock(g_session_owners_mutex);
+          g_session_owners.erase(it->first);
+        }
+        stale_sessions.push_back(std::move(it->second));
+        sessions_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (!stale_sessions.empty()) {
+    LOG(INFO) << "Recycled " << stale_sessions.size() << " stale sessions.";
+  }
+  HibernateIdleSessions();
+  if (!is_tenant())
+    ForEachTenant([](Service* tenant) { tenant->CleanupStaleSessions(); });
+}
+
+void Service::HibernateIdleSessions(time_t now) {
+  if (hibernation_threshold_ <= 0)
+    return;
   int count = 0;
-  for (auto it = sessions_.begin(); it != sessions_.end();) {
-    if (it->second &&
-        it->second->last_active_time() < now - Session::kLifeSpan) {
-      sessions_.erase(it++);
+  std::lock_guard<std::mutex> lock(sessions_mutex_);
+  for (auto& entry : sessions_) {
+    auto& session = entry.second;
+    // sessions are only shared with callers of GetSession() through the map,
+    // which cannot give out new references while it is locked
+    if (session && session.use_count() == 1 && !session->hibernated() &&
+        session->last_active_time() < now - hibernation_threshold_ &&
+        session->Hibernate()) {
       ++count;
-    } else {
-      ++it;
     }
   }
   if (count > 0) {
-    LOG(INFO) << "Recycled " << count << " stale sessions.";
+    LOG(INFO) << "Hibernated " << count << " idle sessions.";
+  }
+}
+
+void Service::ReleaseSchemaPools() {
+  // waits for sessions processing keys without blocking access to others
+  vector<an<Session>> sessions;
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (const auto& entry : sessions_) {
+      if (entry.second)
+        sessions.push_back(entry.second);
+    }
   }
+  for (const auto& session : sessions) {
+    session->ReleaseSchemaPool();
+  }
+  if (!is_tenant())
+    ForEachTenant([](Service* tenant) { tenant->ReleaseSchemaPools(); });
 }
 
 void Service::CleanupAllSessions() {
-  sessions_.clear();
+  SessionMap sessions;
+  {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    sessions.swap(sessions_);
+  }
+  if (is_tenant()) {
+    std::lock_guard<std::mutex> lock(g_session_owners_mutex);
+    for (const auto& entry : sessions) {
+      g_session_owners.erase(entry.first);
+    }
+  } else {
+    ForEachTenant([](Service* tenant) { tenant->CleanupAllSessions(); });
+  }
+}
+
+size_t Service::GetSessionStats(
+    map<SessionId, SessionMemoryUsage>* sessions) const {
+  std::lock_guard<std::mutex> lock(sessions_mutex_);
+  if (sessions) {
+    for (const auto& session : sessions_) {
+      (*sessions)[session.first] = session.second->EstimateMemoryUsage();
+    }
+  }
+  return sessions_.size();
 }
 
 void Service::SetNotificationHandler(const NotificationHandler& handler) {
@@ -160,6 +654,9 @@ void Service::Notify(SessionId session_id,
     std::lock_guard<std::mutex> lock(mutex_);
     notification_handler_(session_id, message_type.c_str(),
                           message_value.c_str());
+  } else if (is_tenant()) {
+    // by default, the frontend handles notifications from all tenants
+    shared_instance().Notify(session_id, message_type, message_value);
   }
 }
 
@@ -167,6 +664,7 @@ ResourceResolver* Service::CreateResourceResolver(const ResourceType& type) {
   the<FallbackResourceResolver> resolver(new FallbackResourceResolver(type));
   resolver->set_root_path(deployer().user_data_dir);
   resolver->set_fallback_root_path(deployer().shared_data_dir);
+  resolver->set_path_index(&deployer().resource_path_index());
   return resolver.release();
 }
 
@@ -182,17 +680,24 @@ ResourceResolver* Service::CreateDeployedResourceResolver(
   the<FallbackResourceResolver> resolver(new FallbackResourceResolver(type));
   resolver->set_root_path(deployer().staging_dir);
   resolver->set_fallback_root_path(deployer().prebuilt_data_dir);
+  resolver->set_path_index(&deployer().resource_path_index());
   return resolver.release();
 }
 
 ResourceResolver* Service::CreateStagingResourceResolver(
     const ResourceType& type) {
   the<ResourceResolver> resolver(new ResourceResolver(type));
-  resolver->set_root_path(deployer().staging_dir);
+  resolver->set_root_path(deployer().output_dir());
   return resolver.release();
 }
 
 Service& Service::instance() {
+  if (g_current_service)
+    return *g_current_service;
+  return shared_instance();
+}
+
+Service& Service::shared_instance() {
   static the<Service> s_instance;
   if (!s_instance) {
     s_instance.reset(new Service);
@@ -200,4 +705,113 @@ Service& Service::instance() {
   return *s_instance;
 }
 
+Service* Service::CreateTenant(const string& user_data_dir) {
+  Service& shared = shared_instance();
+  if (user_data_dir.empty() || user_data_dir == shared.deployer_.user_data_dir)
+    return nullptr;
+  auto destroyed = New<std::promise<void>>();
+  Tenant entry{an<Service>(new Service,
+                           [destroyed](Service* service) {
+                             {
+                               ServiceScope scope(service);
+                               delete service;
+                             }
+                             destroyed->set_value();
+                           }),
+               destroyed->get_future().share()};
+  Service* tenant = entry.service.get();
+  tenant->is_tenant_ = true;
+  Deployer& deployer = tenant->deployer_;
+  deployer.shared_data_dir = shared.deployer_.shared_data_dir;
+  deployer.prebuilt_data_dir = shared.deployer_.prebuilt_data_dir;
+  deployer.staging_dir = shared.deployer_.staging_dir;
+  deployer.distribution_name = shared.deployer_.distribution_name;
+  deployer.distribution_code_name = shared.deployer_.distribution_code_name;
+  deployer.distribution_version = shared.deployer_.distribution_version;
+  deployer.user_data_dir = user_data_dir;
+  deployer.sync_dir = (std::filesystem::path(user_data_dir) / "sync").string();
+  tenant->hibernation_threshold_ = shared.hibernation_threshold_;
+  tenant->schema_pool_size_ = shared.schema_pool_size_;
+  tenant->flight_recorder_size_ = shared.flight_recorder_size_;
+  tenant->slow_key_threshold_ = shared.slow_key_threshold_;
+  tenant->flight_recorder_dump_dir_ = shared.flight_recorder_dump_dir_;
+  std::error_code ec;
+  std::filesystem::create_directories(user_data_dir, ec);
+  if (ec) {
+    LOG(ERROR) << "error creating user data dir for tenant: "
+               << user_data_dir;
+    return nullptr;
+  }
+  {
+    ServiceScope scope(tenant);
+    tenant->StartService();
+    // assigns user id and sync dir for the tenant
+    if (DeploymentTask::Require("installation_update")) {
+      deployer.RunTask("installation_update");
+    }
+  }
+  LOG(INFO) << "created tenant with user data dir: " << user_data_dir;
+  std::lock_guard<std::mutex> lock(g_tenants_mutex);
+  g_tenants[tenant] = std::move(entry);
+  return tenant;
+}
+
+bool Service::DestroyTenant(an<Service> tenant) {
+  if (!tenant)
+    return false;
+  std::shared_future<void> destroyed;
+  {
+    std::lock_guard<std::mutex> lock(g_tenants_mutex);
+    auto it = g_tenants.find(tenant.get());
+    if (it == g_tenants.end())
+      return false;
+    destroyed = it->second.destroyed;
+    g_tenants.erase(it);
+  }
+  // API calls in progress on other threads hold the tenant till they return
+  tenant.reset();
+  destroyed.wait();
+  return true;
+}
+
+an<Service> Service::FindTenant(uintptr_t tenant_id) {
+  std::lock_guard<std::mutex> lock(g_tenants_mutex);
+  auto it = g_tenants.find(reinterpret_cast<Service*>(tenant_id));
+  return it != g_tenants.end() ? it->second.service : nullptr;
+}
+
+void Service::DestroyAllTenants() {
+  map<Service*, Tenant> tenants;
+  {
+    std::lock_guard<std::mutex> lock(g_tenants_mutex);
+    tenants.swap(g_tenants);
+  }
+  for (auto& entry : tenants) {
+    entry.second.service.reset();
+    entry.second.destroyed.wait();
+  }
+}
+
+an<Service> Service::FindSessionOwner(SessionId session_id) {
+  {
+    std::lock_guard<std::mutex> lock(g_session_owners_mutex);
+    auto it = g_session_owners.find(session_id);
+    if (it != g_session_owners.end()) {
+      if (auto owner = it->second.lock())
+        return owner;
+    }
+  }
+  // not owned; the process-wide service outlives the call
+  return an<Service>(an<Service>(), &shared_instance());
+}
+
+ServiceScope::ServiceScope(Service* service) : previous_(g_current_service) {
+  if (service)
+    g_current_service = service;
+}
+
+ServiceScope::~ServiceScope() {
+  g_current_service = previous_;
+}
+
 }  // namespace rime
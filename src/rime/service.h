@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <atomic>
 #include <mutex>
 #include <rime/common.h>
 #include <rime/deployer.h>
@@ -25,38 +26,108 @@ using NotificationHandler = function<void(SessionId session_id,
 
 class Context;
 class Engine;
+class FlightRecorder;
 class KeyEvent;
 class Schema;
 
+// versions of the parts of the session state shown by the frontend; they
+// start at 1 so that a client without any versions gets every part
+struct SessionVersions {
+  int composition = 1;
+  int menu = 1;
+  int highlight = 1;
+  int status = 1;
+  int commit = 1;
+};
+
+// approximate heap usage of a session, excluding the schema and
+// dictionaries shared among sessions
+struct SessionMemoryUsage {
+  // the session, its commit text and the saved state if hibernated
+  size_t session_bytes = 0;
+  // the engine and the schemas kept for switching
+  size_t engine_bytes = 0;
+  // input, composition and commit history
+  size_t context_bytes = 0;
+  // candidates in the menus of the composition
+  size_t menu_bytes = 0;
+
+  size_t total() const {
+    return session_bytes + engine_bytes + context_bytes + menu_bytes;
+  }
+};
+
+// A session is driven by one client thread at a time: its context must not
+// be read or changed by several threads at once. The service may hibernate
+// an idle session or release its schema pool from another thread; these are
+// serialized with key processing and schema switching by the lock of the
+// session.
 class Session {
  public:
   static const int kLifeSpan = 5 * 60;  // seconds
 
   Session();
+  ~Session();
   bool ProcessKey(const KeyEvent& key_event);
   void Activate();
   void ResetCommitText();
   bool CommitComposition();
   void ClearComposition();
   void ApplySchema(Schema* schema);
+  void ReleaseSchemaPool();
 
   Context* context() const;
   Schema* schema() const;
-  time_t last_active_time() const { return last_active_time_; }
+  time_t last_active_time() const { return last_active_time_.load(); }
   const string& commit_text() const { return commit_text_; }
+  SessionMemoryUsage EstimateMemoryUsage() const;
+
+  // Saves the schema, options, properties, input, selections and commit
+  // history of an idle session, and releases its engine.
+  bool Hibernate();
+  // Rebuilds the engine and restores the saved state.
+  bool Revive();
+  bool hibernated() const { return hibernated_.load(); }
+
+  // increases the versions of the parts of the state changed since the last
+  // call, as told by the stamps of the context, or since the last commit for
+  // the commit version
+  const SessionVersions& UpdateVersions();
 
  private:
+  void CreateEngine();
   void OnCommit(const string& commit_text);
 
+  // held while the engine is used or replaced; recursive since notifications
+  // sent while processing a key may call back into the session
+  std::recursive_mutex mutex_;
   the<Engine> engine_;
-  time_t last_active_time_ = 0;
+  // records slow keys, if enabled
+  the<FlightRecorder> flight_recorder_;
+  // touched by client threads, read by the thread cleaning up sessions
+  std::atomic<time_t> last_active_time_{0};
+  std::atomic<bool> hibernated_{false};
   string commit_text_;
+  // state of a hibernated session
+  string snapshot_;
+  SessionVersions versions_;
+  // the state last seen by UpdateVersions()
+  struct {
+    int composition_stamp = 0;
+    int highlight_stamp = 0;
+    int option_stamp = 0;
+    int page_no = -1;
+    bool composing = false;
+    bool disabled = false;
+    Schema* schema = nullptr;
+    string schema_id;
+  } seen_;
 };
 
 class ResourceResolver;
 struct ResourceType;
 
-class RIME_API Service {
+class RIME_API Service : public std::enable_shared_from_this<Service> {
  public:
   ~Service();
 
@@ -68,6 +139,14 @@ class RIME_API Service {
   bool DestroySession(SessionId session_id);
   void CleanupStaleSessions();
   void CleanupAllSessions();
+  // hibernates sessions idle for more than the hibernation threshold as of
+  // the given time
+  void HibernateIdleSessions(time_t now = time(NULL));
+  // releases components of schemas kept by sessions for switching
+  void ReleaseSchemaPools();
+  // estimates the heap usage of each session; returns the number of
+  // sessions
+  size_t GetSessionStats(map<SessionId, SessionMemoryUsage>* sessions) const;
 
   void SetNotificationHandler(const NotificationHandler& handler);
   void ClearNotificationHandler();
@@ -81,20 +160,109 @@ class RIME_API Service {
   ResourceResolver* CreateDeployedResourceResolver(const ResourceType& type);
   ResourceResolver* CreateStagingResourceResolver(const ResourceType& type);
 
+  // sessions idle for more than the given seconds are hibernated when
+  // cleaning up stale sessions. 0 disables hibernation.
+  void set_hibernation_threshold(int seconds) {
+    hibernation_threshold_ = seconds;
+  }
+  int hibernation_threshold() const { return hibernation_threshold_; }
+  // number of schemas each session keeps loaded for switching back to them
+  void set_schema_pool_size(int size) { schema_pool_size_ = size; }
+  int schema_pool_size() const { return schema_pool_size_; }
+  // keeps the last keys of each session, and dumps them to a file in dump_dir
+  // when a key takes longer than threshold_ms. 0 size disables recording.
+  void set_flight_recorder(int size,
+                           int threshold_ms,
+                           const string& dump_dir) {
+    flight_recorder_size_ = size;
+    slow_key_threshold_ = threshold_ms;
+    flight_recorder_dump_dir_ = dump_dir;
+  }
+  int flight_recorder_size() const { return flight_recorder_size_; }
+  int slow_key_threshold() const { return slow_key_threshold_; }
+  const string& flight_recorder_dump_dir() const {
+    return flight_recorder_dump_dir_;
+  }
+
   Deployer& deployer() { return deployer_; }
-  bool disabled() { return !started_ || deployer_.IsMaintenanceMode(); }
+  // sessions are still served during staged maintenance
+  bool disabled() {
+    return !started_ ||
+           (deployer_.IsMaintenanceMode() && !deployer_.IsStaged()) ||
+           (is_tenant() && shared_instance().disabled());
+  }
+  bool is_tenant() const { return is_tenant_; }
 
+  // the service of the tenant in scope in the calling thread, or else the
+  // process-wide service
   static Service& instance();
+  // the process-wide service, which deploys data shared by all tenants
+  static Service& shared_instance();
+
+  // A tenant is an isolated service with its own user data directory, user
+  // dictionaries, user config and sessions. Read-only data deployed by the
+  // process-wide service is shared among tenants.
+  static Service* CreateTenant(const string& user_data_dir);
+  // a tenant is kept alive by the references returned by FindTenant() and
+  // FindSessionOwner(); waits till the other references are released.
+  static bool DestroyTenant(an<Service> tenant);
+  // validates a tenant handle; returns nullptr if the tenant is unknown
+  static an<Service> FindTenant(uintptr_t tenant_id);
+  static void DestroyAllTenants();
+  // the tenant owning the session, or else the process-wide service
+  static an<Service> FindSessionOwner(SessionId session_id);
 
  private:
   Service();
 
   using SessionMap = map<SessionId, an<Session>>;
   SessionMap sessions_;
+  // guards sessions_ so that sessions can be created and destroyed from
+  // multiple threads
+  mutable std::mutex sessions_mutex_;
   Deployer deployer_;
   NotificationHandler notification_handler_;
   std::mutex mutex_;
   bool started_ = false;
+  bool is_tenant_ = false;
+  int hibernation_threshold_ = 0;
+  int schema_pool_size_ = 0;
+  int flight_recorder_size_ = 0;
+  int slow_key_threshold_ = 0;
+  string flight_recorder_dump_dir_;
+};
+
+// Makes the given service current in the calling thread while in scope.
+class RIME_API ServiceScope {
+ public:
+  // a null service leaves the current service unchanged
+  explicit ServiceScope(Service* service);
+  ~ServiceScope();
+
+  ServiceScope(const ServiceScope&) = delete;
+  ServiceScope& operator=(const ServiceScope&) = delete;
+
+ private:
+  Service* previous_;
+};
+
+// Finds a session of any tenant, and makes the service owning the session
+// current in the calling thread while in scope.
+class RIME_API SessionScope {
+ public:
+  explicit SessionScope(SessionId session_id)
+      : owner_(Service::FindSessionOwner(session_id)),
+        service_scope_(owner_.get()),
+        session_(Service::instance().GetSession(session_id)) {}
+
+  Session* operator->() const { return session_.get(); }
+  explicit operator bool() const { return bool(session_); }
+  const an<Session>& get() const { return session_; }
+
+ private:
+  an<Service> owner_;
+  ServiceScope service_scope_;
+  an<Session> session_;
 };
 
 }  // namespace rime
@@ -20,6 +20,7 @@
 #include <rime/module.h>
 #include <rime/service.h>
 #include <rime/setup.h>
+#include <rime/task_scheduler.h>
 
 namespace fs = std::filesystem;
 
@@ -71,6 +72,23 @@ RIME_API void SetupDeployer(RimeTraits* traits) {
   else
     deployer.staging_dir =
         (fs::path(deployer.user_data_dir) / "build").string();
+  if (RIME_STRUCT_HAS_MEMBER(*traits, traits->max_threads))
+    TaskScheduler::instance().set_max_threads(traits->max_threads);
+  if (RIME_STRUCT_HAS_MEMBER(*traits, traits->session_hibernation_threshold))
+    Service::instance().set_hibernation_threshold(
+        traits->session_hibernation_threshold);
+  if (RIME_STRUCT_HAS_MEMBER(*traits, traits->schema_pool_size))
+    Service::instance().set_schema_pool_size(traits->schema_pool_size);
+  if (RIME_STRUCT_HAS_MEMBER(*traits, traits->flight_recorder_size) &&
+      RIME_STRUCT_HAS_MEMBER(*traits, traits->slow_key_threshold)) {
+    std::error_code ec;
+    string dump_dir = PROVIDED(traits, log_dir) && traits->log_dir[0]
+                          ? string(traits->log_dir)
+                          : fs::temp_directory_path(ec).string();
+    Service::instance().set_flight_recorder(traits->flight_recorder_size,
+                                            traits->slow_key_threshold,
+                                            dump_dir);
+  }
 }
 
 RIME_API void SetupLogging(const char* app_name,
@@ -98,7 +98,7 @@ void Switcher::HighlightNextSchema() {
       option = seg.GetCandidateAt(index);
     }
   } while (!option || option->type() != "schema");
-  seg.selected_index = index;
+  context_->Highlight(index);
   seg.tags.insert("paging");
   return;
 }
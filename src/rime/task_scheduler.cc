@@ -0,0 +1,236 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <rime/task_scheduler.h>
+
+namespace rime {
+
+// identifies the worker thread that is running the current task
+static thread_local TaskScheduler* tls_scheduler = nullptr;
+static thread_local int tls_worker_index = -1;
+
+TaskScheduler::TaskScheduler() {
+  set_max_threads(0);
+}
+
+TaskScheduler::~TaskScheduler() {
+  Stop();
+}
+
+bool TaskScheduler::set_max_threads(int max_threads) {
+  // the environment overrides what the host application configures
+  if (const char* env = std::getenv("RIME_MAX_THREADS")) {
+    max_threads = std::atoi(env);
+  }
+  if (max_threads <= 0) {
+    max_threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+#ifdef RIME_NO_THREADING
+  max_threads = 1;
+#endif
+  max_threads = (std::max)(max_threads, 1);
+  std::lock_guard<std::mutex> lock(resize_mutex_);
+  if (max_threads == max_threads_)
+    return true;
+  if (num_outstanding_ > 0) {
+    LOG(WARNING) << "cannot change the thread budget while tasks are running.";
+    return false;
+  }
+  Stop();
+  max_threads_ = max_threads;
+  LOG(INFO) << "task scheduler thread budget: " << max_threads_;
+  return true;
+}
+
+void TaskScheduler::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_)
+    return;
+  int num_workers = max_threads_ - 1;
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(new Worker);
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    threads_.emplace_back(&TaskScheduler::WorkerLoop, this, i);
+  }
+  started_ = true;
+}
+
+void TaskScheduler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_)
+      return;
+    stopping_ = true;
+  }
+  wake_up_.notify_all();
+  // workers drain their queues before quitting
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  workers_.clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = false;
+  started_ = false;
+}
+
+void TaskScheduler::Enqueue(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(resize_mutex_);
+    Start();
+    ++num_outstanding_;
+  }
+  int target = (tls_scheduler == this)
+                   ? tls_worker_index
+                   : static_cast<int>(next_victim_++ % workers_.size());
+  {
+    auto& worker = *workers_[target];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+    ++num_pending_;
+  }
+  {
+    // synchronize with workers about to sleep
+    std::lock_guard<std::mutex> lock(mutex_);
+  }
+  wake_up_.notify_one();
+}
+
+bool TaskScheduler::TryRunOne() {
+  Task task;
+  int self = (tls_scheduler == this) ? tls_worker_index : -1;
+  if (self >= 0) {
+    auto& worker = *workers_[self];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.tasks.empty()) {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+      --num_pending_;
+    }
+  }
+  size_t num_workers = workers_.size();
+  size_t start = self >= 0 ? self + 1 : next_victim_.load();
+  for (size_t i = 0; !task && i < num_workers; ++i) {
+    auto& victim = *workers_[(start + i) % num_workers];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --num_pending_;
+    }
+  }
+  if (!task)
+    return false;
+  task();
+  --num_outstanding_;
+  return true;
+}
+
+void TaskScheduler::WorkerLoop(int index) {
+  tls_scheduler = this;
+  tls_worker_index = index;
+  while (true) {
+    if (TryRunOne())
+      continue;
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_up_.wait(lock, [this] { return stopping_ || num_pending_ > 0; });
+    if (stopping_ && num_pending_ == 0)
+      break;
+  }
+  tls_scheduler = nullptr;
+  tls_worker_index = -1;
+}
+
+std::future<void> TaskScheduler::Async(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(resize_mutex_);
+    ++num_outstanding_;
+  }
+  return std::async(std::launch::async, [this, task = std::move(task)] {
+    // counted off before the future is ready, even if the job throws
+    struct Finish {
+      std::atomic<size_t>& count;
+      ~Finish() { --count; }
+    } finish{num_outstanding_};
+    task();
+  });
+}
+
+TaskScheduler& TaskScheduler::instance() {
+  static the<TaskScheduler> s_instance;
+  if (!s_instance) {
+    s_instance.reset(new TaskScheduler);
+  }
+  return *s_instance;
+}
+
+TaskGroup::~TaskGroup() {
+  try {
+    Wait();
+  } catch (...) {
+  }
+}
+
+void TaskGroup::Run(TaskScheduler::Task task) {
+  if (scheduler_.serial()) {
+    try {
+      task();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_)
+        error_ = std::current_exception();
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_running_;
+  }
+  scheduler_.Enqueue([this, task = std::move(task)] {
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    Finish(error);
+  });
+}
+
+void TaskGroup::Finish(std::exception_ptr error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error && !error_)
+    error_ = error;
+  if (--num_running_ == 0)
+    done_.notify_all();
+}
+
+void TaskGroup::Wait() {
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (num_running_ == 0)
+        break;
+    }
+    // rather than blocking, lend this thread to the pool
+    if (scheduler_.TryRunOne())
+      continue;
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait_for(lock, std::chrono::milliseconds(1),
+                   [this] { return num_running_ == 0; });
+  }
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error.swap(error_);
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+}  // namespace rime
@@ -0,0 +1,128 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+
+#ifndef RIME_TASK_SCHEDULER_H_
+#define RIME_TASK_SCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <rime_api.h>
+#include <rime/common.h>
+
+namespace rime {
+
+// A work-stealing thread pool shared by all parallel work in the library.
+//
+// The thread budget counts the thread that waits for a task group, so a
+// budget of N starts N - 1 worker threads. With a budget of 1 no worker is
+// started and every task runs in the calling thread, in submission order.
+class TaskScheduler {
+ public:
+  using Task = function<void()>;
+
+  RIME_API ~TaskScheduler();
+
+  // 0 selects the number of hardware threads.
+  // Fails, keeping the current budget, while tasks or jobs are outstanding.
+  RIME_API bool set_max_threads(int max_threads);
+  int max_threads() const { return max_threads_; }
+  bool serial() const { return max_threads_ <= 1; }
+
+  // Runs a long-lived job on a thread of its own, outside the budget, so
+  // that it never occupies a worker nor a thread waiting for a task group.
+  RIME_API std::future<void> Async(Task task);
+
+  RIME_API static TaskScheduler& instance();
+
+ private:
+  friend class TaskGroup;
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  TaskScheduler();
+
+  void Start();
+  void Stop();
+  void Enqueue(Task task);
+  // pops from the local queue, or steals from other workers
+  bool TryRunOne();
+  void WorkerLoop(int index);
+
+  std::atomic<int> max_threads_{1};
+  // held while the workers are started or stopped
+  std::mutex resize_mutex_;
+  // tasks enqueued and not yet finished, plus running jobs
+  std::atomic<size_t> num_outstanding_{0};
+  vector<the<Worker>> workers_;
+  vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_up_;
+  std::atomic<size_t> num_pending_{0};
+  std::atomic<size_t> next_victim_{0};
+  bool started_ = false;
+  bool stopping_ = false;
+};
+
+// Tracks a set of tasks and waits for all of them to finish.
+// A thread waiting on the group helps run pending tasks, so groups can nest.
+class TaskGroup {
+ public:
+  explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance())
+      : scheduler_(scheduler) {}
+  RIME_API ~TaskGroup();
+
+  RIME_API void Run(TaskScheduler::Task task);
+  // Rethrows the first exception thrown by a task.
+  RIME_API void Wait();
+
+ private:
+  void Finish(std::exception_ptr error);
+
+  TaskScheduler& scheduler_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  size_t num_running_ = 0;
+  std::exception_ptr error_;
+};
+
+// Calls body(begin, end) on consecutive sub-ranges of [0, size), at most
+// grain_size items each. The ranges are processed in index order if the
+// scheduler is serial.
+template <class Body>
+void ParallelFor(size_t size,
+                 Body body,
+                 size_t grain_size = 0,
+                 TaskScheduler& scheduler = TaskScheduler::instance()) {
+  if (size == 0)
+    return;
+  if (scheduler.serial()) {
+    body(size_t(0), size);
+    return;
+  }
+  if (grain_size == 0) {
+    // a few chunks per thread to balance uneven work
+    size_t num_chunks = size_t(scheduler.max_threads()) * 4;
+    grain_size = (size + num_chunks - 1) / num_chunks;
+  }
+  TaskGroup group(scheduler);
+  for (size_t begin = 0; begin < size; begin += grain_size) {
+    size_t end = (std::min)(begin + grain_size, size);
+    group.Run([&body, begin, end] { body(begin, end); });
+  }
+  group.Wait();
+}
+
+}  // namespace rime
+
+#endif  // RIME_TASK_SCHEDULER_H_
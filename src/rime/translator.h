@@ -28,6 +28,10 @@ class Translator : public Class<Translator, const Ticket&> {
   virtual an<Translation> Query(const string& input,
                                 const Segment& segment) = 0;
 
+  // called when the engine sets the component aside and puts it back to use.
+  virtual void Suspend() {}
+  virtual void Resume() {}
+
   string name_space() const { return name_space_; }
 
  protected:
@@ -12,6 +12,7 @@
 #include <rime/context.h>
 #include <rime/deployer.h>
 #include <rime/key_event.h>
+#include <rime/memory_stats.h>
 #include <rime/menu.h>
 #include <rime/module.h>
 #include <rime/registry.h>
@@ -108,7 +109,7 @@ RIME_API Bool RimeStartMaintenance(Bool full_check) {
   deployer.ScheduleTask("workspace_update");
   deployer.ScheduleTask("user_dict_upgrade");
   deployer.ScheduleTask("cleanup_trash");
-  deployer.StartMaintenance();
+  deployer.StartStagedMaintenance();
   return True;
 }
 
@@ -135,11 +136,17 @@ RIME_API void RimeDeployerInitialize(RimeTraits* traits) {
 
 RIME_API Bool RimePrebuildAllSchemas() {
   Deployer& deployer(Service::instance().deployer());
+  DeploymentLock lock(&deployer);
+  if (!lock.Acquire())
+    return False;
   return Bool(deployer.RunTask("prebuild_all_schemas"));
 }
 
 RIME_API Bool RimeDeployWorkspace() {
   Deployer& deployer(Service::instance().deployer());
+  DeploymentLock lock(&deployer);
+  if (!lock.Acquire())
+    return False;
   return Bool(deployer.RunTask("installation_update") &&
               deployer.RunTask("workspace_update") &&
               deployer.RunTask("user_dict_upgrade") &&
@@ -148,12 +155,18 @@ RIME_API Bool RimeDeployWorkspace() {
 
 RIME_API Bool RimeDeploySchema(const char* schema_file) {
   Deployer& deployer(Service::instance().deployer());
+  DeploymentLock lock(&deployer);
+  if (!lock.Acquire())
+    return False;
   return Bool(deployer.RunTask("schema_update", string(schema_file)));
 }
 
 RIME_API Bool RimeDeployConfigFile(const char* file_name,
                                    const char* version_key) {
   Deployer& deployer(Service::instance().deployer());
+  DeploymentLock lock(&deployer);
+  if (!lock.Acquire())
+    return False;
   TaskInitializer args(make_pair<string, string>(file_name, version_key));
   return Bool(deployer.RunTask("config_file_update", args));
 }
@@ -174,11 +187,13 @@ RIME_API RimeSessionId RimeCreateSession() {
 }
 
 RIME_API Bool RimeFindSession(RimeSessionId session_id) {
-  return Bool(session_id && Service::instance().GetSession(session_id));
+  return Bool(session_id && SessionScope(session_id));
 }
 
 RIME_API Bool RimeDestroySession(RimeSessionId session_id) {
-  return Bool(Service::instance().DestroySession(session_id));
+  auto owner = Service::FindSessionOwner(session_id);
+  ServiceScope scope(owner.get());
+  return Bool(owner->DestroySession(session_id));
 }
 
 RIME_API void RimeCleanupStaleSessions() {
@@ -189,24 +204,49 @@ RIME_API void RimeCleanupAllSessions() {
   Service::instance().CleanupAllSessions();
 }
 
+RIME_API void RimeTrimMemory() {
+  Service::instance().ReleaseSchemaPools();
+}
+
+// tenants
+
+RIME_API RimeTenantId RimeCreateTenant(RimeTraits* traits) {
+  if (!PROVIDED(traits, user_data_dir))
+    return 0;
+  return reinterpret_cast<RimeTenantId>(
+      Service::CreateTenant(traits->user_data_dir));
+}
+
+RIME_API Bool RimeDestroyTenant(RimeTenantId tenant_id) {
+  return Bool(Service::DestroyTenant(Service::FindTenant(tenant_id)));
+}
+
+RIME_API RimeSessionId RimeCreateTenantSession(RimeTenantId tenant_id) {
+  auto tenant = Service::FindTenant(tenant_id);
+  if (!tenant)
+    return kInvalidSessionId;
+  ServiceScope scope(tenant.get());
+  return tenant->CreateSession();
+}
+
 // input
 
 RIME_API Bool RimeProcessKey(RimeSessionId session_id, int keycode, int mask) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   return Bool(session->ProcessKey(KeyEvent(keycode, mask)));
 }
 
 RIME_API Bool RimeCommitComposition(RimeSessionId session_id) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   return Bool(session->CommitComposition());
 }
 
 RIME_API void RimeClearComposition(RimeSessionId session_id) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return;
   session->ClearComposition();
@@ -227,73 +267,82 @@ static void rime_candidate_copy(RimeCandidate* dest, const an<Candidate>& src) {
   dest->reserved = nullptr;
 }
 
+static void FillComposition(Context* ctx, RimeContext* context) {
+  Preedit preedit = ctx->GetPreedit();
+  context->composition.length = preedit.text.length();
+  context->composition.preedit = new char[preedit.text.length() + 1];
+  std::strcpy(context->composition.preedit, preedit.text.c_str());
+  context->composition.cursor_pos = preedit.caret_pos;
+  context->composition.sel_start = preedit.sel_start;
+  context->composition.sel_end = preedit.sel_end;
+  if (RIME_STRUCT_HAS_MEMBER(*context, context->commit_text_preview)) {
+    string commit_text(ctx->GetCommitText());
+    if (!commit_text.empty()) {
+      context->commit_text_preview = new char[commit_text.length() + 1];
+      std::strcpy(context->commit_text_preview, commit_text.c_str());
+    }
+  }
+}
+
+static int GetPageSize(Schema* schema) {
+  return schema ? schema->page_size() : 5;
+}
+
+static void FillMenu(Schema* schema, Context* ctx, RimeContext* context) {
+  Segment& seg(ctx->composition().back());
+  int page_size = GetPageSize(schema);
+  int selected_index = seg.selected_index;
+  int page_no = selected_index / page_size;
+  the<Page> page(seg.menu->CreatePage(page_size, page_no));
+  if (!page)
+    return;
+  context->menu.page_size = page_size;
+  context->menu.page_no = page_no;
+  context->menu.is_last_page = Bool(page->is_last_page);
+  context->menu.highlighted_candidate_index = selected_index % page_size;
+  int i = 0;
+  context->menu.num_candidates = page->candidates.size();
+  context->menu.candidates = new RimeCandidate[page->candidates.size()];
+  for (const an<Candidate>& cand : page->candidates) {
+    RimeCandidate* dest = &context->menu.candidates[i++];
+    rime_candidate_copy(dest, cand);
+  }
+  if (schema) {
+    const string& select_keys(schema->select_keys());
+    if (!select_keys.empty()) {
+      context->menu.select_keys = new char[select_keys.length() + 1];
+      std::strcpy(context->menu.select_keys, select_keys.c_str());
+    }
+    Config* config = schema->config();
+    an<ConfigList> select_labels =
+        config->GetList("menu/alternative_select_labels");
+    if (select_labels && (size_t)page_size <= select_labels->size()) {
+      context->select_labels = new char*[page_size];
+      for (size_t i = 0; i < (size_t)page_size; ++i) {
+        an<ConfigValue> value = select_labels->GetValueAt(i);
+        string label = value->str();
+        context->select_labels[i] = new char[label.length() + 1];
+        std::strcpy(context->select_labels[i], label.c_str());
+      }
+    }
+  }
+}
+
 RIME_API Bool RimeGetContext(RimeSessionId session_id, RimeContext* context) {
   if (!context || context->data_size <= 0)
     return False;
   RIME_STRUCT_CLEAR(*context);
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
   if (!ctx)
     return False;
   if (ctx->IsComposing()) {
-    Preedit preedit = ctx->GetPreedit();
-    context->composition.length = preedit.text.length();
-    context->composition.preedit = new char[preedit.text.length() + 1];
-    std::strcpy(context->composition.preedit, preedit.text.c_str());
-    context->composition.cursor_pos = preedit.caret_pos;
-    context->composition.sel_start = preedit.sel_start;
-    context->composition.sel_end = preedit.sel_end;
-    if (RIME_STRUCT_HAS_MEMBER(*context, context->commit_text_preview)) {
-      string commit_text(ctx->GetCommitText());
-      if (!commit_text.empty()) {
-        context->commit_text_preview = new char[commit_text.length() + 1];
-        std::strcpy(context->commit_text_preview, commit_text.c_str());
-      }
-    }
+    FillComposition(ctx, context);
   }
   if (ctx->HasMenu()) {
-    Segment& seg(ctx->composition().back());
-    int page_size = 5;
-    Schema* schema = session->schema();
-    if (schema)
-      page_size = schema->page_size();
-    int selected_index = seg.selected_index;
-    int page_no = selected_index / page_size;
-    the<Page> page(seg.menu->CreatePage(page_size, page_no));
-    if (page) {
-      context->menu.page_size = page_size;
-      context->menu.page_no = page_no;
-      context->menu.is_last_page = Bool(page->is_last_page);
-      context->menu.highlighted_candidate_index = selected_index % page_size;
-      int i = 0;
-      context->menu.num_candidates = page->candidates.size();
-      context->menu.candidates = new RimeCandidate[page->candidates.size()];
-      for (const an<Candidate>& cand : page->candidates) {
-        RimeCandidate* dest = &context->menu.candidates[i++];
-        rime_candidate_copy(dest, cand);
-      }
-      if (schema) {
-        const string& select_keys(schema->select_keys());
-        if (!select_keys.empty()) {
-          context->menu.select_keys = new char[select_keys.length() + 1];
-          std::strcpy(context->menu.select_keys, select_keys.c_str());
-        }
-        Config* config = schema->config();
-        an<ConfigList> select_labels =
-            config->GetList("menu/alternative_select_labels");
-        if (select_labels && (size_t)page_size <= select_labels->size()) {
-          context->select_labels = new char*[page_size];
-          for (size_t i = 0; i < (size_t)page_size; ++i) {
-            an<ConfigValue> value = select_labels->GetValueAt(i);
-            string label = value->str();
-            context->select_labels[i] = new char[label.length() + 1];
-            std::strcpy(context->select_labels[i], label.c_str());
-          }
-        }
-      }
-    }
+    FillMenu(session->schema(), ctx, context);
   }
   return True;
 }
@@ -326,7 +375,7 @@ RIME_API Bool RimeGetCommit(RimeSessionId session_id, RimeCommit* commit) {
   if (!commit)
     return False;
   RIME_STRUCT_CLEAR(*commit);
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   const string& commit_text(session->commit_text());
@@ -347,17 +396,7 @@ RIME_API Bool RimeFreeCommit(RimeCommit* commit) {
   return True;
 }
 
-RIME_API Bool RimeGetStatus(RimeSessionId session_id, RimeStatus* status) {
-  if (!status || status->data_size <= 0)
-    return False;
-  RIME_STRUCT_CLEAR(*status);
-  an<Session> session(Service::instance().GetSession(session_id));
-  if (!session)
-    return False;
-  Schema* schema = session->schema();
-  Context* ctx = session->context();
-  if (!schema || !ctx)
-    return False;
+static void FillStatus(Schema* schema, Context* ctx, RimeStatus* status) {
   status->schema_id = new char[schema->schema_id().length() + 1];
   std::strcpy(status->schema_id, schema->schema_id().c_str());
   status->schema_name = new char[schema->schema_name().length() + 1];
@@ -369,6 +408,20 @@ RIME_API Bool RimeGetStatus(RimeSessionId session_id, RimeStatus* status) {
   status->is_simplified = Bool(ctx->get_option("simplification"));
   status->is_traditional = Bool(ctx->get_option("traditional"));
   status->is_ascii_punct = Bool(ctx->get_option("ascii_punct"));
+}
+
+RIME_API Bool RimeGetStatus(RimeSessionId session_id, RimeStatus* status) {
+  if (!status || status->data_size <= 0)
+    return False;
+  RIME_STRUCT_CLEAR(*status);
+  SessionScope session(session_id);
+  if (!session)
+    return False;
+  Schema* schema = session->schema();
+  Context* ctx = session->context();
+  if (!schema || !ctx)
+    return False;
+  FillStatus(schema, ctx, status);
   return True;
 }
 
@@ -381,6 +434,108 @@ RIME_API Bool RimeFreeStatus(RimeStatus* status) {
   return True;
 }
 
+// tells whether a part changed since the version seen by the client, and
+// updates it; a part unknown to an older client always counts as changed
+static bool UpdateVersion(RimeContextVersions* versions,
+                          int* seen,
+                          int current) {
+  if (!RIME_STRUCT_HAS_MEMBER(*versions, *seen))
+    return true;
+  if (*seen == current)
+    return false;
+  *seen = current;
+  return true;
+}
+
+RIME_API Bool RimeGetContextDelta(RimeSessionId session_id,
+                                  RimeContextVersions* versions,
+                                  RimeContextDelta* delta) {
+  if (!versions || versions->data_size <= 0 || !delta ||
+      delta->data_size <= 0 ||
+      !RIME_STRUCT_HAS_MEMBER(*delta, delta->commit))
+    return False;
+  RIME_STRUCT_CLEAR(*delta);
+  SessionScope session(session_id);
+  if (!session)
+    return False;
+  Schema* schema = session->schema();
+  Context* ctx = session->context();
+  if (!schema || !ctx)
+    return False;
+  const SessionVersions& current = session->UpdateVersions();
+  bool composition_changed =
+      UpdateVersion(versions, &versions->composition, current.composition);
+  bool menu_changed = UpdateVersion(versions, &versions->menu, current.menu);
+  bool highlight_changed =
+      UpdateVersion(versions, &versions->highlight, current.highlight);
+  bool status_changed =
+      UpdateVersion(versions, &versions->status, current.status);
+  bool commit_changed =
+      UpdateVersion(versions, &versions->commit, current.commit);
+  if (composition_changed || menu_changed || highlight_changed) {
+    delta->context = new RimeContext();
+    RIME_STRUCT_INIT(RimeContext, *delta->context);
+  }
+  if (composition_changed) {
+    delta->composition_changed = True;
+    if (ctx->IsComposing())
+      FillComposition(ctx, delta->context);
+  }
+  if (menu_changed) {
+    delta->menu_changed = True;
+    if (ctx->HasMenu())
+      FillMenu(schema, ctx, delta->context);
+  } else if (highlight_changed) {
+    // same page; only tell where the highlight is
+    delta->highlight_changed = True;
+    if (ctx->HasMenu()) {
+      int page_size = GetPageSize(schema);
+      int selected_index = ctx->composition().back().selected_index;
+      delta->context->menu.page_size = page_size;
+      delta->context->menu.page_no = selected_index / page_size;
+      delta->context->menu.highlighted_candidate_index =
+          selected_index % page_size;
+    }
+  }
+  if (status_changed) {
+    delta->status_changed = True;
+    delta->status = new RimeStatus();
+    RIME_STRUCT_INIT(RimeStatus, *delta->status);
+    FillStatus(schema, ctx, delta->status);
+  }
+  // pending commit text is taken as by RimeGetCommit(); it may have been
+  // read by RimeGetCommit() since the last commit
+  const string& commit_text(session->commit_text());
+  if (commit_changed && !commit_text.empty()) {
+    delta->commit_changed = True;
+    delta->commit = new RimeCommit();
+    RIME_STRUCT_INIT(RimeCommit, *delta->commit);
+    delta->commit->text = new char[commit_text.length() + 1];
+    std::strcpy(delta->commit->text, commit_text.c_str());
+    session->ResetCommitText();
+  }
+  return True;
+}
+
+RIME_API Bool RimeFreeContextDelta(RimeContextDelta* delta) {
+  if (!delta || delta->data_size <= 0)
+    return False;
+  if (delta->context) {
+    RimeFreeContext(delta->context);
+    delete delta->context;
+  }
+  if (delta->status) {
+    RimeFreeStatus(delta->status);
+    delete delta->status;
+  }
+  if (delta->commit) {
+    RimeFreeCommit(delta->commit);
+    delete delta->commit;
+  }
+  RIME_STRUCT_CLEAR(*delta);
+  return True;
+}
+
 // Accessing candidate list
 
 RIME_API Bool RimeCandidateListFromIndex(RimeSessionId session_id,
@@ -388,7 +543,7 @@ RIME_API Bool RimeCandidateListFromIndex(RimeSessionId session_id,
                                          int index) {
   if (!iterator)
     return False;
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
@@ -434,7 +589,7 @@ RIME_API void RimeCandidateListEnd(RimeCandidateListIterator* iterator) {
 RIME_API void RimeSetOption(RimeSessionId session_id,
                             const char* option,
                             Bool value) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return;
   Context* ctx = session->context();
@@ -444,7 +599,7 @@ RIME_API void RimeSetOption(RimeSessionId session_id,
 }
 
 RIME_API Bool RimeGetOption(RimeSessionId session_id, const char* option) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
@@ -456,7 +611,7 @@ RIME_API Bool RimeGetOption(RimeSessionId session_id, const char* option) {
 RIME_API void RimeSetProperty(RimeSessionId session_id,
                               const char* prop,
                               const char* value) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return;
   Context* ctx = session->context();
@@ -469,7 +624,7 @@ RIME_API Bool RimeGetProperty(RimeSessionId session_id,
                               const char* prop,
                               char* value,
                               size_t buffer_size) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
@@ -537,7 +692,7 @@ RIME_API void RimeFreeSchemaList(RimeSchemaList* schema_list) {
 RIME_API Bool RimeGetCurrentSchema(RimeSessionId session_id,
                                    char* schema_id,
                                    size_t buffer_size) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Schema* schema = session->schema();
@@ -551,7 +706,7 @@ RIME_API Bool RimeSelectSchema(RimeSessionId session_id,
                                const char* schema_id) {
   if (!schema_id)
     return False;
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   session->ApplySchema(new Schema(schema_id));
@@ -776,7 +931,7 @@ RIME_API void RimeConfigEnd(RimeConfigIterator* iterator) {
 RIME_API Bool RimeSimulateKeySequence(RimeSessionId session_id,
                                       const char* key_sequence) {
   LOG(INFO) << "simulate key sequence: " << key_sequence;
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   KeySequence keys;
@@ -977,7 +1132,7 @@ RIME_API size_t RimeConfigListSize(RimeConfig* config, const char* key) {
 }
 
 const char* RimeGetInput(RimeSessionId session_id) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return NULL;
   Context* ctx = session->context();
@@ -987,7 +1142,7 @@ const char* RimeGetInput(RimeSessionId session_id) {
 }
 
 size_t RimeGetCaretPos(RimeSessionId session_id) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return 0;
   Context* ctx = session->context();
@@ -999,7 +1154,7 @@ size_t RimeGetCaretPos(RimeSessionId session_id) {
 static bool do_with_candidate(RimeSessionId session_id,
                               size_t index,
                               bool (Context::*verb)(size_t index)) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
@@ -1012,7 +1167,7 @@ static bool do_with_candidate_on_current_page(
     RimeSessionId session_id,
     size_t index,
     bool (Context::*verb)(size_t index)) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
@@ -1053,7 +1208,7 @@ RIME_API Bool RimeDeleteCandidateOnCurrentPage(RimeSessionId session_id,
 }
 
 void RimeSetCaretPos(RimeSessionId session_id, size_t caret_pos) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return;
   Context* ctx = session->context();
@@ -1066,7 +1221,7 @@ RimeStringSlice RimeGetStateLabelAbbreviated(RimeSessionId session_id,
                                              const char* option_name,
                                              Bool state,
                                              Bool abbreviated) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return {nullptr, 0};
   Config* config = session->schema()->config();
@@ -1085,7 +1240,7 @@ const char* RimeGetStateLabel(RimeSessionId session_id,
 }
 
 RIME_API Bool RimeSetInput(RimeSessionId session_id, const char* input) {
-  an<Session> session(Service::instance().GetSession(session_id));
+  SessionScope session(session_id);
   if (!session)
     return False;
   Context* ctx = session->context();
@@ -1095,6 +1250,56 @@ RIME_API Bool RimeSetInput(RimeSessionId session_id, const char* input) {
   return True;
 }
 
+// sets the member if the struct of the client has it
+#define SET_PROVIDED(p, member, value)          \
+  if (RIME_STRUCT_HAS_MEMBER(*(p), (p)->member)) \
+  (p)->member = (value)
+
+RIME_API Bool RimeGetMemoryStats(RimeMemoryStats* stats) {
+  if (!stats || stats->data_size <= 0)
+    return False;
+  MemoryStats s = CollectMemoryStats();
+  RIME_STRUCT_CLEAR(*stats);
+  SET_PROVIDED(stats, num_mapped_files, static_cast<int>(s.num_mapped_files));
+  SET_PROVIDED(stats, num_tables, static_cast<int>(s.num_tables));
+  SET_PROVIDED(stats, num_prisms, static_cast<int>(s.num_prisms));
+  SET_PROVIDED(stats, num_reverse_dbs, static_cast<int>(s.num_reverse_dbs));
+  SET_PROVIDED(stats, mapped_bytes, s.mapped_bytes);
+  SET_PROVIDED(stats, resident_bytes, s.resident_bytes);
+  SET_PROVIDED(stats, num_dbs, static_cast<int>(s.num_dbs));
+  SET_PROVIDED(stats, db_bytes, s.db_bytes);
+  SET_PROVIDED(stats, num_sessions, static_cast<int>(s.num_sessions));
+  SET_PROVIDED(stats, session_bytes, s.session_bytes);
+  SET_PROVIDED(stats, num_configs, static_cast<int>(s.num_configs));
+  SET_PROVIDED(stats, config_bytes, s.config_bytes);
+  SET_PROVIDED(stats, engine_bytes, s.engine_bytes);
+  SET_PROVIDED(stats, context_bytes, s.context_bytes);
+  SET_PROVIDED(stats, menu_bytes, s.menu_bytes);
+  SET_PROVIDED(stats, num_cached_dict_files,
+               static_cast<int>(s.num_cached_dict_files));
+  SET_PROVIDED(stats, cached_dict_bytes, s.cached_dict_bytes);
+  SET_PROVIDED(stats, num_cached_user_dbs,
+               static_cast<int>(s.num_cached_user_dbs));
+  SET_PROVIDED(stats, cached_user_db_bytes, s.cached_user_db_bytes);
+  return True;
+}
+
+RIME_API Bool RimeGetSessionMemoryStats(RimeSessionId session_id,
+                                        RimeSessionMemoryStats* stats) {
+  if (!stats || stats->data_size <= 0)
+    return False;
+  RIME_STRUCT_CLEAR(*stats);
+  SessionScope session(session_id);
+  if (!session)
+    return False;
+  SessionMemoryUsage usage = session->EstimateMemoryUsage();
+  SET_PROVIDED(stats, session_bytes, usage.session_bytes);
+  SET_PROVIDED(stats, engine_bytes, usage.engine_bytes);
+  SET_PROVIDED(stats, context_bytes, usage.context_bytes);
+  SET_PROVIDED(stats, menu_bytes, usage.menu_bytes);
+  return True;
+}
+
 RIME_API RimeApi* rime_get_api() {
   static RimeApi s_api = {0};
   if (!s_api.data_size) {
@@ -1189,6 +1394,14 @@ RIME_API RimeApi* rime_get_api() {
     s_api.delete_candidate_on_current_page = &RimeDeleteCandidateOnCurrentPage;
     s_api.get_state_label_abbreviated = &RimeGetStateLabelAbbreviated;
     s_api.set_input = &RimeSetInput;
+    s_api.get_memory_stats = &RimeGetMemoryStats;
+    s_api.trim_memory = &RimeTrimMemory;
+    s_api.create_tenant = &RimeCreateTenant;
+    s_api.destroy_tenant = &RimeDestroyTenant;
+    s_api.create_tenant_session = &RimeCreateTenantSession;
+    s_api.get_context_delta = &RimeGetContextDelta;
+    s_api.free_context_delta = &RimeFreeContextDelta;
+    s_api.get_session_memory_stats = &RimeGetSessionMemoryStats;
   }
   return &s_api;
 }
@@ -31,6 +31,7 @@ extern "C" {
 #endif /* _WIN32 */
 
 typedef uintptr_t RimeSessionId;
+typedef uintptr_t RimeTenantId;
 
 typedef int Bool;
 
@@ -101,6 +102,28 @@ typedef struct rime_traits_t {
   const char* prebuilt_data_dir;
   //! staging directory. defaults to ${user_data_dir}/build
   const char* staging_dir;
+  // v1.10
+  /*! Maximal number of threads for parallel work, including the calling
+   *  thread. 0 = number of hardware threads (default), 1 = run serially.
+   *  Overridden by the environment variable RIME_MAX_THREADS.
+   */
+  int max_threads;
+  /*! Seconds of inactivity after which a session is hibernated by
+   *  RimeCleanupStaleSessions(). A hibernated session releases its engine,
+   *  and is restored on next access. 0 = never hibernate (default).
+   */
+  int session_hibernation_threshold;
+  /*! Number of schemas recently switched away from, whose components a
+   *  session keeps loaded to switch back to them quickly. 0 = none (default).
+   */
+  int schema_pool_size;
+  /*! Number of recent keys each session records, to dump them to a file in
+   *  log_dir (or the temp dir) when a key takes more than
+   *  slow_key_threshold milliseconds. 0 = off (default).
+   *  Dumps are replayed by the rime_replay tool.
+   */
+  int flight_recorder_size;
+  int slow_key_threshold;
 } RimeTraits;
 
 typedef struct {
@@ -166,6 +189,47 @@ typedef struct rime_status_t {
   Bool is_ascii_punct;
 } RimeStatus;
 
+/*!
+ *  Versions of the parts of the session state. Each increases when the
+ *  part changes; zeros stand for a client that has seen nothing yet.
+ *  Should be initialized by calling RIME_STRUCT_INIT(Type, var);
+ */
+typedef struct rime_context_versions_t {
+  int data_size;
+  int composition;
+  int menu;
+  int highlight;
+  int status;
+  int commit;
+} RimeContextVersions;
+
+/*!
+ *  The parts of the session state changed since given versions.
+ *  Should be initialized by calling RIME_STRUCT_INIT(Type, var);
+ *  The parts are allocated by librime, each initialized with its own
+ *  data_size, and released by RimeFreeContextDelta().
+ */
+typedef struct rime_context_delta_t {
+  int data_size;
+  //! context->composition is set
+  Bool composition_changed;
+  //! context->menu is set with the current page
+  Bool menu_changed;
+  //! the page is unchanged, and only the highlight moved; context->menu has
+  //! page_size, page_no and highlighted_candidate_index but no candidates
+  Bool highlight_changed;
+  //! status is set
+  Bool status_changed;
+  //! commit is set with the unread commit text
+  Bool commit_changed;
+  //! set if any of the composition, menu or highlight changed
+  RimeContext* context;
+  //! set if status_changed
+  RimeStatus* status;
+  //! set if commit_changed
+  RimeCommit* commit;
+} RimeContextDelta;
+
 typedef struct rime_candidate_list_iterator_t {
   void* ptr;
   int index;
@@ -205,6 +269,60 @@ typedef struct rime_string_slice_t {
   size_t length;
 } RimeStringSlice;
 
+/*!
+ *  Memory held by the library. Sizes of in-memory data are estimates.
+ *  Should be initialized by calling RIME_STRUCT_INIT(Type, var);
+ */
+typedef struct rime_memory_stats_t {
+  int data_size;
+  // v1.10
+  //! files mapped into memory, eg. tables, prisms and reverse lookup dbs
+  int num_mapped_files;
+  int num_tables;
+  int num_prisms;
+  int num_reverse_dbs;
+  size_t mapped_bytes;
+  //! bytes of mapped files in physical memory. not available on Windows.
+  size_t resident_bytes;
+  //! opened dbs, including user dictionaries
+  int num_dbs;
+  size_t db_bytes;
+  //! sessions, excluding the schema and dictionaries they share
+  int num_sessions;
+  size_t session_bytes;
+  //! config data in use
+  int num_configs;
+  size_t config_bytes;
+  //! parts of session_bytes: engines with the schemas kept for switching,
+  //! input contexts, and candidates
+  size_t engine_bytes;
+  size_t context_bytes;
+  size_t menu_bytes;
+  //! tables and prisms cached by dictionaries; among the mapped files
+  int num_cached_dict_files;
+  size_t cached_dict_bytes;
+  //! user dbs cached by user dictionaries; among the dbs
+  int num_cached_user_dbs;
+  size_t cached_user_db_bytes;
+} RimeMemoryStats;
+
+/*!
+ *  Memory held by a session, excluding the schema and dictionaries it
+ *  shares with other sessions. Sizes are estimates.
+ *  Should be initialized by calling RIME_STRUCT_INIT(Type, var);
+ */
+typedef struct rime_session_memory_stats_t {
+  int data_size;
+  //! the session itself, its commit text and the saved state if hibernated
+  size_t session_bytes;
+  //! the engine and the schemas it keeps for switching
+  size_t engine_bytes;
+  //! input, composition and commit history
+  size_t context_bytes;
+  //! candidates in the menus of the composition
+  size_t menu_bytes;
+} RimeSessionMemoryStats;
+
 // Setup
 
 /*!
@@ -244,6 +362,11 @@ RIME_API void RimeSetNotificationHandler(RimeNotificationHandler handler,
 RIME_API void RimeInitialize(RimeTraits* traits);
 RIME_API void RimeFinalize(void);
 
+/*!
+ *  Deploys into a new generation of the staging directory in a work thread.
+ *  Sessions keep being served from the previous generation meanwhile,
+ *  unless the staging directory is the same as a data directory.
+ */
 RIME_API Bool RimeStartMaintenance(Bool full_check);
 
 //! \deprecated Use RimeStartMaintenance(full_check = False) instead.
@@ -269,6 +392,29 @@ RIME_API Bool RimeFindSession(RimeSessionId session_id);
 RIME_API Bool RimeDestroySession(RimeSessionId session_id);
 RIME_API void RimeCleanupStaleSessions(void);
 RIME_API void RimeCleanupAllSessions(void);
+/*!
+ *  Releases memory that is reloaded on demand, such as the components of
+ *  schemas kept by sessions for switching. Call it on memory pressure.
+ */
+RIME_API void RimeTrimMemory(void);
+
+// Tenants
+
+/*!
+ *  Creates a tenant isolated from other tenants in the process, with its own
+ *  user data dir, user dictionaries, user config and sessions.
+ *  Only traits->user_data_dir is used; the tenant shares the data deployed by
+ *  the process-wide service, so call it after RimeInitialize().
+ *  Returns 0 on failure.
+ */
+RIME_API RimeTenantId RimeCreateTenant(RimeTraits* traits);
+//! Destroys the tenant with all its sessions.
+RIME_API Bool RimeDestroyTenant(RimeTenantId tenant_id);
+/*!
+ *  Creates a session owned by the tenant. Other session APIs take sessions
+ *  of any tenant.
+ */
+RIME_API RimeSessionId RimeCreateTenantSession(RimeTenantId tenant_id);
 
 // Input
 
@@ -287,6 +433,15 @@ RIME_API Bool RimeGetContext(RimeSessionId session_id, RimeContext* context);
 RIME_API Bool RimeFreeContext(RimeContext* context);
 RIME_API Bool RimeGetStatus(RimeSessionId session_id, RimeStatus* status);
 RIME_API Bool RimeFreeStatus(RimeStatus* status);
+/*!
+ *  Gets the parts of the session state that changed since the given
+ *  versions, which are then updated to the current ones for the next call.
+ *  Reads the unread commit text, as RimeGetCommit() does.
+ */
+RIME_API Bool RimeGetContextDelta(RimeSessionId session_id,
+                                  RimeContextVersions* versions,
+                                  RimeContextDelta* delta);
+RIME_API Bool RimeFreeContextDelta(RimeContextDelta* delta);
 
 // Accessing candidate list
 RIME_API Bool RimeCandidateListBegin(RimeSessionId session_id,
@@ -388,6 +543,14 @@ RIME_API Bool RimeSimulateKeySequence(RimeSessionId session_id,
                                       const char* key_sequence);
 
 RIME_API Bool RimeSetInput(RimeSessionId session_id, const char* input);
+
+// Diagnostics
+
+//! Should be called in the thread that processes input.
+RIME_API Bool RimeGetMemoryStats(RimeMemoryStats* stats);
+RIME_API Bool RimeGetSessionMemoryStats(RimeSessionId session_id,
+                                        RimeSessionMemoryStats* stats);
+
 // Module
 
 /*!
@@ -647,6 +810,23 @@ typedef struct rime_api_t {
                                                  Bool abbreviated);
 
   Bool (*set_input)(RimeSessionId session_id, const char* input);
+
+  //! report memory held by the library.
+  Bool (*get_memory_stats)(RimeMemoryStats* stats);
+  //! release memory that is reloaded on demand.
+  void (*trim_memory)(void);
+
+  RimeTenantId (*create_tenant)(RimeTraits* traits);
+  Bool (*destroy_tenant)(RimeTenantId tenant_id);
+  RimeSessionId (*create_tenant_session)(RimeTenantId tenant_id);
+
+  Bool (*get_context_delta)(RimeSessionId session_id,
+                            RimeContextVersions* versions,
+                            RimeContextDelta* delta);
+  Bool (*free_context_delta)(RimeContextDelta* delta);
+
+  Bool (*get_session_memory_stats)(RimeSessionId session_id,
+                                   RimeSessionMemoryStats* stats);
 } RimeApi;
 
 //! API entry
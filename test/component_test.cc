@@ -4,6 +4,7 @@
 //
 // 2011-04-07 GONG Chen <chen.sst@gmail.com>
 //
+#include <stdexcept>
 #include <gtest/gtest.h>
 #include <rime/common.h>
 #include <rime/component.h>
@@ -64,3 +65,98 @@ TEST(RimeComponentTest, UnknownComponent) {
   // unregistered component class
   EXPECT_FALSE(Registry::instance().Find("test_unknown"));
 }
+
+TEST(RimeComponentTest, LazyComponent) {
+  Registry& r = Registry::instance();
+  int instances = 0;
+  r.Register("test_lazy_hello", [&instances] {
+    ++instances;
+    return new HelloComponent("hello");
+  });
+  EXPECT_TRUE(r.IsRegistered("test_lazy_hello"));
+  EXPECT_FALSE(r.FindInstantiated("test_lazy_hello"));
+  EXPECT_EQ(0, instances);
+
+  Greeting::Component* h = Greeting::Require("test_lazy_hello");
+  ASSERT_TRUE(h != NULL);
+  EXPECT_EQ(1, instances);
+  EXPECT_EQ(h, Greeting::Require("test_lazy_hello"));
+  EXPECT_EQ(h, r.FindInstantiated("test_lazy_hello"));
+  EXPECT_EQ(1, instances);
+
+  the<Greeting> g(h->Create("michael"));
+  EXPECT_STREQ("hello, michael!", g->Say().c_str());
+
+  r.Unregister("test_lazy_hello");
+  EXPECT_FALSE(r.IsRegistered("test_lazy_hello"));
+  EXPECT_FALSE(r.Find("test_lazy_hello"));
+
+  // unregistered before ever being used
+  r.Register("test_lazy_unused", [&instances] {
+    ++instances;
+    return new HelloComponent("good morning");
+  });
+  r.Unregister("test_lazy_unused");
+  EXPECT_FALSE(r.Find("test_lazy_unused"));
+  EXPECT_EQ(1, instances);
+}
+
+TEST(RimeComponentTest, FailedFactoryIsRetried) {
+  Registry& r = Registry::instance();
+  int attempts = 0;
+  r.Register("test_flaky_hello", [&attempts]() -> ComponentBase* {
+    if (++attempts == 1)
+      throw std::runtime_error("not ready");
+    if (attempts == 2)
+      return nullptr;
+    return new HelloComponent("hello");
+  });
+  EXPECT_THROW(r.Find("test_flaky_hello"), std::runtime_error);
+  EXPECT_FALSE(r.Find("test_flaky_hello"));
+  EXPECT_TRUE(r.IsRegistered("test_flaky_hello"));
+  EXPECT_TRUE(r.Find("test_flaky_hello") != NULL);
+  EXPECT_EQ(3, attempts);
+  r.Unregister("test_flaky_hello");
+}
+
+TEST(RimeComponentTest, ComponentLookingUpItself) {
+  Registry& r = Registry::instance();
+  ComponentBase* found_by_itself = nullptr;
+  r.Register("test_recursive_hello", [&r, &found_by_itself] {
+    found_by_itself = r.Find("test_recursive_hello");
+    return new HelloComponent("hello");
+  });
+  ComponentBase* component = r.Find("test_recursive_hello");
+  EXPECT_TRUE(component != NULL);
+  EXPECT_FALSE(found_by_itself);
+  EXPECT_EQ(component, r.Find("test_recursive_hello"));
+  r.Unregister("test_recursive_hello");
+}
+
+TEST(RimeComponentTest, DefaultModuleComponentsAreAvailable) {
+  // registered by the default modules, loaded in rime_test_main.cc
+  const char* kComponents[] = {
+      // core
+      "config", "config_builder", "schema", "user_config",
+      // dict
+      "tabledb", "stabledb", "plain_userdb", "userdb", "corrector",
+      "dictionary", "reverse_lookup_dictionary", "user_dictionary",
+      "userdb_recovery_task",
+      // gears
+      "ascii_composer", "chord_composer", "express_editor", "fluid_editor",
+      "fluency_editor", "key_binder", "navigator", "punctuator", "recognizer",
+      "selector", "speller", "shape_processor", "abc_segmentor",
+      "affix_segmentor", "ascii_segmentor", "matcher", "punct_segmentor",
+      "fallback_segmentor", "echo_translator", "punct_translator",
+      "table_translator", "script_translator", "r10n_translator",
+      "reverse_lookup_translator", "schema_list_translator",
+      "switch_translator", "history_translator", "simplifier", "uniquifier",
+      "charset_filter", "cjk_minifier", "reverse_lookup_filter",
+      "single_char_filter", "shape_formatter",
+  };
+  Registry& r = Registry::instance();
+  for (const char* name : kComponents) {
+    EXPECT_TRUE(r.IsRegistered(name)) << name;
+    EXPECT_TRUE(r.Find(name) != NULL) << name;
+  }
+}
@@ -0,0 +1,231 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <gtest/gtest.h>
+#include <rime/deployer.h>
+
+using namespace rime;
+
+namespace fs = std::filesystem;
+
+extern char** environ;
+
+// set by rime_test_main.cc
+extern const char* rime_test_executable;
+
+// tells the helper process what to deploy
+static const char* kHelperVariable = "RIME_DEPLOYMENT_LOCK_TEST_HELPER";
+
+static const char* kTestDir = "deployment_lock_test";
+static const char* kBuildLog = "deployment_lock_test/build.log";
+
+// builds an artifact slowly enough for the processes to overlap
+class SlowBuild : public DeploymentTask {
+ public:
+  bool Run(Deployer* deployer) override {
+    std::ofstream(kBuildLog, std::ios::app) << "built\n";
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    fs::create_directories(deployer->staging_dir);
+    std::ofstream(fs::path(deployer->staging_dir) / "artifact.bin") << "data";
+    return true;
+  }
+};
+
+// crashes while building
+class CrashingBuild : public DeploymentTask {
+ public:
+  bool Run(Deployer* deployer) override { _exit(2); }
+};
+
+class RimeDeploymentLockTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    fs::remove_all(kTestDir);
+    fs::create_directories(fs::path(kTestDir) / "user");
+    std::ofstream(fs::path(kTestDir) / "user" / "default.yaml")
+        << "schema_list: []\n";
+  }
+
+  virtual void TearDown() { fs::remove_all(kTestDir); }
+
+ public:
+  static void Setup(Deployer* deployer) {
+    deployer->user_data_dir = deployer->shared_data_dir =
+        (fs::path(kTestDir) / "user").string();
+    deployer->staging_dir = deployer->prebuilt_data_dir =
+        (fs::path(kTestDir) / "build").string();
+  }
+
+  // runs the test binary as a helper process deploying the given task,
+  // since forking a process with running threads is not safe; returns the
+  // process id
+  static pid_t DeployInChildProcess(const string& task = "build") {
+    string filter = "--gtest_filter=RimeDeploymentLockHelper.*";
+    char* argv[] = {const_cast<char*>(rime_test_executable),
+                    const_cast<char*>(filter.c_str()), nullptr};
+    string variable = string(kHelperVariable) + "=" + task;
+    vector<char*> envp;
+    for (char** env = environ; *env; ++env)
+      envp.push_back(*env);
+    envp.push_back(const_cast<char*>(variable.c_str()));
+    envp.push_back(nullptr);
+    // keeps the report of the helper out of the test output
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+    pid_t pid = 0;
+    int error = posix_spawnp(&pid, rime_test_executable, &actions, nullptr,
+                             argv, envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    return error ? -1 : pid;
+  }
+
+  static int CountBuilds() {
+    std::ifstream log(kBuildLog);
+    int count = 0;
+    for (string line; std::getline(log, line);)
+      ++count;
+    return count;
+  }
+};
+
+TEST_F(RimeDeploymentLockTest, ArtifactIsBuiltOnce) {
+  const int kNumProcesses = 3;
+  pid_t pids[kNumProcesses];
+  for (auto& pid : pids) {
+    pid = DeployInChildProcess();
+    ASSERT_GT(pid, 0);
+  }
+  for (auto pid : pids) {
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+  }
+  EXPECT_EQ(1, CountBuilds());
+  EXPECT_TRUE(fs::exists(fs::path(kTestDir) / "build" / "artifact.bin"));
+  EXPECT_TRUE(
+      fs::exists(fs::path(kTestDir) / "build" / "deployment.manifest"));
+}
+
+TEST_F(RimeDeploymentLockTest, FinishedDeploymentIsAdopted) {
+  pid_t pid = DeployInChildProcess();
+  ASSERT_GT(pid, 0);
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_EQ(1, CountBuilds());
+  // the lock is free; the sources are the same
+  Deployer deployer;
+  Setup(&deployer);
+  deployer.ScheduleTask(New<SlowBuild>());
+  EXPECT_TRUE(deployer.Run());
+  EXPECT_FALSE(deployer.HasPendingTasks());
+  EXPECT_EQ(1, CountBuilds());
+}
+
+TEST_F(RimeDeploymentLockTest, ModifiedSourcesAreRebuilt) {
+  pid_t pid = DeployInChildProcess();
+  ASSERT_GT(pid, 0);
+  // waits until the first process holds the lock
+  while (CountBuilds() == 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::ofstream(fs::path(kTestDir) / "user" / "custom.yaml") << "patch: {}\n";
+  Deployer deployer;
+  Setup(&deployer);
+  deployer.ScheduleTask(New<SlowBuild>());
+  EXPECT_TRUE(deployer.Run());
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_EQ(2, CountBuilds());
+}
+
+TEST_F(RimeDeploymentLockTest, ModifiedNestedSourcesAreRebuilt) {
+  fs::create_directories(fs::path(kTestDir) / "user" / "opencc");
+  pid_t pid = DeployInChildProcess();
+  ASSERT_GT(pid, 0);
+  while (CountBuilds() == 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::ofstream(fs::path(kTestDir) / "user" / "opencc" / "t2s.json") << "{}";
+  Deployer deployer;
+  Setup(&deployer);
+  deployer.ScheduleTask(New<SlowBuild>());
+  EXPECT_TRUE(deployer.Run());
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_EQ(2, CountBuilds());
+}
+
+TEST_F(RimeDeploymentLockTest, LockOfCrashedProcessIsRecovered) {
+  pid_t pid = DeployInChildProcess("crash");
+  ASSERT_GT(pid, 0);
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_EQ(2, WEXITSTATUS(status));
+  Deployer deployer;
+  Setup(&deployer);
+  deployer.set_lock_timeout(5);
+  deployer.ScheduleTask(New<SlowBuild>());
+  EXPECT_TRUE(deployer.Run());
+  EXPECT_EQ(1, CountBuilds());
+}
+
+TEST_F(RimeDeploymentLockTest, TimeoutWaitingForLock) {
+  pid_t pid = DeployInChildProcess();
+  ASSERT_GT(pid, 0);
+  while (CountBuilds() == 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  Deployer deployer;
+  Setup(&deployer);
+  deployer.set_lock_timeout(0);
+  deployer.ScheduleTask(New<SlowBuild>());
+  EXPECT_FALSE(deployer.Run());
+  EXPECT_FALSE(deployer.HasPendingTasks());
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_EQ(1, CountBuilds());
+}
+
+TEST_F(RimeDeploymentLockTest, DeployingTasksDirectlyTakesTheLock) {
+  pid_t pid = DeployInChildProcess();
+  ASSERT_GT(pid, 0);
+  while (CountBuilds() == 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  Deployer deployer;
+  Setup(&deployer);
+  deployer.set_lock_timeout(0);
+  DeploymentLock lock(&deployer);
+  EXPECT_FALSE(lock.Acquire());
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(lock.Acquire());
+}
+
+// the helper process run by RimeDeploymentLockTest; passes without doing
+// anything when run with the other tests
+TEST(RimeDeploymentLockHelper, Deploy) {
+  const char* task = std::getenv(kHelperVariable);
+  if (!task)
+    return;
+  Deployer deployer;
+  RimeDeploymentLockTest::Setup(&deployer);
+  if (string(task) == "crash")
+    deployer.ScheduleTask(New<CrashingBuild>());
+  else
+    deployer.ScheduleTask(New<SlowBuild>());
+  EXPECT_TRUE(deployer.Run());
+}
+
+#endif  // _WIN32
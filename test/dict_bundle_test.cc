@@ -0,0 +1,117 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/dict/dict_bundle.h>
+#include <rime/dict/prism.h>
+#include <rime/dict/table.h>
+
+using namespace rime;
+
+static const char* kTableFile = "dict_bundle_test.table.bin";
+static const char* kPrismFile = "dict_bundle_test.prism.bin";
+static const char* kBundleFile = "dict_bundle_test.bundle.bin";
+
+class RimeDictBundleTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    Syllabary syllabary = {"a", "b"};
+    Vocabulary vocabulary;
+    auto entry = New<ShortDictEntry>();
+    entry->code.push_back(1);
+    entry->text = "bee";
+    entry->weight = 1.0;
+    vocabulary[1].entries.push_back(entry);
+    Table table(kTableFile);
+    table.Remove();
+    ASSERT_TRUE(table.Build(syllabary, vocabulary, 1, 42));
+    ASSERT_TRUE(table.Save());
+    Prism prism(kPrismFile);
+    prism.Remove();
+    ASSERT_TRUE(prism.Build(syllabary, nullptr, 42, 7));
+    ASSERT_TRUE(prism.Save());
+  }
+
+  virtual void TearDown() {
+    std::filesystem::remove(kTableFile);
+    std::filesystem::remove(kPrismFile);
+    std::filesystem::remove(kBundleFile);
+  }
+
+  static bool BuildBundle() {
+    DictBundle bundle(kBundleFile);
+    return bundle.Build({{"table", kTableFile}, {"prism", kPrismFile}}, 42, 7);
+  }
+
+  static size_t CountMappedFiles(const string& file_name) {
+    auto stats = MappedFile::GetStats();
+    return std::count_if(stats.begin(), stats.end(), [&](const auto& file) {
+      return std::filesystem::path(file.file_name).filename() == file_name;
+    });
+  }
+};
+
+TEST_F(RimeDictBundleTest, BuildAndLoad) {
+  ASSERT_TRUE(BuildBundle());
+  EXPECT_FALSE(std::filesystem::exists(string(kBundleFile) + ".tmp"));
+  DictBundle bundle(kBundleFile);
+  ASSERT_TRUE(bundle.Load());
+  EXPECT_EQ(42, bundle.dict_file_checksum());
+  EXPECT_EQ(7, bundle.schema_file_checksum());
+  EXPECT_TRUE(bundle.HasSection("table"));
+  EXPECT_TRUE(bundle.HasSection("prism"));
+  EXPECT_FALSE(bundle.HasSection("reverse"));
+}
+
+TEST_F(RimeDictBundleTest, ReadFromSections) {
+  ASSERT_TRUE(BuildBundle());
+  // only the bundle is needed from now on
+  std::filesystem::remove(kTableFile);
+  std::filesystem::remove(kPrismFile);
+  auto bundle = DictBundle::Open(kBundleFile);
+  ASSERT_TRUE(bundle);
+  EXPECT_EQ(bundle, DictBundle::Open(kBundleFile));
+  the<Table> table(new Table(kTableFile));
+  the<Prism> prism(new Prism(kPrismFile));
+  ASSERT_TRUE(bundle->Attach("table", table.get()));
+  ASSERT_TRUE(bundle->Attach("prism", prism.get()));
+  EXPECT_FALSE(bundle->Attach("reverse", table.get()));
+  EXPECT_TRUE(table->bundled());
+  EXPECT_TRUE(table->Exists());
+  bundle.reset();
+  ASSERT_TRUE(table->Load());
+  ASSERT_TRUE(prism->Load());
+  EXPECT_EQ(42, table->dict_file_checksum());
+  EXPECT_EQ(7, prism->schema_file_checksum());
+  TableAccessor accessor = table->QueryWords(1);
+  ASSERT_FALSE(accessor.exhausted());
+  EXPECT_EQ("bee", table->GetEntryText(*accessor.entry()));
+  EXPECT_TRUE(prism->HasKey("b"));
+  // the sections share a single mapping of the bundle
+  EXPECT_EQ(1, CountMappedFiles(kBundleFile));
+  EXPECT_EQ(0, CountMappedFiles(kTableFile));
+  // reopening the bundle reuses the mapping kept by the attached files
+  bundle = DictBundle::Open(kBundleFile);
+  ASSERT_TRUE(bundle);
+  EXPECT_TRUE(bundle->HasSection("table"));
+  EXPECT_EQ(1, CountMappedFiles(kBundleFile));
+  bundle.reset();
+  // which is unmapped with the last file attached to it
+  table.reset();
+  EXPECT_EQ(1, CountMappedFiles(kBundleFile));
+  prism.reset();
+  EXPECT_EQ(0, CountMappedFiles(kBundleFile));
+}
+
+TEST_F(RimeDictBundleTest, InvalidBundle) {
+  std::ofstream(kBundleFile) << "not a bundle";
+  EXPECT_FALSE(DictBundle::Open(kBundleFile));
+  // a failed build leaves the existing file in place
+  DictBundle bundle(kBundleFile);
+  EXPECT_FALSE(bundle.Build({{"table", "nonexistent.table.bin"}}, 0, 0));
+  EXPECT_TRUE(std::filesystem::exists(kBundleFile));
+}
@@ -0,0 +1,191 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+#include <rime/common.h>
+#include <rime/task_scheduler.h>
+#include <rime/dict/dict_compiler.h>
+#include <rime/dict/dictionary.h>
+
+using namespace rime;
+
+static const char* kSchemaFile = "dict_compiler_test.schema.yaml";
+
+static const char* kTestFileSuffixes[] = {
+    ".table.bin",
+    ".prism.bin",
+    ".reverse.bin",
+};
+
+static string ReadFile(const string& file_name) {
+  std::ifstream in(file_name, std::ios::binary);
+  return string(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+}
+
+static void WriteSchemaFile() {
+  std::ofstream schema(kSchemaFile);
+  schema << "speller:\n"
+            "  algebra:\n"
+            "    - derive/^([zcs])h/$1/\n"
+            "    - derive/^([nl])ve$/$1ue/\n"
+            "    - abbrev/^([a-z]).+$/$1/\n";
+}
+
+static vector<string> BuildDictionary(const string& dict_name) {
+  Dictionary dict(dict_name, {}, {New<Table>(dict_name + ".table.bin")},
+                  New<Prism>(dict_name + ".prism.bin"));
+  DictCompiler compiler(&dict);
+  compiler.set_options(DictCompiler::kRebuild);
+  EXPECT_TRUE(compiler.Compile(kSchemaFile));
+  vector<string> images;
+  for (const char* suffix : kTestFileSuffixes) {
+    images.push_back(ReadFile(dict_name + suffix));
+  }
+  return images;
+}
+
+static void ExpectSameImages(const vector<string>& expected,
+                             const vector<string>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_FALSE(expected[i].empty()) << kTestFileSuffixes[i];
+    EXPECT_TRUE(expected[i] == actual[i])
+        << kTestFileSuffixes[i] << " differs.";
+  }
+}
+
+TEST(RimeDictCompilerTest, ReproducibleWithAnyNumberOfThreads) {
+  WriteSchemaFile();
+  auto& scheduler = TaskScheduler::instance();
+  int saved_max_threads = scheduler.max_threads();
+  scheduler.set_max_threads(1);
+  auto serial = BuildDictionary("dictionary_test");
+  scheduler.set_max_threads(4);
+  auto parallel = BuildDictionary("dictionary_test");
+  scheduler.set_max_threads(saved_max_threads);
+  std::filesystem::remove(kSchemaFile);
+
+  ExpectSameImages(serial, parallel);
+}
+
+static const char* kRebuildTestDict = "dict_compiler_rebuild_test";
+
+static void WriteRebuildTestDict(const string& extra_lines) {
+  std::ofstream dict(string(kRebuildTestDict) + ".dict.yaml");
+  dict << "---\n"
+          "name: dict_compiler_rebuild_test\n"
+          "version: \"1.0\"\n"
+          "sort: by_weight\n"
+          "...\n"
+          "\n"
+          "你\tni\t100\n"
+          "好\thao\t100\n"
+          "号\thao\t20\n"
+          "我\two\t100\n"
+          "们\tmen\t100\n"
+          "你好\n"
+          "我们\t\t50\n"
+          "你们好\n"
+       << extra_lines;
+}
+
+static vector<string> CompileDictionary(const string& dict_name,
+                                        DictCompiler::Stats* stats) {
+  Dictionary dict(dict_name, {}, {New<Table>(dict_name + ".table.bin")},
+                  New<Prism>(dict_name + ".prism.bin"));
+  DictCompiler compiler(&dict);
+  EXPECT_TRUE(compiler.Compile(kSchemaFile));
+  *stats = compiler.stats();
+  vector<string> images;
+  for (const char* suffix : kTestFileSuffixes) {
+    images.push_back(ReadFile(dict_name + suffix));
+  }
+  return images;
+}
+
+static void RemoveCompiledFiles(const string& dict_name) {
+  for (const char* suffix : kTestFileSuffixes) {
+    std::filesystem::remove(dict_name + suffix);
+  }
+  std::filesystem::remove(dict_name + ".table.record");
+}
+
+// rebuilding with results of the previous build should yield the same files
+// as a clean build, while only redoing the work affected by the edit.
+TEST(RimeDictCompilerTest, IncrementalBuildMatchesCleanBuild) {
+  WriteSchemaFile();
+  RemoveCompiledFiles(kRebuildTestDict);
+  WriteRebuildTestDict("");
+  DictCompiler::Stats stats;
+  CompileDictionary(kRebuildTestDict, &stats);
+  EXPECT_TRUE(stats.table_rebuilt);
+  const string record_file = string(kRebuildTestDict) + ".table.record";
+  ASSERT_TRUE(std::filesystem::exists(record_file));
+
+  struct Edit {
+    const char* lines;
+    bool prism_reused;
+    bool table_reused;
+  } edits[] = {
+      // a comment yields the same entries
+      {"# a comment\n", true, true},
+      // a new phrase
+      {"我们好\n", true, false},
+      // a new word of a known syllable
+      {"我们好\n浩\thao\t10\n", true, false},
+      // a new reading of a word changes the syllabary
+      {"我们好\n浩\thao\t10\n好\thou\t60\n", false, false},
+      {"我们好\n浩\thao\t10\n好\thou\t60\n# a comment\n", true, true},
+  };
+  for (const auto& edit : edits) {
+    WriteRebuildTestDict(edit.lines);
+    auto incremental = CompileDictionary(kRebuildTestDict, &stats);
+    EXPECT_EQ(edit.table_reused, stats.table_reused) << edit.lines;
+    EXPECT_EQ(!edit.table_reused, stats.table_rebuilt) << edit.lines;
+    EXPECT_EQ(edit.prism_reused, stats.prism_reused) << edit.lines;
+    EXPECT_EQ(!edit.prism_reused, stats.prism_rebuilt) << edit.lines;
+    // keep the record of the incremental build for the next edit
+    std::filesystem::rename(record_file, record_file + ".saved");
+    RemoveCompiledFiles(kRebuildTestDict);
+    auto clean = CompileDictionary(kRebuildTestDict, &stats);
+    EXPECT_FALSE(stats.table_reused);
+    ExpectSameImages(clean, incremental);
+    std::filesystem::rename(record_file + ".saved", record_file);
+  }
+  RemoveCompiledFiles(kRebuildTestDict);
+  std::filesystem::remove(string(kRebuildTestDict) + ".dict.yaml");
+  std::filesystem::remove(kSchemaFile);
+}
+
+TEST(RimeDictCompilerTest, TruncatedBuildRecordIsIgnored) {
+  WriteSchemaFile();
+  RemoveCompiledFiles(kRebuildTestDict);
+  WriteRebuildTestDict("");
+  DictCompiler::Stats stats;
+  auto clean = CompileDictionary(kRebuildTestDict, &stats);
+  const string record_file = string(kRebuildTestDict) + ".table.record";
+  const string record = ReadFile(record_file);
+  ASSERT_LT(2u, record.size());
+  // cut before the trailer
+  {
+    std::ofstream out(record_file, std::ios::binary | std::ios::trunc);
+    out << record.substr(0, record.size() - 2);
+  }
+  WriteRebuildTestDict("# a comment\n");
+  CompileDictionary(kRebuildTestDict, &stats);
+  EXPECT_FALSE(stats.table_reused);
+  EXPECT_TRUE(stats.table_rebuilt);
+  // and saved again in whole
+  WriteRebuildTestDict("");
+  auto rebuilt = CompileDictionary(kRebuildTestDict, &stats);
+  EXPECT_TRUE(stats.table_reused);
+  ExpectSameImages(clean, rebuilt);
+  RemoveCompiledFiles(kRebuildTestDict);
+  std::filesystem::remove(string(kRebuildTestDict) + ".dict.yaml");
+  std::filesystem::remove(kSchemaFile);
+}
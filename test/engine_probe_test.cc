@@ -0,0 +1,76 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/context.h>
+#include <rime/engine.h>
+#include <rime/schema.h>
+
+using namespace rime;
+
+static const char* kSchemaFile = "engine_probe_test.schema.yaml";
+
+class RimeEngineProbeTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::ofstream schema(kSchemaFile);
+    schema << "schema:\n"
+              "  schema_id: engine_probe_test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - speller\n"
+              "  segmentors:\n"
+              "    - abc_segmentor\n"
+              "    - fallback_segmentor\n"
+              "  translators:\n"
+              "    - echo_translator\n";
+    schema.close();
+    engine_.reset(Engine::Create());
+    engine_->ApplySchema(new Schema("engine_probe_test"));
+  }
+
+  virtual void TearDown() {
+    engine_.reset();
+    std::filesystem::remove(kSchemaFile);
+  }
+
+  the<Engine> engine_;
+};
+
+TEST_F(RimeEngineProbeTest, ProbeLeavesContextUntouched) {
+  Context* ctx = engine_->context();
+  ctx->set_input("rime");
+  ASSERT_TRUE(ctx->HasMenu());
+  auto selected = ctx->GetSelectedCandidate();
+  int updates = 0;
+  ctx->update_notifier().connect([&updates](Context*) { ++updates; });
+
+  auto cand = engine_->Probe("ri");
+  ASSERT_TRUE(cand);
+  EXPECT_EQ("ri", cand->text());
+  EXPECT_EQ(0, cand->start());
+  EXPECT_EQ(2, cand->end());
+
+  EXPECT_EQ(0, updates);
+  EXPECT_EQ("rime", ctx->input());
+  EXPECT_EQ(4, ctx->caret_pos());
+  EXPECT_EQ(selected, ctx->GetSelectedCandidate());
+}
+
+TEST_F(RimeEngineProbeTest, ProbeAfterConfirmedSegment) {
+  Context* ctx = engine_->context();
+  ctx->set_input("rime");
+  ASSERT_TRUE(ctx->ConfirmCurrentSelection());
+  ctx->set_input("rimeime");
+  ASSERT_TRUE(ctx->HasMenu());
+
+  auto cand = engine_->Probe("rimei");
+  ASSERT_TRUE(cand);
+  EXPECT_EQ("i", cand->text());
+  EXPECT_EQ(4, cand->start());
+  EXPECT_EQ("rimeime", ctx->input());
+}
@@ -0,0 +1,127 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/context.h>
+#include <rime/engine.h>
+#include <rime/flight_recorder.h>
+#include <rime/key_event.h>
+#include <rime/schema.h>
+
+using namespace rime;
+
+static const char* kSchemaFile = "flight_recorder_test.schema.yaml";
+static const char* kDumpDir = "flight_recorder_test";
+
+class RimeFlightRecorderTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::ofstream schema(kSchemaFile);
+    schema << "schema:\n"
+              "  schema_id: flight_recorder_test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - speller\n"
+              "    - express_editor\n"
+              "  segmentors:\n"
+              "    - abc_segmentor\n"
+              "    - fallback_segmentor\n"
+              "  translators:\n"
+              "    - echo_translator\n";
+    schema.close();
+    std::filesystem::create_directories(kDumpDir);
+    engine_.reset(Engine::Create());
+    engine_->ApplySchema(new Schema("flight_recorder_test"));
+  }
+
+  virtual void TearDown() {
+    engine_.reset();
+    std::filesystem::remove(kSchemaFile);
+    std::filesystem::remove_all(kDumpDir);
+  }
+
+  bool Type(FlightRecorder* recorder, const string& key) {
+    KeyEvent key_event(key);
+    recorder->BeginKey(key_event, engine_.get());
+    return recorder->EndKey(engine_->ProcessKey(key_event));
+  }
+
+  the<Engine> engine_;
+};
+
+TEST_F(RimeFlightRecorderTest, KeepsLastKeys) {
+  FlightRecorder recorder(3, 60000, kDumpDir);
+  engine_->context()->set_option("full_shape", true);
+  for (const char* key : {"r", "i", "m", "e"}) {
+    EXPECT_FALSE(Type(&recorder, key));
+  }
+  auto records = recorder.records();
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ("i", records[0].key);
+  EXPECT_EQ("r", records[0].input);
+  EXPECT_EQ(1u, records[0].caret_pos);
+  EXPECT_EQ("e", records[2].key);
+  EXPECT_EQ("rim", records[2].input);
+  EXPECT_TRUE(records[2].accepted);
+  EXPECT_EQ("flight_recorder_test", records[2].schema_id);
+  auto full_shape = std::make_pair(string("full_shape"), true);
+  EXPECT_NE(records[2].options.end(),
+            std::find(records[2].options.begin(), records[2].options.end(),
+                      full_shape));
+}
+
+TEST_F(RimeFlightRecorderTest, DumpsOnSlowKey) {
+  // every key is slow
+  FlightRecorder recorder(8, 0, kDumpDir);
+  EXPECT_TRUE(Type(&recorder, "r"));
+  EXPECT_TRUE(Type(&recorder, "i"));
+  // records since the last dump
+  vector<KeystrokeRecord> records;
+  ASSERT_TRUE(FlightRecorder::Load(recorder.last_dump_file(), &records));
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("i", records[0].key);
+  EXPECT_EQ("r", records[0].input);
+}
+
+TEST_F(RimeFlightRecorderTest, DumpsAreNotOverwritten) {
+  FlightRecorder recorder(8, 0, kDumpDir);
+  EXPECT_TRUE(Type(&recorder, "r"));
+  string first_dump = recorder.last_dump_file();
+  // within the same second, if not the same millisecond
+  EXPECT_TRUE(Type(&recorder, "i"));
+  EXPECT_NE(first_dump, recorder.last_dump_file());
+  EXPECT_TRUE(std::filesystem::exists(first_dump));
+}
+
+TEST_F(RimeFlightRecorderTest, SaveAndLoad) {
+  vector<KeystrokeRecord> records(2);
+  records[0].schema_id = "alpha";
+  records[0].options = {{"ascii_mode", false}};
+  records[0].key = "Shift+A";
+  records[0].accepted = true;
+  records[0].elapsed_us = 1200;
+  records[1].schema_id = "beta";
+  records[1].options = {{"ascii_mode", true}, {"full_shape", true}};
+  // fields containing separators
+  records[1].input = "a\tb\\c\n";
+  records[1].caret_pos = 2;
+  records[1].key = "BackSpace";
+  records[1].elapsed_us = 250000;
+  const string file_path = string(kDumpDir) + "/keys.txt";
+  ASSERT_TRUE(FlightRecorder::Save(file_path, records));
+  vector<KeystrokeRecord> loaded;
+  ASSERT_TRUE(FlightRecorder::Load(file_path, &loaded));
+  ASSERT_EQ(2u, loaded.size());
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(records[i].schema_id, loaded[i].schema_id);
+    EXPECT_EQ(records[i].options, loaded[i].options);
+    EXPECT_EQ(records[i].input, loaded[i].input);
+    EXPECT_EQ(records[i].caret_pos, loaded[i].caret_pos);
+    EXPECT_EQ(records[i].key, loaded[i].key);
+    EXPECT_EQ(records[i].accepted, loaded[i].accepted);
+    EXPECT_EQ(records[i].elapsed_us, loaded[i].elapsed_us);
+  }
+}
@@ -0,0 +1,140 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/context.h>
+#include <rime/memory_stats.h>
+#include <rime/schema.h>
+#include <rime/service.h>
+#include <rime/dict/prism.h>
+#include <rime/dict/text_db.h>
+#include <rime/dict/user_db.h>
+#include <rime/dict/user_dictionary.h>
+
+using namespace rime;
+
+TEST(RimeMemoryStatsTest, MappedFilesAreCounted) {
+  const string file_name = "memory_stats_test.prism.bin";
+  {
+    Prism prism(file_name);
+    prism.Remove();
+    set<string> keyset = {"ni", "hao", "rime"};
+    ASSERT_TRUE(prism.Build(keyset));
+    ASSERT_TRUE(prism.Save());
+  }
+  auto before = CollectMemoryStats();
+  {
+    Prism prism(file_name);
+    ASSERT_TRUE(prism.Load());
+    auto loaded = CollectMemoryStats();
+    EXPECT_EQ(before.num_mapped_files + 1, loaded.num_mapped_files);
+    EXPECT_EQ(before.num_prisms + 1, loaded.num_prisms);
+    EXPECT_EQ(before.mapped_bytes + std::filesystem::file_size(file_name),
+              loaded.mapped_bytes);
+    EXPECT_LE(loaded.resident_bytes, loaded.mapped_bytes);
+  }
+  auto after = CollectMemoryStats();
+  EXPECT_EQ(before.num_mapped_files, after.num_mapped_files);
+  EXPECT_EQ(before.mapped_bytes, after.mapped_bytes);
+  std::filesystem::remove(file_name);
+}
+
+TEST(RimeMemoryStatsTest, DbMemoryUsageFollowsContents) {
+  UserDbWrapper<TextDb> db("memory_stats_test.txt", "memory_stats_test");
+  if (db.Exists())
+    db.Remove();
+  auto before = CollectMemoryStats();
+  ASSERT_TRUE(db.Open());
+  auto opened = CollectMemoryStats();
+  EXPECT_EQ(before.num_dbs + 1, opened.num_dbs);
+  for (int i = 0; i < 100; ++i) {
+    db.Update("key" + std::to_string(i), "value");
+  }
+  auto updated = CollectMemoryStats();
+  EXPECT_GT(updated.db_bytes, opened.db_bytes + 100 * 8);
+  for (int i = 0; i < 100; ++i) {
+    db.Erase("key" + std::to_string(i));
+  }
+  EXPECT_EQ(opened.db_bytes, CollectMemoryStats().db_bytes);
+  db.Close();
+  auto closed = CollectMemoryStats();
+  EXPECT_EQ(before.num_dbs, closed.num_dbs);
+  EXPECT_EQ(before.db_bytes, closed.db_bytes);
+  db.Remove();
+}
+
+TEST(RimeMemoryStatsTest, MinimalSchemaConfigIsCounted) {
+  const string file_name = "memory_stats_test.schema.yaml";
+  {
+    std::ofstream schema(file_name);
+    schema << "schema:\n"
+              "  schema_id: memory_stats_test\n"
+              "  name: Memory Stats Test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - speller\n"
+              "  translators:\n"
+              "    - echo_translator\n";
+  }
+  auto before = CollectMemoryStats();
+  {
+    Schema schema("memory_stats_test");
+    ASSERT_TRUE(schema.config());
+    EXPECT_EQ("Memory Stats Test", schema.schema_name());
+    auto loaded = CollectMemoryStats();
+    EXPECT_EQ(before.num_configs + 1, loaded.num_configs);
+    EXPECT_GT(loaded.config_bytes, before.config_bytes);
+  }
+  auto after = CollectMemoryStats();
+  EXPECT_EQ(before.num_configs, after.num_configs);
+  EXPECT_EQ(before.config_bytes, after.config_bytes);
+  std::filesystem::remove(file_name);
+}
+
+TEST(RimeMemoryStatsTest, SessionUsageIsBrokenDown) {
+  const string file_name = "memory_stats_test.schema.yaml";
+  {
+    std::ofstream schema(file_name);
+    schema << "schema:\n"
+              "  schema_id: memory_stats_test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - speller\n"
+              "  segmentors:\n"
+              "    - abc_segmentor\n"
+              "  translators:\n"
+              "    - echo_translator\n";
+  }
+  Session session;
+  session.ApplySchema(new Schema("memory_stats_test"));
+  SessionMemoryUsage idle = session.EstimateMemoryUsage();
+  EXPECT_GT(idle.session_bytes, 0);
+  EXPECT_GT(idle.engine_bytes, 0);
+  EXPECT_GT(idle.context_bytes, 0);
+  EXPECT_EQ(0, idle.menu_bytes);
+  session.context()->set_input("rime");
+  SessionMemoryUsage composing = session.EstimateMemoryUsage();
+  EXPECT_GT(composing.context_bytes, idle.context_bytes);
+  EXPECT_GT(composing.menu_bytes, 0);
+  EXPECT_EQ(composing.session_bytes + composing.engine_bytes +
+                composing.context_bytes + composing.menu_bytes,
+            composing.total());
+  std::filesystem::remove(file_name);
+}
+
+TEST(RimeMemoryStatsTest, CachedUserDbsAreCounted) {
+  UserDictionaryComponent component;
+  size_t bytes = 0;
+  EXPECT_EQ(0, component.GetCacheStats(&bytes));
+  {
+    the<UserDictionary> dict(
+        component.Create("memory_stats_test", "plain_userdb"));
+    ASSERT_TRUE(dict);
+    EXPECT_EQ(1, component.GetCacheStats(&bytes));
+  }
+  // released by the last dictionary using it
+  EXPECT_EQ(0, component.GetCacheStats(&bytes));
+}
@@ -0,0 +1,128 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/dict/ngram_model.h>
+#include <rime/gear/ngram_grammar.h>
+
+using namespace rime;
+
+class RimeNgramModelTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    NgramCounts counts;
+    counts[{"<s>"}] = 4;
+    counts[{"</s>"}] = 4;
+    counts[{"北京"}] = 3;
+    counts[{"天安门"}] = 2;
+    counts[{"我"}] = 4;
+    counts[{"爱"}] = 3;
+    counts[{"<s>", "我"}] = 4;
+    counts[{"我", "爱"}] = 3;
+    counts[{"爱", "北京"}] = 2;
+    counts[{"北京", "天安门"}] = 2;
+    counts[{"天安门", "</s>"}] = 2;
+    counts[{"<s>", "我", "爱"}] = 3;
+    counts[{"我", "爱", "北京"}] = 2;
+    model_.reset(new NgramModel(kFileName));
+    model_->Remove();
+    ASSERT_TRUE(model_->Build(counts, 3));
+    ASSERT_TRUE(model_->Save());
+    model_.reset(new NgramModel(kFileName));
+    ASSERT_TRUE(model_->Load());
+  }
+
+  virtual void TearDown() {
+    model_->Close();
+    model_->Remove();
+  }
+
+  NgramModel::WordId Id(const string& word) {
+    return model_->FindWord(word.c_str(), word.length());
+  }
+
+  double Score(const vector<string>& context, const string& word) {
+    vector<NgramModel::WordId> ids;
+    for (const auto& w : context) {
+      ids.push_back(Id(w));
+    }
+    NgramModel::State state;
+    model_->SetContext(ids.data(), ids.size(), &state);
+    return model_->Score(state, Id(word));
+  }
+
+  static const char kFileName[];
+  an<NgramModel> model_;
+};
+
+const char RimeNgramModelTest::kFileName[] = "ngram_model_test.ngram.bin";
+
+TEST_F(RimeNgramModelTest, Vocabulary) {
+  EXPECT_EQ(3, model_->order());
+  EXPECT_EQ(6u, model_->num_words());
+  EXPECT_EQ(3u, model_->max_word_length());
+  EXPECT_EQ(Id("<s>"), model_->sentence_begin());
+  EXPECT_EQ(Id("</s>"), model_->sentence_end());
+  EXPECT_EQ("北京", model_->GetWord(Id("北京")));
+  EXPECT_EQ(kInvalidStringId, Id("上海"));
+  EXPECT_EQ(5u, model_->num_ngrams(2));
+  EXPECT_EQ(2u, model_->num_ngrams(3));
+}
+
+TEST_F(RimeNgramModelTest, Score) {
+  // seen bigrams score higher than backing off to unigrams
+  EXPECT_GT(Score({"爱"}, "北京"), Score({"爱"}, "天安门"));
+  EXPECT_GT(Score({"北京"}, "天安门"), Score({}, "天安门"));
+  // trigrams refine the bigram estimate
+  EXPECT_GT(Score({"<s>", "我"}, "爱"), Score({"我"}, "北京"));
+  for (const char* word : {"<s>", "</s>", "北京", "天安门", "我", "爱"}) {
+    double score = Score({"我", "爱"}, word);
+    EXPECT_LT(score, 0.0);
+    EXPECT_TRUE(std::isfinite(score));
+  }
+  NgramModel::State state;
+  EXPECT_TRUE(std::isinf(model_->Score(state, kInvalidStringId)));
+}
+
+TEST_F(RimeNgramModelTest, Probabilities) {
+  // probabilities of the words following a context sum up to 1
+  for (const char* context : {"<s>", "我", "爱", "北京"}) {
+    double sum = 0.0;
+    for (const char* word : {"<s>", "</s>", "北京", "天安门", "我", "爱"}) {
+      sum += std::exp(Score({context}, word));
+    }
+    EXPECT_NEAR(1.0, sum, 0.05) << context;
+  }
+}
+
+TEST_F(RimeNgramModelTest, Grammar) {
+  NgramGrammar grammar(nullptr, model_);
+  EXPECT_DOUBLE_EQ(Score({"<s>"}, "我"), grammar.Query("", "我", false));
+  EXPECT_DOUBLE_EQ(Score({"<s>", "我"}, "爱"), grammar.Query("我", "爱", false));
+  // the context is split into known words
+  EXPECT_DOUBLE_EQ(Score({"我", "爱"}, "北京"),
+                   grammar.Query("我爱", "北京", false));
+  EXPECT_DOUBLE_EQ(Score({"爱", "北京"}, "天安门") +
+                       Score({"北京", "天安门"}, "</s>"),
+                   grammar.Query("我爱北京", "天安门", true));
+  EXPECT_GT(grammar.Query("我爱", "北京", false),
+            grammar.Query("我爱", "上海", false));
+}
+
+TEST_F(RimeNgramModelTest, InvalidNumSlots) {
+  model_->Close();
+  for (uint32_t num_slots : {0u, 3u, 4u}) {
+    {
+      std::fstream file(kFileName,
+                        std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(offsetof(ngram::Metadata, num_slots));
+      file.write(reinterpret_cast<const char*>(&num_slots), sizeof(num_slots));
+    }
+    // not a power of two, or too few for the words
+    EXPECT_FALSE(NgramModel(kFileName).Load()) << num_slots;
+  }
+}
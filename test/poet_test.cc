@@ -0,0 +1,136 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <chrono>
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/registry.h>
+#include <rime/dict/vocabulary.h>
+#include <rime/gear/grammar.h>
+#include <rime/gear/ngram_grammar.h>
+#include <rime/gear/poet.h>
+
+using namespace rime;
+
+// records the words the poet extends lines with
+class QueryCountingGrammar : public Grammar {
+ public:
+  double Query(const string& context,
+               const string& word,
+               bool is_rear) override {
+    ++num_queries;
+    words.insert(word);
+    return 0.0;
+  }
+
+  static size_t num_queries;
+  static set<string> words;
+};
+
+size_t QueryCountingGrammar::num_queries = 0;
+set<string> QueryCountingGrammar::words;
+
+class QueryCountingGrammarComponent : public Grammar::Component {
+ public:
+  Grammar* Create(Config* config) override {
+    return new QueryCountingGrammar;
+  }
+};
+
+class RimePoetTest : public ::testing::Test {
+ protected:
+  void AddWord(int start, int end, const string& text, double weight) {
+    auto entry = New<DictEntry>();
+    entry->text = text;
+    entry->weight = weight;
+    graph_[start][end].push_back(entry);
+  }
+
+  WordGraph graph_;
+};
+
+TEST_F(RimePoetTest, MakeSentence) {
+  AddWord(0, 1, "a", -1.0);
+  AddWord(0, 1, "b", -2.0);
+  AddWord(1, 2, "c", -1.0);
+  Poet poet(nullptr, nullptr);
+  auto sentence = poet.MakeSentence(graph_, 2, "");
+  ASSERT_TRUE(sentence);
+  EXPECT_EQ("ac", sentence->text());
+  EXPECT_EQ(2, sentence->end());
+}
+
+TEST_F(RimePoetTest, LatticeWidthKeepsHeaviestWords) {
+  // the heaviest word at the head leads nowhere
+  AddWord(0, 1, "x", -1.0);
+  AddWord(0, 2, "y", -3.0);
+  AddWord(0, 2, "w", -4.0);
+  AddWord(2, 3, "z", -1.0);
+  Poet poet(nullptr, nullptr);
+  auto sentence = poet.MakeSentence(graph_, 3, "");
+  ASSERT_TRUE(sentence);
+  EXPECT_EQ("yz", sentence->text());
+  poet.set_max_lattice_width(2);
+  sentence = poet.MakeSentence(graph_, 3, "");
+  ASSERT_TRUE(sentence);
+  EXPECT_EQ("yz", sentence->text());
+  // only "x" is tried at the head
+  poet.set_max_lattice_width(1);
+  EXPECT_FALSE(poet.MakeSentence(graph_, 3, ""));
+  poet.set_max_lattice_width(0);
+  EXPECT_TRUE(poet.MakeSentence(graph_, 3, ""));
+}
+
+TEST_F(RimePoetTest, LatticeWidthOnWideGraph) {
+  const int kLength = 64;
+  const int kWordsPerPosition = 100;
+  for (int i = 0; i < kLength; ++i) {
+    for (int j = 0; j < kWordsPerPosition; ++j) {
+      AddWord(i, i + 1, std::to_string(j) + ",", -1.0 - j);
+    }
+  }
+  Poet poet(nullptr, nullptr);
+  poet.set_max_lattice_width(3);
+  auto sentence = poet.MakeSentence(graph_, kLength, "");
+  ASSERT_TRUE(sentence);
+  EXPECT_EQ(kLength, sentence->size());
+  for (const auto& word : sentence->components()) {
+    EXPECT_EQ("0,", word.text);
+  }
+}
+
+TEST_F(RimePoetTest, LatticeWidthBoundsWordsTried) {
+  const int kLength = 64;
+  const int kWordsPerPosition = 100;
+  const size_t kLatticeWidth = 3;
+  for (int i = 0; i < kLength; ++i) {
+    for (int j = 0; j < kWordsPerPosition; ++j) {
+      AddWord(i, i + 1, std::to_string(j) + ",", -1.0 - j);
+    }
+  }
+  auto& registry = Registry::instance();
+  registry.Register("grammar", new QueryCountingGrammarComponent);
+  QueryCountingGrammar::num_queries = 0;
+  QueryCountingGrammar::words.clear();
+  {
+    Poet poet(nullptr, nullptr);
+    poet.set_max_lattice_width(kLatticeWidth);
+    auto start_time = std::chrono::steady_clock::now();
+    auto sentence = poet.MakeSentence(graph_, kLength, "");
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    EXPECT_LT(elapsed, std::chrono::seconds(1));
+    ASSERT_TRUE(sentence);
+    EXPECT_EQ(kLength, sentence->size());
+  }
+  registry.Register<NgramGrammarComponent>("grammar");
+  // only the heaviest words at each position are tried
+  EXPECT_EQ(kLatticeWidth, QueryCountingGrammar::words.size());
+  EXPECT_EQ(1u, QueryCountingGrammar::words.count("0,"));
+  EXPECT_EQ(0u, QueryCountingGrammar::words.count(
+                    std::to_string(kLatticeWidth) + ","));
+  // lines are kept by their last word, hence as many lines per position
+  EXPECT_GE(kLength * kLatticeWidth * kLatticeWidth,
+            QueryCountingGrammar::num_queries);
+  EXPECT_LT(0u, QueryCountingGrammar::num_queries);
+}
@@ -53,3 +53,45 @@ TEST(RimeResourceResolverTest, FallbackRootPath) {
   }
   fs::remove_all("fallback");
 }
+
+TEST(RimeResourceResolverTest, PathIndexAgreesWithProbing) {
+  fs::create_directories("index_test/user");
+  fs::create_directories("index_test/shared");
+  for (auto name : {"user_only", "both"}) {
+    std::ofstream(fs::path("index_test/user") / (string("not_") + name +
+                                                 ".minerals"))
+        .close();
+  }
+  for (auto name : {"shared_only", "both"}) {
+    std::ofstream(fs::path("index_test/shared") / (string("not_") + name +
+                                                   ".minerals"))
+        .close();
+  }
+  FallbackResourceResolver probing(kMineralsType);
+  probing.set_root_path("index_test/user");
+  probing.set_fallback_root_path("index_test/shared");
+  ResourcePathIndex index;
+  FallbackResourceResolver indexed(kMineralsType);
+  indexed.set_root_path("index_test/user");
+  indexed.set_fallback_root_path("index_test/shared");
+  indexed.set_path_index(&index);
+  auto expect_agreement = [&] {
+    for (auto id : {"user_only", "shared_only", "both", "neither"}) {
+      EXPECT_TRUE(probing.ResolvePath(id) == indexed.ResolvePath(id)) << id;
+    }
+  };
+  expect_agreement();
+  // shadowing a shared file is seen once the index is rebuilt
+  auto shadow = fs::absolute("index_test/user/not_shared_only.minerals");
+  std::ofstream(shadow.string()).close();
+  index.Invalidate();
+  expect_agreement();
+  EXPECT_TRUE(shadow == indexed.ResolvePath("shared_only"));
+  // a suspended index does not serve stale results
+  index.Suspend();
+  fs::remove(shadow);
+  expect_agreement();
+  index.Resume();
+  expect_agreement();
+  fs::remove_all("index_test");
+}
@@ -0,0 +1,178 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+#include <rime/config.h>
+#include <rime/schema.h>
+#include <rime/task_scheduler.h>
+#include <rime/ticket.h>
+#include <rime/dict/dict_bundle.h>
+#include <rime/dict/reverse_lookup_dictionary.h>
+
+using namespace rime;
+
+static const char* kFileName = "reverse_lookup_dictionary_test.reverse.bin";
+static const char* kBundleFileName =
+    "reverse_lookup_dictionary_test.bundle.bin";
+
+static bool BuildReverseDb(const string& stem) {
+  ReverseDb db(kFileName);
+  db.Remove();
+  Syllabary syllabary = {"ba", "ma"};
+  Vocabulary vocabulary;
+  auto ba = New<ShortDictEntry>();
+  ba->text = "\xe5\x85\xab";  // 八
+  vocabulary[0].entries.push_back(ba);
+  auto ma = New<ShortDictEntry>();
+  ma->text = "\xe9\xa9\xac";  // 马
+  vocabulary[1].entries.push_back(ma);
+  vocabulary[1].entries.push_back(ba);
+  ReverseLookupTable stems;
+  stems[ma->text].insert(stem);
+  return db.Build(nullptr, syllabary, vocabulary, stems, 0) && db.Save();
+}
+
+TEST(RimeReverseLookupDictionaryTest, LookupCodes) {
+  ASSERT_TRUE(BuildReverseDb("m"));
+  auto db = New<ReverseDb>(kFileName);
+  ReverseLookupDictionary dict(db);
+  ASSERT_TRUE(dict.Load());
+
+  vector<string> codes;
+  // repeated lookups are served from cache with the same results
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(dict.ReverseLookup("\xe5\x85\xab", &codes));
+    EXPECT_EQ((vector<string>{"ba", "ma"}), codes);
+    ASSERT_TRUE(dict.LookupStems("\xe9\xa9\xac", &codes));
+    EXPECT_EQ((vector<string>{"m"}), codes);
+    EXPECT_FALSE(dict.LookupStems("\xe5\x85\xab", &codes));
+    EXPECT_TRUE(codes.empty());
+  }
+  string str_list;
+  ASSERT_TRUE(dict.ReverseLookup("\xe9\xa9\xac", &str_list));
+  EXPECT_EQ("ma", str_list);
+
+  // reloading the db drops cached results
+  db->Close();
+  ASSERT_TRUE(BuildReverseDb("mm"));
+  ASSERT_TRUE(db->Load());
+  ASSERT_TRUE(dict.LookupStems("\xe9\xa9\xac", &codes));
+  EXPECT_EQ((vector<string>{"mm"}), codes);
+  db->Close();
+  db->Remove();
+}
+
+TEST(RimeReverseLookupDictionaryTest, SharesCodeLists) {
+  ReverseDb db(kFileName);
+  db.Remove();
+  Syllabary syllabary = {"ba", "ma"};
+  Vocabulary vocabulary;
+  for (const char* text : {"\xe5\x85\xab", "\xe7\x88\xb8"}) {  // 八, 爸
+    auto e = New<ShortDictEntry>();
+    e->text = text;
+    vocabulary[0].entries.push_back(e);
+    vocabulary[1].entries.push_back(e);
+  }
+  ReverseLookupTable stems;
+  stems["\xe9\xa9\xac"].insert("ba");  // 马
+  ASSERT_TRUE(db.Build(nullptr, syllabary, vocabulary, stems, 0));
+  ASSERT_TRUE(db.Save());
+  ASSERT_TRUE(db.Load());
+
+  // {ba, ma} is stored once; the single code of the stem is not pooled
+  auto metadata = db.metadata();
+  EXPECT_EQ(3u, metadata->index.size);
+  EXPECT_EQ(2u, metadata->code_lists.size);
+  vector<string> codes;
+  ASSERT_TRUE(db.LookupCodes("\xe5\x85\xab", &codes));
+  EXPECT_EQ((vector<string>{"ba", "ma"}), codes);
+  ASSERT_TRUE(db.LookupCodes("\xe7\x88\xb8", &codes));
+  EXPECT_EQ((vector<string>{"ba", "ma"}), codes);
+  ASSERT_TRUE(db.LookupCodes("\xe9\xa9\xac\x1fstem", &codes));
+  EXPECT_EQ((vector<string>{"ba"}), codes);
+  db.Close();
+  db.Remove();
+}
+
+// builds a db of many texts having several codes each
+static string BuildLargeReverseDb() {
+  const int kNumSyllables = 64;
+  const int kNumTexts = 2000;
+  ReverseDb db(kFileName);
+  db.Remove();
+  Syllabary syllabary;
+  for (int i = 0; i < kNumSyllables; ++i) {
+    syllabary.insert("s" + std::to_string(100 + i));
+  }
+  Vocabulary vocabulary;
+  for (int k = 0; k < kNumTexts; ++k) {
+    auto e = New<ShortDictEntry>();
+    e->text = "t" + std::to_string(k);
+    for (int j = 0; j < 2 + k % 5; ++j) {
+      vocabulary[(k * 7 + j * 13) % kNumSyllables].entries.push_back(e);
+    }
+  }
+  ReverseLookupTable stems;
+  for (int k = 0; k < kNumTexts; k += 3) {
+    stems["t" + std::to_string(k)] = {"x", "y" + std::to_string(k % 4)};
+  }
+  if (!db.Build(nullptr, syllabary, vocabulary, stems, 0) || !db.Save())
+    return string();
+  std::ifstream in(kFileName, std::ios::binary);
+  return string(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+}
+
+TEST(RimeReverseLookupDictionaryTest, ReproducibleWithAnyNumberOfThreads) {
+  auto& scheduler = TaskScheduler::instance();
+  int saved_max_threads = scheduler.max_threads();
+  scheduler.set_max_threads(1);
+  string serial = BuildLargeReverseDb();
+  scheduler.set_max_threads(4);
+  string parallel = BuildLargeReverseDb();
+  scheduler.set_max_threads(saved_max_threads);
+  std::filesystem::remove(kFileName);
+  ASSERT_FALSE(serial.empty());
+  EXPECT_TRUE(serial == parallel) << "reverse db differs.";
+}
+
+// exposes the db of a dictionary
+struct ReverseLookupDictionaryDb : ReverseLookupDictionary {
+  static an<ReverseDb> Of(ReverseLookupDictionary* dict) {
+    return dict->*(&ReverseLookupDictionaryDb::db_);
+  }
+};
+
+TEST(RimeReverseLookupDictionaryTest, BundledDbIsPooled) {
+  ASSERT_TRUE(BuildReverseDb("m"));
+  ASSERT_TRUE(
+      DictBundle(kBundleFileName).Build({{"reverse", kFileName}}, 0, 0));
+  std::filesystem::remove(kFileName);
+  auto* config = new Config;
+  config->SetString("reverse_lookup/dictionary",
+                    "reverse_lookup_dictionary_test");
+  config->SetBool("reverse_lookup/bundle", true);
+  Schema schema("reverse_lookup_dictionary_test", config);
+  Ticket ticket(&schema, "reverse_lookup");
+  auto* component = ReverseLookupDictionary::Require(
+      "reverse_lookup_dictionary");
+  ASSERT_TRUE(component);
+  the<ReverseLookupDictionary> dict(component->Create(ticket));
+  ASSERT_TRUE(dict);
+  ASSERT_TRUE(dict->Load());
+  vector<string> codes;
+  ASSERT_TRUE(dict->LookupStems("\xe9\xa9\xac", &codes));  // 马
+  EXPECT_EQ((vector<string>{"m"}), codes);
+  // another dictionary shares the db of the bundled section
+  the<ReverseLookupDictionary> another(component->Create(ticket));
+  ASSERT_TRUE(another);
+  EXPECT_EQ(ReverseLookupDictionaryDb::Of(dict.get()),
+            ReverseLookupDictionaryDb::Of(another.get()));
+  dict.reset();
+  another.reset();
+  std::filesystem::remove(kBundleFileName);
+}
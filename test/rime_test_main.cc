@@ -2,7 +2,11 @@
 #include <rime_api.h>
 #include <rime/setup.h>
 
+// for tests running the test binary as a helper process
+const char* rime_test_executable = nullptr;
+
 int main(int argc, char **argv) {
+  rime_test_executable = argv[0];
   testing::InitGoogleTest(&argc, argv);
 
   RIME_STRUCT(RimeTraits, traits);
@@ -0,0 +1,150 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/context.h>
+#include <rime/engine.h>
+#include <rime/menu.h>
+#include <rime/registry.h>
+#include <rime/schema.h>
+#include <rime/segmentor.h>
+
+using namespace rime;
+
+// keeps the default Suspend(), and counts updates of the context
+class UpdateCountingSegmentor : public Segmentor {
+ public:
+  explicit UpdateCountingSegmentor(const Ticket& ticket) : Segmentor(ticket) {
+    engine_->context()->update_notifier().connect(
+        [](Context* ctx) { ++count; });
+  }
+  bool Proceed(Segmentation* segmentation) override { return true; }
+
+  static int count;
+};
+
+int UpdateCountingSegmentor::count = 0;
+
+static const char* kSchemaIds[] = {"schema_pool_test_alpha",
+                                   "schema_pool_test_beta",
+                                   "schema_pool_test_gamma"};
+
+class RimeSchemaPoolTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    for (const char* schema_id : kSchemaIds) {
+      std::ofstream schema(string(schema_id) + ".schema.yaml");
+      bool alpha = schema_id == kSchemaIds[0];
+      schema << "schema:\n"
+                "  schema_id: "
+             << schema_id
+             << "\n"
+                "engine:\n"
+                "  processors:\n"
+                "    - speller\n"
+                "    - "
+             << (alpha ? "express_editor" : "fluid_editor")
+             << "\n"
+                "  segmentors:\n"
+             << (alpha ? "    - schema_pool_test_counter\n" : "")
+             << "    - abc_segmentor\n"
+                "    - fallback_segmentor\n"
+                "  translators:\n"
+                "    - echo_translator\n";
+    }
+    Registry::instance().Register(
+        "schema_pool_test_counter",
+        new Component<UpdateCountingSegmentor>);
+    UpdateCountingSegmentor::count = 0;
+    engine_.reset(Engine::Create());
+    engine_->set_schema_pool_size(1);
+  }
+
+  virtual void TearDown() {
+    engine_.reset();
+    Registry::instance().Unregister("schema_pool_test_counter");
+    for (const char* schema_id : kSchemaIds) {
+      std::filesystem::remove(string(schema_id) + ".schema.yaml");
+    }
+  }
+
+  // marks the current schema object, to tell if it is reused later
+  void MarkSchema() { engine_->schema()->set_select_keys("marked"); }
+  bool IsMarked() const {
+    return engine_->schema()->select_keys() == "marked";
+  }
+
+  void Switch(const char* schema_id) {
+    engine_->ApplySchema(new Schema(schema_id));
+    ASSERT_EQ(schema_id, engine_->schema()->schema_id());
+  }
+
+  the<Engine> engine_;
+};
+
+TEST_F(RimeSchemaPoolTest, SwitchBackToPooledSchema) {
+  Switch(kSchemaIds[0]);
+  MarkSchema();
+  Context* ctx = engine_->context();
+  EXPECT_TRUE(ctx->get_option("_auto_commit"));
+  Switch(kSchemaIds[1]);
+  EXPECT_FALSE(IsMarked());
+  EXPECT_FALSE(ctx->get_option("_auto_commit"));
+  Switch(kSchemaIds[0]);
+  EXPECT_TRUE(IsMarked());
+  // resumed components restore transient options
+  EXPECT_TRUE(ctx->get_option("_auto_commit"));
+  // and keep working
+  ctx->set_input("rime");
+  ASSERT_FALSE(ctx->composition().empty());
+  auto cand = ctx->composition().back().GetSelectedCandidate();
+  ASSERT_TRUE(bool(cand));
+  EXPECT_EQ("rime", cand->text());
+}
+
+TEST_F(RimeSchemaPoolTest, LeastRecentlyUsedSchemaIsEvicted) {
+  Switch(kSchemaIds[0]);
+  MarkSchema();
+  Switch(kSchemaIds[1]);
+  Switch(kSchemaIds[2]);
+  Switch(kSchemaIds[0]);
+  EXPECT_FALSE(IsMarked());
+}
+
+TEST_F(RimeSchemaPoolTest, ReapplyingSchemaReloadsIt) {
+  Switch(kSchemaIds[0]);
+  MarkSchema();
+  Switch(kSchemaIds[0]);
+  EXPECT_FALSE(IsMarked());
+}
+
+TEST_F(RimeSchemaPoolTest, ReleaseSchemaPool) {
+  Switch(kSchemaIds[0]);
+  MarkSchema();
+  Switch(kSchemaIds[1]);
+  engine_->ReleaseSchemaPool();
+  Switch(kSchemaIds[0]);
+  EXPECT_FALSE(IsMarked());
+}
+
+TEST_F(RimeSchemaPoolTest, PooledComponentsAreDetachedFromContext) {
+  Switch(kSchemaIds[0]);
+  MarkSchema();
+  Context* ctx = engine_->context();
+  ctx->set_input("a");
+  EXPECT_LT(0, UpdateCountingSegmentor::count);
+  Switch(kSchemaIds[1]);
+  int count = UpdateCountingSegmentor::count;
+  ctx->set_input("b");
+  EXPECT_EQ(count, UpdateCountingSegmentor::count);
+  // reattached when the pooled components are back to use
+  Switch(kSchemaIds[0]);
+  ASSERT_TRUE(IsMarked());
+  count = UpdateCountingSegmentor::count;
+  ctx->set_input("c");
+  EXPECT_LT(count, UpdateCountingSegmentor::count);
+}
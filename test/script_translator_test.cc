@@ -0,0 +1,167 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime_api.h>
+#include <rime/candidate.h>
+#include <rime/context.h>
+#include <rime/engine.h>
+#include <rime/menu.h>
+#include <rime/schema.h>
+#include <rime/service.h>
+#include <rime/dict/dict_compiler.h>
+#include <rime/dict/dictionary.h>
+
+using namespace rime;
+
+static const char* kDictName = "script_translator_test";
+static const char* kSchemaId = "script_translator_test";
+static const char* kDictFile = "script_translator_test.dict.yaml";
+static const char* kSchemaFile = "script_translator_test.schema.yaml";
+static const char* kCompiledFileSuffixes[] = {
+    ".table.bin",
+    ".prism.bin",
+    ".reverse.bin",
+};
+
+// the longest spelling in the dictionary
+static const size_t kMaxSyllableLength = 5;
+
+class RimeScriptTranslatorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::ofstream dict(kDictFile);
+    dict << "---\n"
+            "name: script_translator_test\n"
+            "version: \"0.1\"\n"
+            "sort: by_weight\n"
+            "...\n"
+            "\xe5\x95\x8a\ta\t10\n"             // 啊
+            "\xe5\xae\x89\tan\t100\n"           // 安
+            "\xe8\x8c\xb6\tcha\t10\n"           // 茶
+            "\xe7\xbc\xa0\tchan\t10\n"          // 缠
+            "\xe9\x95\xbf\tchang\t100\n"        // 长
+            "\xe5\xb8\xb8\tchang\t50\n"         // 常
+            "\xe5\x9c\xba\tchang\t20\n"         // 场
+            "\xe5\xb9\xb2\tgan\t10\n"           // 干
+            "\xe6\xb1\x89\than\t50\n"           // 汉
+            "\xe8\xa1\x8c\thang\t50\n"          // 行
+            "\xe9\x82\xa3\tna\t10\n"            // 那
+            "\xe5\x9b\xbe\ttu\t10\n"            // 图
+            "\xe5\x9b\xa2\ttuan\t50\n"          // 团
+            "\xe9\x95\xbf\xe5\xae\x89\tchang an\t200\n";  // 长安
+    dict.close();
+    Dictionary dictionary(kDictName, {},
+                          {New<Table>(string(kDictName) + ".table.bin")},
+                          New<Prism>(string(kDictName) + ".prism.bin"));
+    DictCompiler compiler(&dictionary);
+    compiler.set_options(DictCompiler::kRebuild);
+    ASSERT_TRUE(compiler.Compile(""));  // no schema file
+  }
+
+  virtual void TearDown() {
+    engine_.reset();
+    std::filesystem::remove(kDictFile);
+    std::filesystem::remove(kSchemaFile);
+    for (const char* suffix : kCompiledFileSuffixes) {
+      std::filesystem::remove(string(kDictName) + suffix);
+    }
+  }
+
+  static void WriteSchemaFile(const string& translator_options) {
+    std::ofstream schema(kSchemaFile);
+    schema << "schema:\n"
+              "  schema_id: script_translator_test\n"
+              "engine:\n"
+              "  segmentors:\n"
+              "    - abc_segmentor\n"
+              "    - fallback_segmentor\n"
+              "  translators:\n"
+              "    - script_translator\n"
+              "translator:\n"
+              "  dictionary: script_translator_test\n"
+           << translator_options;
+  }
+
+  void CreateEngine(const string& translator_options) {
+    WriteSchemaFile(translator_options);
+    engine_.reset(Engine::Create());
+    engine_->ApplySchema(new Schema(kSchemaId));
+  }
+
+  // returns all candidates for the current segment of the context
+  static vector<an<Candidate>> GetCandidates(Context* ctx) {
+    vector<an<Candidate>> candidates;
+    if (ctx->composition().empty())
+      return candidates;
+    auto menu = ctx->composition().back().menu;
+    if (!menu)
+      return candidates;
+    menu->Prepare(1000);
+    for (size_t i = 0; i < menu->candidate_count(); ++i) {
+      candidates.push_back(menu->GetCandidateAt(i));
+    }
+    return candidates;
+  }
+
+  the<Engine> engine_;
+};
+
+TEST_F(RimeScriptTranslatorTest, Translate) {
+  CreateEngine("");
+  Context* ctx = engine_->context();
+  ctx->set_input("changan");
+  auto candidates = GetCandidates(ctx);
+  ASSERT_LT(3, candidates.size());
+  EXPECT_EQ("\xe9\x95\xbf\xe5\xae\x89", candidates[0]->text());  // 长安
+  EXPECT_EQ(7, candidates[0]->end());
+}
+
+TEST_F(RimeScriptTranslatorTest, MaxCandidates) {
+  CreateEngine("  max_candidates: 3\n");
+  Context* ctx = engine_->context();
+  ctx->set_input("changan");
+  auto candidates = GetCandidates(ctx);
+  ASSERT_EQ(3, candidates.size());
+  EXPECT_EQ("\xe9\x95\xbf\xe5\xae\x89", candidates[0]->text());  // 长安
+}
+
+TEST_F(RimeScriptTranslatorTest, BoundedLongInput) {
+  const size_t kMaxVertices = 64;
+  const size_t kMaxCandidates = 20;
+  WriteSchemaFile("  max_syllable_graph_vertices: 64\n"
+                  "  max_lattice_width: 4\n"
+                  "  max_candidates: 20\n");
+  string input;
+  while (input.length() < 8192) {
+    input += "changanhangtuanana";
+  }
+  Service& service = Service::shared_instance();
+  service.StartService();
+  SessionId session_id = service.CreateSession();
+  ASSERT_NE(kInvalidSessionId, session_id);
+  ASSERT_TRUE(RimeSelectSchema(session_id, kSchemaId));
+  auto start_time = std::chrono::steady_clock::now();
+  ASSERT_TRUE(RimeSetInput(session_id, input.c_str()));
+  Context* ctx = service.GetSession(session_id)->context();
+  ASSERT_TRUE(ctx);
+  EXPECT_EQ(input, ctx->input());
+  auto candidates = GetCandidates(ctx);
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  EXPECT_LT(elapsed, std::chrono::seconds(2));
+  ASSERT_FALSE(candidates.empty());
+  EXPECT_GE(kMaxCandidates, candidates.size());
+  // candidates cover at most the window of the syllable graph
+  for (const auto& cand : candidates) {
+    EXPECT_EQ(0, cand->start());
+    EXPECT_GE(kMaxVertices * kMaxSyllableLength, cand->end());
+  }
+  // the sentence is made of the heaviest words within the window
+  EXPECT_EQ("sentence", candidates[0]->type());
+  EXPECT_LT(kMaxVertices, candidates[0]->end());
+  service.DestroySession(session_id);
+}
@@ -0,0 +1,147 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/context.h>
+#include <rime/menu.h>
+#include <rime/schema.h>
+#include <rime/service.h>
+
+using namespace rime;
+
+static const char* kSchemaFile = "session_hibernation_test.schema.yaml";
+
+// everything a client can observe of the session
+static string DescribeSession(Session& session) {
+  std::ostringstream out;
+  Context* ctx = session.context();
+  if (!ctx)
+    return "(hibernated)";
+  out << "schema: " << session.schema()->schema_id() << "\n";
+  out << "input: " << ctx->input() << " caret: " << ctx->caret_pos() << "\n";
+  auto preedit = ctx->GetPreedit();
+  out << "preedit: " << preedit.text << " [" << preedit.sel_start << ", "
+      << preedit.sel_end << ") caret: " << preedit.caret_pos << "\n";
+  for (const auto& segment : ctx->composition()) {
+    out << "segment: [" << segment.start << ", " << segment.end
+        << ") status: " << segment.status
+        << " selected: " << segment.selected_index << "\n";
+    if (segment.menu) {
+      segment.menu->Prepare(10);
+      for (size_t i = 0; i < segment.menu->candidate_count(); ++i) {
+        auto cand = segment.menu->GetCandidateAt(i);
+        out << "  candidate: " << cand->text() << " " << cand->comment()
+            << "\n";
+      }
+    }
+  }
+  for (const auto& option : ctx->options()) {
+    out << "option: " << option.first << " = " << option.second << "\n";
+  }
+  for (const auto& property : ctx->properties()) {
+    out << "property: " << property.first << " = " << property.second << "\n";
+  }
+  out << "history: " << ctx->commit_history().repr() << "\n";
+  out << "commit text: " << session.commit_text() << "\n";
+  return out.str();
+}
+
+class RimeSessionHibernationTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::ofstream schema(kSchemaFile);
+    schema << "schema:\n"
+              "  schema_id: session_hibernation_test\n"
+              "  name: Session Hibernation Test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - speller\n"
+              "    - selector\n"
+              "    - express_editor\n"
+              "  segmentors:\n"
+              "    - abc_segmentor\n"
+              "    - fallback_segmentor\n"
+              "  translators:\n"
+              "    - echo_translator\n";
+    schema.close();
+    session_.reset(new Session);
+    session_->ApplySchema(new Schema("session_hibernation_test"));
+  }
+
+  virtual void TearDown() {
+    session_.reset();
+    std::filesystem::remove(kSchemaFile);
+  }
+
+  void ExpectSameAfterRevival() {
+    string before = DescribeSession(*session_);
+    ASSERT_TRUE(session_->Hibernate());
+    EXPECT_TRUE(session_->hibernated());
+    EXPECT_EQ(nullptr, session_->context());
+    ASSERT_TRUE(session_->Revive());
+    EXPECT_FALSE(session_->hibernated());
+    EXPECT_EQ(before, DescribeSession(*session_));
+  }
+
+  the<Session> session_;
+};
+
+TEST_F(RimeSessionHibernationTest, IdleSession) {
+  ExpectSameAfterRevival();
+}
+
+TEST_F(RimeSessionHibernationTest, OptionsPropertiesAndHistory) {
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  ctx->set_option("full_shape", true);
+  ctx->set_option("ascii_punct", false);
+  ctx->set_property("client_app", "test");
+  ctx->commit_history().Push(CommitRecord("raw", "hello"));
+  ctx->commit_history().Push(CommitRecord("thru", " "));
+  ExpectSameAfterRevival();
+}
+
+TEST_F(RimeSessionHibernationTest, SelectedSegments) {
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  ctx->set_input("nihao");
+  ASSERT_TRUE(ctx->Select(0));
+  ExpectSameAfterRevival();
+}
+
+TEST_F(RimeSessionHibernationTest, CaretInsideInput) {
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  ctx->set_input("rime");
+  ctx->set_caret_pos(2);
+  ExpectSameAfterRevival();
+  EXPECT_EQ(2, session_->context()->caret_pos());
+}
+
+TEST_F(RimeSessionHibernationTest, SessionInUseIsNotHibernated) {
+  Service& service = Service::shared_instance();
+  service.StartService();
+  int threshold = service.hibernation_threshold();
+  service.set_hibernation_threshold(1);
+  SessionId idle_id = service.CreateSession();
+  SessionId busy_id = service.CreateSession();
+  ASSERT_NE(kInvalidSessionId, idle_id);
+  ASSERT_NE(kInvalidSessionId, busy_id);
+  // kept alive by the service
+  Session* idle = service.GetSession(idle_id).get();
+  // as if a client thread were processing a key
+  an<Session> busy = service.GetSession(busy_id);
+  // as if both sessions had been idle for a while
+  service.HibernateIdleSessions(time(NULL) + 2);
+  EXPECT_TRUE(idle->hibernated());
+  EXPECT_FALSE(busy->hibernated());
+  busy.reset();
+  service.DestroySession(idle_id);
+  service.DestroySession(busy_id);
+  service.set_hibernation_threshold(threshold);
+}
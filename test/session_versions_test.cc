@@ -0,0 +1,152 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/context.h>
+#include <rime/key_event.h>
+#include <rime/menu.h>
+#include <rime/schema.h>
+#include <rime/service.h>
+#include <rime/translation.h>
+
+using namespace rime;
+
+static const char* kSchemaFile = "session_versions_test.schema.yaml";
+
+class RimeSessionVersionsTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::ofstream schema(kSchemaFile);
+    schema << "schema:\n"
+              "  schema_id: session_versions_test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - speller\n"
+              "    - express_editor\n"
+              "  segmentors:\n"
+              "    - abc_segmentor\n"
+              "    - fallback_segmentor\n"
+              "  translators:\n"
+              "    - echo_translator\n";
+    schema.close();
+    session_.reset(new Session);
+    session_->ApplySchema(new Schema("session_versions_test"));
+  }
+
+  virtual void TearDown() {
+    session_.reset();
+    std::filesystem::remove(kSchemaFile);
+  }
+
+  the<Session> session_;
+};
+
+TEST_F(RimeSessionVersionsTest, UnchangedState) {
+  SessionVersions before = session_->UpdateVersions();
+  SessionVersions after = session_->UpdateVersions();
+  EXPECT_EQ(before.composition, after.composition);
+  EXPECT_EQ(before.menu, after.menu);
+  EXPECT_EQ(before.highlight, after.highlight);
+  EXPECT_EQ(before.status, after.status);
+  EXPECT_EQ(before.commit, after.commit);
+}
+
+TEST_F(RimeSessionVersionsTest, ComposingAndCommitting) {
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  SessionVersions idle = session_->UpdateVersions();
+  ctx->set_input("rime");
+  SessionVersions composing = session_->UpdateVersions();
+  EXPECT_LT(idle.composition, composing.composition);
+  EXPECT_LT(idle.menu, composing.menu);
+  // is_composing is part of the status
+  EXPECT_LT(idle.status, composing.status);
+  EXPECT_EQ(idle.commit, composing.commit);
+  // the caret moves within the same page of candidates
+  ctx->set_caret_pos(2);
+  SessionVersions caret_moved = session_->UpdateVersions();
+  EXPECT_LT(composing.composition, caret_moved.composition);
+  EXPECT_EQ(composing.status, caret_moved.status);
+  ctx->set_caret_pos(4);
+  ctx->Commit();
+  SessionVersions committed = session_->UpdateVersions();
+  EXPECT_LT(caret_moved.commit, committed.commit);
+  EXPECT_LT(caret_moved.composition, committed.composition);
+  EXPECT_EQ("rime", session_->commit_text());
+}
+
+TEST_F(RimeSessionVersionsTest, OptionsChangeStatusOnly) {
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  SessionVersions before = session_->UpdateVersions();
+  ctx->set_option("ascii_mode", true);
+  SessionVersions after = session_->UpdateVersions();
+  EXPECT_LT(before.status, after.status);
+  EXPECT_EQ(before.composition, after.composition);
+  EXPECT_EQ(before.menu, after.menu);
+}
+
+TEST_F(RimeSessionVersionsTest, HighlightAndPaging) {
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  ctx->set_input("rime");
+  ASSERT_FALSE(ctx->composition().empty());
+  auto translation = New<FifoTranslation>();
+  for (int i = 0; i < 10; ++i) {
+    translation->Append(
+        New<SimpleCandidate>("test", 0, 4, "rime" + std::to_string(i)));
+  }
+  Segment& seg(ctx->composition().back());
+  seg.menu = New<Menu>();
+  seg.menu->AddTranslation(translation);
+  seg.menu->Prepare(10);
+  seg.selected_index = 0;
+  SessionVersions first_page = session_->UpdateVersions();
+  // within the first page of 5 candidates
+  ASSERT_TRUE(ctx->Highlight(1));
+  SessionVersions highlighted = session_->UpdateVersions();
+  EXPECT_LT(first_page.highlight, highlighted.highlight);
+  EXPECT_EQ(first_page.menu, highlighted.menu);
+  EXPECT_EQ(first_page.composition, highlighted.composition);
+  // on to the second page
+  ASSERT_TRUE(ctx->Highlight(6));
+  SessionVersions second_page = session_->UpdateVersions();
+  EXPECT_LT(highlighted.menu, second_page.menu);
+  EXPECT_EQ(highlighted.composition, second_page.composition);
+}
+
+TEST_F(RimeSessionVersionsTest, AlternatingPunctuation) {
+  const char* schema_file = "session_versions_punct_test.schema.yaml";
+  {
+    std::ofstream schema(schema_file);
+    schema << "schema:\n"
+              "  schema_id: session_versions_punct_test\n"
+              "engine:\n"
+              "  processors:\n"
+              "    - punctuator\n"
+              "  segmentors:\n"
+              "    - punct_segmentor\n"
+              "  translators:\n"
+              "    - punct_translator\n"
+              "punctuator:\n"
+              "  half_shape:\n"
+              "    ',': [A, B]\n";
+  }
+  session_->ApplySchema(new Schema("session_versions_punct_test"));
+  Context* ctx = session_->context();
+  ASSERT_TRUE(ctx);
+  ASSERT_TRUE(session_->ProcessKey(KeyEvent(',', 0)));
+  ASSERT_TRUE(ctx->HasMenu());
+  EXPECT_EQ(0, ctx->composition().back().selected_index);
+  SessionVersions first = session_->UpdateVersions();
+  // pressing the key again highlights the next alternative
+  ASSERT_TRUE(session_->ProcessKey(KeyEvent(',', 0)));
+  EXPECT_EQ(1, ctx->composition().back().selected_index);
+  SessionVersions second = session_->UpdateVersions();
+  EXPECT_LT(first.highlight, second.highlight);
+  std::filesystem::remove(schema_file);
+}
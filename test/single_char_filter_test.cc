@@ -0,0 +1,73 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/filter.h>
+#include <rime/ticket.h>
+#include <rime/translation.h>
+#include <rime/gear/translator_commons.h>
+
+using namespace rime;
+
+// counts candidates pulled from the wrapped translation
+class CountingTranslation : public FifoTranslation {
+ public:
+  bool Next() override {
+    ++pulled;
+    return FifoTranslation::Next();
+  }
+  size_t pulled = 0;
+};
+
+static an<Candidate> MakePhrase(const string& type, const string& text) {
+  auto entry = New<DictEntry>();
+  entry->text = text;
+  return New<Phrase>(nullptr, type, 0, 1, entry);
+}
+
+static an<Translation> ApplyFilter(an<Translation> translation) {
+  auto component = Filter::Require("single_char_filter");
+  EXPECT_TRUE(component != NULL);
+  the<Filter> filter(component->Create(Ticket()));
+  return filter->Apply(translation, nullptr);
+}
+
+static vector<string> Drain(an<Translation> translation) {
+  vector<string> texts;
+  while (!translation->exhausted()) {
+    texts.push_back(translation->Peek()->text());
+    translation->Next();
+  }
+  return texts;
+}
+
+TEST(RimeSingleCharFilterTest, SingleCharsFirst) {
+  auto translation = New<FifoTranslation>();
+  translation->Append(MakePhrase("table", "ab"));
+  translation->Append(MakePhrase("table", "a"));
+  translation->Append(MakePhrase("user_table", "cd"));
+  translation->Append(MakePhrase("user_table", "b"));
+  translation->Append(MakePhrase("completion", "abc"));
+  translation->Append(MakePhrase("table", "c"));
+  EXPECT_EQ((vector<string>{"a", "b", "ab", "cd", "abc", "c"}),
+            Drain(ApplyFilter(translation)));
+}
+
+TEST(RimeSingleCharFilterTest, FirstCandidateDoesNotDrainTranslation) {
+  auto translation = New<CountingTranslation>();
+  translation->Append(MakePhrase("table", "ab"));
+  translation->Append(MakePhrase("table", "a"));
+  for (int i = 0; i < 10000; ++i) {
+    translation->Append(MakePhrase("table", "xy"));
+  }
+  auto filtered = ApplyFilter(translation);
+  ASSERT_FALSE(filtered->exhausted());
+  EXPECT_EQ("a", filtered->Peek()->text());
+  EXPECT_EQ(2u, translation->pulled);
+  filtered->Next();
+  EXPECT_EQ("ab", filtered->Peek()->text());
+  EXPECT_LT(translation->pulled, 1000u);
+  EXPECT_EQ(10002u, Drain(filtered).size() + 1);
+}
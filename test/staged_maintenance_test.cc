@@ -0,0 +1,240 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+#include <rime/candidate.h>
+#include <rime/config.h>
+#include <rime/context.h>
+#include <rime/deployer.h>
+#include <rime/key_event.h>
+#include <rime/registry.h>
+#include <rime/schema.h>
+#include <rime/service.h>
+#include <rime/setup.h>
+#include <rime/task_scheduler.h>
+#include <rime/config/config_component.h>
+#include <rime/dict/dictionary.h>
+
+using namespace rime;
+
+namespace fs = std::filesystem;
+
+static const char* kSchemaId = "staged_maintenance_test";
+static const char* kSchemaFile = "staged_maintenance_test.schema.yaml";
+static const char* kDictFile = "staged_maintenance_test.dict.yaml";
+static const char* kDefaultFile = "default.yaml";
+static const char* kUserFile = "user.yaml";
+static const char* kStagingDir = "staged_maintenance_test_build";
+
+static void WriteSchemaFile(const string& version,
+                            bool with_dictionary = false) {
+  std::ofstream schema(kSchemaFile);
+  schema << "schema:\n"
+            "  schema_id: staged_maintenance_test\n"
+            "  version: \""
+         << version
+         << "\"\n"
+            "engine:\n"
+            "  processors:\n"
+            "    - speller\n"
+            "    - express_editor\n"
+            "  segmentors:\n"
+            "    - abc_segmentor\n"
+            "  translators:\n"
+         << (with_dictionary ? "    - table_translator\n"
+                               "translator:\n"
+                               "  dictionary: staged_maintenance_test\n"
+                             : "    - echo_translator\n");
+}
+
+static void WriteDictFile(const string& version, const string& text) {
+  std::ofstream dict(kDictFile);
+  dict << "---\n"
+          "name: staged_maintenance_test\n"
+          "version: \""
+       << version
+       << "\"\n"
+          "...\n"
+       << text << "\tni\n";
+}
+
+static string ReadFile(const fs::path& file_path) {
+  std::ifstream in(file_path.string());
+  return string(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+}
+
+class RimeStagedMaintenanceTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    LoadModules(kDeployerModules);
+    had_user_file_ = fs::exists(kUserFile);
+    std::ofstream config(kDefaultFile);
+    config << "schema_list:\n"
+              "  - schema: staged_maintenance_test\n";
+    config.close();
+    WriteSchemaFile("1.0");
+    auto& deployer = Service::instance().deployer();
+    saved_staging_dir_ = deployer.staging_dir;
+    deployer.staging_dir = kStagingDir;
+    // the components resolve files in the staging dir they are created with
+    Registry::instance().Register<DictionaryComponent>("dictionary");
+    RegisterConfigComponent();
+    auto& scheduler = TaskScheduler::instance();
+    saved_max_threads_ = scheduler.max_threads();
+    scheduler.set_max_threads(2);
+    Service::instance().StartService();
+  }
+
+  virtual void TearDown() {
+    Service::instance().StopService();
+    TaskScheduler::instance().set_max_threads(saved_max_threads_);
+    Service::instance().deployer().staging_dir = saved_staging_dir_;
+    Registry::instance().Register<DictionaryComponent>("dictionary");
+    RegisterConfigComponent();
+    fs::remove(kDefaultFile);
+    fs::remove(kSchemaFile);
+    fs::remove(kDictFile);
+    if (!had_user_file_)
+      fs::remove(kUserFile);
+    fs::remove_all(kStagingDir);
+  }
+
+  static void RegisterConfigComponent() {
+    Registry::instance()
+        .Register<ConfigComponent<ConfigLoader, DeployedConfigResourceProvider>>(
+            "config");
+  }
+
+  // applies a schema that does not depend on deployed data
+  static bool ApplyTestSchema(Session* session) {
+    the<Config> config(new Config);
+    if (!config->LoadFromFile(kSchemaFile))
+      return false;
+    session->ApplySchema(new Schema(kSchemaId, config.release()));
+    return true;
+  }
+
+  // the text of the first candidate for the input
+  static string Translate(Session* session, const string& input) {
+    Context* ctx = session->context();
+    ctx->set_input(input);
+    auto cand = ctx->GetSelectedCandidate();
+    string text = cand ? cand->text() : string();
+    ctx->Clear();
+    return text;
+  }
+
+  string saved_staging_dir_;
+  int saved_max_threads_ = 0;
+  bool had_user_file_ = false;
+};
+
+TEST_F(RimeStagedMaintenanceTest, ServesSessionsDuringWorkspaceUpdate) {
+  auto& service = Service::instance();
+  auto& deployer = service.deployer();
+  if (!DeploymentTask::Require("workspace_update")) {
+    GTEST_SKIP() << "deployment tasks are not available.";
+  }
+  ASSERT_TRUE(deployer.RunTask("workspace_update"));
+  const fs::path compiled_schema = fs::path(kStagingDir) / kSchemaFile;
+  ASSERT_NE(string::npos, ReadFile(compiled_schema).find("1.0"));
+
+  SessionId existing_id = service.CreateSession();
+  ASSERT_NE(kInvalidSessionId, existing_id);
+  ASSERT_TRUE(ApplyTestSchema(service.GetSession(existing_id).get()));
+
+  WriteSchemaFile("2.0");
+  // make sure the change is noticed within the same second
+  fs::last_write_time(kSchemaFile,
+                      fs::last_write_time(kSchemaFile) + std::chrono::hours(1));
+  deployer.ScheduleTask("workspace_update");
+  ASSERT_TRUE(deployer.StartStagedMaintenance());
+
+  const KeyEvent key('a', 0);
+  int calls = 0;
+  int failures = 0;
+  do {
+    ++calls;
+    SessionId session_id = service.CreateSession();
+    auto session = service.GetSession(session_id);
+    if (!session || !ApplyTestSchema(session.get()) ||
+        !session->ProcessKey(key)) {
+      ++failures;
+    }
+    service.DestroySession(session_id);
+    auto existing = service.GetSession(existing_id);
+    if (!existing || !existing->ProcessKey(key)) {
+      ++failures;
+    }
+  } while (deployer.IsMaintenanceMode() || calls < 100);
+  deployer.JoinMaintenanceThread();
+
+  EXPECT_EQ(0, failures) << "in " << calls << " calls";
+  EXPECT_NE(string::npos, ReadFile(compiled_schema).find("2.0"));
+  EXPECT_FALSE(fs::exists(string(kStagingDir) + ".next"));
+  EXPECT_FALSE(fs::exists(string(kStagingDir) + ".old"));
+}
+
+TEST_F(RimeStagedMaintenanceTest, NewSessionsLoadActivatedGeneration) {
+  auto& service = Service::instance();
+  auto& deployer = service.deployer();
+  if (!DeploymentTask::Require("workspace_update")) {
+    GTEST_SKIP() << "deployment tasks are not available.";
+  }
+  WriteSchemaFile("1.0", true);
+  WriteDictFile("1.0", "\xe4\xbd\xa0");  // 你
+  ASSERT_TRUE(deployer.RunTask("workspace_update"));
+
+  // keeps the dictionary of the first generation loaded
+  SessionId existing_id = service.CreateSession();
+  auto existing = service.GetSession(existing_id);
+  ASSERT_TRUE(existing && ApplyTestSchema(existing.get()));
+  EXPECT_EQ("\xe4\xbd\xa0", Translate(existing.get(), "ni"));
+
+  WriteDictFile("2.0", "\xe6\xb3\xa5");  // 泥
+  deployer.ScheduleTask("workspace_update");
+  ASSERT_TRUE(deployer.StartStagedMaintenance());
+  deployer.JoinMaintenanceThread();
+
+  SessionId session_id = service.CreateSession();
+  auto session = service.GetSession(session_id);
+  ASSERT_TRUE(session && ApplyTestSchema(session.get()));
+  EXPECT_EQ("\xe6\xb3\xa5", Translate(session.get(), "ni"));
+  // the existing session keeps using the files it has loaded
+  EXPECT_EQ("\xe4\xbd\xa0", Translate(existing.get(), "ni"));
+  service.DestroySession(session_id);
+  service.DestroySession(existing_id);
+}
+
+TEST_F(RimeStagedMaintenanceTest, ConfigsReloadAfterActivation) {
+  auto& deployer = Service::instance().deployer();
+  if (!DeploymentTask::Require("workspace_update")) {
+    GTEST_SKIP() << "deployment tasks are not available.";
+  }
+  ASSERT_TRUE(deployer.RunTask("workspace_update"));
+  const string config_id = string(kSchemaId) + ".schema";
+  the<Config> existing(Config::Require("config")->Create(config_id));
+  string version;
+  ASSERT_TRUE(existing->GetString("schema/version", &version));
+  EXPECT_EQ("1.0", version);
+
+  WriteSchemaFile("2.0");
+  fs::last_write_time(kSchemaFile,
+                      fs::last_write_time(kSchemaFile) + std::chrono::hours(1));
+  deployer.ScheduleTask("workspace_update");
+  ASSERT_TRUE(deployer.StartStagedMaintenance());
+  deployer.JoinMaintenanceThread();
+
+  // the cached config of the previous generation is not handed out again
+  the<Config> config(Config::Require("config")->Create(config_id));
+  ASSERT_TRUE(config->GetString("schema/version", &version));
+  EXPECT_EQ("2.0", version);
+  ASSERT_TRUE(existing->GetString("schema/version", &version));
+  EXPECT_EQ("1.0", version);
+}
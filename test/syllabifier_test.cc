@@ -5,6 +5,7 @@
 // 2011-07-05 GONG Chen <chen.sst@gmail.com>
 //
 #include <algorithm>
+#include <chrono>
 #include <utility>
 #include <gtest/gtest.h>
 #include <rime/dict/prism.h>
@@ -12,6 +13,19 @@
 
 class RimeSyllabifierTest : public ::testing::Test {
  public:
+  // the number of edges when the last vertex of the graph was visited
+  static size_t CountEdgesBeforeLastVertex(const rime::SyllableGraph& g) {
+    size_t num_edges = 0;
+    for (const auto& x : g.edges) {
+      if (!g.vertices.empty() && x.first == g.vertices.rbegin()->first)
+        continue;
+      for (const auto& y : x.second) {
+        num_edges += y.second.size();
+      }
+    }
+    return num_edges;
+  }
+
   virtual void SetUp() {
     rime::vector<rime::string> syllables;
     syllables.push_back("a");      // 0 == id
@@ -160,3 +174,56 @@ TEST_F(RimeSyllabifierTest, TransposedSyllableGraph) {
   ASSERT_FALSE(NULL == g.indices[0][syllable_id_["chan"]][0]);
   EXPECT_EQ(4, g.indices[0][syllable_id_["chan"]][0]->end_pos);
 }
+
+TEST_F(RimeSyllabifierTest, BoundedGraphForLongInput) {
+  const size_t kMaxVertices = 256;
+  const size_t kMaxEdges = 1024;
+  rime::string input;
+  while (input.length() < 8192) {
+    input += "changanhangtuanana";
+  }
+  rime::Syllabifier s;
+  s.SetLimits(kMaxVertices, kMaxEdges);
+  rime::SyllableGraph g;
+  auto start_time = std::chrono::steady_clock::now();
+  int consumed = s.BuildSyllableGraph(input, *prism_, &g);
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  EXPECT_LT(elapsed, std::chrono::seconds(1));
+  EXPECT_EQ(input.length(), g.input_length);
+  EXPECT_EQ(consumed, g.interpreted_length);
+  EXPECT_LT(0, g.interpreted_length);
+  EXPECT_GT(input.length(), g.interpreted_length);
+  EXPECT_GE(kMaxVertices, g.vertices.size());
+  for (const auto& x : g.edges) {
+    for (const auto& y : x.second) {
+      // the window ends at the last vertex
+      EXPECT_GE(g.interpreted_length, y.first);
+    }
+  }
+  // the last vertex is admitted within limits, then adds its edges
+  EXPECT_GT(kMaxEdges, CountEdgesBeforeLastVertex(g));
+  // the interpreted part is the same as without limits
+  rime::Syllabifier unbounded;
+  rime::SyllableGraph full;
+  unbounded.BuildSyllableGraph(input.substr(0, g.interpreted_length), *prism_,
+                               &full);
+  EXPECT_EQ(g.interpreted_length, full.interpreted_length);
+  EXPECT_EQ(full.vertices.size(), g.vertices.size());
+}
+
+TEST_F(RimeSyllabifierTest, GraphBoundedByEdges) {
+  const size_t kMaxEdges = 64;
+  rime::string input;
+  while (input.length() < 8192) {
+    input += "changanhangtuanana";
+  }
+  rime::Syllabifier s;
+  s.SetLimits(0, kMaxEdges);
+  rime::SyllableGraph g;
+  auto start_time = std::chrono::steady_clock::now();
+  s.BuildSyllableGraph(input, *prism_, &g);
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  EXPECT_LT(elapsed, std::chrono::seconds(1));
+  EXPECT_GT(input.length(), g.interpreted_length);
+  EXPECT_GT(kMaxEdges, CountEdgesBeforeLastVertex(g));
+}
@@ -4,6 +4,7 @@
 //
 // 2011-07-03 GONG Chen <chen.sst@gmail.com>
 //
+#include <filesystem>
 #include <gtest/gtest.h>
 #include <rime/algo/syllabifier.h>
 #include <rime/dict/table.h>
@@ -207,4 +208,129 @@ TEST_F(RimeTableTest, QueryWithSyllableGraph) {
   EXPECT_TRUE(result[4].front().Next());
   EXPECT_STREQ("lia", Text(result[4].front()).c_str());
   EXPECT_FALSE(result[4].front().Next());
+
+  // an alternative path to yi-er: [0, 3), [3, 4)
+  g.vertices[3] = rime::kNormalSpelling;
+  g.edges[0][3][1].type = rime::kNormalSpelling;
+  g.edges[0][3][1].end_pos = 3;
+  g.edges[3][4][2].type = rime::kNormalSpelling;
+  g.edges[3][4][2].end_pos = 4;
+  g.indices[0][1].push_back(&g.edges[0][3][1]);
+  g.indices[3][2].push_back(&g.edges[3][4][2]);
+
+  ASSERT_TRUE(table_->Query(g, 0, &result));
+  ASSERT_TRUE(result.find(7) != result.end());
+  EXPECT_EQ(4, result[7].size());
+  // a frontier of 1 leaves no room for the alternative path
+  ASSERT_TRUE(table_->Query(g, 0, &result, 1));
+  ASSERT_TRUE(result.find(3) != result.end());
+  EXPECT_STREQ("yi", Text(result[3].front()).c_str());
+  ASSERT_TRUE(result.find(7) != result.end());
+  EXPECT_EQ(2, result[7].size());
+}
+
+TEST_F(RimeTableTest, PartitionedTable) {
+  const char kPartitionedFileName[] = "table_test.partitioned.bin";
+  rime::Table partitioned(kPartitionedFileName);
+  partitioned.Remove();
+  rime::Syllabary syll;
+  rime::Vocabulary voc;
+  PrepareSampleVocabulary(syll, voc);
+  ASSERT_TRUE(partitioned.Build(syll, voc, total_num_entries, 0, 3));
+  ASSERT_TRUE(partitioned.Save());
+  ASSERT_TRUE(partitioned.Load());
+  EXPECT_EQ(3, partitioned.num_partitions());
+  EXPECT_EQ(0, partitioned.num_mapped_partitions());
+
+  // same results as the monolithic table
+  for (rime::SyllableId id = 0; id < 5; ++id) {
+    rime::TableAccessor expected = table_->QueryWords(id);
+    rime::TableAccessor actual = partitioned.QueryWords(id);
+    ASSERT_EQ(expected.remaining(), actual.remaining());
+    for (; !expected.exhausted(); expected.Next(), actual.Next()) {
+      EXPECT_EQ(Text(expected), partitioned.GetEntryText(*actual.entry()));
+      EXPECT_EQ(expected.entry()->weight, actual.entry()->weight);
+    }
+  }
+  rime::Code code;
+  for (rime::SyllableId id = 1; id <= 4; ++id)
+    code.push_back(id);
+  {
+    rime::TableAccessor v = partitioned.QueryPhrases(code);
+    ASSERT_EQ(2, v.remaining());
+    EXPECT_EQ("yi-er-san-si", partitioned.GetEntryText(*v.entry()));
+    ASSERT_TRUE(v.Next());
+    EXPECT_EQ("yi-er-san-er-yi", partitioned.GetEntryText(*v.entry()));
+    ASSERT_EQ(2, v.extra_code()->size);
+    EXPECT_EQ(1, v.extra_code()->at[1]);
+  }
+
+  // partitions are unmapped once released, as soon as the budget is exceeded
+  partitioned.set_partition_budget(1);
+  {
+    rime::TableAccessor a = partitioned.QueryWords(1);
+    rime::TableAccessor b = partitioned.QueryWords(4);
+    EXPECT_EQ(2, partitioned.num_mapped_partitions());
+    EXPECT_EQ("yi", partitioned.GetEntryText(*a.entry()));
+  }
+  EXPECT_EQ(1, partitioned.num_mapped_partitions());
+
+  // a table shared by dictionaries keeps the largest budget asked for
+  rime::Table shared(kPartitionedFileName);
+  ASSERT_TRUE(shared.Load());
+  shared.RequestPartitionBudget(8 << 20);
+  EXPECT_EQ(8 << 20, shared.partition_budget());
+  shared.RequestPartitionBudget(1 << 20);
+  EXPECT_EQ(8 << 20, shared.partition_budget());
+  shared.RequestPartitionBudget(16 << 20);
+  EXPECT_EQ(16 << 20, shared.partition_budget());
+  // no limit is the largest of all
+  shared.RequestPartitionBudget(0);
+  EXPECT_EQ(0, shared.partition_budget());
+  shared.RequestPartitionBudget(1 << 20);
+  EXPECT_EQ(0, shared.partition_budget());
+  shared.Close();
+  partitioned.Close();
+  ASSERT_TRUE(partitioned.Remove());
+  EXPECT_FALSE(partitioned.Exists());
+}
+
+TEST_F(RimeTableTest, PartitionsOutliveRebuild) {
+  const char kPartitionedFileName[] = "table_test.rebuilt.bin";
+  rime::Syllabary syll;
+  rime::Vocabulary voc;
+  PrepareSampleVocabulary(syll, voc);
+  {
+    rime::Table table(kPartitionedFileName);
+    table.Remove();
+    ASSERT_TRUE(table.Build(syll, voc, total_num_entries, 0, 3));
+    ASSERT_TRUE(table.Save());
+  }
+  rime::Table loaded(kPartitionedFileName);
+  ASSERT_TRUE(loaded.Load());
+  EXPECT_EQ(0, loaded.num_mapped_partitions());
+
+  // a later deployment builds the table again in place
+  rime::Table rebuilt(kPartitionedFileName);
+  rebuilt.Remove();
+  ASSERT_TRUE(rebuilt.Build(syll, voc, total_num_entries, 1, 3));
+  ASSERT_TRUE(rebuilt.Save());
+  // the loaded table maps the partitions it has validated
+  {
+    rime::TableAccessor a = loaded.QueryWords(1);
+    ASSERT_FALSE(a.exhausted());
+    EXPECT_EQ("yi", loaded.GetEntryText(*a.entry()));
+  }
+  loaded.Close();
+
+  // a table missing any of its partitions fails to load
+  const auto missing = rebuilt.partition_file_name(1);
+  ASSERT_TRUE(std::filesystem::remove(missing));
+  rime::Table broken(kPartitionedFileName);
+  EXPECT_FALSE(broken.Load());
+  // and the partitions after the missing one are removed with it
+  ASSERT_TRUE(broken.Remove());
+  EXPECT_FALSE(std::filesystem::exists(rebuilt.partition_file_name(0)));
+  EXPECT_FALSE(std::filesystem::exists(rebuilt.partition_file_name(2)));
+  EXPECT_FALSE(broken.Exists());
 }
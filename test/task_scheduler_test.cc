@@ -0,0 +1,147 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <gtest/gtest.h>
+#include <rime/task_scheduler.h>
+
+using namespace rime;
+
+class RimeTaskSchedulerTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    saved_max_threads_ = TaskScheduler::instance().max_threads();
+  }
+  virtual void TearDown() {
+    TaskScheduler::instance().set_max_threads(saved_max_threads_);
+  }
+
+  int saved_max_threads_ = 0;
+};
+
+TEST_F(RimeTaskSchedulerTest, ParallelForCoversRange) {
+  TaskScheduler::instance().set_max_threads(4);
+  const size_t kSize = 10000;
+  vector<int> visited(kSize, 0);
+  ParallelFor(kSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      ++visited[i];
+    }
+  });
+  for (size_t i = 0; i < kSize; ++i) {
+    ASSERT_EQ(1, visited[i]) << "at index " << i;
+  }
+}
+
+TEST_F(RimeTaskSchedulerTest, ThreadBudgetIsNeverExceeded) {
+  for (int budget : {1, 2, 3}) {
+    TaskScheduler::instance().set_max_threads(budget);
+    if (TaskScheduler::instance().max_threads() != budget) {
+      // overridden by RIME_MAX_THREADS
+      continue;
+    }
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    ParallelFor(
+        64,
+        [&](size_t, size_t) {
+          int now = ++running;
+          int observed = peak;
+          while (now > observed && !peak.compare_exchange_weak(observed, now))
+            ;
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          --running;
+        },
+        1);
+    EXPECT_LE(peak, budget);
+    EXPECT_GE(peak, 1);
+  }
+}
+
+TEST_F(RimeTaskSchedulerTest, SerialBudgetRunsInOrder) {
+  TaskScheduler::instance().set_max_threads(1);
+  if (!TaskScheduler::instance().serial()) {
+    GTEST_SKIP() << "thread budget overridden by RIME_MAX_THREADS";
+  }
+  auto caller = std::this_thread::get_id();
+  vector<size_t> order;
+  TaskGroup group;
+  for (size_t i = 0; i < 100; ++i) {
+    group.Run([&, i] {
+      EXPECT_EQ(caller, std::this_thread::get_id());
+      order.push_back(i);
+    });
+  }
+  group.Wait();
+  ASSERT_EQ(100, order.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(i, order[i]);
+  }
+}
+
+TEST_F(RimeTaskSchedulerTest, NestedGroups) {
+  TaskScheduler::instance().set_max_threads(2);
+  std::atomic<int> count{0};
+  ParallelFor(
+      8,
+      [&](size_t, size_t) {
+        ParallelFor(
+            8, [&](size_t begin, size_t end) { count += int(end - begin); },
+            1);
+      },
+      1);
+  EXPECT_EQ(64, count);
+}
+
+TEST_F(RimeTaskSchedulerTest, ExceptionIsRethrownByWait) {
+  TaskScheduler::instance().set_max_threads(3);
+  TaskGroup group;
+  group.Run([] { throw std::runtime_error("boom"); });
+  group.Run([] {});
+  EXPECT_THROW(group.Wait(), std::runtime_error);
+}
+
+TEST_F(RimeTaskSchedulerTest, AsyncJobRunsOutsideBudget) {
+  auto& scheduler = TaskScheduler::instance();
+  for (int budget : {1, 2}) {
+    ASSERT_TRUE(scheduler.set_max_threads(budget));
+    if (scheduler.max_threads() != budget) {
+      // overridden by RIME_MAX_THREADS
+      continue;
+    }
+    std::atomic<bool> release{false};
+    std::thread::id job_thread;
+    // the job would never finish if it ran in the calling thread
+    auto job = scheduler.Async([&] {
+      job_thread = std::this_thread::get_id();
+      while (!release)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    // the budget is left to parallel work while the job is running
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    ParallelFor(
+        16,
+        [&](size_t, size_t) {
+          int now = ++running;
+          int observed = peak;
+          while (now > observed && !peak.compare_exchange_weak(observed, now))
+            ;
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+          --running;
+        },
+        1);
+    EXPECT_EQ(budget, peak);
+    EXPECT_FALSE(scheduler.set_max_threads(budget + 1));
+    EXPECT_EQ(budget, scheduler.max_threads());
+    release = true;
+    ASSERT_EQ(std::future_status::ready,
+              job.wait_for(std::chrono::seconds(10)));
+    job.get();
+    EXPECT_NE(std::this_thread::get_id(), job_thread);
+  }
+}
@@ -0,0 +1,168 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <gtest/gtest.h>
+#include <rime/config.h>
+#include <rime/service.h>
+#include <rime/dict/db.h>
+#include <rime/dict/user_dictionary.h>
+
+using namespace rime;
+
+static const char* kTenantDirs[] = {"tenant_test_a", "tenant_test_b"};
+
+class RimeTenantTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    Service::shared_instance().StartService();
+    for (int i = 0; i < 2; ++i) {
+      tenants_[i] = Service::FindTenant(reinterpret_cast<uintptr_t>(
+          Service::CreateTenant(kTenantDirs[i])));
+      ASSERT_TRUE(tenants_[i] != nullptr);
+    }
+  }
+
+  virtual void TearDown() {
+    for (auto& tenant : tenants_) {
+      if (tenant)
+        Service::DestroyTenant(std::move(tenant));
+    }
+    for (const char* dir : kTenantDirs) {
+      std::filesystem::remove_all(dir);
+    }
+    // tenants fall back to the shared data dir, which is also the user data
+    // dir of the process in tests
+    std::filesystem::remove("tenant_test.userdb.txt");
+    std::filesystem::remove("tenant_test.yaml");
+  }
+
+  // learns a word as if committed by the user of the tenant
+  void Learn(Service* tenant, const string& code, const string& text) {
+    ServiceScope scope(tenant);
+    the<UserDictionary> dict(
+        user_dictionary_.Create("tenant_test", "plain_userdb"));
+    ASSERT_TRUE(dict && dict->Load());
+    DictEntry entry;
+    entry.text = text;
+    entry.custom_code = code + " ";
+    ASSERT_TRUE(dict->UpdateEntry(entry, 1));
+  }
+
+  size_t CountWords(Service* tenant, const string& code) {
+    ServiceScope scope(tenant);
+    the<UserDictionary> dict(
+        user_dictionary_.Create("tenant_test", "plain_userdb"));
+    if (!dict || !dict->Load())
+      return 0;
+    UserDictEntryIterator result;
+    return dict->LookupWords(&result, code, false);
+  }
+
+  an<Service> tenants_[2];
+  UserDictionaryComponent user_dictionary_;
+};
+
+TEST_F(RimeTenantTest, TenantsHaveSeparateUserData) {
+  EXPECT_TRUE(tenants_[0]->is_tenant());
+  EXPECT_FALSE(Service::shared_instance().is_tenant());
+  EXPECT_EQ(kTenantDirs[1], tenants_[1]->deployer().user_data_dir);
+  // read-only data is shared
+  EXPECT_EQ(Service::shared_instance().deployer().staging_dir,
+            tenants_[1]->deployer().staging_dir);
+}
+
+TEST_F(RimeTenantTest, LearningIsIsolated) {
+  Learn(tenants_[0].get(), "rime", "alpha");
+  Learn(tenants_[1].get(), "rime", "beta");
+  Learn(tenants_[1].get(), "tenant", "beta");
+  EXPECT_EQ(1u, CountWords(tenants_[0].get(), "rime"));
+  EXPECT_EQ(0u, CountWords(tenants_[0].get(), "tenant"));
+  EXPECT_EQ(1u, CountWords(tenants_[1].get(), "rime"));
+  EXPECT_EQ(1u, CountWords(tenants_[1].get(), "tenant"));
+  EXPECT_EQ(0u, CountWords(&Service::shared_instance(), "rime"));
+}
+
+TEST_F(RimeTenantTest, UserConfigIsIsolated) {
+  {
+    ServiceScope scope(tenants_[0].get());
+    the<Config> user_config(Config::Require("user_config")->Create("user"));
+    ASSERT_TRUE(user_config->SetString("var/tenant", "alpha"));
+  }
+  ServiceScope scope(tenants_[1].get());
+  the<Config> user_config(Config::Require("user_config")->Create("user"));
+  string value;
+  EXPECT_FALSE(user_config->GetString("var/tenant", &value));
+}
+
+TEST_F(RimeTenantTest, SessionsBelongToTenants) {
+  SessionId session_id;
+  {
+    ServiceScope scope(tenants_[0].get());
+    session_id = Service::instance().CreateSession();
+  }
+  ASSERT_NE(kInvalidSessionId, session_id);
+  EXPECT_EQ(tenants_[0], Service::FindSessionOwner(session_id));
+  EXPECT_FALSE(tenants_[1]->GetSession(session_id));
+  EXPECT_FALSE(Service::shared_instance().GetSession(session_id));
+  {
+    SessionScope session(session_id);
+    ASSERT_TRUE(bool(session));
+    EXPECT_EQ(tenants_[0].get(), &Service::instance());
+  }
+  EXPECT_EQ(&Service::shared_instance(), &Service::instance());
+  // sessions are destroyed with the tenant
+  Service::DestroyTenant(std::move(tenants_[0]));
+  EXPECT_EQ(&Service::shared_instance(),
+            Service::FindSessionOwner(session_id).get());
+}
+
+TEST_F(RimeTenantTest, DestroyTenantWaitsForCallsInProgress) {
+  auto tenant_id = reinterpret_cast<uintptr_t>(tenants_[1].get());
+  std::atomic<bool> released{false};
+  // as if an API call on another thread were using the tenant
+  std::thread caller([tenant = tenants_[1], &released]() mutable {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(kTenantDirs[1], tenant->deployer().user_data_dir);
+    released = true;
+    tenant.reset();
+  });
+  EXPECT_TRUE(Service::DestroyTenant(std::move(tenants_[1])));
+  EXPECT_TRUE(released);
+  EXPECT_FALSE(Service::FindTenant(tenant_id));
+  caller.join();
+}
+
+TEST_F(RimeTenantTest, ComponentsCreatedByTenantServeAllTenants) {
+  std::ofstream(string(kTenantDirs[0]) + "/tenant_test.yaml") << "owner: a\n";
+  std::ofstream("tenant_test.yaml") << "owner: shared\n";
+  Service::shared_instance().deployer().resource_path_index().Invalidate();
+  tenants_[0]->deployer().resource_path_index().Invalidate();
+  // as if a tenant session were the first to use the components
+  the<DbComponentBase> db_component;
+  the<ConfigComponentBase> config_component;
+  {
+    ServiceScope scope(tenants_[0].get());
+    db_component.reset(new DbComponentBase);
+    config_component.reset(new ConfigComponent<ConfigLoader>);
+    string owner;
+    the<Config> config(config_component->Create("tenant_test"));
+    EXPECT_TRUE(config->GetString("owner", &owner));
+    EXPECT_EQ("a", owner);
+  }
+  string db_path = db_component->DbFilePath("tenant_test", ".userdb");
+  EXPECT_EQ(string::npos, db_path.find(kTenantDirs[0]));
+  string owner;
+  the<Config> config(config_component->Create("tenant_test"));
+  EXPECT_TRUE(config->GetString("owner", &owner));
+  EXPECT_EQ("shared", owner);
+  {
+    ServiceScope scope(tenants_[1].get());
+    db_path = db_component->DbFilePath("tenant_test", ".userdb");
+    EXPECT_NE(string::npos, db_path.find(kTenantDirs[1]));
+  }
+}
@@ -127,6 +127,13 @@ int main(int argc, char* argv[]) {
     Deployer& deployer(Service::instance().deployer());
     setup_deployer(&deployer, argc, argv);
     LoadModules(kDeployerModules);
+    DeploymentLock lock(&deployer);
+    if (!lock.Acquire()) {
+      std::cerr << "another process is deploying to " << deployer.staging_dir
+                << std::endl;
+      SetConsoleOutputCodePage(codepage);
+      return 1;
+    }
     WorkspaceUpdate update;
     int res = update.Run(&deployer) ? 0 : 1;
     SetConsoleOutputCodePage(codepage);
@@ -149,6 +156,13 @@ int main(int argc, char* argv[]) {
     Deployer& deployer(Service::instance().deployer());
     setup_deployer(&deployer, argc - 1, argv + 1);
     LoadModules(kDeployerModules);
+    DeploymentLock lock(&deployer);
+    if (!lock.Acquire()) {
+      std::cerr << "another process is deploying to " << deployer.staging_dir
+                << std::endl;
+      SetConsoleOutputCodePage(codepage);
+      return 1;
+    }
     string schema_file(argv[0]);
     SchemaUpdate update(schema_file);
     update.set_verbose(true);
@@ -0,0 +1,585 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Compares the contents of compiled dictionary files, to make sure that
+// two builds are equivalent regardless of the binary layout.
+//
+// usage: rime_dict_diff [--max-diffs=<n>] [--tolerance=<x>] <a> <b>
+//
+// <a> and <b> are either compiled files of the same type, or directories,
+// in which case each .table.bin, .prism.bin and .reverse.bin file found in
+// either directory is compared with the file of the same name in the other.
+//
+// Tables are compared by the entries under each code: texts, codes, weights
+// and their order. Prisms are compared by the spelling descriptors of each
+// spelling, reverse dbs by the codes looked up for each key.
+//
+// Prints up to --max-diffs differences per file with context, and exits
+// with 0 if the files are equivalent, 1 if they differ, 2 on errors.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <rime/dict/prism.h>
+#include <rime/dict/reverse_lookup_dictionary.h>
+#include <rime/dict/table.h>
+#include "codepage.h"
+
+using namespace rime;
+
+namespace fs = std::filesystem;
+
+struct Options {
+  size_t max_diffs = 20;
+  double tolerance = 0.0;
+};
+
+// counts differences of a pair of files, printing the first few
+class Differences {
+ public:
+  explicit Differences(const Options& options) : options_(options) {}
+
+  void Add(const string& where, const vector<string>& context) {
+    if (count_++ >= options_.max_diffs)
+      return;
+    std::cout << where << "\n";
+    for (const auto& line : context) {
+      std::cout << "  " << line << "\n";
+    }
+  }
+
+  size_t count() const { return count_; }
+  const Options& options() const { return options_; }
+
+ private:
+  const Options& options_;
+  size_t count_ = 0;
+};
+
+static string quote(const string& str) {
+  return "'" + str + "'";
+}
+
+static string format_weight(double weight) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%g", weight);
+  return buffer;
+}
+
+// compares two sorted maps key by key; values are compared by `compare`
+template <class Map, class OnlyIn, class Compare>
+static void merge_compare(const Map& a,
+                          const Map& b,
+                          OnlyIn only_in,
+                          Compare compare) {
+  auto i = a.begin();
+  auto j = b.begin();
+  while (i != a.end() || j != b.end()) {
+    if (j == b.end() || (i != a.end() && i->first < j->first)) {
+      only_in('-', *i++);
+    } else if (i == a.end() || j->first < i->first) {
+      only_in('+', *j++);
+    } else {
+      compare(*i++, *j++);
+    }
+  }
+}
+
+// lists the items around the first difference of two sequences
+template <class T, class Equal, class Format>
+static bool diff_sequences(const vector<T>& a,
+                           const vector<T>& b,
+                           Equal equal,
+                           Format format,
+                           vector<string>* context) {
+  const size_t kContext = 2;
+  size_t first = 0;
+  while (first < a.size() && first < b.size() && equal(a[first], b[first]))
+    ++first;
+  if (first == a.size() && first == b.size())
+    return false;
+  size_t begin = first > kContext ? first - kContext : 0;
+  for (size_t i = begin; i < first; ++i) {
+    context->push_back("  [" + std::to_string(i) + "] " + format(a[i]));
+  }
+  for (size_t i = first; i < a.size() && i <= first + kContext; ++i) {
+    context->push_back("- [" + std::to_string(i) + "] " + format(a[i]));
+  }
+  for (size_t i = first; i < b.size() && i <= first + kContext; ++i) {
+    context->push_back("+ [" + std::to_string(i) + "] " + format(b[i]));
+  }
+  return true;
+}
+
+// tables
+
+struct TableEntry {
+  string text;
+  string code;
+  double weight;
+};
+
+// entries of a head syllable by their index code; long entries are listed
+// under the index code followed by " ..."
+using EntryLists = map<string, vector<TableEntry>>;
+
+class TableReader {
+ public:
+  explicit TableReader(Table* table) : table_(table) {
+    size_t num_syllables = table->metadata()->num_syllables;
+    for (size_t i = 0; i < num_syllables; ++i) {
+      syllables_.push_back(table->GetSyllableById(i));
+    }
+  }
+
+  const vector<string>& syllables() const { return syllables_; }
+
+  void Read(SyllableId head, EntryLists* result) {
+    an<TablePartition> partition;
+    auto node = table_->FindHeadNode(head, &partition);
+    if (!node)
+      return;
+    Code code;
+    code.push_back(head);
+    AddEntries(code, node->entries, result);
+    if (node->next_level)
+      VisitTrunk(1, code, &node->next_level->trunk(), result);
+  }
+
+ private:
+  string Spell(const SyllableId* begin, const SyllableId* end) {
+    string result;
+    for (auto p = begin; p != end; ++p) {
+      if (!result.empty())
+        result += ' ';
+      result += *p >= 0 && size_t(*p) < syllables_.size()
+                    ? syllables_[*p]
+                    : "#" + std::to_string(*p);
+    }
+    return result;
+  }
+
+  string Spell(const Code& code) {
+    return Spell(code.data(), code.data() + code.size());
+  }
+
+  void AddEntries(const Code& code,
+                  const List<table::Entry>& entries,
+                  EntryLists* result) {
+    if (entries.size == 0)
+      return;
+    string spelled = Spell(code);
+    auto& list = (*result)[spelled];
+    for (const auto& entry : entries) {
+      list.push_back(
+          {table_->GetEntryText(entry), spelled, double(entry.weight)});
+    }
+  }
+
+  void VisitTrunk(size_t level,
+                  Code& code,
+                  table::TrunkIndex* trunk,
+                  EntryLists* result) {
+    for (const auto& node : *trunk) {
+      code.push_back(node.key);
+      AddEntries(code, node.entries, result);
+      if (node.next_level) {
+        if (level + 1 < Code::kIndexCodeMaxLength)
+          VisitTrunk(level + 1, code, &node.next_level->trunk(), result);
+        else
+          VisitTail(code, &node.next_level->tail(), result);
+      }
+      code.pop_back();
+    }
+  }
+
+  void VisitTail(const Code& code,
+                 table::TailIndex* tail,
+                 EntryLists* result) {
+    string spelled = Spell(code);
+    auto& list = (*result)[spelled + " ..."];
+    for (const auto& long_entry : *tail) {
+      const auto& extra = long_entry.extra_code;
+      list.push_back({table_->GetEntryText(long_entry.entry),
+                      spelled + " " + Spell(extra.begin(), extra.end()),
+                      double(long_entry.entry.weight)});
+    }
+  }
+
+  Table* table_;
+  vector<string> syllables_;
+};
+
+static string format_entry(const TableEntry& entry) {
+  return entry.text + "\t" + entry.code + "\t" + format_weight(entry.weight);
+}
+
+static void diff_tables(Table* a, Table* b, Differences* diffs) {
+  TableReader reader_a(a);
+  TableReader reader_b(b);
+  // syllable ids follow the order of spellings in both tables
+  map<string, SyllableId> heads_a, heads_b;
+  for (size_t i = 0; i < reader_a.syllables().size(); ++i)
+    heads_a[reader_a.syllables()[i]] = i;
+  for (size_t i = 0; i < reader_b.syllables().size(); ++i)
+    heads_b[reader_b.syllables()[i]] = i;
+  merge_compare(
+      heads_a, heads_b,
+      [&](char side, const pair<const string, SyllableId>& head) {
+        EntryLists lists;
+        (side == '-' ? reader_a : reader_b).Read(head.second, &lists);
+        size_t num_entries = 0;
+        for (const auto& list : lists)
+          num_entries += list.second.size();
+        diffs->Add("syllable " + quote(head.first) + " only in " +
+                       (side == '-' ? "a" : "b"),
+                   {std::to_string(num_entries) + " entries"});
+      },
+      [&](const pair<const string, SyllableId>& head_a,
+          const pair<const string, SyllableId>& head_b) {
+        EntryLists lists_a, lists_b;
+        reader_a.Read(head_a.second, &lists_a);
+        reader_b.Read(head_b.second, &lists_b);
+        merge_compare(
+            lists_a, lists_b,
+            [&](char side, const pair<const string, vector<TableEntry>>& list) {
+              vector<string> context;
+              for (const auto& entry : list.second)
+                context.push_back(string(1, side) + " " + format_entry(entry));
+              diffs->Add("code " + quote(list.first) + " only in " +
+                             (side == '-' ? "a" : "b"),
+                         context);
+            },
+            [&](const pair<const string, vector<TableEntry>>& list_a,
+                const pair<const string, vector<TableEntry>>& list_b) {
+              vector<string> context;
+              double tolerance = diffs->options().tolerance;
+              if (diff_sequences(
+                      list_a.second, list_b.second,
+                      [tolerance](const TableEntry& x, const TableEntry& y) {
+                        return x.text == y.text && x.code == y.code &&
+                               std::fabs(x.weight - y.weight) <= tolerance;
+                      },
+                      format_entry, &context)) {
+                diffs->Add("entries of code " + quote(list_a.first) +
+                               " differ",
+                           context);
+              }
+            });
+      });
+}
+
+// prisms
+
+struct Descriptor {
+  string syllable;
+  SpellingProperties properties;
+};
+
+// recovers the spelling for each spelling id by walking the trie
+static vector<string> list_spellings(Prism* prism) {
+  auto metadata = prism->metadata();
+  vector<string> spellings(metadata->num_spellings);
+  auto& trie = prism->trie();
+  std::queue<std::pair<string, size_t>> q;
+  q.push({string(), 0});
+  while (!q.empty()) {
+    auto node = q.front();
+    q.pop();
+    for (const char* c = metadata->alphabet; *c; ++c) {
+      string key = node.first + *c;
+      size_t node_pos = node.second;
+      size_t key_pos = node.first.length();
+      int ret = trie.traverse(key.c_str(), node_pos, key_pos);
+      if (ret <= -2)
+        continue;
+      if (ret >= 0 && size_t(ret) < spellings.size())
+        spellings[ret] = key;
+      q.push({key, node_pos});
+    }
+  }
+  return spellings;
+}
+
+// descriptors of each spelling; syllables are spelled out with the
+// syllabary if known, otherwise given by id
+static map<string, vector<Descriptor>> read_prism(
+    Prism* prism,
+    const vector<string>& syllabary) {
+  map<string, vector<Descriptor>> result;
+  auto spellings = list_spellings(prism);
+  for (size_t i = 0; i < spellings.size(); ++i) {
+    auto& descriptors = result[spellings[i]];
+    for (auto accessor = prism->QuerySpelling(i); !accessor.exhausted();
+         accessor.Next()) {
+      SyllableId id = accessor.syllable_id();
+      descriptors.push_back({id >= 0 && size_t(id) < syllabary.size()
+                                 ? syllabary[id]
+                                 : "#" + std::to_string(id),
+                             accessor.properties()});
+    }
+  }
+  return result;
+}
+
+static string format_descriptor(const Descriptor& descriptor) {
+  static const char* kSpellingTypes[] = {
+      "normal", "fuzzy", "abbreviation", "completion", "ambiguous", "invalid",
+  };
+  const auto& properties = descriptor.properties;
+  string type = properties.type >= 0 && properties.type <= kInvalidSpelling
+                    ? kSpellingTypes[properties.type]
+                    : std::to_string(properties.type);
+  string result = descriptor.syllable + "\t" + type + "\t" +
+                  format_weight(properties.credibility);
+  if (!properties.tips.empty())
+    result += "\t" + properties.tips;
+  return result;
+}
+
+static void diff_prisms(Prism* a,
+                        Prism* b,
+                        const vector<string>& syllabary_a,
+                        const vector<string>& syllabary_b,
+                        Differences* diffs) {
+  auto spellings_a = read_prism(a, syllabary_a);
+  auto spellings_b = read_prism(b, syllabary_b);
+  merge_compare(
+      spellings_a, spellings_b,
+      [&](char side, const pair<const string, vector<Descriptor>>& spelling) {
+        vector<string> context;
+        for (const auto& descriptor : spelling.second)
+          context.push_back(string(1, side) + " " +
+                            format_descriptor(descriptor));
+        diffs->Add("spelling " + quote(spelling.first) + " only in " +
+                       (side == '-' ? "a" : "b"),
+                   context);
+      },
+      [&](const pair<const string, vector<Descriptor>>& spelling_a,
+          const pair<const string, vector<Descriptor>>& spelling_b) {
+        vector<string> context;
+        double tolerance = diffs->options().tolerance;
+        if (diff_sequences(
+                spelling_a.second, spelling_b.second,
+                [tolerance](const Descriptor& x, const Descriptor& y) {
+                  return x.syllable == y.syllable &&
+                         x.properties.type == y.properties.type &&
+                         x.properties.tips == y.properties.tips &&
+                         std::fabs(x.properties.credibility -
+                                   y.properties.credibility) <= tolerance;
+                },
+                format_descriptor, &context)) {
+          diffs->Add("spelling " + quote(spelling_a.first) + " differs",
+                     context);
+        }
+      });
+}
+
+// reverse dbs
+
+static set<string> list_keys(ReverseDb* db) {
+  auto metadata = db->metadata();
+  StringTable keys(metadata->key_trie.get(), metadata->key_trie_size);
+  set<string> result;
+  for (size_t i = 0; i < metadata->index.size; ++i) {
+    result.insert(keys.GetString(i));
+  }
+  return result;
+}
+
+static void diff_reverse_dbs(ReverseDb* a, ReverseDb* b, Differences* diffs) {
+  const auto& dict_settings_a = a->metadata()->dict_settings;
+  const auto& dict_settings_b = b->metadata()->dict_settings;
+  string settings_a = dict_settings_a.empty() ? "" : dict_settings_a.c_str();
+  string settings_b = dict_settings_b.empty() ? "" : dict_settings_b.c_str();
+  if (settings_a != settings_b) {
+    diffs->Add("dict settings differ", {"- " + settings_a, "+ " + settings_b});
+  }
+  // keys in either db, looked up in both
+  auto keys = list_keys(a);
+  auto keys_b = list_keys(b);
+  keys.insert(keys_b.begin(), keys_b.end());
+  for (const auto& key : keys) {
+    vector<string> codes_a, codes_b;
+    bool found_a = a->LookupCodes(key, &codes_a);
+    bool found_b = b->LookupCodes(key, &codes_b);
+    if (found_a != found_b) {
+      vector<string> context;
+      for (const auto& code : found_a ? codes_a : codes_b)
+        context.push_back(string(found_a ? "- " : "+ ") + code);
+      diffs->Add("key " + quote(key) + " only in " + (found_a ? "a" : "b"),
+                 context);
+      continue;
+    }
+    vector<string> context;
+    if (diff_sequences(
+            codes_a, codes_b,
+            [](const string& x, const string& y) { return x == y; },
+            [](const string& x) { return x; }, &context)) {
+      diffs->Add("codes of key " + quote(key) + " differ", context);
+    }
+  }
+}
+
+static string read_format(const string& file_name) {
+  char format[32] = {0};
+  std::ifstream fin(file_name, std::ios::binary);
+  fin.read(format, sizeof(format) - 1);
+  return format;
+}
+
+static bool starts_with(const string& str, const char* prefix) {
+  return str.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static bool ends_with(const string& str, const string& suffix) {
+  return str.length() >= suffix.length() &&
+         str.compare(str.length() - suffix.length(), suffix.length(),
+                     suffix) == 0;
+}
+
+// the syllables of the table built along with a prism, if any
+static vector<string> read_syllabary(const string& prism_file) {
+  const string kPrismSuffix = ".prism.bin";
+  vector<string> syllabary;
+  if (!ends_with(prism_file, kPrismSuffix))
+    return syllabary;
+  string table_file =
+      prism_file.substr(0, prism_file.length() - kPrismSuffix.length()) +
+      ".table.bin";
+  if (!fs::exists(table_file))
+    return syllabary;
+  Table table(table_file);
+  if (!table.Load())
+    return syllabary;
+  for (size_t i = 0; i < table.metadata()->num_syllables; ++i) {
+    syllabary.push_back(table.GetSyllableById(i));
+  }
+  return syllabary;
+}
+
+// returns the number of differences, or -1 on errors
+static int diff_files(const string& file_a,
+                      const string& file_b,
+                      const Options& options) {
+  std::cout << "--- " << file_a << "\n+++ " << file_b << "\n";
+  string format_a = read_format(file_a);
+  string format_b = read_format(file_b);
+  Differences diffs(options);
+  if (starts_with(format_a, "Rime::Table/") &&
+      starts_with(format_b, "Rime::Table/")) {
+    Table a(file_a), b(file_b);
+    if (!a.Load() || !b.Load())
+      return -1;
+    diff_tables(&a, &b, &diffs);
+  } else if (starts_with(format_a, "Rime::Prism/") &&
+             starts_with(format_b, "Rime::Prism/")) {
+    Prism a(file_a), b(file_b);
+    if (!a.Load() || !b.Load())
+      return -1;
+    diff_prisms(&a, &b, read_syllabary(file_a), read_syllabary(file_b),
+                &diffs);
+  } else if (starts_with(format_a, "Rime::Reverse/") &&
+             starts_with(format_b, "Rime::Reverse/")) {
+    ReverseDb a(file_a), b(file_b);
+    if (!a.Load() || !b.Load())
+      return -1;
+    diff_reverse_dbs(&a, &b, &diffs);
+  } else {
+    std::cerr << "unsupported or mismatching file formats: "
+              << quote(format_a) << ", " << quote(format_b) << std::endl;
+    return -1;
+  }
+  if (diffs.count() > options.max_diffs) {
+    std::cout << "... " << diffs.count() - options.max_diffs
+              << " more differences\n";
+  }
+  std::cout << "differences: " << diffs.count() << "\n" << std::endl;
+  return static_cast<int>((std::min)(diffs.count(), size_t(INT32_MAX)));
+}
+
+static bool is_compiled_file(const fs::path& path) {
+  string name = path.filename().string();
+  // partitions of a table are compared through the table
+  return ends_with(name, ".table.bin") || ends_with(name, ".prism.bin") ||
+         ends_with(name, ".reverse.bin");
+}
+
+static set<string> list_compiled_files(const fs::path& dir) {
+  set<string> result;
+  for (const auto& entry : fs::directory_iterator(dir)) {
+    if (entry.is_regular_file() && is_compiled_file(entry.path()))
+      result.insert(entry.path().filename().string());
+  }
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  unsigned int codepage = SetConsoleOutputCodePage();
+  Options options;
+  vector<string> paths;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if (starts_with(arg, "--max-diffs=")) {
+      options.max_diffs = static_cast<size_t>(atoi(arg.c_str() + 12));
+    } else if (starts_with(arg, "--tolerance=")) {
+      options.tolerance = atof(arg.c_str() + 12);
+    } else if (starts_with(arg, "--")) {
+      paths.clear();
+      break;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    std::cerr << "usage: rime_dict_diff [--max-diffs=<n>] [--tolerance=<x>] "
+                 "<a> <b>"
+              << std::endl;
+    SetConsoleOutputCodePage(codepage);
+    return 2;
+  }
+
+  vector<pair<string, string>> pairs;
+  bool error = false;
+  size_t num_differences = 0;
+  if (fs::is_directory(paths[0]) && fs::is_directory(paths[1])) {
+    auto files_a = list_compiled_files(paths[0]);
+    auto files_b = list_compiled_files(paths[1]);
+    for (const auto& file : files_a) {
+      if (files_b.count(file)) {
+        pairs.emplace_back((fs::path(paths[0]) / file).string(),
+                           (fs::path(paths[1]) / file).string());
+      } else {
+        std::cout << "only in " << paths[0] << ": " << file << "\n";
+        ++num_differences;
+      }
+    }
+    for (const auto& file : files_b) {
+      if (!files_a.count(file)) {
+        std::cout << "only in " << paths[1] << ": " << file << "\n";
+        ++num_differences;
+      }
+    }
+  } else {
+    pairs.emplace_back(paths[0], paths[1]);
+  }
+  for (const auto& pair : pairs) {
+    int result = diff_files(pair.first, pair.second, options);
+    if (result < 0) {
+      std::cerr << "error comparing " << pair.first << " and " << pair.second
+                << std::endl;
+      error = true;
+    } else {
+      num_differences += result;
+    }
+  }
+  SetConsoleOutputCodePage(codepage);
+  return error ? 2 : num_differences ? 1 : 0;
+}
@@ -0,0 +1,605 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Reports the shape of compiled dictionary files: bytes taken by each
+// section, index fan-out, entry list lengths and the largest buckets.
+//
+// usage: rime_dict_stats [--json] [--top=<n>] <file>...
+//
+// Accepts .table.bin, .prism.bin and .reverse.bin files; the file type is
+// told by the format string in the file header.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <rime/dict/prism.h>
+#include <rime/dict/reverse_lookup_dictionary.h>
+#include <rime/dict/table.h>
+#include "codepage.h"
+
+using namespace rime;
+
+// counts values in power-of-two buckets: 0, 1, 2-3, 4-7, ...
+class Histogram {
+ public:
+  void Add(size_t value) {
+    size_t bucket = 0;
+    while ((size_t(1) << bucket) <= value)
+      ++bucket;
+    if (buckets_.size() <= bucket)
+      buckets_.resize(bucket + 1);
+    ++buckets_[bucket];
+    ++count_;
+    sum_ += value;
+    max_ = (std::max)(max_, value);
+  }
+
+  size_t count() const { return count_; }
+  size_t sum() const { return sum_; }
+  size_t max() const { return max_; }
+  double mean() const { return count_ ? double(sum_) / count_ : 0.0; }
+  const vector<size_t>& buckets() const { return buckets_; }
+
+  static size_t LowerBound(size_t bucket) {
+    return bucket ? size_t(1) << (bucket - 1) : 0;
+  }
+  static size_t UpperBound(size_t bucket) {
+    return bucket ? (size_t(1) << bucket) - 1 : 0;
+  }
+
+ private:
+  vector<size_t> buckets_;
+  size_t count_ = 0;
+  size_t sum_ = 0;
+  size_t max_ = 0;
+};
+
+// keeps the n largest items seen
+class Largest {
+ public:
+  explicit Largest(size_t limit = 0) : limit_(limit) {}
+
+  bool Accepts(size_t size) const {
+    return limit_ > 0 && (items_.size() < limit_ || size > items_.back().first);
+  }
+
+  void Add(size_t size, const string& key) {
+    if (!Accepts(size))
+      return;
+    auto pos = std::upper_bound(
+        items_.begin(), items_.end(), size,
+        [](size_t x, const std::pair<size_t, string>& y) {
+          return x > y.first;
+        });
+    items_.emplace(pos, size, key);
+    if (items_.size() > limit_)
+      items_.pop_back();
+  }
+
+  const vector<std::pair<size_t, string>>& items() const { return items_; }
+
+ private:
+  size_t limit_;
+  vector<std::pair<size_t, string>> items_;
+};
+
+struct Report {
+  string file_name;
+  string format;
+  size_t file_size = 0;
+  vector<std::pair<string, size_t>> sections;
+  vector<std::pair<string, size_t>> counts;
+  vector<std::pair<string, Histogram>> histograms;
+  vector<std::pair<string, Largest>> largest;
+
+  void AddSection(const string& name, size_t bytes) {
+    sections.emplace_back(name, bytes);
+  }
+  void AddCount(const string& name, size_t value) {
+    counts.emplace_back(name, value);
+  }
+  // the bytes not covered by any section: alignment and reserved space
+  void AddUnaccounted() {
+    size_t total = 0;
+    for (const auto& section : sections) {
+      total += section.second;
+    }
+    AddSection("unaccounted", file_size > total ? file_size - total : 0);
+  }
+};
+
+template <class T>
+static size_t array_bytes(const Array<T>* array) {
+  return array ? sizeof(Array<T>) + sizeof(T) * array->size - sizeof(T) : 0;
+}
+
+class TableStats {
+ public:
+  TableStats(Table* table, size_t top, Report* report)
+      : table_(table),
+        report_(report),
+        entry_lists_(top),
+        trunk_indices_(top),
+        tail_indices_(top) {}
+
+  void Collect() {
+    auto metadata = table_->metadata();
+    report_->AddCount("syllables", metadata->num_syllables);
+    report_->AddCount("entries", metadata->num_entries);
+    report_->AddCount("partitions", table_->num_partitions());
+
+    auto syllabary = metadata->syllabary.get();
+    if (syllabary) {
+      for (size_t i = 0; i < syllabary->size; ++i) {
+        raw_text_bytes_ += table_->GetSyllableById(i).length();
+      }
+    }
+    auto index = metadata->index.get();
+    size_t head_index_bytes = array_bytes(index);
+    for (size_t i = 0; i < metadata->num_syllables; ++i) {
+      an<TablePartition> partition;
+      auto node = table_->FindHeadNode(i, &partition);
+      if (!node)
+        continue;
+      Code code;
+      code.push_back(i);
+      AddEntryList(0, code, node->entries);
+      if (node->next_level)
+        VisitTrunk(1, code, &node->next_level->trunk());
+    }
+    // the index of a partitioned table is split into the partition files
+    size_t num_partitions = table_->num_partitions();
+    if (num_partitions > 0) {
+      auto bounds = metadata->partition_bounds.get();
+      for (size_t k = 0; k < num_partitions; ++k) {
+        an<TablePartition> partition;
+        table_->FindHeadNode(bounds->at[k], &partition);
+        if (partition)
+          report_->file_size += partition->file_size();
+      }
+      head_index_bytes =
+          metadata->num_syllables * sizeof(table::HeadIndexNode) +
+          num_partitions * (sizeof(table::PartitionMetadata) +
+                            sizeof(Array<table::HeadIndexNode>) -
+                            sizeof(table::HeadIndexNode)) +
+          array_bytes(bounds);
+    }
+    StringTable strings(metadata->string_table.get(),
+                        metadata->string_table_size);
+    report_->AddCount("unique strings", strings.NumKeys());
+    report_->AddCount("raw text bytes", raw_text_bytes_);
+    report_->AddCount("trunk indices", trunk_index_sizes_[0].count() +
+                                           trunk_index_sizes_[1].count());
+    report_->AddCount("tail indices", tail_index_sizes_.count());
+    report_->AddCount("long entries", tail_index_sizes_.sum());
+
+    report_->AddSection("metadata", sizeof(table::Metadata));
+    report_->AddSection("syllabary", array_bytes(syllabary));
+    report_->AddSection("head index", head_index_bytes);
+    report_->AddSection("trunk indices", trunk_index_bytes_);
+    report_->AddSection("tail indices", tail_index_bytes_);
+    report_->AddSection("entry lists", entry_list_bytes_);
+    report_->AddSection("string table", metadata->string_table_size);
+    report_->AddUnaccounted();
+
+    for (size_t level = 0; level < Code::kIndexCodeMaxLength; ++level) {
+      report_->histograms.emplace_back(
+          "entry list length (level " + std::to_string(level + 1) + ")",
+          entry_list_lengths_[level]);
+    }
+    report_->histograms.emplace_back("trunk index fan-out (level 2)",
+                                     trunk_index_sizes_[0]);
+    report_->histograms.emplace_back("trunk index fan-out (level 3)",
+                                     trunk_index_sizes_[1]);
+    report_->histograms.emplace_back("tail index size (level 4)",
+                                     tail_index_sizes_);
+    report_->histograms.emplace_back("long entry extra code length",
+                                     extra_code_lengths_);
+    report_->largest.emplace_back("entry lists", entry_lists_);
+    report_->largest.emplace_back("trunk indices", trunk_indices_);
+    report_->largest.emplace_back("tail indices", tail_indices_);
+  }
+
+ private:
+  string CodeToString(const Code& code) {
+    string result;
+    for (auto syllable_id : code) {
+      if (!result.empty())
+        result += ' ';
+      result += table_->GetSyllableById(syllable_id);
+    }
+    return result;
+  }
+
+  void AddEntryList(size_t level, const Code& code,
+                    const List<table::Entry>& entries) {
+    entry_list_lengths_[level].Add(entries.size);
+    entry_list_bytes_ += sizeof(table::Entry) * entries.size;
+    if (entry_lists_.Accepts(entries.size))
+      entry_lists_.Add(entries.size, CodeToString(code));
+    for (const auto& entry : entries) {
+      raw_text_bytes_ += table_->GetEntryText(entry).length();
+    }
+  }
+
+  // below the head index, the index code grows by one syllable per level
+  // until it reaches kIndexCodeMaxLength; then come the tail indices.
+  void VisitTrunk(size_t level, Code& code, table::TrunkIndex* trunk) {
+    trunk_index_sizes_[level - 1].Add(trunk->size);
+    trunk_index_bytes_ += array_bytes(trunk);
+    if (trunk_indices_.Accepts(trunk->size))
+      trunk_indices_.Add(trunk->size, CodeToString(code));
+    for (const auto& node : *trunk) {
+      code.push_back(node.key);
+      AddEntryList(level, code, node.entries);
+      if (node.next_level) {
+        if (level + 1 < Code::kIndexCodeMaxLength)
+          VisitTrunk(level + 1, code, &node.next_level->trunk());
+        else
+          VisitTail(code, &node.next_level->tail());
+      }
+      code.pop_back();
+    }
+  }
+
+  void VisitTail(const Code& code, table::TailIndex* tail) {
+    tail_index_sizes_.Add(tail->size);
+    tail_index_bytes_ += array_bytes(tail);
+    if (tail_indices_.Accepts(tail->size))
+      tail_indices_.Add(tail->size, CodeToString(code));
+    for (const auto& long_entry : *tail) {
+      extra_code_lengths_.Add(long_entry.extra_code.size);
+      tail_index_bytes_ += sizeof(SyllableId) * long_entry.extra_code.size;
+      raw_text_bytes_ += table_->GetEntryText(long_entry.entry).length();
+    }
+  }
+
+  Table* table_;
+  Report* report_;
+  Histogram entry_list_lengths_[Code::kIndexCodeMaxLength];
+  Histogram trunk_index_sizes_[2];
+  Histogram tail_index_sizes_;
+  Histogram extra_code_lengths_;
+  Largest entry_lists_;
+  Largest trunk_indices_;
+  Largest tail_indices_;
+  size_t trunk_index_bytes_ = 0;
+  size_t tail_index_bytes_ = 0;
+  size_t entry_list_bytes_ = 0;
+  size_t raw_text_bytes_ = 0;
+};
+
+// recovers the spelling for each spelling id by walking the trie
+static vector<string> list_spellings(Prism* prism) {
+  auto metadata = prism->metadata();
+  vector<string> spellings(metadata->num_spellings);
+  auto& trie = prism->trie();
+  std::queue<std::pair<string, size_t>> q;
+  q.push({string(), 0});
+  while (!q.empty()) {
+    auto node = q.front();
+    q.pop();
+    for (const char* c = metadata->alphabet; *c; ++c) {
+      string key = node.first + *c;
+      size_t node_pos = node.second;
+      size_t key_pos = node.first.length();
+      int ret = trie.traverse(key.c_str(), node_pos, key_pos);
+      if (ret <= -2)
+        continue;
+      if (ret >= 0 && size_t(ret) < spellings.size())
+        spellings[ret] = key;
+      q.push({key, node_pos});
+    }
+  }
+  return spellings;
+}
+
+static void collect_prism_stats(Prism* prism, size_t top, Report* report) {
+  static const char* kSpellingTypes[] = {
+      "normal", "fuzzy", "abbreviation", "completion", "ambiguous", "invalid",
+  };
+  const size_t kNumSpellingTypes = sizeof(kSpellingTypes) / sizeof(char*);
+  auto metadata = prism->metadata();
+  report->AddCount("syllables", metadata->num_syllables);
+  report->AddCount("spellings", metadata->num_spellings);
+  report->AddCount("double array units", metadata->double_array_size);
+
+  size_t descriptor_bytes = 0;
+  size_t tips_bytes = 0;
+  vector<size_t> descriptors_by_type(kNumSpellingTypes);
+  Histogram descriptors_per_spelling;
+  Largest largest_spellings(top);
+  auto spelling_map = metadata->spelling_map.get();
+  if (spelling_map) {
+    auto spellings = list_spellings(prism);
+    for (size_t i = 0; i < spelling_map->size; ++i) {
+      const auto& item = spelling_map->at[i];
+      descriptors_per_spelling.Add(item.size);
+      largest_spellings.Add(item.size,
+                            i < spellings.size() ? spellings[i] : string());
+      descriptor_bytes += sizeof(prism::SpellingDescriptor) * item.size;
+      for (const auto& descriptor : item) {
+        if (descriptor.type >= 0 &&
+            size_t(descriptor.type) < kNumSpellingTypes)
+          ++descriptors_by_type[descriptor.type];
+        if (descriptor.tips.data)
+          tips_bytes += descriptor.tips.length() + 1;
+      }
+    }
+  }
+  report->AddCount("spelling descriptors", descriptors_per_spelling.sum());
+  for (size_t i = 0; i < kNumSpellingTypes; ++i) {
+    report->AddCount(string(kSpellingTypes[i]) + " spellings",
+                     descriptors_by_type[i]);
+  }
+
+  report->AddSection("metadata", sizeof(prism::Metadata));
+  report->AddSection("double array",
+                     metadata->double_array_size * prism->trie().unit_size());
+  report->AddSection("spelling map", array_bytes(spelling_map));
+  report->AddSection("spelling descriptors", descriptor_bytes);
+  report->AddSection("spelling tips", tips_bytes);
+  report->AddUnaccounted();
+
+  report->histograms.emplace_back("descriptors per spelling",
+                                  descriptors_per_spelling);
+  report->largest.emplace_back("spellings", largest_spellings);
+}
+
+static void collect_reverse_db_stats(ReverseDb* db,
+                                     size_t top,
+                                     Report* report) {
+  auto metadata = db->metadata();
+  StringTable keys(metadata->key_trie.get(), metadata->key_trie_size);
+  StringTable codes(metadata->code_trie.get(), metadata->code_trie_size);
+  report->AddCount("entries", metadata->index.size);
+  report->AddCount("unique keys", keys.NumKeys());
+  report->AddCount("unique codes", codes.NumKeys());
+
+  Histogram codes_per_key;
+  Largest largest_values(top);
+  set<uint32_t> code_lists;
+  size_t raw_text_bytes = 0;
+  size_t key_bytes = 0;
+  for (size_t i = 0; i < metadata->index.size; ++i) {
+    string key = keys.GetString(i);
+    key_bytes += key.length();
+    uint32_t entry = metadata->index.at[i];
+    const StringId* list = &entry;
+    if (!(entry & reverse::kLastCode)) {
+      list = &metadata->code_lists.at[entry];
+      code_lists.insert(entry);
+    }
+    size_t num_codes = 0;
+    raw_text_bytes += key.length();
+    do {
+      string code = codes.GetString(list[num_codes] & ~reverse::kLastCode);
+      raw_text_bytes += code.length() + 1;
+    } while (!(list[num_codes++] & reverse::kLastCode));
+    codes_per_key.Add(num_codes);
+    largest_values.Add(num_codes, key);
+  }
+  report->AddCount("shared code lists", code_lists.size());
+  report->AddCount("raw text bytes", raw_text_bytes);
+  // input to the tries, for comparing trie implementations
+  report->AddCount("unique key bytes", key_bytes);
+  size_t code_bytes = 0;
+  for (size_t i = 0; i < codes.NumKeys(); ++i) {
+    code_bytes += codes.GetString(i).length();
+  }
+  report->AddCount("unique code bytes", code_bytes);
+
+  size_t settings_bytes = 0;
+  if (metadata->dict_settings.data)
+    settings_bytes = metadata->dict_settings.length() + 1;
+  report->AddSection("metadata", sizeof(reverse::Metadata));
+  report->AddSection("dict settings", settings_bytes);
+  report->AddSection("index", sizeof(uint32_t) * metadata->index.size);
+  report->AddSection("key trie", metadata->key_trie_size);
+  report->AddSection("code trie", metadata->code_trie_size);
+  report->AddSection("code lists",
+                     sizeof(StringId) * metadata->code_lists.size);
+  report->AddUnaccounted();
+
+  report->histograms.emplace_back("codes per key", codes_per_key);
+  report->largest.emplace_back("keys", largest_values);
+}
+
+static string read_format(const string& file_name) {
+  char format[32] = {0};
+  std::ifstream fin(file_name, std::ios::binary);
+  fin.read(format, sizeof(format) - 1);
+  return format;
+}
+
+static bool starts_with(const string& str, const char* prefix) {
+  return str.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static bool collect_stats(const string& file_name,
+                          size_t top,
+                          Report* report) {
+  report->file_name = file_name;
+  report->format = read_format(file_name);
+  if (starts_with(report->format, "Rime::Table/")) {
+    Table table(file_name);
+    if (!table.Load())
+      return false;
+    report->file_size = table.file_size();
+    TableStats(&table, top, report).Collect();
+  } else if (starts_with(report->format, "Rime::Prism/")) {
+    Prism prism(file_name);
+    if (!prism.Load())
+      return false;
+    report->file_size = prism.file_size();
+    collect_prism_stats(&prism, top, report);
+  } else if (starts_with(report->format, "Rime::Reverse/")) {
+    ReverseDb db(file_name);
+    if (!db.Load())
+      return false;
+    report->file_size = db.file_size();
+    collect_reverse_db_stats(&db, top, report);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void print_text(const Report& report) {
+  std::cout << "file: " << report.file_name << "\n";
+  std::cout << "format: " << report.format << "\n";
+  std::cout << "file size: " << report.file_size << "\n";
+  std::cout << "\nsections (bytes):\n";
+  for (const auto& section : report.sections) {
+    printf("  %-24s %12zu %6.1f%%\n", section.first.c_str(), section.second,
+           report.file_size ? 100.0 * section.second / report.file_size : 0.0);
+  }
+  std::cout << "\ncounts:\n";
+  for (const auto& count : report.counts) {
+    printf("  %-24s %12zu\n", count.first.c_str(), count.second);
+  }
+  for (const auto& histogram : report.histograms) {
+    const auto& h = histogram.second;
+    printf("\n%s: count %zu, mean %.2f, max %zu\n", histogram.first.c_str(),
+           h.count(), h.mean(), h.max());
+    for (size_t i = 0; i < h.buckets().size(); ++i) {
+      if (!h.buckets()[i])
+        continue;
+      size_t lower = Histogram::LowerBound(i);
+      size_t upper = Histogram::UpperBound(i);
+      string range = lower == upper ? std::to_string(lower)
+                                    : std::to_string(lower) + "-" +
+                                          std::to_string(upper);
+      printf("  %-16s %12zu\n", range.c_str(), h.buckets()[i]);
+    }
+  }
+  for (const auto& largest : report.largest) {
+    if (largest.second.items().empty())
+      continue;
+    std::cout << "\nlargest " << largest.first << ":\n";
+    for (const auto& item : largest.second.items()) {
+      std::cout << "  " << item.first << "\t" << item.second << "\n";
+    }
+  }
+  std::cout << std::endl;
+}
+
+static string json_string(const string& str) {
+  string result = "\"";
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      result += escaped;
+    } else {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+static void print_json(const Report& report, bool last) {
+  std::ostream& out = std::cout;
+  out << "  {\n";
+  out << "    \"file\": " << json_string(report.file_name) << ",\n";
+  out << "    \"format\": " << json_string(report.format) << ",\n";
+  out << "    \"file_size\": " << report.file_size << ",\n";
+  out << "    \"sections\": {";
+  for (size_t i = 0; i < report.sections.size(); ++i) {
+    out << (i ? ", " : "") << json_string(report.sections[i].first) << ": "
+        << report.sections[i].second;
+  }
+  out << "},\n    \"counts\": {";
+  for (size_t i = 0; i < report.counts.size(); ++i) {
+    out << (i ? ", " : "") << json_string(report.counts[i].first) << ": "
+        << report.counts[i].second;
+  }
+  out << "},\n    \"histograms\": {";
+  for (size_t i = 0; i < report.histograms.size(); ++i) {
+    const auto& h = report.histograms[i].second;
+    out << (i ? "," : "") << "\n      "
+        << json_string(report.histograms[i].first) << ": {\"count\": "
+        << h.count() << ", \"sum\": " << h.sum() << ", \"max\": " << h.max()
+        << ", \"buckets\": [";
+    bool first = true;
+    for (size_t j = 0; j < h.buckets().size(); ++j) {
+      if (!h.buckets()[j])
+        continue;
+      out << (first ? "" : ", ") << "{\"min\": " << Histogram::LowerBound(j)
+          << ", \"max\": " << Histogram::UpperBound(j)
+          << ", \"count\": " << h.buckets()[j] << "}";
+      first = false;
+    }
+    out << "]}";
+  }
+  out << "\n    },\n    \"largest\": {";
+  for (size_t i = 0; i < report.largest.size(); ++i) {
+    out << (i ? "," : "") << "\n      " << json_string(report.largest[i].first)
+        << ": [";
+    const auto& items = report.largest[i].second.items();
+    for (size_t j = 0; j < items.size(); ++j) {
+      out << (j ? ", " : "") << "{\"key\": " << json_string(items[j].second)
+          << ", \"size\": " << items[j].first << "}";
+    }
+    out << "]";
+  }
+  out << "\n    }\n  }" << (last ? "" : ",") << "\n";
+}
+
+int main(int argc, char* argv[]) {
+  unsigned int codepage = SetConsoleOutputCodePage();
+  bool json = false;
+  size_t top = 10;
+  vector<string> files;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg == "--json") {
+      json = true;
+    } else if (starts_with(arg, "--top=")) {
+      top = static_cast<size_t>(atoi(arg.c_str() + 6));
+    } else if (starts_with(arg, "--")) {
+      files.clear();
+      break;
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.empty()) {
+    std::cerr << "usage: " << argv[0] << " [--json] [--top=<n>] <file>..."
+              << std::endl;
+    SetConsoleOutputCodePage(codepage);
+    return 1;
+  }
+  int ret = 0;
+  vector<Report> reports;
+  for (const auto& file_name : files) {
+    Report report;
+    if (!collect_stats(file_name, top, &report)) {
+      std::cerr << "Error loading dictionary file: " << file_name << std::endl;
+      ret = 1;
+      continue;
+    }
+    reports.push_back(std::move(report));
+  }
+  if (json) {
+    std::cout << "[\n";
+    for (size_t i = 0; i < reports.size(); ++i) {
+      print_json(reports[i], i + 1 == reports.size());
+    }
+    std::cout << "]" << std::endl;
+  } else {
+    for (const auto& report : reports) {
+      print_text(report);
+    }
+  }
+  SetConsoleOutputCodePage(codepage);
+  return ret;
+}
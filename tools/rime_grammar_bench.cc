@@ -0,0 +1,143 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Measures the cost of scoring words with a compiled n-gram model.
+//
+// usage: rime_grammar_bench [--rounds=<n>] <model.ngram.bin> [<text>]
+//
+// Queries are made of the words of the model, or of the lines of a text file
+// split by the grammar component itself. Reports nanoseconds per call of
+// NgramModel::Score, with the context resolved ahead, and per call of
+// Grammar::Query, which looks up the words by their text, with a new context
+// for every call and with several words scored in each context.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <utf8.h>
+#include <rime/config.h>
+#include <rime/gear/ngram_grammar.h>
+
+using namespace rime;
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+  string context;
+  string word;
+};
+
+static double elapsed_ns(Clock::time_point start, size_t calls) {
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start)
+                .count();
+  return calls ? double(ns) / calls : 0.0;
+}
+
+// takes the context and the word at each character boundary of the text
+static void load_samples(const string& file_name, vector<Sample>* samples) {
+  std::ifstream in(file_name.c_str());
+  string line;
+  while (std::getline(in, line)) {
+    const char* begin = line.c_str();
+    const char* end = begin + line.length();
+    for (const char* p = begin; p < end;) {
+      const char* q = p;
+      utf8::unchecked::next(q);
+      samples->push_back({string(begin, p), string(p, q)});
+      p = q;
+    }
+  }
+}
+
+static void make_samples(NgramModel* model, vector<Sample>* samples) {
+  uint32_t n = model->num_words();
+  for (uint32_t i = 0; i < n; ++i) {
+    samples->push_back(
+        {model->GetWord((i * 7919u) % n), model->GetWord(i)});
+  }
+}
+
+int main(int argc, char* argv[]) {
+  int rounds = 10;
+  vector<string> args;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg.compare(0, 9, "--rounds=") == 0) {
+      rounds = atoi(arg.c_str() + 9);
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.empty() || args.size() > 2 || rounds < 1) {
+    std::cerr << "usage: " << argv[0]
+              << " [--rounds=<n>] <model.ngram.bin> [<text>]" << std::endl;
+    return 1;
+  }
+  auto model = New<NgramModel>(args[0]);
+  if (!model->Load()) {
+    std::cerr << "Error loading n-gram model: " << args[0] << std::endl;
+    return 1;
+  }
+  vector<Sample> samples;
+  if (args.size() == 2) {
+    load_samples(args[1], &samples);
+  } else {
+    make_samples(model.get(), &samples);
+  }
+  if (samples.empty()) {
+    std::cerr << "no samples." << std::endl;
+    return 1;
+  }
+  std::cout << "samples: " << samples.size() << std::endl;
+
+  vector<NgramModel::State> states(samples.size());
+  vector<NgramModel::WordId> word_ids(samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const auto& s = samples[i];
+    NgramModel::WordId context[] = {
+        model->FindWord(s.context.c_str(), s.context.length())};
+    model->SetContext(context, context[0] != kInvalidStringId ? 1 : 0,
+                      &states[i]);
+    word_ids[i] = model->FindWord(s.word.c_str(), s.word.length());
+  }
+  double sum = 0.0;
+  auto start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+      sum += model->Score(states[i], word_ids[i]);
+    }
+  }
+  std::cout << "Score: " << elapsed_ns(start, rounds * samples.size())
+            << " ns" << std::endl;
+
+  NgramGrammar grammar(nullptr, model);
+  start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (const auto& s : samples) {
+      sum += grammar.Query(s.context, s.word, false);
+    }
+  }
+  std::cout << "Query: " << elapsed_ns(start, rounds * samples.size())
+            << " ns" << std::endl;
+
+  // the poet scores the words at a position in the same context
+  const size_t kWordsPerContext = 8;
+  start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+      for (size_t j = 0; j < kWordsPerContext; ++j) {
+        const auto& word = samples[(i + j) % samples.size()].word;
+        sum += grammar.Query(samples[i].context, word, false);
+      }
+    }
+  }
+  std::cout << "Query, " << kWordsPerContext << " words per context: "
+            << elapsed_ns(start, rounds * samples.size() * kWordsPerContext)
+            << " ns" << std::endl;
+  // keeps the loops from being optimized away
+  std::cerr << "checksum: " << sum << std::endl;
+  return 0;
+}
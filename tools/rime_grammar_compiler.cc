@@ -0,0 +1,98 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Compiles n-gram counts into a memory-mapped language model, which is
+// loaded by the built-in grammar component as <language>.ngram.bin.
+//
+// usage: rime_grammar_compiler [--order=<n>] <counts.txt> <output.ngram.bin>
+//
+// Each line of the count file holds the words of one n-gram separated by
+// spaces, then a tab and its count:
+//
+//   <s> 你好	12
+//   你好 世界	3
+//
+// Lines starting with '#' are comments. Use <s> and </s> to mark the
+// beginning and the end of sentences.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <rime/dict/ngram_model.h>
+
+using namespace rime;
+
+static bool load_counts(const string& file_name,
+                        int order,
+                        NgramCounts* counts) {
+  std::ifstream in(file_name.c_str());
+  if (!in) {
+    std::cerr << "Error opening file: " << file_name << std::endl;
+    return false;
+  }
+  string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    size_t tab = line.rfind('\t');
+    if (tab == string::npos) {
+      std::cerr << file_name << ":" << line_number << ": missing count."
+                << std::endl;
+      return false;
+    }
+    double count = atof(line.c_str() + tab + 1);
+    vector<string> words;
+    std::istringstream iss(line.substr(0, tab));
+    string word;
+    while (iss >> word) {
+      words.push_back(word);
+    }
+    if (words.empty() || (int)words.size() > order)
+      continue;
+    (*counts)[words] += count;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int order = 3;
+  vector<string> args;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg.compare(0, 8, "--order=") == 0) {
+      order = atoi(arg.c_str() + 8);
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() != 2 || order < 1 || order > ngram::kMaxOrder) {
+    std::cerr << "usage: " << argv[0]
+              << " [--order=<n>] <counts.txt> <output.ngram.bin>" << std::endl
+              << "order: 1 to " << ngram::kMaxOrder << ", default 3"
+              << std::endl;
+    return 1;
+  }
+  NgramCounts counts;
+  if (!load_counts(args[0], order, &counts)) {
+    return 1;
+  }
+  NgramModel model(args[1]);
+  model.Remove();
+  if (!model.Build(counts, order) || !model.Save() || !model.Load()) {
+    std::cerr << "Error building n-gram model: " << args[1] << std::endl;
+    return 1;
+  }
+  std::cout << "words: " << model.num_words() << std::endl;
+  for (int k = 1; k <= model.order(); ++k) {
+    std::cout << k << "-grams: " << model.num_ngrams(k) << std::endl;
+  }
+  std::cout << "file size: " << model.file_size() << std::endl;
+  return 0;
+}
@@ -0,0 +1,515 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Drives many sessions from many threads through the API and reports
+// throughput, per-operation latency and memory growth.
+//
+// usage: rime_loadgen [options]
+//
+//   --schemas=<id[:weight],...>  schema mix, default luna_pinyin
+//   --sessions=<n>               concurrent sessions, default 100
+//   --threads=<n>                worker threads, default 4
+//   --duration=<seconds>         how long to run, default 10
+//   --corpus=<file>              key sequences, one input per line
+//   --churn=<n>                  recreate a session every n inputs, 0 = never
+//   --lock=<global|none>         serialize API calls across threads,
+//                                default global
+//   --interval=<seconds>         progress report interval, default 1
+//
+// Each session belongs to exactly one worker thread. With --lock=global,
+// API calls from different threads are serialized by a mutex, which is
+// the safe setting for the library; --lock=none lets calls overlap to
+// expose contention on shared state.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rime_api.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+using std::string;
+using std::vector;
+using Clock = std::chrono::steady_clock;
+
+static const char* kDefaultCorpus[] = {
+    "nihao",
+    "zhongguo",
+    "women",
+    "shurufa",
+    "pinyin",
+    "jintiantianqihenhao",
+    "xiexie",
+    "mingtianjian",
+    "zhongwen",
+    "dajiahao",
+};
+
+enum Operation {
+  kCreateSession,
+  kSelectSchema,
+  kProcessKey,
+  kGetContext,
+  kCommit,
+  kDestroySession,
+  kNumOperations,
+};
+
+static const char* kOperationNames[kNumOperations] = {
+    "create_session", "select_schema", "process_key",
+    "get_context",    "commit",        "destroy_session",
+};
+
+// Latencies in nanoseconds, in log-linear buckets with 16 sub-buckets per
+// power of two, so memory use is constant however long the run.
+class Histogram {
+ public:
+  static const int kSubBuckets = 16;
+  static const int kNumBuckets = 64 * kSubBuckets;
+
+  Histogram() : buckets_(kNumBuckets, 0) {}
+
+  void Record(uint64_t value) {
+    ++buckets_[BucketOf(value)];
+    ++count_;
+    sum_ += value;
+    max_ = std::max(max_, value);
+  }
+
+  void Merge(const Histogram& other) {
+    for (int i = 0; i < kNumBuckets; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  // upper bound of the bucket holding the given quantile
+  uint64_t Percentile(double quantile) const {
+    if (count_ == 0)
+      return 0;
+    uint64_t rank = static_cast<uint64_t>(quantile * (count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank)
+        return std::min(UpperBoundOf(i), max_);
+    }
+    return max_;
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t mean() const { return count_ ? sum_ / count_ : 0; }
+  uint64_t max() const { return max_; }
+
+ private:
+  static int BucketOf(uint64_t value) {
+    if (value < kSubBuckets)
+      return static_cast<int>(value);
+    int exponent = 0;
+    while (value >> (exponent + 1))
+      ++exponent;
+    int shift = exponent - 4;
+    int sub = static_cast<int>((value >> shift) & (kSubBuckets - 1));
+    return (shift + 1) * kSubBuckets + sub;
+  }
+
+  static uint64_t UpperBoundOf(int bucket) {
+    if (bucket < kSubBuckets)
+      return bucket;
+    int shift = bucket / kSubBuckets - 1;
+    uint64_t sub = bucket % kSubBuckets;
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+  }
+
+  vector<uint64_t> buckets_;
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+struct Options {
+  vector<std::pair<string, int>> schemas;
+  int sessions = 100;
+  int threads = 4;
+  int duration = 10;
+  string corpus;
+  int churn = 0;
+  bool global_lock = true;
+  int interval = 1;
+};
+
+static std::mutex g_api_mutex;
+static std::atomic<bool> g_stop(false);
+static std::atomic<uint64_t> g_keys(0);
+static std::atomic<uint64_t> g_inputs(0);
+static std::atomic<uint64_t> g_errors(0);
+
+static size_t resident_set_size() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return counters.WorkingSetSize;
+  return 0;
+#else
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm) {
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+    if (n == 2)
+      return static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE);
+  }
+  // peak rather than current, where /proc is unavailable
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+  }
+  return 0;
+#endif
+}
+
+class Worker {
+ public:
+  Worker(const Options& options,
+         const vector<string>& corpus,
+         const vector<string>& schema_pool,
+         int num_sessions,
+         unsigned seed)
+      : options_(options),
+        corpus_(corpus),
+        schema_pool_(schema_pool),
+        num_sessions_(num_sessions),
+        random_(seed) {}
+
+  void Run() {
+    rime_ = rime_get_api();
+    for (int i = 0; i < num_sessions_; ++i) {
+      slots_.push_back(Slot());
+      Open(&slots_.back());
+    }
+    for (size_t i = 0; !g_stop; i = (i + 1) % slots_.size()) {
+      Slot& slot = slots_[i];
+      if (!slot.session_id) {
+        Open(&slot);
+        continue;
+      }
+      Type(&slot, corpus_[random_() % corpus_.size()]);
+      if (options_.churn > 0 && ++slot.inputs % options_.churn == 0) {
+        Close(&slot);
+        Open(&slot);
+      }
+    }
+    for (auto& slot : slots_) {
+      Close(&slot);
+    }
+  }
+
+  const Histogram& latency(Operation op) const { return latencies_[op]; }
+
+ private:
+  struct Slot {
+    RimeSessionId session_id = 0;
+    int inputs = 0;
+  };
+
+  template <class Call>
+  auto Timed(Operation op, Call call) -> decltype(call()) {
+    std::unique_lock<std::mutex> lock(g_api_mutex, std::defer_lock);
+    if (options_.global_lock)
+      lock.lock();
+    auto start = Clock::now();
+    auto result = call();
+    auto elapsed = Clock::now() - start;
+    latencies_[op].Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return result;
+  }
+
+  void Open(Slot* slot) {
+    slot->session_id = Timed(kCreateSession, [&] {
+      return rime_->create_session();
+    });
+    if (!slot->session_id) {
+      ++g_errors;
+      return;
+    }
+    const string& schema_id = schema_pool_[random_() % schema_pool_.size()];
+    if (!Timed(kSelectSchema, [&] {
+          return rime_->select_schema(slot->session_id, schema_id.c_str());
+        })) {
+      ++g_errors;
+    }
+  }
+
+  void Close(Slot* slot) {
+    if (!slot->session_id)
+      return;
+    if (!Timed(kDestroySession, [&] {
+          return rime_->destroy_session(slot->session_id);
+        })) {
+      ++g_errors;
+    }
+    slot->session_id = 0;
+  }
+
+  // types the input one key at a time, refreshing the context after each
+  // key as a front end would, then commits the composition.
+  void Type(Slot* slot, const string& input) {
+    RimeSessionId session_id = slot->session_id;
+    for (char ch : input) {
+      if (!Timed(kProcessKey, [&] {
+            return rime_->process_key(session_id, ch, 0);
+          })) {
+        ++g_errors;
+      }
+      ++g_keys;
+      Timed(kGetContext, [&] {
+        RIME_STRUCT(RimeContext, context);
+        Bool ok = rime_->get_context(session_id, &context);
+        if (ok)
+          rime_->free_context(&context);
+        return ok;
+      });
+    }
+    Timed(kCommit, [&] {
+      Bool ok = rime_->commit_composition(session_id);
+      RIME_STRUCT(RimeCommit, commit);
+      if (rime_->get_commit(session_id, &commit))
+        rime_->free_commit(&commit);
+      return ok;
+    });
+    ++g_inputs;
+  }
+
+  const Options& options_;
+  const vector<string>& corpus_;
+  const vector<string>& schema_pool_;
+  int num_sessions_;
+  std::minstd_rand random_;
+  RimeApi* rime_ = nullptr;
+  vector<Slot> slots_;
+  Histogram latencies_[kNumOperations];
+};
+
+static bool parse_schemas(const string& value, Options* options) {
+  options->schemas.clear();
+  size_t start = 0;
+  while (start <= value.length()) {
+    size_t end = value.find(',', start);
+    if (end == string::npos)
+      end = value.length();
+    string item = value.substr(start, end - start);
+    int weight = 1;
+    size_t colon = item.find(':');
+    if (colon != string::npos) {
+      weight = atoi(item.c_str() + colon + 1);
+      item.resize(colon);
+    }
+    if (item.empty() || weight <= 0)
+      return false;
+    options->schemas.emplace_back(item, weight);
+    start = end + 1;
+  }
+  return !options->schemas.empty();
+}
+
+static bool parse_options(int argc, char* argv[], Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == string::npos)
+      return false;
+    string name = arg.substr(2, eq - 2);
+    string value = arg.substr(eq + 1);
+    if (name == "schemas") {
+      if (!parse_schemas(value, options))
+        return false;
+    } else if (name == "sessions") {
+      options->sessions = atoi(value.c_str());
+    } else if (name == "threads") {
+      options->threads = atoi(value.c_str());
+    } else if (name == "duration") {
+      options->duration = atoi(value.c_str());
+    } else if (name == "corpus") {
+      options->corpus = value;
+    } else if (name == "churn") {
+      options->churn = atoi(value.c_str());
+    } else if (name == "lock") {
+      if (value != "global" && value != "none")
+        return false;
+      options->global_lock = value == "global";
+    } else if (name == "interval") {
+      options->interval = atoi(value.c_str());
+    } else {
+      return false;
+    }
+  }
+  if (options->schemas.empty())
+    options->schemas.emplace_back("luna_pinyin", 1);
+  return options->sessions > 0 && options->threads > 0 &&
+         options->duration > 0 && options->churn >= 0 &&
+         options->interval > 0;
+}
+
+static bool load_corpus(const string& file_name, vector<string>* corpus) {
+  if (file_name.empty()) {
+    corpus->assign(std::begin(kDefaultCorpus), std::end(kDefaultCorpus));
+    return true;
+  }
+  std::ifstream fin(file_name);
+  if (!fin)
+    return false;
+  string line;
+  while (std::getline(fin, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty() && line[0] != '#')
+      corpus->push_back(line);
+  }
+  return !corpus->empty();
+}
+
+static void print_latency(const char* name, const Histogram& histogram) {
+  if (histogram.count() == 0)
+    return;
+  printf("%-16s %10llu %8.1f %8.1f %8.1f %8.1f %8.1f %10.1f\n", name,
+         (unsigned long long)histogram.count(), histogram.mean() / 1e3,
+         histogram.Percentile(0.5) / 1e3, histogram.Percentile(0.9) / 1e3,
+         histogram.Percentile(0.99) / 1e3, histogram.Percentile(0.999) / 1e3,
+         histogram.max() / 1e3);
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parse_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--schemas=<id[:weight],...>] [--sessions=<n>] "
+            "[--threads=<n>] [--duration=<seconds>] [--corpus=<file>] "
+            "[--churn=<n>] [--lock=<global|none>] [--interval=<seconds>]\n",
+            argv[0]);
+    return 1;
+  }
+  vector<string> corpus;
+  if (!load_corpus(options.corpus, &corpus)) {
+    fprintf(stderr, "Error loading corpus: %s\n", options.corpus.c_str());
+    return 1;
+  }
+  // weighted schema mix, picked uniformly by the workers
+  vector<string> schema_pool;
+  for (const auto& schema : options.schemas) {
+    schema_pool.insert(schema_pool.end(), schema.second, schema.first);
+  }
+
+  RimeApi* rime = rime_get_api();
+  RIME_STRUCT(RimeTraits, traits);
+  traits.app_name = "rime.loadgen";
+  rime->setup(&traits);
+
+  fprintf(stderr, "initializing...\n");
+  rime->initialize(NULL);
+  if (rime->start_maintenance(False))
+    rime->join_maintenance_thread();
+
+  size_t initial_rss = resident_set_size();
+  printf("sessions: %d, threads: %d, duration: %ds, churn: %d, lock: %s\n",
+         options.sessions, options.threads, options.duration, options.churn,
+         options.global_lock ? "global" : "none");
+
+  vector<std::unique_ptr<Worker>> workers;
+  for (int i = 0; i < options.threads; ++i) {
+    int num_sessions = options.sessions / options.threads +
+                       (i < options.sessions % options.threads ? 1 : 0);
+    if (num_sessions == 0)
+      break;
+    workers.emplace_back(
+        new Worker(options, corpus, schema_pool, num_sessions, 1 + i));
+  }
+  auto start = Clock::now();
+  vector<std::thread> threads;
+  for (auto& worker : workers) {
+    threads.emplace_back(&Worker::Run, worker.get());
+  }
+
+  printf("%8s %12s %10s %12s %12s\n", "time(s)", "keys", "keys/s", "inputs",
+         "rss(KiB)");
+  auto deadline = start + std::chrono::seconds(options.duration);
+  auto next_report = start;
+  uint64_t last_keys = 0;
+  while (Clock::now() < deadline) {
+    next_report += std::chrono::seconds(options.interval);
+    std::this_thread::sleep_until(std::min(next_report, deadline));
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t keys = g_keys;
+    printf("%8.1f %12llu %10.0f %12llu %12zu\n", elapsed,
+           (unsigned long long)keys,
+           (keys - last_keys) / double(options.interval),
+           (unsigned long long)g_inputs.load(), resident_set_size() / 1024);
+    fflush(stdout);
+    last_keys = keys;
+  }
+  g_stop = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  size_t final_rss = resident_set_size();
+
+  Histogram latencies[kNumOperations];
+  for (const auto& worker : workers) {
+    for (int op = 0; op < kNumOperations; ++op) {
+      latencies[op].Merge(worker->latency(Operation(op)));
+    }
+  }
+  printf("\nthroughput: %.0f keys/s, %.0f inputs/s, %llu errors\n",
+         g_keys / elapsed, g_inputs / elapsed,
+         (unsigned long long)g_errors.load());
+  printf("\nlatency (us):\n");
+  printf("%-16s %10s %8s %8s %8s %8s %8s %10s\n", "operation", "count",
+         "mean", "p50", "p90", "p99", "p99.9", "max");
+  for (int op = 0; op < kNumOperations; ++op) {
+    print_latency(kOperationNames[op], latencies[op]);
+  }
+  uint64_t creations = latencies[kCreateSession].count();
+  if (creations > 0) {
+    printf("\nsession creation cost: %.1f us (create + select schema)\n",
+           (latencies[kCreateSession].mean() +
+            latencies[kSelectSchema].mean()) /
+               1e3);
+  }
+  printf("\nrss: %zu KiB at start, %zu KiB at end, growth %lld KiB\n",
+         initial_rss / 1024, final_rss / 1024,
+         ((long long)final_rss - (long long)initial_rss) / 1024);
+
+  RIME_STRUCT(RimeMemoryStats, stats);
+  if (rime->get_memory_stats(&stats)) {
+    printf("mapped: %zu bytes, dbs: %zu bytes, configs: %zu bytes, "
+           "sessions left: %d\n",
+           stats.mapped_bytes, stats.db_bytes, stats.config_bytes,
+           stats.num_sessions);
+  }
+  rime->finalize();
+  return g_errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Reports memory held by the library after loading a schema.
+//
+// usage: rime_memory_stats [schema_id [key_sequence]]
+//
+#include <stdio.h>
+#include <rime_api.h>
+
+static void print_memory_stats(const RimeMemoryStats& stats) {
+  printf("mapped files: %d (tables: %d, prisms: %d, reverse dbs: %d)\n",
+         stats.num_mapped_files, stats.num_tables, stats.num_prisms,
+         stats.num_reverse_dbs);
+  printf("  mapped bytes: %zu\n", stats.mapped_bytes);
+  printf("  resident bytes: %zu\n", stats.resident_bytes);
+  printf("  cached by dictionaries: %d (%zu bytes)\n",
+         stats.num_cached_dict_files, stats.cached_dict_bytes);
+  printf("dbs: %d\n", stats.num_dbs);
+  printf("  estimated bytes: %zu\n", stats.db_bytes);
+  printf("  cached by user dictionaries: %d (%zu bytes)\n",
+         stats.num_cached_user_dbs, stats.cached_user_db_bytes);
+  printf("sessions: %d\n", stats.num_sessions);
+  printf("  estimated bytes: %zu\n", stats.session_bytes);
+  printf("    engines: %zu\n", stats.engine_bytes);
+  printf("    contexts: %zu\n", stats.context_bytes);
+  printf("    menus: %zu\n", stats.menu_bytes);
+  printf("configs: %d\n", stats.num_configs);
+  printf("  estimated bytes: %zu\n", stats.config_bytes);
+}
+
+static void print_session_memory_stats(const RimeSessionMemoryStats& stats) {
+  printf("this session:\n");
+  printf("  session bytes: %zu\n", stats.session_bytes);
+  printf("  engine bytes: %zu\n", stats.engine_bytes);
+  printf("  context bytes: %zu\n", stats.context_bytes);
+  printf("  menu bytes: %zu\n", stats.menu_bytes);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 3) {
+    fprintf(stderr, "usage: %s [schema_id [key_sequence]]\n", argv[0]);
+    return 1;
+  }
+  RimeApi* rime = rime_get_api();
+
+  RIME_STRUCT(RimeTraits, traits);
+  traits.app_name = "rime.memory_stats";
+  rime->setup(&traits);
+
+  fprintf(stderr, "initializing...\n");
+  rime->initialize(NULL);
+  if (rime->start_maintenance(False))
+    rime->join_maintenance_thread();
+
+  RimeSessionId session_id = rime->create_session();
+  if (!session_id) {
+    fprintf(stderr, "Error creating rime session.\n");
+    rime->finalize();
+    return 1;
+  }
+  int ret = 0;
+  if (argc > 1 && !rime->select_schema(session_id, argv[1])) {
+    fprintf(stderr, "Error selecting schema: %s\n", argv[1]);
+    ret = 1;
+  } else if (argc > 2 && !rime->simulate_key_sequence(session_id, argv[2])) {
+    fprintf(stderr, "Error processing key sequence: %s\n", argv[2]);
+    ret = 1;
+  } else {
+    RIME_STRUCT(RimeMemoryStats, stats);
+    RIME_STRUCT(RimeSessionMemoryStats, session_stats);
+    if (rime->get_memory_stats(&stats) &&
+        rime->get_session_memory_stats(session_id, &session_stats)) {
+      print_memory_stats(stats);
+      print_session_memory_stats(session_stats);
+    } else {
+      fprintf(stderr, "Error getting memory stats.\n");
+      ret = 1;
+    }
+  }
+
+  rime->destroy_session(session_id);
+  rime->finalize();
+  return ret;
+}
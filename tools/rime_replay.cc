@@ -0,0 +1,134 @@
+//
+// Copyright RIME Developers
+// Distributed under the BSD License
+//
+// Replays the keys dumped by the flight recorder of a session on a slow key,
+// to reproduce and profile the slow path offline.
+//
+// usage: rime_replay [--repeat=<n>] <dump-file>
+//
+// Run it in a copy of the user data directory where the keys were recorded,
+// so that the same schema, dictionaries and user data are used. Before each
+// key, the schema, options, input and caret of the session are restored as
+// recorded. Prints the recorded and replayed time of every key; with
+// --repeat, the keys are replayed n times in new sessions and the shortest
+// time is reported.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <rime_api.h>
+#include <rime/flight_recorder.h>
+#include <rime/key_event.h>
+#include "codepage.h"
+
+using namespace rime;
+
+static bool replay(RimeApi* rime,
+                   const vector<KeystrokeRecord>& records,
+                   vector<int64_t>* elapsed_us) {
+  RimeSessionId session_id = rime->create_session();
+  if (!session_id) {
+    fprintf(stderr, "Error creating rime session.\n");
+    return false;
+  }
+  string schema_id;
+  for (size_t i = 0; i < records.size(); ++i) {
+    const auto& record = records[i];
+    if (!record.schema_id.empty() && record.schema_id != schema_id) {
+      if (!rime->select_schema(session_id, record.schema_id.c_str())) {
+        fprintf(stderr, "Error selecting schema: %s\n",
+                record.schema_id.c_str());
+      }
+      schema_id = record.schema_id;
+    }
+    for (const auto& option : record.options) {
+      if (bool(rime->get_option(session_id, option.first.c_str())) !=
+          option.second) {
+        rime->set_option(session_id, option.first.c_str(), option.second);
+      }
+    }
+    const char* input = rime->get_input(session_id);
+    if (record.input != (input ? input : "")) {
+      rime->set_input(session_id, record.input.c_str());
+    }
+    if (rime->get_caret_pos(session_id) != record.caret_pos) {
+      rime->set_caret_pos(session_id, record.caret_pos);
+    }
+    KeyEvent key_event;
+    if (!key_event.Parse(record.key)) {
+      fprintf(stderr, "Invalid key: %s\n", record.key.c_str());
+      continue;
+    }
+    auto start = std::chrono::steady_clock::now();
+    rime->process_key(session_id, key_event.keycode(), key_event.modifier());
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    (*elapsed_us)[i] = (std::min)(
+        (*elapsed_us)[i],
+        (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count());
+    RIME_STRUCT(RimeCommit, commit);
+    if (rime->get_commit(session_id, &commit))
+      rime->free_commit(&commit);
+  }
+  rime->destroy_session(session_id);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int repeat = 1;
+  const char* dump_file = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strncmp(argv[i], "--repeat=", 9)) {
+      repeat = atoi(argv[i] + 9);
+    } else if (!dump_file) {
+      dump_file = argv[i];
+    } else {
+      dump_file = nullptr;
+      break;
+    }
+  }
+  if (!dump_file || repeat < 1) {
+    fprintf(stderr, "usage: %s [--repeat=<n>] <dump-file>\n", argv[0]);
+    return 1;
+  }
+  vector<KeystrokeRecord> records;
+  if (!FlightRecorder::Load(dump_file, &records) || records.empty()) {
+    fprintf(stderr, "Error loading keys from %s\n", dump_file);
+    return 1;
+  }
+  unsigned int codepage = SetConsoleOutputCodePage();
+  RimeApi* rime = rime_get_api();
+  RIME_STRUCT(RimeTraits, traits);
+  traits.app_name = "rime.replay";
+  rime->setup(&traits);
+  fprintf(stderr, "initializing...\n");
+  rime->initialize(NULL);
+  if (rime->start_maintenance(False))
+    rime->join_maintenance_thread();
+
+  vector<int64_t> elapsed_us(records.size(),
+                             std::numeric_limits<int64_t>::max());
+  bool success = true;
+  for (int i = 0; i < repeat && success; ++i) {
+    success = replay(rime, records, &elapsed_us);
+  }
+  if (success) {
+    printf("%-4s %-16s %12s %12s  %s\n", "#", "key", "recorded_us",
+           "replayed_us", "input");
+    for (size_t i = 0; i < records.size(); ++i) {
+      const auto& record = records[i];
+      size_t caret_pos = (std::min)(record.caret_pos, record.input.length());
+      printf("%-4zu %-16s %12lld %12lld  %s|%s\n", i + 1, record.key.c_str(),
+             (long long)record.elapsed_us, (long long)elapsed_us[i],
+             record.input.substr(0, caret_pos).c_str(),
+             record.input.substr(caret_pos).c_str());
+    }
+  }
+  rime->finalize();
+  SetConsoleOutputCodePage(codepage);
+  return success ? 0 : 1;
+}
@@ -1,21 +1,41 @@
 // rime_table_decompiler.cc
 // nopdan <me@nopdan.com>
 //
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 #include <rime/dict/table.h>
 #include "codepage.h"
 
 // usage:
-//   rime_table_decompiler <rime-table-file> [save-path]
+//   rime_table_decompiler [options] <rime-table-file> [save-path]
+// options:
+//   --threads=<n>          decoding threads, default: hardware threads
+//   --syllable=<spelling>  only entries whose code starts with the syllable
+//   --range=<from>:<to>    only entries whose first syllable is in the
+//                          range [from, to) of spellings; either end can be
+//                          omitted
 // example:
 //   rime_table_decompiler pinyin.table.bin pinyin.dict.yaml
+//   rime_table_decompiler --range=a:c pinyin.table.bin a-b.dict.yaml
+//
+// The head index is split into ranges of syllables decoded in parallel.
+// Decoded ranges are written in order, so the output is the same for any
+// number of threads.
 
-void outCode(rime::Table* table, const rime::Code code, std::ofstream& fout) {
+void outCode(rime::Table* table, const rime::Code code, std::ostream& fout) {
   if (code.empty()) {
     return;
   }
@@ -31,7 +51,7 @@ void outCode(rime::Table* table, const rime::Code code, std::ofstream& fout) {
 
 void access(rime::Table* table,
             rime::TableAccessor accessor,
-            std::ofstream& fout) {
+            std::ostream& fout) {
   while (!accessor.exhausted()) {
     auto word = table->GetEntryText(*accessor.entry());
     fout << word << "\t";
@@ -41,54 +61,187 @@ void access(rime::Table* table,
     if (weight >= 0) {
       fout << "\t" << exp(weight);
     }
-    fout << std::endl;
+    fout << "\n";
     accessor.Next();
   }
 }
 
+void recursion(rime::Table* table,
+               rime::TableQuery* query,
+               std::ostream& fout);
+
+// entries under syllable i at the current level of the query
+void visit(rime::Table* table,
+           rime::TableQuery* query,
+           int i,
+           std::ostream& fout) {
+  auto accessor = query->Access(i);
+  access(table, accessor, fout);
+  if (query->Advance(i)) {
+    if (query->level() < 3) {
+      recursion(table, query, fout);
+    } else {
+      auto accessor = query->Access(0);
+      access(table, accessor, fout);
+    }
+    query->Backdate();
+  }
+}
+
 // recursively traverse table
 void recursion(rime::Table* table,
                rime::TableQuery* query,
-               std::ofstream& fout) {
+               std::ostream& fout) {
   for (int i = 0; i < table->metadata()->num_syllables; i++) {
-    auto accessor = query->Access(i);
-    access(table, accessor, fout);
-    if (query->Advance(i)) {
-      if (query->level() < 3) {
-        recursion(table, query, fout);
-      } else {
-        auto accessor = query->Access(0);
-        access(table, accessor, fout);
-      }
-      query->Backdate();
-    }
+    visit(table, query, i, fout);
   }
 }
 
-void traversal(rime::Table* table, std::ofstream& fout) {
+// decodes entries whose first syllable is in [begin, end)
+std::string decompile(rime::Table* table, int begin, int end) {
+  std::ostringstream out;
+  out << std::fixed;
+  out << std::setprecision(0);
+  rime::TableQuery query(table);
+  for (int i = begin; i < end; i++) {
+    visit(table, &query, i, out);
+  }
+  return out.str();
+}
+
+// decodes ranges of head syllables in parallel, and writes them in order.
+// at most `window` decoded ranges wait to be written.
+void traversal(rime::Table* table,
+               int begin,
+               int end,
+               int num_threads,
+               std::ostream& fout) {
   auto metadata = table->metadata();
   std::cout << "num_syllables: " << metadata->num_syllables << std::endl;
   std::cout << "num_entries: " << metadata->num_entries << std::endl;
+  if (begin >= end)
+    return;
 
-  fout << std::fixed;
-  fout << std::setprecision(0);
-  rime::TableQuery query(table->metadata()->index.get());
-  recursion(table, &query, fout);
+  const int kChunksPerThread = 16;
+  int chunk_size =
+      std::max(1, (end - begin) / (num_threads * kChunksPerThread));
+  int num_chunks = (end - begin + chunk_size - 1) / chunk_size;
+  const int window = num_threads * 2;
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::condition_variable writable;
+  std::map<int, std::string> decoded;
+  int num_written = 0;
+  std::atomic<int> next_chunk{0};
+
+  auto worker = [&] {
+    for (int k = next_chunk++; k < num_chunks; k = next_chunk++) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        writable.wait(lock, [&] { return k < num_written + window; });
+      }
+      int chunk_begin = begin + k * chunk_size;
+      int chunk_end = std::min(chunk_begin + chunk_size, end);
+      std::string text = decompile(table, chunk_begin, chunk_end);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded[k] = std::move(text);
+      }
+      ready.notify_one();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (int k = 0; k < num_chunks; ++k) {
+    std::string text;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ready.wait(lock, [&] { return decoded.count(k) != 0; });
+      text = std::move(decoded[k]);
+      decoded.erase(k);
+      ++num_written;
+    }
+    writable.notify_all();
+    fout << text;
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// head syllable ids [begin, end) of spellings [from, to);
+// syllable ids are in the order of spellings.
+void find_range(rime::Table* table,
+                const std::string& from,
+                const std::string& to,
+                int* begin,
+                int* end) {
+  int num_syllables = table->metadata()->num_syllables;
+  *begin = num_syllables;
+  *end = num_syllables;
+  for (int i = 0; i < num_syllables; ++i) {
+    auto syllable = table->GetSyllableById(i);
+    if (*begin == num_syllables && syllable >= from)
+      *begin = i;
+    if (!to.empty() && syllable >= to) {
+      *end = i;
+      break;
+    }
+  }
+  *end = std::max(*begin, *end);
+}
+
+void usage() {
+  std::cout << "Usage: rime_table_decompiler [--threads=<n>] "
+               "[--syllable=<spelling> | --range=<from>:<to>] "
+               "<rime-table-file> [save-path]"
+            << std::endl;
+  std::cout
+      << "Example: rime_table_decompiler pinyin.table.bin pinyin.dict.yaml"
+      << std::endl;
 }
 
 int main(int argc, char* argv[]) {
   unsigned int codepage = SetConsoleOutputCodePage();
-  if (argc < 2 || argc > 3) {
-    std::cout << "Usage: rime_table_decompiler <rime-table-file> [save-path]"
-              << std::endl;
-    std::cout
-        << "Example: rime_table_decompiler pinyin.table.bin pinyin.dict.yaml"
-        << std::endl;
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool filtered = false;
+  std::string syllable;
+  std::string from, to;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0) {
+      args.push_back(arg);
+      continue;
+    }
+    std::string name = arg.substr(2, eq == std::string::npos ? eq : eq - 2);
+    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    if (name == "threads") {
+      num_threads = atoi(value.c_str());
+    } else if (name == "syllable" && !value.empty() && !filtered) {
+      syllable = value;
+      filtered = true;
+    } else if (name == "range" && value.find(':') != std::string::npos &&
+               !filtered) {
+      from = value.substr(0, value.find(':'));
+      to = value.substr(value.find(':') + 1);
+      filtered = true;
+    } else {
+      args.clear();
+      break;
+    }
+  }
+  if (args.size() < 1 || args.size() > 2 || num_threads < 1) {
+    usage();
     SetConsoleOutputCodePage(codepage);
     return 0;
   }
 
-  std::string fileName(argv[1]);
+  std::string fileName(args[0]);
   rime::Table table(fileName);
   bool success = table.Load();
   if (!success) {
@@ -97,12 +250,27 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  int begin = 0;
+  int end = table.metadata()->num_syllables;
+  if (!syllable.empty()) {
+    // up to the smallest spelling after it
+    find_range(&table, syllable, syllable + '\0', &begin, &end);
+    if (begin == end || table.GetSyllableById(begin) != syllable) {
+      std::cerr << "Syllable not found: " << syllable << std::endl;
+      SetConsoleOutputCodePage(codepage);
+      return 1;
+    }
+  } else if (filtered) {
+    find_range(&table, from, to, &begin, &end);
+  }
+
   // Remove the extension ".table.bin" if present.
   const size_t table_bin_idx = fileName.rfind(".table.bin");
   if (std::string::npos != table_bin_idx) {
     fileName.erase(table_bin_idx);
   }
-  const std::string outputName = (argc == 3) ? argv[2] : fileName + ".yaml";
+  const std::string outputName =
+      (args.size() == 2) ? args[1] : fileName + ".yaml";
 
   std::ofstream fout;
   fout.open(outputName);
@@ -124,7 +292,7 @@ int main(int argc, char* argv[]) {
        << "\n"
           "version: \"1.0\"\n"
           "...\n\n";
-  traversal(&table, fout);
+  traversal(&table, begin, end, num_threads, fout);
   std::cout << "Save to: " << outputName << std::endl;
   fout.close();
   SetConsoleOutputCodePage(codepage);